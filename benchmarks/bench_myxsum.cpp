@@ -0,0 +1,212 @@
+//
+// Copyright (c) 2020, Regents of the University of Minnesota.
+// All rights reserved.
+//
+// Contributors:
+//    Yaser Afshar
+//
+// Brief: Timing of the MPI reductions for exact summation.
+//
+//        Usage: mpirun -np N bench_myxsum [n1 n2 ...]
+//
+//        Times MPI_Allreduce, MPI_Reduce, and MPI_Scan on arrays of n small
+//        or large accumulators with the XSUM op of myxsum.hpp, and on arrays
+//        of n doubles with MPI_SUM, for each length n (1 to 1e5 by default).
+//        Each accumulator of each rank holds one value in [-1, 1).  Only the
+//        collective call is timed, not filling or rounding the accumulators.
+//        The time of a case is the mean over repetitions of the slowest rank.
+//        Cases whose buffers would take more than MAX_BYTES on a rank (large
+//        accumulators are 42 kB each) are left out.
+//
+//        Rank 0 prints the results as JSON.  For each case, "overhead" is its
+//        time over that of MPI_SUM on doubles for the same call and length,
+//        the cost of a reproducible result.
+//
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../xsum/myxsum.hpp"
+#include "../xsum/xsum.hpp"
+
+using namespace xsum;
+
+/* Minimum time spent on each case, in seconds */
+constexpr double MIN_TIME = 0.25;
+
+/* Maximum size of a send or receive buffer on a rank, in bytes */
+constexpr std::size_t MAX_BYTES = std::size_t(1) << 26;
+
+/* Default lengths */
+std::vector<int> const default_sizes = {1, 10, 100, 1000, 10000, 100000};
+
+enum class collective { allreduce, reduce, scan };
+
+char const *const collective_names[] = {"allreduce", "reduce", "scan"};
+
+/* Call the collective on n elements */
+void call(collective const c, void const *send, void *recv, int const n,
+          MPI_Datatype const type, MPI_Op const op) {
+  switch (c) {
+    case collective::allreduce:
+      MPI_Allreduce(send, recv, n, type, op, MPI_COMM_WORLD);
+      break;
+    case collective::reduce:
+      MPI_Reduce(send, recv, n, type, op, 0, MPI_COMM_WORLD);
+      break;
+    case collective::scan:
+      MPI_Scan(send, recv, n, type, op, MPI_COMM_WORLD);
+      break;
+  }
+}
+
+/* Mean time of one call on the slowest rank, in seconds */
+double time_call(collective const c, void const *send, void *recv, int const n,
+                 MPI_Datatype const type, MPI_Op const op, int &reps) {
+  /* Warm up, and find how many repetitions fill MIN_TIME on every rank */
+  call(c, send, recv, n, type, op);
+  MPI_Barrier(MPI_COMM_WORLD);
+  double t = MPI_Wtime();
+  call(c, send, recv, n, type, op);
+  t = MPI_Wtime() - t;
+  MPI_Allreduce(MPI_IN_PLACE, &t, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+  reps = std::max(3, static_cast<int>(MIN_TIME / std::max(t, 1e-9)));
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  t = MPI_Wtime();
+  for (int r = 0; r < reps; ++r) {
+    call(c, send, recv, n, type, op);
+  }
+  t = MPI_Wtime() - t;
+  MPI_Allreduce(MPI_IN_PLACE, &t, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+  return t / reps;
+}
+
+int main(int argc, char **argv) {
+  MPI_Init(&argc, &argv);
+
+  int world_size;
+  MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+  int world_rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+
+  std::vector<int> sizes;
+  for (int i = 1; i < argc; ++i) {
+    sizes.push_back(static_cast<int>(std::atof(argv[i])));
+  }
+  if (sizes.empty()) {
+    sizes = default_sizes;
+  }
+
+  MPI_Datatype small_mpi = create_mpi_type<xsum_small_accumulator>();
+  MPI_Datatype large_mpi = create_mpi_type<xsum_large_accumulator>();
+  MPI_Op small_op = create_XSUM<xsum_small_accumulator>();
+  MPI_Op large_op = create_XSUM<xsum_large_accumulator>();
+
+  std::mt19937_64 gen(world_rank + 1);
+  std::uniform_real_distribution<double> u(-1.0, 1.0);
+
+  if (world_rank == 0) {
+    int version, subversion;
+    MPI_Get_version(&version, &subversion);
+    std::printf("{\n");
+    std::printf("  \"benchmark\": \"bench_myxsum\",\n");
+    std::printf("  \"ranks\": %d,\n", world_size);
+    std::printf("  \"mpi_version\": \"%d.%d\",\n", version, subversion);
+    std::printf("  \"min_time\": %g,\n", MIN_TIME);
+    std::printf("  \"results\": [");
+  }
+
+  bool first = true;
+  for (int const n : sizes) {
+    std::vector<double> dsend(n), drecv(n);
+    for (auto &x : dsend) {
+      x = u(gen);
+    }
+
+    std::size_t const small_bytes = n * sizeof(xsum_small_accumulator);
+    std::size_t const large_bytes = n * sizeof(xsum_large_accumulator);
+
+    std::vector<xsum_small_accumulator> ssend, srecv;
+    if (small_bytes <= MAX_BYTES) {
+      ssend.resize(n);
+      srecv.resize(n);
+      for (int i = 0; i < n; ++i) {
+        xsum_add(&ssend[i], dsend[i]);
+      }
+    }
+
+    std::vector<xsum_large_accumulator> lsend, lrecv;
+    if (large_bytes <= MAX_BYTES) {
+      lsend.resize(n);
+      lrecv.resize(n);
+      for (int i = 0; i < n; ++i) {
+        xsum_add(&lsend[i], dsend[i]);
+      }
+    }
+
+    for (collective const c :
+         {collective::allreduce, collective::reduce, collective::scan}) {
+      struct bench_case {
+        char const *type;
+        void const *send;
+        void *recv;
+        MPI_Datatype mpi_type;
+        MPI_Op op;
+        std::size_t bytes;
+        bool run;
+      };
+      bench_case const cases[] = {
+          {"double", dsend.data(), drecv.data(), MPI_DOUBLE, MPI_SUM,
+           n * sizeof(double), true},
+          {"small", ssend.data(), srecv.data(), small_mpi, small_op,
+           small_bytes, !ssend.empty()},
+          {"large", lsend.data(), lrecv.data(), large_mpi, large_op,
+           large_bytes, !lsend.empty()},
+      };
+
+      double base = 0;
+      for (auto const &b : cases) {
+        if (!b.run) {
+          continue;
+        }
+        int reps;
+        double const t =
+            time_call(c, b.send, b.recv, n, b.mpi_type, b.op, reps);
+        if (base == 0) {
+          base = t;
+        }
+        if (world_rank == 0) {
+          std::printf(
+              "%s\n    {\"op\": \"%s\", \"type\": \"%s\", \"n\": %d, "
+              "\"bytes\": %zu, \"reps\": %d, \"time_us\": %.3f, "
+              "\"ns_per_element\": %.3f, \"bandwidth_MBps\": %.1f, "
+              "\"overhead\": %.2f}",
+              first ? "" : ",", collective_names[static_cast<int>(c)], b.type,
+              n, b.bytes, reps, 1e6 * t, 1e9 * t / n, 1e-6 * b.bytes / t,
+              t / base);
+          first = false;
+        }
+      }
+    }
+  }
+
+  if (world_rank == 0) {
+    std::printf("\n  ]\n}\n");
+  }
+
+  destroy_XSUM(small_op);
+  destroy_XSUM(large_op);
+  destroy_mpi_type(small_mpi);
+  destroy_mpi_type(large_mpi);
+
+  MPI_Finalize();
+  return 0;
+}
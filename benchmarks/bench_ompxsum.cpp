@@ -0,0 +1,147 @@
+//
+// Copyright (c) 2020, Regents of the University of Minnesota.
+// All rights reserved.
+//
+// Contributors:
+//    Yaser Afshar
+//
+// Brief: Timing of the OpenMP reductions for exact summation.
+//
+//        Usage: bench_ompxsum [n1 n2 ...]
+//
+//        Compares the user-defined reductions of ompxsum.hpp with the usual
+//        hand-written alternative, an array with one accumulator per thread
+//        that is merged by one thread after the parallel region, and with a
+//        plain (inexact) double reduction.  The values are in [-1, 1).  The
+//        reported time is the best of several repetitions, in nanoseconds per
+//        term.  Set OMP_NUM_THREADS to change the number of threads.
+//
+
+#include <omp.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../xsum/ompxsum.hpp"
+#include "../xsum/xsum.hpp"
+
+using namespace xsum;
+
+/* Minimum time spent on each case, in seconds */
+constexpr double MIN_TIME = 0.25;
+
+/* Default lengths */
+std::vector<xsum_length> const default_sizes = {1000, 100000, 10000000};
+
+struct bench_case {
+  std::string name;
+  std::function<double(double const *, xsum_length)> run;
+};
+
+std::vector<bench_case> const cases = {
+    {"double_for",
+     [](double const *a, xsum_length const n) {
+       double s = 0;
+#pragma omp parallel for reduction(+ : s)
+       for (xsum_length i = 0; i < n; ++i) {
+         s += a[i];
+       }
+       return s;
+     }},
+    {"small_for",
+     [](double const *a, xsum_length const n) {
+       xsum_small_accumulator sacc;
+#pragma omp parallel for reduction(xsum_small : sacc)
+       for (xsum_length i = 0; i < n; ++i) {
+         xsum_add(&sacc, a[i]);
+       }
+       return xsum_round(&sacc);
+     }},
+    {"large_for",
+     [](double const *a, xsum_length const n) {
+       xsum_large_accumulator lacc;
+#pragma omp parallel for reduction(xsum_large : lacc)
+       for (xsum_length i = 0; i < n; ++i) {
+         xsum_add(&lacc, a[i]);
+       }
+       return xsum_round(&lacc);
+     }},
+    {"large_block",
+     [](double const *a, xsum_length const n) {
+       xsum_large_accumulator lacc;
+#pragma omp parallel reduction(xsum_large : lacc)
+       {
+         xsum_length const nt = omp_get_num_threads();
+         xsum_length const t = omp_get_thread_num();
+         xsum_length const i1 = n * t / nt;
+         xsum_length const i2 = n * (t + 1) / nt;
+         xsum_add(&lacc, a + i1, i2 - i1);
+       }
+       return xsum_round(&lacc);
+     }},
+    {"large_array",
+     [](double const *a, xsum_length const n) {
+       std::vector<xsum_large_accumulator> laccs(omp_get_max_threads());
+#pragma omp parallel
+       {
+         xsum_length const nt = omp_get_num_threads();
+         xsum_length const t = omp_get_thread_num();
+         xsum_length const i1 = n * t / nt;
+         xsum_length const i2 = n * (t + 1) / nt;
+         xsum_add(&laccs[t], a + i1, i2 - i1);
+       }
+       for (std::size_t t = 1; t < laccs.size(); ++t) {
+         xsum_add(&laccs[0], &laccs[t]);
+       }
+       return xsum_round(&laccs[0]);
+     }},
+};
+
+int main(int argc, char **argv) {
+  std::vector<xsum_length> sizes;
+  for (int i = 1; i < argc; ++i) {
+    sizes.push_back(static_cast<xsum_length>(std::atof(argv[i])));
+  }
+  if (sizes.empty()) {
+    sizes = default_sizes;
+  }
+
+  std::printf("# threads=%d\n", omp_get_max_threads());
+  std::printf("%-16s %12s %10s\n", "# kernel", "n", "ns/term");
+
+  std::mt19937_64 gen(1);
+  std::uniform_real_distribution<double> u(-1.0, 1.0);
+
+  for (xsum_length const n : sizes) {
+    std::vector<double> a(n);
+    for (auto &x : a) {
+      x = u(gen);
+    }
+
+    for (auto const &c : cases) {
+      double best = 1e300;
+      double spent = 0;
+      volatile double sink = 0;
+      int rep = 0;
+      while (spent < MIN_TIME || rep < 3) {
+        auto const t1 = std::chrono::steady_clock::now();
+        sink = sink + c.run(a.data(), n);
+        auto const t2 = std::chrono::steady_clock::now();
+        double const t = std::chrono::duration<double>(t2 - t1).count();
+        best = std::min(best, t);
+        spent += t;
+        ++rep;
+      }
+      std::printf("%-16s %12ld %10.3f\n", c.name.c_str(), static_cast<long>(n),
+                  1e9 * best / n);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,269 @@
+//
+// Copyright (c) 2020, Regents of the University of Minnesota.
+// All rights reserved.
+//
+// Contributors:
+//    Yaser Afshar
+//
+// Brief: Timing of the vector functions for exact summation.
+//
+//        Usage: bench_xsum [n1 n2 ...]
+//
+//        Each kernel is timed on three data sets, "narrow" with values in
+//        [-1, 1) which touch a handful of chunks, "wide" with random
+//        exponents over most of the double range which scatter over the
+//        chunks of the large accumulator, and "integer" with whole numbers
+//        up to a billion, which take the integer fast path.  The data come from
+//        misc/workload.hpp; if XSUM_WORKLOAD_CACHE names a directory, they
+//        are generated once and mapped from files there.  The reported time
+//        is the best of several repetitions, in nanoseconds per term.  Build
+//        options that change the kernels (see README.md) are printed in the
+//        header, so that the output of differently compiled binaries can be
+//        compared.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "../xsum/adaptxsum.hpp"
+#include "../xsum/misc/workload.hpp"
+#include "../xsum/xsum.hpp"
+
+using namespace xsum;
+
+/* Minimum time spent on each case, in seconds */
+constexpr double MIN_TIME = 0.25;
+
+/* Default lengths, the last one is well beyond the last level cache */
+std::vector<xsum_length> const default_sizes = {1000, 100000, 10000000,
+                                                33554432};
+
+struct bench_case {
+  std::string name;
+  std::function<double(double const *, double const *, xsum_length)> run;
+};
+
+std::vector<bench_case> const cases = {
+    {"double_add",
+     [](double const *a, double const *, xsum_length const n) {
+       double s = 0;
+       for (xsum_length i = 0; i < n; ++i) {
+         s += a[i];
+       }
+       return s;
+     }},
+    {"small_add",
+     [](double const *a, double const *, xsum_length const n) {
+       xsum_small_accumulator sacc;
+       xsum_add(&sacc, a, n);
+       return xsum_round(&sacc);
+     }},
+    {"large_add",
+     [](double const *a, double const *, xsum_length const n) {
+       xsum_large_accumulator lacc;
+       xsum_add(&lacc, a, n);
+       return xsum_round(&lacc);
+     }},
+    {"small_sqnorm",
+     [](double const *a, double const *, xsum_length const n) {
+       xsum_small_accumulator sacc;
+       xsum_add_sqnorm(&sacc, a, n);
+       return xsum_round(&sacc);
+     }},
+    {"small_dot",
+     [](double const *a, double const *b, xsum_length const n) {
+       xsum_small_accumulator sacc;
+       xsum_add_dot(&sacc, a, b, n);
+       return xsum_round(&sacc);
+     }},
+    {"small_add1",
+     [](double const *a, double const *, xsum_length const n) {
+       xsum_small_accumulator sacc;
+       for (xsum_length i = 0; i < n; ++i) {
+         xsum_add(&sacc, a[i]);
+       }
+       return xsum_round(&sacc);
+     }},
+    {"small_buffered",
+     [](double const *a, double const *, xsum_length const n) {
+       xsum_buffered<xsum_small_accumulator> bsacc;
+       for (xsum_length i = 0; i < n; ++i) {
+         bsacc.add(a[i]);
+       }
+       return bsacc.round();
+     }},
+    {"large_add1",
+     [](double const *a, double const *, xsum_length const n) {
+       xsum_large_accumulator lacc;
+       for (xsum_length i = 0; i < n; ++i) {
+         xsum_add(&lacc, a[i]);
+       }
+       return xsum_round(&lacc);
+     }},
+    {"large_buffered",
+     [](double const *a, double const *, xsum_length const n) {
+       xsum_buffered<xsum_large_accumulator> blacc;
+       for (xsum_length i = 0; i < n; ++i) {
+         blacc.add(a[i]);
+       }
+       return blacc.round();
+     }},
+    {"large_sqnorm",
+     [](double const *a, double const *, xsum_length const n) {
+       xsum_large_accumulator lacc;
+       xsum_add_sqnorm(&lacc, a, n);
+       return xsum_round(&lacc);
+     }},
+    {"large_dot",
+     [](double const *a, double const *b, xsum_length const n) {
+       xsum_large_accumulator lacc;
+       xsum_add_dot(&lacc, a, b, n);
+       return xsum_round(&lacc);
+     }},
+    {"window_add",
+     [](double const *a, double const *, xsum_length const n) {
+       xsum_window_accumulator wacc;
+       xsum_add(&wacc, a, n);
+       return xsum_round(&wacc);
+     }},
+    {"window_dot",
+     [](double const *a, double const *b, xsum_length const n) {
+       xsum_window_accumulator wacc;
+       xsum_add_dot(&wacc, a, b, n);
+       return xsum_round(&wacc);
+     }},
+#ifdef __SIZEOF_INT128__
+    {"small128_add",
+     [](double const *a, double const *, xsum_length const n) {
+       xsum_small128_accumulator sacc;
+       xsum_add(&sacc, a, n);
+       return xsum_round(&sacc);
+     }},
+    {"large128_add",
+     [](double const *a, double const *, xsum_length const n) {
+       xsum_large128_accumulator lacc;
+       xsum_add(&lacc, a, n);
+       return xsum_round(&lacc);
+     }},
+    {"large128_dot",
+     [](double const *a, double const *b, xsum_length const n) {
+       xsum_large128_accumulator lacc;
+       xsum_add_dot(&lacc, a, b, n);
+       return xsum_round(&lacc);
+     }},
+#endif
+    {"bounded_add",
+     [](double const *a, double const *, xsum_length const n) {
+       xsum_bounded_accumulator<-64, 0> bacc;
+       xsum_add(&bacc, a, n);
+       return xsum_round(&bacc);
+     }},
+    {"bounded_dot",
+     [](double const *a, double const *b, xsum_length const n) {
+       xsum_bounded_accumulator<-64, 0> bacc;
+       xsum_add_dot(&bacc, a, b, n);
+       return xsum_round(&bacc);
+     }},
+    {"binned2_add",
+     [](double const *a, double const *, xsum_length const n) {
+       xsum_binned_accumulator bacc(2);
+       xsum_add(&bacc, a, n);
+       return xsum_round(&bacc);
+     }},
+    {"binned_add",
+     [](double const *a, double const *, xsum_length const n) {
+       xsum_binned_accumulator bacc;
+       xsum_add(&bacc, a, n);
+       return xsum_round(&bacc);
+     }},
+    {"binned_dot",
+     [](double const *a, double const *b, xsum_length const n) {
+       xsum_binned_accumulator bacc;
+       xsum_add_dot(&bacc, a, b, n);
+       return xsum_round(&bacc);
+     }},
+    {"adapt_add",
+     [](double const *a, double const *, xsum_length const n) {
+       return xsum_sum_adaptive(a, n);
+     }},
+    {"adapt_dot",
+     [](double const *a, double const *b, xsum_length const n) {
+       return xsum_dot_adaptive(a, b, n);
+     }},
+    {"adapt_add_conc",
+     [](double const *a, double const *, xsum_length const n) {
+       return xsum_sum_adaptive(a, n, xsum_adapt_policy::concurrent);
+     }},
+};
+
+/* Parameters of data set data for operand seed */
+xsum_workload_params params(std::string const &data, unsigned const seed) {
+  xsum_workload_params p;
+  /* squares and products of wide values must stay finite */
+  p.kind = data == "narrow"    ? xsum_workload_kind::uniform
+           : data == "integer" ? xsum_workload_kind::integer
+                               : xsum_workload_kind::wide;
+  p.seed = seed;
+  return p;
+}
+
+int main(int argc, char **argv) {
+  std::vector<xsum_length> sizes;
+  for (int i = 1; i < argc; ++i) {
+    sizes.push_back(static_cast<xsum_length>(std::atof(argv[i])));
+  }
+  if (sizes.empty()) {
+    sizes = default_sizes;
+  }
+
+  std::printf("# prefetch add=%d sqnorm=%d dot=%d, stream threshold=%ld\n",
+              XSUM_PREFETCH_ADD, XSUM_PREFETCH_SQNORM, XSUM_PREFETCH_DOT,
+              static_cast<long>(XSUM_STREAM_THRESHOLD));
+#ifdef XSUM_LARGE_INTERLEAVED
+  std::printf("# large accumulator layout: interleaved chunk/count\n");
+#else
+  std::printf("# large accumulator layout: separate chunk and count arrays\n");
+#endif
+  std::printf("# small carry budget=%d, large count bits=%d\n",
+              XSUM_SMALL_CARRY_TERMS, XSUM_LCOUNT_BITS);
+  std::printf("# integer block=%ld\n",
+              static_cast<long>(XSUM_INTEGER_BLOCK_SIZE));
+  std::printf("%-16s %-8s %12s %10s\n", "# kernel", "data", "n", "ns/term");
+
+  char const *const cache = std::getenv("XSUM_WORKLOAD_CACHE");
+
+  for (std::string const data : {"narrow", "wide", "integer"}) {
+    for (xsum_length const n : sizes) {
+      xsum_workload const wa(n, params(data, 1), cache ? cache : "");
+      xsum_workload const wb(n, params(data, 2), cache ? cache : "");
+      double const *a = wa.data();
+      double const *b = wb.data();
+
+      for (auto const &c : cases) {
+        double best = 1e300;
+        double spent = 0;
+        volatile double sink = 0;
+        int rep = 0;
+        while (spent < MIN_TIME || rep < 3) {
+          auto const t1 = std::chrono::steady_clock::now();
+          sink = sink + c.run(a, b, n);
+          auto const t2 = std::chrono::steady_clock::now();
+          double const t = std::chrono::duration<double>(t2 - t1).count();
+          best = std::min(best, t);
+          spent += t;
+          ++rep;
+        }
+        std::printf("%-16s %-8s %12ld %10.3f\n", c.name.c_str(), data.c_str(),
+                    static_cast<long>(n), 1e9 * best / n);
+      }
+    }
+  }
+
+  return 0;
+}
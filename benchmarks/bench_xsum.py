@@ -0,0 +1,256 @@
+#
+# Copyright (c) 2020, Regents of the University of Minnesota.
+# All rights reserved.
+#
+# Contributors:
+#    Yaser Afshar
+#
+# Brief: Timing of the Python bindings for exact summation.
+#
+#        Usage: python benchmarks/bench_xsum.py [n1 n2 ...] [--threads T]
+#
+#        Times the accumulators (xsum_small_accumulator, xsum_large_accumulator
+#        with the free functions, and the xsum_small and xsum_large classes)
+#        through the bindings, against math.fsum, numpy.sum, and a Kahan loop,
+#        for each length n (1 to 1e6 by default).  The values are uniform in
+#        [-1, 1), and are passed as float64, float32, and int64 arrays, which
+#        the bindings convert, and as contiguous, strided (every other element)
+#        and reversed views, which they copy.  The time of a case is the best
+#        of several repetitions.
+#
+#        The output is JSON.  For each case, "overhead" is its time over that
+#        of the same kernel on a contiguous float64 array of the same length,
+#        the cost of the conversion or copy, and "exact" tells whether the
+#        result is the same as math.fsum.  Per-call overhead is the time of the
+#        cases of length 1.  The "threads" entries time T threads each summing
+#        its own array, and "speedup" is T times the time of one thread over
+#        that of T threads, about 1 when the bindings hold the GIL.
+#
+
+import argparse
+import json
+import math
+import platform
+import sys
+import threading
+import time
+
+import numpy as np
+
+try:
+    from xsum import (xsum_add, xsum_add_dot, xsum_large,
+                      xsum_large_accumulator, xsum_round, xsum_small,
+                      xsum_small_accumulator)
+except ImportError:
+    raise Exception('Failed to import `xsum` module')
+
+# Minimum time spent on each repetition of a case, in seconds
+MIN_TIME = 0.05
+
+# Number of repetitions of each case, of which the best is kept
+REPEATS = 5
+
+# Default lengths
+DEFAULT_SIZES = [1, 100, 10000, 1000000]
+
+# Longest array summed by the loops in Python, which are slow
+MAX_LOOP = 100000
+
+DTYPES = ['float64', 'float32', 'int64']
+
+LAYOUTS = ['contiguous', 'strided', 'reversed']
+
+
+def kahan(a):
+    """Kahan compensated sum of the elements of a, in a Python loop."""
+    s = 0.0
+    c = 0.0
+    for x in a.tolist():
+        y = x - c
+        t = s + y
+        c = (t - s) - y
+        s = t
+    return s
+
+
+def small_add(a, b):
+    sacc = xsum_small_accumulator()
+    xsum_add(sacc, a)
+    return xsum_round(sacc)
+
+
+def large_add(a, b):
+    lacc = xsum_large_accumulator()
+    xsum_add(lacc, a)
+    return xsum_round(lacc)
+
+
+def large_dot(a, b):
+    lacc = xsum_large_accumulator()
+    xsum_add_dot(lacc, a, b)
+    return xsum_round(lacc)
+
+
+def small_class(a, b):
+    sacc = xsum_small()
+    sacc.add(a)
+    return sacc.round()
+
+
+def large_class(a, b):
+    lacc = xsum_large()
+    lacc.add(a)
+    return lacc.round()
+
+
+def small_add1(a, b):
+    """One call of the bindings per value."""
+    sacc = xsum_small_accumulator()
+    for x in a.tolist():
+        xsum_add(sacc, x)
+    return xsum_round(sacc)
+
+
+# Name, function of two arrays, exact result (sum or dot product), and whether
+# it loops in Python
+CASES = [
+    ('numpy_sum', lambda a, b: float(np.sum(a)), 'sum', False),
+    ('numpy_dot', lambda a, b: float(np.dot(a, b)), 'dot', False),
+    ('fsum', lambda a, b: math.fsum(a), 'sum', False),
+    ('kahan', lambda a, b: kahan(a), 'sum', True),
+    ('small_add', small_add, 'sum', False),
+    ('large_add', large_add, 'sum', False),
+    ('large_dot', large_dot, 'dot', False),
+    ('small_class', small_class, 'sum', False),
+    ('large_class', large_class, 'sum', False),
+    ('small_add1', small_add1, 'sum', True),
+]
+
+
+def best_time(f, a, b):
+    """Best time of one call of f(a, b) over the repetitions, and the # of
+    calls timed in each."""
+    f(a, b)
+    reps = 1
+    while True:
+        t = time.perf_counter()
+        for _ in range(reps):
+            f(a, b)
+        t = time.perf_counter() - t
+        if t >= MIN_TIME:
+            break
+        reps = reps * 2 if t <= 0 else max(reps * 2,
+                                          int(reps * MIN_TIME / t) + 1)
+    best = t / reps
+    for _ in range(REPEATS - 1):
+        t = time.perf_counter()
+        for _ in range(reps):
+            f(a, b)
+        best = min(best, (time.perf_counter() - t) / reps)
+    return best, reps
+
+
+def make_array(values, dtype, layout):
+    """The values as an array of dtype, with the layout."""
+    if dtype == 'int64':
+        values = np.round(values * (1 << 20))
+    if layout == 'contiguous':
+        return np.ascontiguousarray(values, dtype=dtype)
+    if layout == 'strided':
+        a = np.zeros(2 * len(values), dtype=dtype)
+        a[::2] = values
+        return a[::2]
+    return np.ascontiguousarray(values[::-1], dtype=dtype)[::-1]
+
+
+def time_threads(f, arrays):
+    """Time of f on each array, each in a thread of its own."""
+    def run(a):
+        for _ in range(REPEATS):
+            f(a, a)
+
+    threads = [threading.Thread(target=run, args=(a, )) for a in arrays]
+    t = time.perf_counter()
+    for th in threads:
+        th.start()
+    for th in threads:
+        th.join()
+    return (time.perf_counter() - t) / REPEATS
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Timing of the Python bindings for exact summation.')
+    parser.add_argument('sizes', nargs='*', type=float,
+                        help='lengths of the arrays (default: %s)' %
+                        ' '.join(str(n) for n in DEFAULT_SIZES))
+    parser.add_argument('--threads', type=int, default=4,
+                        help='# of threads for the GIL check (default: 4)')
+    args = parser.parse_args()
+
+    sizes = [int(n) for n in args.sizes] or DEFAULT_SIZES
+
+    rng = np.random.default_rng(1)
+
+    results = []
+    for n in sizes:
+        values = rng.uniform(-1.0, 1.0, n)
+        other = rng.uniform(-1.0, 1.0, n)
+        for name, f, kind, loop in CASES:
+            if loop and n > MAX_LOOP:
+                continue
+            base = None
+            for dtype in DTYPES:
+                for layout in LAYOUTS:
+                    a = make_array(values, dtype, layout)
+                    b = make_array(other, dtype, layout)
+                    t, reps = best_time(f, a, b)
+                    if base is None:
+                        base = t
+                    a64 = a.astype(np.float64)
+                    if kind == 'sum':
+                        exact = math.fsum(a64)
+                    else:
+                        exact = math.fsum(a64 * b.astype(np.float64))
+                    results.append({
+                        'kernel': name,
+                        'dtype': dtype,
+                        'layout': layout,
+                        'n': n,
+                        'reps': reps,
+                        'time_us': round(1e6 * t, 3),
+                        'ns_per_term': round(1e9 * t / n, 3),
+                        'overhead': round(t / base, 2),
+                        'exact': f(a, b) == exact,
+                    })
+
+    threads = []
+    n = max(sizes)
+    arrays = [rng.uniform(-1.0, 1.0, n) for _ in range(args.threads)]
+    for name, f, kind, loop in CASES:
+        if loop and n > MAX_LOOP:
+            continue
+        t1 = time_threads(f, arrays[:1])
+        tn = time_threads(f, arrays)
+        threads.append({
+            'kernel': name,
+            'n': n,
+            'threads': args.threads,
+            'time_us': round(1e6 * tn, 3),
+            'speedup': round(args.threads * t1 / tn, 2),
+        })
+
+    json.dump({
+        'benchmark': 'bench_xsum.py',
+        'python': platform.python_version(),
+        'numpy': np.__version__,
+        'min_time': MIN_TIME,
+        'repeats': REPEATS,
+        'results': results,
+        'threads': threads,
+    }, sys.stdout, indent=2)
+    sys.stdout.write('\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,178 @@
+//
+// Copyright (c) 2020, Regents of the University of Minnesota.
+// All rights reserved.
+//
+// Contributors:
+//    Yaser Afshar
+//
+
+// CORRECTNESS CHECKS FOR THE ADAPTIVE EXACT SUM
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "../xsum/adaptxsum.hpp"
+#include "../xsum/xsum.hpp"
+
+using namespace xsum;
+
+int different(double const a, double const b) {
+  return (std::isnan(a) != std::isnan(b)) ||
+         (!std::isnan(a) && !std::isnan(b) &&
+          (a != b || std::signbit(a) != std::signbit(b)));
+}
+
+void result(double const r, double const s, const char *test) {
+  if (different(r, s)) {
+    std::printf(" \n-- %s\n", test);
+    std::printf("   ANSWER: %.16le\n", s);
+    std::printf("Result incorrect %.16le != %.16le\n", r, s);
+  }
+}
+
+void check(bool const ok, const char *test) {
+  if (!ok) {
+    std::printf(" \n-- %s\n", test);
+    std::printf("Check failed\n");
+  }
+}
+
+/* Exact sum, and exact sum of the products, correctly rounded */
+double exact(std::vector<double> const &v) {
+  xsum_small_accumulator sacc;
+  xsum_add(&sacc, v);
+  return xsum_round(&sacc);
+}
+
+double exact_dot(std::vector<double> const &v, std::vector<double> const &w) {
+  xsum_small_accumulator sacc;
+  xsum_add_dot(&sacc, v, w);
+  return xsum_round(&sacc);
+}
+
+/* Values in [-1, 1) times 2^e, e in [emin, emin + erange) */
+std::vector<double> values(int const n, int const emin, int const erange,
+                           unsigned long long r) {
+  std::vector<double> v(n);
+  for (auto &x : v) {
+    r ^= r << 13;
+    r ^= r >> 7;
+    r ^= r << 17;
+    double const f = static_cast<double>(r >> 11) / 4503599627370496.0 - 1;
+    x = std::ldexp(f, emin + static_cast<int>(r % erange));
+  }
+  return v;
+}
+
+int main() {
+  std::cout << "\nCORRECTNESS ADAPTIVE SUM TESTS\n";
+
+  std::cout << "A: well-conditioned sums need no fallback\n";
+
+  {
+    xsum_adapt_stats stats;
+    for (int n : {1, 2, 15, 16, 17, 1000, 100003}) {
+      std::vector<double> const v = values(n, 0, 40, 88172645463325252ULL + n);
+      std::vector<double> const w = values(n, -20, 40, 1234567ULL + n);
+      /* Positive, so that nothing cancels */
+      std::vector<double> p(v);
+      for (auto &x : p) {
+        x = std::fabs(x) + 1;
+      }
+
+      /* The sum of two values of the same binade is often a tie */
+      double r;
+      check(xsum_compensated_sum(p.data(), n, &r) || n < 3, "Test 1");
+      result(r, exact(p), "Test 2");
+      result(xsum_sum_adaptive(p, xsum_adapt_policy::rerun, &stats), exact(p),
+             "Test 3");
+      result(xsum_sum_adaptive(v, xsum_adapt_policy::rerun, &stats), exact(v),
+             "Test 4");
+      result(xsum_dot_adaptive(v, w, xsum_adapt_policy::rerun, &stats),
+             exact_dot(v, w), "Test 5");
+      result(xsum_sqnorm_adaptive(v, xsum_adapt_policy::rerun, &stats),
+             exact_dot(v, v), "Test 6");
+    }
+    check(stats.calls == 28 && stats.fallbacks < 3, "Test 7");
+  }
+
+  std::cout << "B: sums the compensated sum does not determine\n";
+
+  {
+    double const inf = std::numeric_limits<double>::infinity();
+    double const nan = std::numeric_limits<double>::quiet_NaN();
+    double const big = std::numeric_limits<double>::max();
+    double const tiny = std::numeric_limits<double>::denorm_min();
+
+    /* Ties, cancellation to zero or to a tiny value, denormals, overflow,
+       and Inf and NaN */
+    std::vector<std::vector<double>> const cases = {
+        {1.0, std::ldexp(1.0, -53)},
+        {1.0, std::ldexp(1.0, -53), std::ldexp(1.0, -106)},
+        {1e300, 1.0, -1e300},
+        {1e300, -1e300, 1e-300},
+        {-0.0, -0.0},
+        {0.5, -0.5},
+        {tiny, 2 * tiny, -tiny},
+        {big, big, -big},
+        {big, big},
+        {-big, -big},
+        {1.0, inf},
+        {inf, -inf},
+        {nan, 1.0},
+    };
+
+    for (auto const &v : cases) {
+      xsum_adapt_stats stats;
+      double r;
+      bool const ok =
+          xsum_compensated_sum(v.data(), static_cast<xsum_length>(v.size()),
+                               &r);
+      check(!ok || !different(r, exact(v)), "Test 8");
+      result(xsum_sum_adaptive(v, xsum_adapt_policy::rerun, &stats), exact(v),
+             "Test 9");
+      result(xsum_sum_adaptive(v, xsum_adapt_policy::concurrent, &stats),
+             exact(v), "Test 10");
+      check(stats.fallbacks == (ok ? 0 : 2), "Test 11");
+    }
+
+    /* A tie is never taken from the compensated sum */
+    double r;
+    check(!xsum_compensated_sum(cases[0].data(), 2, &r), "Test 12");
+  }
+
+  std::cout << "C: policies on long vectors, with and without fallback\n";
+
+  {
+    int const n = 200000;
+    std::vector<double> v = values(n, -30, 60, 2463534242ULL);
+    std::vector<double> const w = values(n, -30, 60, 3141592653ULL);
+
+    xsum_adapt_stats stats;
+    double const s = exact(v);
+    result(xsum_sum_adaptive(v, xsum_adapt_policy::rerun, &stats), s,
+           "Test 13");
+    result(xsum_sum_adaptive(v, xsum_adapt_policy::concurrent, &stats), s,
+           "Test 14");
+    result(xsum_dot_adaptive(v, w, xsum_adapt_policy::concurrent, &stats),
+           exact_dot(v, w), "Test 15");
+    check(stats.calls == 3 && stats.fallbacks == 0, "Test 16");
+
+    /* Cancel the sum down to a value far below the error bound */
+    double naive = 0;
+    for (double const x : v) {
+      naive += x;
+    }
+    v.push_back(-naive);
+    v.push_back(std::ldexp(1.0, -90));
+    double const s2 = exact(v);
+    result(xsum_sum_adaptive(v, xsum_adapt_policy::rerun, &stats), s2,
+           "Test 17");
+    result(xsum_sum_adaptive(v, xsum_adapt_policy::concurrent, &stats), s2,
+           "Test 18");
+    check(stats.calls == 5 && stats.fallbacks == 2, "Test 19");
+  }
+}
@@ -0,0 +1,221 @@
+//
+// Copyright (c) 2020, Regents of the University of Minnesota.
+// All rights reserved.
+//
+// Contributors:
+//    Yaser Afshar
+//
+
+// CORRECTNESS CHECKS FOR THE DELTA ENCODING OF ACCUMULATORS
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "../xsum/deltaxsum.hpp"
+#include "../xsum/xsum.hpp"
+
+using namespace xsum;
+
+int different(double const a, double const b) {
+  return (std::isnan(a) != std::isnan(b)) ||
+         (!std::isnan(a) && !std::isnan(b) && a != b);
+}
+
+void result(double const r, double const s, const char *test) {
+  if (different(r, s)) {
+    std::printf(" \n-- %s\n", test);
+    std::printf("   ANSWER: %.16le\n", s);
+    std::printf("Result incorrect %.16le != %.16le\n", r, s);
+  }
+}
+
+void check(bool const ok, const char *test) {
+  if (!ok) {
+    std::printf(" \n-- %s\n", test);
+    std::printf("Check failed\n");
+  }
+}
+
+/* Whether applying the bytes throws, and then leaves the sum unchanged */
+bool throws(std::vector<unsigned char> const &buf) {
+  xsum_small_accumulator sacc;
+  xsum_add(&sacc, 3.0);
+  try {
+    xsum_apply_delta(&sacc, buf.data(), buf.size());
+  } catch (std::runtime_error const &) {
+    return xsum_round(&sacc) == 3.0;
+  }
+  return false;
+}
+
+int main() {
+  std::cout << "\nCORRECTNESS DELTA ENCODING TESTS\n";
+
+  std::mt19937_64 gen(1);
+  std::uniform_real_distribution<double> u(-1.0, 1.0);
+  std::uniform_int_distribution<int> e(-1000, 1000);
+  std::uniform_int_distribution<int> len(0, 300);
+
+  std::cout << "A: replicas follow a large and a small accumulator\n";
+
+  {
+    xsum_large_accumulator lacc;
+    xsum_small_accumulator sacc;
+    xsum_delta_encoder lenc;
+    xsum_delta_encoder senc;
+    xsum_large_accumulator lrep;
+    xsum_small_accumulator srep;
+    std::vector<unsigned char> buf;
+    for (int k = 0; k < 200; ++k) {
+      /* Batches of values of one magnitude, or of any, or none */
+      int const m = len(gen);
+      int const e0 = k % 3 == 0 ? 0 : e(gen);
+      for (int i = 0; i < m; ++i) {
+        double const x = std::ldexp(u(gen), k % 3 == 2 ? e(gen) : e0);
+        xsum_add(&lacc, x);
+        xsum_add(&sacc, x);
+      }
+      buf.clear();
+      std::size_t const nb = lenc.encode(&lacc, buf);
+      check(nb == buf.size() && (m > 0 || nb == 2), "Test 1");
+      check(xsum_apply_delta(&lrep, buf.data(), buf.size()) == nb, "Test 2");
+      result(xsum_round(&lrep), xsum_round(&lacc), "Test 3");
+
+      buf.clear();
+      senc.encode(&sacc, buf);
+      xsum_apply_delta(&srep, buf.data(), buf.size());
+      result(xsum_round(&srep), xsum_round(&sacc), "Test 4");
+    }
+
+    /* A few values near 1 change a few chunks */
+    buf.clear();
+    xsum_add(&lacc, 1.5);
+    xsum_add(&lacc, 0.25);
+    check(lenc.encode(&lacc, buf) <= 20, "Test 5");
+  }
+
+  std::cout << "B: Inf and NaN, and a rollback that takes them away\n";
+
+  {
+    xsum_large_accumulator lacc;
+    xsum_delta_encoder enc;
+    xsum_large_accumulator rep;
+    std::vector<unsigned char> buf;
+    xsum_add(&lacc, 2.0);
+    enc.encode(&lacc, buf);
+
+    xsum_small_accumulator snap;
+    xsum_snapshot(&lacc, &snap);
+    xsum_add(&lacc, 1.0 / 0.0);
+    xsum_add(&lacc, 5.0);
+    enc.encode(&lacc, buf);
+    xsum_add(&lacc, -1.0 / 0.0);
+    enc.encode(&lacc, buf);
+    std::size_t i = 0;
+    i += xsum_apply_delta(&rep, buf.data() + i, buf.size() - i);
+    i += xsum_apply_delta(&rep, buf.data() + i, buf.size() - i);
+    result(xsum_round(&rep), 1.0 / 0.0, "Test 6");
+    i += xsum_apply_delta(&rep, buf.data() + i, buf.size() - i);
+    check(i == buf.size() && std::isnan(xsum_round(&rep)), "Test 7");
+
+    xsum_rollback(&lacc, &snap);
+    xsum_add(&lacc, 3.0);
+    buf.clear();
+    enc.encode(&lacc, buf);
+    check((buf[1] & XSUM_DELTA_FULL) != 0, "Test 8");
+    xsum_apply_delta(&rep, buf.data(), buf.size());
+    result(xsum_round(&rep), 5.0, "Test 9");
+
+    xsum_add(&lacc, 0.0 / 0.0);
+    buf.clear();
+    enc.encode(&lacc, buf);
+    xsum_apply_delta(&rep, buf.data(), buf.size());
+    check(std::isnan(xsum_round(&rep)), "Test 10");
+    xsum_init(&lacc);
+    buf.clear();
+    enc.encode(&lacc, buf);
+    xsum_apply_delta(&rep, buf.data(), buf.size());
+    result(xsum_round(&rep), 0.0, "Test 11");
+  }
+
+  {
+    xsum_large_accumulator lacc;
+    xsum_delta_encoder enc;
+    xsum_small_accumulator rep;
+    std::vector<unsigned char> buf;
+    xsum_add(&lacc, 1.0 / 0.0);
+    xsum_add(&lacc, 0.0 / 0.0);
+    enc.encode(&lacc, buf);
+    xsum_apply_delta(&rep, buf.data(), buf.size());
+    check(std::isnan(xsum_round(&rep)), "Test 12");
+
+    xsum_small_accumulator snap;
+    xsum_snapshot(&lacc, &snap);
+    xsum_add(&lacc, -1.0 / 0.0);
+    buf.clear();
+    enc.encode(&lacc, buf);
+    xsum_apply_delta(&rep, buf.data(), buf.size());
+    xsum_rollback(&lacc, &snap);
+    xsum_add(&lacc, 2.0);
+    buf.clear();
+    enc.encode(&lacc, buf);
+    xsum_apply_delta(&rep, buf.data(), buf.size());
+    check((buf[1] & XSUM_DELTA_FULL) != 0 && std::isnan(xsum_round(&rep)),
+          "Test 13");
+  }
+
+  std::cout << "C: a full delta, for new replicas and ones behind\n";
+
+  {
+    xsum_large_accumulator lacc;
+    xsum_delta_encoder enc;
+    xsum_small_accumulator behind;
+    std::vector<unsigned char> buf;
+    for (int k = 0; k < 10; ++k) {
+      for (int i = 0; i < 100; ++i) {
+        xsum_add(&lacc, std::ldexp(u(gen), e(gen)));
+      }
+      buf.clear();
+      enc.encode(&lacc, buf);
+      if (k < 5) {
+        xsum_apply_delta(&behind, buf.data(), buf.size());
+      }
+    }
+    enc.reset();
+    buf.clear();
+    enc.encode(&lacc, buf);
+    xsum_small_accumulator fresh;
+    xsum_apply_delta(&fresh, buf.data(), buf.size());
+    xsum_apply_delta(&behind, buf.data(), buf.size());
+    result(xsum_round(&fresh), xsum_round(&lacc), "Test 14");
+    result(xsum_round(&behind), xsum_round(&lacc), "Test 15");
+  }
+
+  std::cout << "D: deltas that are truncated or malformed\n";
+
+  {
+    xsum_small_accumulator sacc;
+    xsum_delta_encoder enc;
+    std::vector<unsigned char> buf;
+    xsum_add(&sacc, 1e300);
+    xsum_add(&sacc, 1e-300);
+    enc.encode(&sacc, buf);
+    check(!throws(buf), "Test 16");
+    for (std::size_t n = 0; n < buf.size(); ++n) {
+      check(throws(std::vector<unsigned char>(buf.begin(), buf.begin() + n)),
+            "Test 17");
+    }
+    check(throws({1, 0, XSUM_SCHUNKS, 2}), "Test 18");
+    check(throws({0, 8}), "Test 19");
+    check(throws({XSUM_SCHUNKS + 1, 0}), "Test 20");
+    /* A chunk of 2^34 */
+    check(throws({1, 0, 3, 0x80, 0x80, 0x80, 0x80, 0x80, 0x01}), "Test 21");
+    check(throws({1, 0, 3, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+                  0x80, 0x80, 0x01}),
+          "Test 22");
+  }
+}
@@ -0,0 +1,143 @@
+//
+// Copyright (c) 2020, Regents of the University of Minnesota.
+// All rights reserved.
+//
+// Contributors:
+//    Yaser Afshar
+//
+
+// CORRECTNESS CHECKS FOR THE MEMORY-MAPPED ARRAY OF ACCUMULATORS
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+
+#include "../xsum/mmapxsum.hpp"
+#include "../xsum/xsum.hpp"
+
+using namespace xsum;
+
+xsum_flt term1[] = {1.234e88, -93.3e-23, 994.33,  1334.3,  457.34, -1.234e88,
+                    93.3e-23, -994.33,   -1334.3, -457.34, 0};
+xsum_flt term2[] = {1.,
+                    -23.,
+                    456.,
+                    -78910.,
+                    1112131415.,
+                    -161718192021.,
+                    22232425262728.,
+                    -2930313233343536.,
+                    373839404142434445.,
+                    -46474849505152535455.,
+                    -46103918342424313856.};
+xsum_flt term3[] = {1.1e-322,
+                    5.3443e-321,
+                    -9.343e-320,
+                    3.33e-314,
+                    4.41e-322,
+                    -8.8e-318,
+                    3.1e-310,
+                    4.1e-300,
+                    -4e-300,
+                    7e-307,
+                    1.0000070031003328e-301};
+
+xsum_flt *terms[] = {term1, term2, term3};
+
+/* # of accumulators in the array, more than fit in a page */
+constexpr std::size_t N = 1000;
+
+char const *const path = "test_mmapxsum.xsum";
+
+int different(double const a, double const b) {
+  return (std::isnan(a) != std::isnan(b)) ||
+         (!std::isnan(a) && !std::isnan(b) && a != b);
+}
+
+void result(double const r, double const s, const char *test) {
+  if (different(r, s)) {
+    std::printf(" \n-- %s\n", test);
+    std::printf("   ANSWER: %.16le\n", s);
+    std::printf("Result incorrect %.16le != %.16le\n", r, s);
+  }
+}
+
+void check(bool const ok, const char *test) {
+  if (!ok) {
+    std::printf(" \n-- %s\n", test);
+    std::printf("Check failed\n");
+  }
+}
+
+/* Whether opening the file with n and mode throws */
+bool throws(char const *file, std::size_t const n, xsum_mmap_mode const mode) {
+  try {
+    xsum_mmap_array a(file, n, mode);
+  } catch (std::runtime_error const &) {
+    return true;
+  }
+  return false;
+}
+
+int main() {
+  std::cout << "\nCORRECTNESS MEMORY-MAPPED ARRAY TESTS\n";
+
+  std::cout << "A: create, add, checkpoint, and reopen read-only\n";
+
+  {
+    xsum_mmap_array a(path, N, xsum_mmap_mode::create);
+    check(a.size() == N, "Test 1");
+    for (std::size_t i = 0; i < N; ++i) {
+      xsum_flt const *t = terms[i % 3];
+      for (int k = 0; k < 10; ++k) {
+        a.add(i, t[k]);
+      }
+    }
+    check(a.checkpoint() == 1, "Test 2");
+  }
+
+  {
+    xsum_mmap_array a(path, 0, xsum_mmap_mode::read_only);
+    check(a.size() == N && a.read_only(), "Test 3");
+    check(a.checkpoints() == 1, "Test 4");
+    for (std::size_t i = 0; i < N; ++i) {
+      result(a.round(i), terms[i % 3][10], "Test 5");
+    }
+  }
+
+  std::cout << "B: reopen, resume, and read from a second mapping\n";
+
+  {
+    xsum_mmap_array a(path, N, xsum_mmap_mode::open);
+    xsum_mmap_array r(path, N, xsum_mmap_mode::read_only);
+    for (std::size_t i = 0; i < N; ++i) {
+      a.add(i, terms[i % 3], 10);
+    }
+    a.sync(0, N / 2);
+    a.sync(N / 2, N, false);
+    for (std::size_t i = 0; i < N; ++i) {
+      result(r.round(i), 2 * terms[i % 3][10], "Test 6");
+    }
+    xsum_small_accumulator sacc = r[N - 1];
+    result(xsum_round(&sacc), 2 * terms[(N - 1) % 3][10], "Test 7");
+    check(a.checkpoint() == 2 && r.checkpoints() == 2, "Test 8");
+  }
+
+  std::cout << "C: files that do not match\n";
+
+  {
+    check(throws(path, N + 1, xsum_mmap_mode::open), "Test 9");
+    check(throws("test_mmapxsum.none", 0, xsum_mmap_mode::open), "Test 10");
+
+    std::FILE *f = std::fopen(path, "r+b");
+    std::fputc('Y', f);
+    std::fclose(f);
+    check(throws(path, 0, xsum_mmap_mode::read_only), "Test 11");
+
+    xsum_mmap_array a(path, 0, xsum_mmap_mode::create);
+    check(a.size() == 0 && a.checkpoints() == 0, "Test 12");
+  }
+
+  std::remove(path);
+}
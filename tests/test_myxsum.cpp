@@ -269,6 +269,55 @@ int main() {
     result(&lacc, term2[10] * 1000, world_rank, "Test 2");
   }
 
+  // Free the created user-op
+  MPI_Op_free(&XSUM);
+  destroy_mpi_type(acc_mpi);
+
+  // Create the MPI data type of the binned accumulator
+  create_mpi_type<xsum_binned_accumulator>(acc_mpi);
+
+  // Create the XSUM user-op
+  create_XSUM<xsum_binned_accumulator>(XSUM);
+
+  if (world_rank == 0) {
+    std::cout << "\nBINNED ACCUMULATOR SUM TESTS\n";
+    std::cout << "A: BINNED ACCUMULATOR, same as the sum on one processor\n";
+  }
+
+  {
+    xsum_flt *terms[] = {term1, term2, term3, term4, term5, term6};
+    for (int fold = 1; fold <= XSUM_BIN_MAX_FOLD; ++fold) {
+      for (int t = 0; t < 6; ++t) {
+        xsum_binned_accumulator bacc(fold);
+        for (int j = 0; j < 100; ++j) {
+          for (int i = 0; i < 10; ++i) {
+            if (((i + j) % world_size) == world_rank) {
+              xsum_add(&bacc, terms[t][i]);
+            }
+          }
+        }
+
+        MPI_Allreduce(MPI_IN_PLACE, &bacc, 1, acc_mpi, XSUM, MPI_COMM_WORLD);
+
+        /* Reversed, on one processor */
+        xsum_binned_accumulator bacc1(fold);
+        for (int j = 0; j < 100; ++j) {
+          for (int i = 9; i >= 0; --i) {
+            xsum_add(&bacc1, terms[t][i]);
+          }
+        }
+
+        double const r = xsum_round(&bacc);
+        double const s = xsum_round(&bacc1);
+        if (different(r, s) || bacc.fold != fold) {
+          std::printf(" \n-- Test %d on processor %d\n", 7 + t, world_rank);
+          std::printf("   ANSWER: %.16le\n", s);
+          std::printf("binned: Result incorrect %.16le != %.16le\n", r, s);
+        }
+      }
+    }
+  }
+
   // Free the created user-op
   MPI_Op_free(&XSUM);
 
@@ -0,0 +1,193 @@
+//
+// Copyright (c) 2020, Regents of the University of Minnesota.
+// All rights reserved.
+//
+// Contributors:
+//    Yaser Afshar
+//
+
+// CORRECTNESS CHECKS FOR THE OPENMP REDUCTIONS FOR EXACT SUMMATION
+
+#include <omp.h>
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+#include "../xsum/ompxsum.hpp"
+#include "../xsum/xsum.hpp"
+
+using namespace xsum;
+
+xsum_flt term1[] = {1.234e88, -93.3e-23, 994.33,  1334.3,  457.34, -1.234e88,
+                    93.3e-23, -994.33,   -1334.3, -457.34, 0};
+xsum_flt term2[] = {1.,
+                    -23.,
+                    456.,
+                    -78910.,
+                    1112131415.,
+                    -161718192021.,
+                    22232425262728.,
+                    -2930313233343536.,
+                    373839404142434445.,
+                    -46474849505152535455.,
+                    -46103918342424313856.};
+xsum_flt term3[] = {1.1e-322,
+                    5.3443e-321,
+                    -9.343e-320,
+                    3.33e-314,
+                    4.41e-322,
+                    -8.8e-318,
+                    3.1e-310,
+                    4.1e-300,
+                    -4e-300,
+                    7e-307,
+                    1.0000070031003328e-301};
+
+/* Repeat factor, so that each thread has many terms */
+constexpr int REP = (1 << 12);
+
+int different(double const a, double const b) {
+  return (std::isnan(a) != std::isnan(b)) ||
+         (!std::isnan(a) && !std::isnan(b) && a != b);
+}
+
+void result(xsum_small_accumulator *const sacc, double const s,
+            const char *test) {
+  double const r = xsum_round(sacc);
+  double const r2 = xsum_round(sacc);
+
+  if (different(r, r2)) {
+    std::printf(" \n-- %s\n", test);
+    std::printf("   ANSWER: %.16le\n", s);
+    std::printf("Different second time %.16le != %.16le\n", r, r2);
+  }
+
+  if (different(r, s)) {
+    std::printf(" \n-- %s\n", test);
+    std::printf("   ANSWER: %.16le\n", s);
+    std::printf("Result incorrect %.16le != %.16le\n", r, s);
+    std::printf("    ");
+    print_binary(r);
+    std::printf("    ");
+    print_binary(s);
+  }
+}
+
+void result(xsum_large_accumulator *const lacc, double const s,
+            const char *test) {
+  result(xsum_round_to_small_ptr(lacc), s, test);
+}
+
+void result(xsum_window_accumulator *const wacc, double const s,
+            const char *test) {
+  result(xsum_round_to_small_ptr(wacc), s, test);
+}
+
+int main() {
+  std::cout << "\nCORRECTNESS OPENMP TESTS ON " << omp_get_max_threads()
+            << " THREADS\n";
+
+  std::cout << "A: parallel for reduction, one term at a time\n";
+
+  {
+    xsum_small_accumulator sacc;
+    xsum_large_accumulator lacc;
+    xsum_window_accumulator wacc;
+
+#pragma omp parallel for reduction(xsum_small : sacc) \
+    reduction(xsum_large : lacc) reduction(xsum_window : wacc)
+    for (int i = 0; i < 10 * REP; ++i) {
+      xsum_add(&sacc, term1[i % 10]);
+      xsum_add(&lacc, term2[i % 10]);
+      xsum_add(&wacc, term3[i % 10]);
+    }
+
+    result(&sacc, term1[10] * REP, "Test 1");
+    result(&lacc, term2[10] * REP, "Test 2");
+    result(&wacc, term3[10] * REP, "Test 3");
+  }
+
+  std::cout << "B: parallel reduction, vector of terms per thread\n";
+
+  {
+    xsum_small_accumulator sacc;
+    xsum_large_accumulator lacc;
+    xsum_window_accumulator wacc;
+
+#pragma omp parallel reduction(xsum_small : sacc) \
+    reduction(xsum_large : lacc) reduction(xsum_window : wacc)
+    {
+#pragma omp for
+      for (int j = 0; j < REP; ++j) {
+        xsum_add(&sacc, term2, 10);
+        xsum_add(&lacc, term3, 10);
+        xsum_add(&wacc, term1, 10);
+      }
+    }
+
+    result(&sacc, term2[10] * REP, "Test 4");
+    result(&lacc, term3[10] * REP, "Test 5");
+    result(&wacc, term1[10] * REP, "Test 6");
+  }
+
+  std::cout << "C: reduction into an accumulator that is not empty\n";
+
+  {
+    xsum_large_accumulator lacc;
+    xsum_add(&lacc, term2, 10);
+
+#pragma omp parallel for reduction(xsum_large : lacc)
+    for (int j = 0; j < REP; ++j) {
+      xsum_add(&lacc, term2, 10);
+    }
+
+    result(&lacc, term2[10] * (REP + 1), "Test 7");
+  }
+
+  std::cout << "D: binned reduction, same as the sum on one thread\n";
+
+  {
+    xsum_flt *terms[] = {term1, term2, term3};
+    for (int t = 0; t < 3; ++t) {
+      xsum_binned_accumulator bacc(2);
+      xsum_binned_accumulator bacc1(2);
+      for (int i = 10 * REP - 1; i >= 0; --i) {
+        xsum_add(&bacc1, terms[t][i % 10]);
+      }
+
+#pragma omp parallel for schedule(dynamic, 7) reduction(xsum_binned : bacc)
+      for (int i = 0; i < 10 * REP; ++i) {
+        xsum_add(&bacc, terms[t][i % 10]);
+      }
+
+      double const r = xsum_round(&bacc);
+      double const s = xsum_round(&bacc1);
+      if (different(r, s) || bacc.fold != 2) {
+        std::printf(" \n-- Test %d\n", 8 + t);
+        std::printf("   ANSWER: %.16le\n", s);
+        std::printf("Result incorrect %.16le != %.16le\n", r, s);
+      }
+    }
+  }
+
+  std::cout << "E: small reduction with adds near the carry budget\n";
+
+  {
+    /* Each thread merges chunks that are not propagated, close to overflow */
+    int const m = XSUM_SMALL_CARRY_BUDGET - 1;
+    xsum_small_accumulator sacc;
+    int nthreads = 0;
+
+#pragma omp parallel num_threads(4) reduction(xsum_small : sacc) \
+    reduction(+ : nthreads)
+    {
+      nthreads = 1;
+      for (int i = 0; i < m; ++i) {
+        xsum_add(&sacc, 1.5);
+      }
+    }
+
+    result(&sacc, 1.5 * m * nthreads, "Test 11");
+  }
+}
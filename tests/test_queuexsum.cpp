@@ -0,0 +1,172 @@
+//
+// Copyright (c) 2020, Regents of the University of Minnesota.
+// All rights reserved.
+//
+// Contributors:
+//    Yaser Afshar
+//
+
+// CORRECTNESS CHECKS FOR THE INGESTION QUEUE FOR EXACT SUMMATION
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../xsum/queuexsum.hpp"
+#include "../xsum/xsum.hpp"
+
+using namespace xsum;
+
+xsum_flt term1[] = {1.234e88, -93.3e-23, 994.33,  1334.3,  457.34, -1.234e88,
+                    93.3e-23, -994.33,   -1334.3, -457.34, 0};
+xsum_flt term2[] = {1.,
+                    -23.,
+                    456.,
+                    -78910.,
+                    1112131415.,
+                    -161718192021.,
+                    22232425262728.,
+                    -2930313233343536.,
+                    373839404142434445.,
+                    -46474849505152535455.,
+                    -46103918342424313856.};
+xsum_flt term3[] = {1.1e-322,
+                    5.3443e-321,
+                    -9.343e-320,
+                    3.33e-314,
+                    4.41e-322,
+                    -8.8e-318,
+                    3.1e-310,
+                    4.1e-300,
+                    -4e-300,
+                    7e-307,
+                    1.0000070031003328e-301};
+
+xsum_flt *terms[] = {term1, term2, term3};
+
+/* # of producer threads (a power of two, so that the answers are exact) */
+constexpr int NPRODUCERS = 4;
+/* Repeat factor, so that the rings fill and wrap around many times */
+constexpr int REP = (1 << 14);
+
+int different(double const a, double const b) {
+  return (std::isnan(a) != std::isnan(b)) ||
+         (!std::isnan(a) && !std::isnan(b) && a != b);
+}
+
+void result(double const r, double const s, const char *test) {
+  if (different(r, s)) {
+    std::printf(" \n-- %s\n", test);
+    std::printf("   ANSWER: %.16le\n", s);
+    std::printf("Result incorrect %.16le != %.16le\n", r, s);
+    std::printf("    ");
+    print_binary(r);
+    std::printf("    ");
+    print_binary(s);
+  }
+}
+
+int main() {
+  std::cout << "\nCORRECTNESS INGESTION QUEUE TESTS\n";
+
+  std::cout << "A: one producer\n";
+
+  for (int k = 0; k < 3; ++k) {
+    xsum_queue q(1, 64);
+    for (int j = 0; j < REP; ++j) {
+      for (int i = 0; i < 10; ++i) {
+        q.push(0, terms[k][i]);
+      }
+    }
+    result(q.round(), terms[k][10] * REP, "Test 1");
+
+    /* Adding after rounding goes on from the same sum */
+    for (int j = 0; j < REP; ++j) {
+      for (int i = 0; i < 10; ++i) {
+        q.push(0, terms[k][i]);
+      }
+    }
+    result(q.round(), terms[k][10] * REP * 2, "Test 2");
+  }
+
+  std::cout << "B: " << NPRODUCERS << " producers, waiting when full\n";
+
+  {
+    xsum_queue q(NPRODUCERS, 256);
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < NPRODUCERS; ++p) {
+      producers.emplace_back([&q, p]() {
+        for (int j = 0; j < REP; ++j) {
+          for (int i = 0; i < 10; ++i) {
+            q.push(p, term2[i]);
+          }
+        }
+      });
+    }
+    for (auto &t : producers) {
+      t.join();
+    }
+
+    xsum_small_accumulator sacc = q.round_to_small();
+    result(xsum_round(&sacc), term2[10] * REP * NPRODUCERS, "Test 3");
+  }
+
+  std::cout << "C: " << NPRODUCERS << " producers, rejected when full\n";
+
+  {
+    xsum_queue q(NPRODUCERS, 16, xsum_backpressure::reject);
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < NPRODUCERS; ++p) {
+      producers.emplace_back([&q, p]() {
+        for (int j = 0; j < REP; ++j) {
+          for (int i = 0; i < 10; ++i) {
+            while (!q.push(p, term3[i])) {
+              std::this_thread::yield();
+            }
+          }
+        }
+      });
+    }
+    for (auto &t : producers) {
+      t.join();
+    }
+
+    result(q.round(), term3[10] * REP * NPRODUCERS, "Test 4");
+  }
+
+  std::cout << "D: values pushed before destruction are added\n";
+
+  {
+    xsum_queue q(1);
+    for (int i = 0; i < 10; ++i) {
+      q.push(0, term1[i]);
+    }
+  }
+
+  std::cout << "E: an idle consumer sleeps, and wakes up for new values\n";
+
+  {
+    xsum_queue q(2);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    /* A consumer that kept polling would take about all of the wall time */
+    std::clock_t const c0 = std::clock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    double const cpu = double(std::clock() - c0) / CLOCKS_PER_SEC;
+    if (cpu > 0.25) {
+      std::printf(" \n-- Test 5\n");
+      std::printf("Check failed, %.3f s of CPU time in 0.5 s\n", cpu);
+    }
+
+    for (int i = 0; i < 10; ++i) {
+      q.push(i & 1, term1[i]);
+    }
+    result(q.round(), term1[10], "Test 6");
+  }
+}
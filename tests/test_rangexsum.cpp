@@ -0,0 +1,196 @@
+//
+// Copyright (c) 2020, Regents of the University of Minnesota.
+// All rights reserved.
+//
+// Contributors:
+//    Yaser Afshar
+//
+
+// CORRECTNESS CHECKS FOR THE RANGE-SUM INDEX
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "../xsum/rangexsum.hpp"
+#include "../xsum/xsum.hpp"
+
+using namespace xsum;
+
+char const *const path = "test_rangexsum.xsumrng";
+
+int different(double const a, double const b) {
+  return (std::isnan(a) != std::isnan(b)) ||
+         (!std::isnan(a) && !std::isnan(b) && a != b);
+}
+
+void result(double const r, double const s, const char *test) {
+  if (different(r, s)) {
+    std::printf(" \n-- %s\n", test);
+    std::printf("   ANSWER: %.16le\n", s);
+    std::printf("Result incorrect %.16le != %.16le\n", r, s);
+  }
+}
+
+void check(bool const ok, const char *test) {
+  if (!ok) {
+    std::printf(" \n-- %s\n", test);
+    std::printf("Check failed\n");
+  }
+}
+
+/* Sum of values i to j-1, added one range at a time */
+double direct(std::vector<double> const &v, xsum_length const i,
+              xsum_length const j) {
+  xsum_large_accumulator lacc;
+  xsum_add(&lacc, v.data() + i, j - i);
+  return xsum_round(&lacc);
+}
+
+/* Whether loading the file for n values throws */
+bool throws(char const *file, std::vector<double> const &v,
+            xsum_length const n) {
+  try {
+    xsum_range_index idx(file, v.data(), n);
+  } catch (std::runtime_error const &) {
+    return true;
+  }
+  return false;
+}
+
+int main() {
+  std::cout << "\nCORRECTNESS RANGE-SUM INDEX TESTS\n";
+
+  /* Values of very different magnitudes, which cancel */
+  std::mt19937_64 gen(1);
+  std::uniform_real_distribution<double> u(-1.0, 1.0);
+  std::uniform_int_distribution<int> e(-60, 60);
+  std::vector<double> v(10007);
+  for (auto &x : v) {
+    x = std::ldexp(u(gen), e(gen));
+  }
+  xsum_length const n = static_cast<xsum_length>(v.size());
+
+  std::cout << "A: random ranges, for several block sizes and threads\n";
+
+  {
+    std::uniform_int_distribution<xsum_length> r(0, n);
+    for (xsum_length const block : {1, 3, 64, 1000, 20000}) {
+      for (int const nthreads : {1, 4}) {
+        xsum_range_index idx(v, block, nthreads);
+        check(idx.size() == n && idx.block() == block, "Test 1");
+        result(idx.sum(0, n), direct(v, 0, n), "Test 2");
+        for (int k = 0; k < 200; ++k) {
+          xsum_length i = r(gen);
+          xsum_length j = r(gen);
+          if (i > j) {
+            std::swap(i, j);
+          }
+          result(idx.sum(i, j), direct(v, i, j), "Test 3");
+        }
+      }
+    }
+  }
+
+  std::cout << "B: ranges at block ends, and empty ranges\n";
+
+  {
+    xsum_range_index idx(v, 100, 2);
+    for (xsum_length const i : {0, 1, 99, 100, 101, 5000, 10000}) {
+      for (xsum_length const j : {i, i + 1, i + 99, i + 100, i + 101, n}) {
+        if (j <= n) {
+          result(idx.sum(i, j), direct(v, i, j), "Test 4");
+        }
+      }
+    }
+    result(idx.sum(n, n), 0, "Test 5");
+
+    xsum_range_index none(v.data(), 0);
+    result(none.sum(0, 0), 0, "Test 6");
+
+    /* add does not initialize the accumulator */
+    xsum_small_accumulator sacc;
+    xsum_add(&sacc, 1.0);
+    idx.add(0, n, &sacc);
+    idx.add(5, 500, &sacc);
+    xsum_large_accumulator lacc;
+    xsum_add(&lacc, 1.0);
+    xsum_add(&lacc, v.data(), n);
+    xsum_add(&lacc, v.data() + 5, 495);
+    result(xsum_round(&sacc), xsum_round(&lacc), "Test 7");
+  }
+
+  std::cout << "C: Inf and NaN in a block\n";
+
+  {
+    std::vector<double> w(v.begin(), v.begin() + 1000);
+    w[500] = std::numeric_limits<double>::infinity();
+    xsum_range_index idx(w, 64);
+    result(idx.sum(0, 1000), std::numeric_limits<double>::infinity(),
+           "Test 8");
+    result(idx.sum(0, 500), direct(w, 0, 500), "Test 9");
+    result(idx.sum(501, 1000), direct(w, 501, 1000), "Test 10");
+    w[700] = -std::numeric_limits<double>::infinity();
+    xsum_range_index idx2(w, 64);
+    check(std::isnan(idx2.sum(0, 1000)), "Test 11");
+    result(idx2.sum(501, 1000), -std::numeric_limits<double>::infinity(),
+           "Test 12");
+  }
+
+  std::cout << "D: save and load\n";
+
+  {
+    xsum_range_index idx(v, 50, 4);
+    idx.save(path);
+    xsum_range_index idx2(path, v.data(), n);
+    check(idx2.size() == n && idx2.block() == 50, "Test 13");
+    std::uniform_int_distribution<xsum_length> r(0, n);
+    for (int k = 0; k < 100; ++k) {
+      xsum_length i = r(gen);
+      xsum_length j = r(gen);
+      if (i > j) {
+        std::swap(i, j);
+      }
+      result(idx2.sum(i, j), direct(v, i, j), "Test 14");
+    }
+
+    check(throws(path, v, n - 1), "Test 15");
+    check(throws("test_rangexsum.none", v, n), "Test 16");
+
+    std::FILE *f = std::fopen(path, "r+b");
+    std::fputc('Y', f);
+    std::fclose(f);
+    check(throws(path, v, n), "Test 17");
+
+    xsum_range_index(v, 50).save(path);
+    f = std::fopen(path, "ab");
+    std::fputc(0, f);
+    std::fclose(f);
+    check(throws(path, v, n), "Test 18");
+  }
+
+  std::remove(path);
+
+  std::cout << "E: whole blocks of values with one exponent\n";
+
+  {
+    /* The chunks of such blocks are near overflow before their carries are
+       propagated */
+    xsum_flt const values[] = {1.5, 1.9999999999999998, -1.25};
+    for (xsum_flt const x : values) {
+      for (xsum_length const blocks : {4, 64}) {
+        xsum_length const n = blocks * XSUM_RANGE_BLOCK;
+        std::vector<xsum_flt> w(n, x);
+        xsum_range_index idx(w, XSUM_RANGE_BLOCK, 4);
+        result(idx.sum(0, n), direct(w, 0, n), "Test 19");
+        result(idx.sum(1, n - 1), direct(w, 1, n - 1), "Test 20");
+        result(idx.sum(XSUM_RANGE_BLOCK, n), direct(w, XSUM_RANGE_BLOCK, n),
+               "Test 21");
+      }
+    }
+  }
+}
@@ -0,0 +1,96 @@
+//
+// Copyright (c) 2020, Regents of the University of Minnesota.
+// All rights reserved.
+//
+// Contributors:
+//    Yaser Afshar
+//
+
+// CHECKS FOR THE NESTED PROFILING TIMERS
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "../xsum/misc/timer.hpp"
+
+void check(bool const ok, const char *test) {
+  if (!ok) {
+    std::printf(" \n-- %s\n", test);
+    std::printf("Check failed\n");
+  }
+}
+
+/* Node of the calling thread's tree with this name, below node i */
+umuqTimerNode const *find(std::size_t const i, char const *name) {
+  umuqThreadTimers const *t = umuqProfiler::threadTimers();
+  for (std::size_t const c : t->nodes[i].children) {
+    if (std::strcmp(t->nodes[c].name, name) == 0) {
+      return &t->nodes[c];
+    }
+  }
+  return nullptr;
+}
+
+void work(int const n) {
+  for (int i = 0; i < n; ++i) {
+    umuqScopedTimer t("outer");
+    {
+      umuqScopedTimer t2("inner");
+    }
+    {
+      umuqScopedTimer t2("inner");
+    }
+  }
+  umuqScopedTimer t("inner");
+}
+
+int main() {
+  std::cout << "\nPROFILING TIMER TESTS\n";
+
+  std::cout << "A: nesting\n";
+
+  {
+    work(5);
+    umuqThreadTimers const *t = umuqProfiler::threadTimers();
+    umuqTimerNode const *outer = find(0, "outer");
+    check(outer && outer->calls == 5, "Test 1");
+    umuqTimerNode const *inner = outer ? find(outer - &t->nodes[0], "inner") : nullptr;
+    check(inner && inner->calls == 10, "Test 2");
+    check(inner && inner->ticks <= outer->ticks, "Test 3");
+    umuqTimerNode const *top = find(0, "inner");
+    check(top && top->calls == 1 && top != inner, "Test 4");
+    check(t->current == 0, "Test 5");
+  }
+
+  std::cout << "B: threads are merged in the report\n";
+
+  {
+    std::thread th(work, 3);
+    th.join();
+
+    std::ostringstream os;
+    umuqProfiler::report(os);
+    std::istringstream is(os.str());
+    std::string line;
+    std::getline(is, line);
+    std::string name;
+    unsigned long calls = 0, threads = 0;
+    double total, mean, mn, mx, parent;
+    is >> name >> calls >> total >> mean >> mn >> mx >> parent >> threads;
+    check(name == "outer" && calls == 8 && threads == 2, "Test 6");
+    is >> name >> calls >> total >> mean >> mn >> mx >> parent >> threads;
+    check(name == "inner" && calls == 16 && threads == 2, "Test 7");
+  }
+
+  std::cout << "C: reset\n";
+
+  {
+    umuqProfiler::reset();
+    check(umuqProfiler::threadTimers()->nodes.size() == 1, "Test 8");
+    work(1);
+    check(find(0, "outer")->calls == 1, "Test 9");
+  }
+}
@@ -0,0 +1,199 @@
+//
+// Copyright (c) 2020, Regents of the University of Minnesota.
+// All rights reserved.
+//
+// Contributors:
+//    Yaser Afshar
+//
+
+// CHECKS FOR THE GENERATOR OF BENCHMARK WORKLOADS
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#include "../xsum/misc/workload.hpp"
+#include "../xsum/xsum.hpp"
+
+using namespace xsum;
+
+constexpr xsum_length N = 10001;
+
+xsum_workload_kind const kinds[] = {
+    xsum_workload_kind::uniform,  xsum_workload_kind::wide,
+    xsum_workload_kind::cancel,   xsum_workload_kind::denormal,
+    xsum_workload_kind::narrow,   xsum_workload_kind::inf_nan,
+    xsum_workload_kind::integer};
+
+xsum_workload_order const orders[] = {
+    xsum_workload_order::generated,  xsum_workload_order::shuffled,
+    xsum_workload_order::sorted,     xsum_workload_order::increasing,
+    xsum_workload_order::decreasing, xsum_workload_order::alternating};
+
+int different(double const a, double const b) {
+  return (std::isnan(a) != std::isnan(b)) ||
+         (!std::isnan(a) && !std::isnan(b) && a != b);
+}
+
+void check(bool const ok, const char *test, int const i) {
+  if (!ok) {
+    std::printf(" \n-- %s (case %d)\n", test, i);
+    std::printf("Check failed\n");
+  }
+}
+
+/* The values, sorted, with NaNs last, to compare them as multisets */
+std::vector<double> sorted(xsum_workload const &w) {
+  std::vector<double> v(w.data(), w.data() + w.size());
+  std::sort(v.begin(), v.end(), [](double const a, double const b) {
+    return std::isnan(b) ? !std::isnan(a) : a < b;
+  });
+  return v;
+}
+
+bool same(std::vector<double> const &a, std::vector<double> const &b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    if (different(a[i], b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  std::cout << "\nWORKLOAD GENERATOR TESTS\n";
+
+  std::cout << "A: kinds, seeds, and exact sums\n";
+
+  for (auto const kind : kinds) {
+    int const k = static_cast<int>(kind);
+    xsum_workload_params p;
+    p.kind = kind;
+    p.special_fraction = 1e-3;
+    xsum_workload w1(N, p);
+    xsum_workload w2(N, p);
+    p.seed = 2;
+    xsum_workload w3(N, p);
+
+    check(same(sorted(w1), sorted(w2)), "Test 1", k);
+    check(!same(sorted(w1), sorted(w3)), "Test 2", k);
+
+    xsum_small_accumulator sacc;
+    xsum_add(&sacc, w1.data(), w1.size());
+    check(!different(xsum_round(&sacc), w1.sum()), "Test 3", k);
+  }
+
+  {
+    /* The exact sum of the cancel values is the smallest of them */
+    xsum_workload_params p;
+    p.kind = xsum_workload_kind::cancel;
+    xsum_workload w(N, p);
+    double const *m = std::min_element(
+        w.data(), w.data() + N,
+        [](double const a, double const b) { return std::fabs(a) < std::fabs(b); });
+    check(w.sum() == *m && w.sum() != 0, "Test 4", 0);
+
+    /* Inf and NaN values give a NaN */
+    p.kind = xsum_workload_kind::inf_nan;
+    p.special_fraction = 1e-2;
+    xsum_workload w2(N, p);
+    check(std::isnan(w2.sum()), "Test 5", 0);
+  }
+
+  std::cout << "B: orders\n";
+
+  for (auto const kind : kinds) {
+    xsum_workload_params p;
+    p.kind = kind;
+    p.special_fraction = 1e-3;
+    xsum_workload w0(N, p);
+    std::vector<double> const s0 = sorted(w0);
+
+    for (auto const order : orders) {
+      int const k = static_cast<int>(kind) * 10 + static_cast<int>(order);
+      p.order = order;
+      xsum_workload w(N, p);
+      double const *v = w.data();
+      check(same(sorted(w), s0), "Test 6", k);
+      check(!different(w.sum(), w0.sum()), "Test 7", k);
+
+      bool ok = true;
+      for (xsum_length i = 1; i < N; ++i) {
+        double const a = v[i - 1];
+        double const b = v[i];
+        if (std::isnan(a) || std::isnan(b)) {
+          continue;
+        }
+        switch (order) {
+          case xsum_workload_order::sorted:
+            ok = ok && a <= b;
+            break;
+          case xsum_workload_order::increasing:
+            ok = ok && std::fabs(a) <= std::fabs(b);
+            break;
+          case xsum_workload_order::decreasing:
+            ok = ok && std::fabs(a) >= std::fabs(b);
+            break;
+          default:
+            break;
+        }
+      }
+      check(ok, "Test 8", k);
+    }
+  }
+
+  {
+    /* Alternating signs, while both are left */
+    xsum_workload_params p;
+    p.kind = xsum_workload_kind::wide;
+    p.order = xsum_workload_order::alternating;
+    xsum_workload w(N, p);
+    double const *v = w.data();
+    bool ok = true;
+    for (xsum_length i = 1; i < 1000; ++i) {
+      ok = ok && (v[i - 1] >= 0) != (v[i] >= 0);
+      ok = ok && (i < 2 || std::fabs(v[i]) <= std::fabs(v[i - 2]));
+    }
+    check(ok, "Test 9", 0);
+  }
+
+  std::cout << "C: cache\n";
+
+  {
+    xsum_workload_params p;
+    p.kind = xsum_workload_kind::wide;
+    p.order = xsum_workload_order::decreasing;
+    xsum_workload w0(N, p);
+
+    std::string path;
+    {
+      xsum_workload w1(N, p, ".");
+      path = w1.path();
+      check(!w1.cached(), "Test 10", 0);
+      check(same(sorted(w1), sorted(w0)) && w1.sum() == w0.sum(), "Test 11",
+            0);
+    }
+    {
+      xsum_workload w2(N, p, ".");
+      check(w2.cached(), "Test 12", 0);
+      check(std::equal(w2.data(), w2.data() + N, w0.data()), "Test 13", 0);
+      check(w2.sum() == w0.sum(), "Test 14", 0);
+    }
+
+    /* A damaged file is made again */
+    std::FILE *f = std::fopen(path.c_str(), "r+b");
+    std::fputc('Y', f);
+    std::fclose(f);
+    {
+      xsum_workload w3(N, p, ".");
+      check(!w3.cached(), "Test 15", 0);
+      check(std::equal(w3.data(), w3.data() + N, w0.data()), "Test 16", 0);
+    }
+    std::remove(path.c_str());
+  }
+}
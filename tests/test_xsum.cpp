@@ -33,10 +33,16 @@
 
 // CORRECTNESS CHECKS FOR FUNCTIONS FOR EXACT SUMMATION.
 
+#include <algorithm>
 #include <cmath>
+#include <complex>
 #include <cstdio>
 #include <iomanip>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
+
 #include "../xsum/xsum.hpp"
 
 using namespace xsum;
@@ -64,6 +70,8 @@ constexpr double Sdenorm = (4 * pow2_1024 * pow2_52);
 constexpr int REP1 = (1 << 23);
 /* Repeat factor for second set of ten term tests */
 constexpr int REP10 = (1 << 13);
+/* Repeat factor for complex ten term tests (spans several blocks) */
+constexpr int REPC = (1 << 6);
 
 /* Tests with one term. Answer should be the same as the term. */
 
@@ -640,6 +648,1254 @@ int main(int argc, char **argv) {
     result(&lacc1, s, i / 11);
   }
 
+  std::printf("\nH: COMPLEX TEN TERM TESTS TIMES %d\n", REPC);
+
+  for (int i = 0; i < ten_term_size; i += 11) {
+    /* Real parts from this row, imaginary parts from the next one */
+    int const j = (i + 11) % ten_term_size;
+    double const sr = ten_term[i + 10] * REPC;
+    double const si = ten_term[j + 10] * REPC;
+
+    std::vector<std::complex<double>> z(10 * REPC);
+    std::vector<std::complex<double>> one(10 * REPC, {1.0, 0.0});
+    std::vector<std::complex<double>> img(10 * REPC, {0.0, 1.0});
+    for (int k = 0; k < 10 * REPC; ++k) {
+      z[k] = {ten_term[i + k % 10], ten_term[j + k % 10]};
+    }
+
+    xsum_small_accumulator sacc_re;
+    xsum_small_accumulator sacc_im;
+    xsum_add(&sacc_re, &sacc_im, z.data(), 10 * REPC);
+    result(&sacc_re, sr, i / 11);
+    result(&sacc_im, si, i / 11);
+
+    xsum_large_accumulator lacc_re;
+    xsum_large_accumulator lacc_im;
+    xsum_add(&lacc_re, &lacc_im, z);
+    result(&lacc_re, sr, i / 11);
+    result(&lacc_im, si, i / 11);
+
+    /* z * i = -im + i re */
+    xsum_small sre;
+    xsum_small sim;
+    sre.add_dot(sim, z, img);
+    result(sre.get(), -si, i / 11);
+    result(sim.get(), sr, i / 11);
+
+    xsum_large lre;
+    xsum_large lim;
+    lre.add_dot(lim, z.data(), one.data(), 10 * REPC);
+    result(lre.get(), sr, i / 11);
+    result(lim.get(), si, i / 11);
+
+    /* conj(i) * z = im - i re, and conj(z) * 1 = re - i im */
+    xsum_small_accumulator sacc_c_re;
+    xsum_small_accumulator sacc_c_im;
+    xsum_add_dotc(&sacc_c_re, &sacc_c_im, img, z);
+    result(&sacc_c_re, si, i / 11);
+    result(&sacc_c_im, -sr, i / 11);
+
+    xsum_large_accumulator lacc_c_re;
+    xsum_large_accumulator lacc_c_im;
+    xsum_add_dotc(&lacc_c_re, &lacc_c_im, z.data(), one.data(), 10 * REPC);
+    result(&lacc_c_re, sr, i / 11);
+    result(&lacc_c_im, -si, i / 11);
+
+    /* Squared norm of the complex vector is that of its interleaved parts */
+    xsum_large_accumulator lacc_n;
+    xsum_add_sqnorm(&lacc_n, reinterpret_cast<double const *>(z.data()),
+                    20 * REPC);
+    double const sn = xsum_round(&lacc_n);
+
+    xsum_small_accumulator sacc_n;
+    xsum_add_sqnorm(&sacc_n, z.data(), 10 * REPC);
+    result(&sacc_n, sn, i / 11);
+
+    xsum_large lacc_n2;
+    lacc_n2.add_sqnorm(z);
+    result(lacc_n2.get(), sn, i / 11);
+  }
+
+  std::printf("\nI: WINDOWED ACCUMULATOR TESTS\n");
+
+  for (int i = 0; i < ten_term_size; i += 11) {
+    double const s = ten_term[i + 10];
+
+    xsum_window_accumulator wacc;
+    for (int j = 0; j < 10; ++j) {
+      xsum_add(&wacc, ten_term[i + j]);
+    }
+    result(xsum_round_to_small_ptr(&wacc), s, i / 11);
+
+    xsum_window_accumulator wacc2;
+    xsum_add(&wacc2, ten_term + i, 10);
+    result(xsum_round_to_small_ptr(&wacc2), s, i / 11);
+
+    /* Merging the two gives twice the sum */
+    xsum_add(&wacc, &wacc2);
+    result(xsum_round_to_small_ptr(&wacc), s * 2, i / 11);
+  }
+
+  for (int i = 0; i < ten_term_size; i += 11) {
+    double const s = ten_term[i + 10] * REP10;
+
+    xsum_window_accumulator wacc;
+    for (int j = 0; j < REP10; ++j) {
+      xsum_add(&wacc, ten_term + i, 10);
+    }
+    result(xsum_round_to_small_ptr(&wacc), s, i / 11);
+  }
+
+  {
+    /* Values whose exponents drift over most of the range, with outliers far
+       from the rest, so that the window is moved many times */
+    int const n = 1 << 17;
+    std::vector<double> v(n);
+    std::vector<double> w(n);
+    unsigned long long r = 88172645463325252ULL;
+    for (int k = 0; k < n; ++k) {
+      r ^= r << 13;
+      r ^= r >> 7;
+      r ^= r << 17;
+      double const f = static_cast<double>(r >> 11) / 9007199254740992.0;
+      int const e = (k % 997 == 0) ? static_cast<int>(r % 2000) - 1000
+                                   : -900 + (1800 * k) / n +
+                                         static_cast<int>(r % 40);
+      v[k] = std::ldexp((r & 1) ? f : -f, e);
+      w[k] = std::ldexp(1.0 - f, -e / 2);
+    }
+
+    xsum_large_accumulator lacc;
+    xsum_add(&lacc, v);
+    double const s = xsum_round(&lacc);
+
+    xsum_window_accumulator wacc;
+    xsum_add(&wacc, v);
+    result(xsum_round_to_small_ptr(&wacc), s, 0);
+
+    xsum_window_accumulator wacc1;
+    for (int k = n - 1; k >= 0; --k) {
+      xsum_add(&wacc1, v[k]);
+    }
+    result(xsum_round_to_small_ptr(&wacc1), s, 1);
+
+    xsum_large_accumulator lacc_n;
+    xsum_add_sqnorm(&lacc_n, v);
+    xsum_window_accumulator wacc_n;
+    xsum_add_sqnorm(&wacc_n, v);
+    result(xsum_round_to_small_ptr(&wacc_n), xsum_round(&lacc_n), 2);
+
+    xsum_large_accumulator lacc_d;
+    xsum_add_dot(&lacc_d, v, w);
+    xsum_window_accumulator wacc_d;
+    xsum_add_dot(&wacc_d, v.data(), w.data(), n);
+    result(xsum_round_to_small_ptr(&wacc_d), xsum_round(&lacc_d), 3);
+  }
+
+  std::printf("\nJ: BUFFERED ACCUMULATOR TEN TERM TESTS TIMES %d\n", REP10);
+
+  for (int i = 0; i < ten_term_size; i += 11) {
+    double const s = ten_term[i + 10] * REP10;
+
+    /* A buffer size that does not divide the # of terms, so that some are
+       still in the buffer when rounding */
+    xsum_buffered<xsum_small_accumulator, 7> bsacc;
+    xsum_buffered<xsum_large_accumulator> blacc;
+    xsum_buffered<xsum_window_accumulator> bwacc;
+    for (int j = 0; j < REP10; ++j) {
+      for (int k = 0; k < 10; ++k) {
+        bsacc.add(ten_term[i + k]);
+        blacc.add(ten_term[i + k]);
+        bwacc.add(ten_term[i + k]);
+      }
+    }
+    result(bsacc.get(), s, i / 11);
+    result(blacc.get(), s, i / 11);
+    xsum_small_accumulator sacc = bwacc.round_to_small();
+    result(&sacc, s, i / 11);
+
+    /* Single values and vectors mixed */
+    xsum_buffered<xsum_large_accumulator, 3> blacc2;
+    blacc2.add(ten_term[i]);
+    blacc2.add(ten_term + i + 1, 8);
+    blacc2.add(ten_term[i + 9]);
+    result(blacc2.get(), ten_term[i + 10], i / 11);
+  }
+
+  std::printf("\nK: SMALL ACCUMULATOR VECTOR TESTS\n");
+
+  {
+    /* Long vectors, over many carry propagations, with values of both signs
+       over a wide range, and zeros and denormalized numbers, checked against
+       the large accumulator */
+    int const n = 10007;
+    std::vector<double> v(n);
+    std::vector<double> w(n);
+    unsigned long long r = 2463534242ULL;
+    for (int k = 0; k < n; ++k) {
+      r ^= r << 13;
+      r ^= r >> 7;
+      r ^= r << 17;
+      double const f = static_cast<double>(r >> 11) / 9007199254740992.0;
+      v[k] = (k % 13 == 0) ? 0.0
+             : (k % 17 == 0)
+                 ? ((r & 1) ? Sdenorm : -Ldenorm) * static_cast<double>(k)
+                 : std::ldexp((r & 1) ? f : -f, static_cast<int>(r % 1200) - 600);
+      w[k] = std::ldexp(1.0 - f, static_cast<int>(r % 800) - 400);
+    }
+
+    for (int m = n; m > n - 4; --m) {
+      xsum_large_accumulator lacc;
+      xsum_add(&lacc, v.data(), m);
+      xsum_small_accumulator sacc;
+      xsum_add(&sacc, v.data(), m);
+      result(&sacc, xsum_round(&lacc), 0);
+
+      xsum_large_accumulator lacc_n;
+      xsum_add_sqnorm(&lacc_n, v.data(), m);
+      xsum_small_accumulator sacc_n;
+      xsum_add_sqnorm(&sacc_n, v.data(), m);
+      result(&sacc_n, xsum_round(&lacc_n), 1);
+
+      xsum_large_accumulator lacc_d;
+      xsum_add_dot(&lacc_d, v.data(), w.data(), m);
+      xsum_small_accumulator sacc_d;
+      xsum_add_dot(&sacc_d, v.data(), w.data(), m);
+      result(&sacc_d, xsum_round(&lacc_d), 2);
+    }
+
+    /* Inf and NaN at even and odd positions, found after the loop */
+    double const inf = 1.0 / 0.0;
+    for (int k = 0; k < 6; ++k) {
+      std::vector<double> x(v.begin(), v.begin() + 100);
+      x[10 + k] = inf;
+      xsum_small_accumulator sacc;
+      xsum_add(&sacc, x);
+      result(&sacc, inf, 3);
+
+      x[50 + k] = -inf;
+      xsum_small_accumulator sacc2;
+      xsum_add(&sacc2, x);
+      xsum_small_accumulator sacc_n;
+      xsum_add_sqnorm(&sacc_n, x);
+      result(&sacc2, inf - inf, 4);
+      result(&sacc_n, inf, 5);
+    }
+  }
+
+  std::printf("\nL: SIGN, ZERO AND COMPARISON TESTS\n");
+
+  {
+    /* Check the sign of the exact sum against that of the rounded sum, which
+       is the same, and the comparison of two sums against that of their
+       rounded values, when these differ (rounding is monotonic) */
+    auto check = [](int const r, int const s, int const i) {
+      ++total_small_test;
+      if (r != s) {
+        ++small_test_fails;
+        std::printf(" \n-- TEST %d\n", i);
+        std::printf("   ANSWER: %d\n", s);
+        std::printf("Result incorrect %d != %d\n", r, s);
+      }
+    };
+    auto sgn = [](double const x) { return (x > 0) - (x < 0); };
+
+    for (int i = 0; i < ten_term_size; i += 11) {
+      double const s = ten_term[i + 10];
+
+      xsum_small_accumulator sacc;
+      xsum_add(&sacc, ten_term + i, 10);
+      xsum_large lacc;
+      lacc.add(ten_term + i, 10);
+
+      check(xsum_sign(&sacc), sgn(s), i / 11);
+      check(lacc.sign(), sgn(s), i / 11);
+      check(xsum_is_zero(&sacc), s == 0, i / 11);
+      check(lacc.is_zero(), s == 0, i / 11);
+
+      for (int j = 0; j < ten_term_size; j += 11) {
+        double const t = ten_term[j + 10];
+        if (s == t && i != j) {
+          continue;
+        }
+        xsum_small_accumulator sacc2;
+        xsum_add(&sacc2, ten_term + j, 10);
+        xsum_large lacc2;
+        lacc2.add(ten_term + j, 10);
+        int const c = i == j ? 0 : (s > t) - (s < t);
+        check(xsum_compare(&sacc, &sacc2), c, i / 11);
+        check(lacc.compare(lacc2), c, i / 11);
+      }
+    }
+
+    /* The uppermost chunk is too small to give the sign by itself */
+    double const big = std::ldexp(1.0, 40);
+    double const almost = -(big - std::ldexp(1.0, -12));
+    for (int k = 0; k < 2; ++k) {
+      double const sg = k == 0 ? 1.0 : -1.0;
+      xsum_small ssacc;
+      ssacc.add(sg * big);
+      ssacc.add(sg * almost);
+      check(ssacc.sign(), sgn(sg), 0);
+      check(ssacc.is_zero(), 0, 0);
+
+      xsum_small ssacc2;
+      ssacc2.add(sg * std::ldexp(1.0, -12));
+      check(ssacc.compare(ssacc2), 0, 0);
+      ssacc2.add(sg * Sdenorm);
+      check(ssacc.compare(ssacc2), -sgn(sg), 0);
+      check(ssacc2.compare(ssacc), sgn(sg), 0);
+    }
+
+    /* Sums decided by their uppermost chunks, and sums that are not, of
+       values of both signs and many exponents, checked against the sign of
+       the rounded exact difference.  Each set of values is added to a small
+       accumulator one at a time, close to its carry budget, and to a large
+       and a windowed accumulator. */
+    {
+      unsigned long long r = 88172645463325252ULL;
+      auto next = [&r]() {
+        r ^= r << 13;
+        r ^= r >> 7;
+        r ^= r << 17;
+        return r;
+      };
+      int const m = XSUM_SMALL_CARRY_BUDGET - 3;
+      for (int t = 0; t < 40; ++t) {
+        std::vector<double> v[2];
+        for (int h = 0; h < 2; ++h) {
+          /* a dominant value, far above or close to the others, or none */
+          int const top = static_cast<int>(next() % 3);
+          for (int k = 0; k < m; ++k) {
+            double const f = static_cast<double>(next() >> 11) /
+                             9007199254740992.0;
+            int const e = k == 0 && top < 2 ? (top == 0 ? 80 : 12)
+                                            : static_cast<int>(next() % 20);
+            v[h].push_back(std::ldexp((next() & 1) ? 1 + f : -1 - f, e));
+          }
+          if (t % 4 == 3) {
+            /* the same values, so that the sums are equal */
+            v[1] = v[0];
+            break;
+          }
+        }
+
+        xsum_small_accumulator sacc_a[2];
+        xsum_large_accumulator lacc_a[2];
+        xsum_window_accumulator wacc_a[2];
+        xsum_small_accumulator sacc_d;
+        for (int h = 0; h < 2; ++h) {
+          for (double const x : v[h]) {
+            xsum_add(&sacc_a[h], x);
+            xsum_add(&sacc_d, h == 0 ? x : -x);
+          }
+          xsum_add(&lacc_a[h], v[h]);
+          xsum_add(&wacc_a[h], v[h]);
+        }
+        int const c = sgn(xsum_round(&sacc_d));
+        check(xsum_compare(&sacc_a[0], &sacc_a[1]), c, t);
+        check(xsum_compare(&lacc_a[0], &lacc_a[1]), c, t);
+        check(xsum_compare(&wacc_a[0], &wacc_a[1]), c, t);
+
+        for (int h = 0; h < 2; ++h) {
+          xsum_small_accumulator sacc_r;
+          xsum_add(&sacc_r, v[h]);
+          int const s = sgn(xsum_round(&sacc_r));
+          check(xsum_sign(&sacc_a[h]), s, t);
+          check(xsum_sign(&lacc_a[h]), s, t);
+          check(xsum_sign(&wacc_a[h]), s, t);
+        }
+      }
+    }
+
+    /* A sum of values of one sign is decided without adding the chunks of a
+       large or windowed accumulator to its small accumulator */
+    {
+      xsum_large_accumulator lacc_p;
+      xsum_window_accumulator wacc_p;
+      for (int k = 1; k <= 1000; ++k) {
+        xsum_add(&lacc_p, -k * 0.25);
+        xsum_add(&wacc_p, -k * 0.25);
+      }
+      check(xsum_sign(&lacc_p), -1, 0);
+      check(xsum_sign(&wacc_p), -1, 0);
+      check(xsum_is_zero(&lacc_p), 0, 0);
+      xsum_small_accumulator const sacc_zero;
+      check(std::equal(lacc_p.sacc.chunk, lacc_p.sacc.chunk + XSUM_SCHUNKS,
+                       sacc_zero.chunk),
+            1, 0);
+      check(std::equal(wacc_p.sacc.chunk, wacc_p.sacc.chunk + XSUM_SCHUNKS,
+                       sacc_zero.chunk),
+            1, 0);
+    }
+
+    /* NaN compares neither smaller nor larger */
+    xsum_small_accumulator sacc_nan;
+    xsum_add(&sacc_nan, 1.0 / 0.0);
+    xsum_add(&sacc_nan, -1.0 / 0.0);
+    xsum_small_accumulator sacc_one;
+    xsum_add(&sacc_one, 1.0);
+    check(xsum_sign(&sacc_nan), 0, 0);
+    check(xsum_is_zero(&sacc_nan), 0, 0);
+    check(xsum_compare(&sacc_nan, &sacc_one), 0, 0);
+  }
+
+  std::printf("\nM: NEGATION, SUBTRACTION AND SCALING TESTS\n");
+
+  {
+    auto check = [](int const r, int const s, int const i) {
+      ++total_small_test;
+      if (r != s) {
+        ++small_test_fails;
+        std::printf(" \n-- TEST %d\n", i);
+        std::printf("   ANSWER: %d\n", s);
+        std::printf("Result incorrect %d != %d\n", r, s);
+      }
+    };
+
+    int const exps[] = {-1100, -600, -37, -1, 1, 5, 33, 64, 700};
+
+    for (int i = 0; i < ten_term_size; i += 11) {
+      double const s = ten_term[i + 10];
+
+      xsum_small_accumulator sacc;
+      xsum_add(&sacc, ten_term + i, 10);
+      xsum_large lacc;
+      lacc.add(ten_term + i, 10);
+
+      /* Negation, checked against adding the negated terms */
+      xsum_small_accumulator sacc_neg;
+      xsum_add(&sacc_neg, ten_term + i, 10);
+      xsum_negate(&sacc_neg);
+      xsum_large lacc_neg;
+      lacc_neg.add(ten_term + i, 10);
+      lacc_neg.negate();
+      xsum_small_accumulator sacc_ref;
+      for (int k = 0; k < 10; ++k) {
+        xsum_add(&sacc_ref, -ten_term[i + k]);
+      }
+      check(xsum_compare(&sacc_neg, &sacc_ref), 0, i / 11);
+      result(&sacc_neg, -s, i / 11);
+      result(lacc_neg.get(), -s, i / 11);
+
+      /* Subtraction, checked against adding the negated terms of the other
+         sum, and undone by adding them back */
+      for (int j = 0; j < ten_term_size; j += 11) {
+        xsum_small_accumulator sacc2;
+        xsum_add(&sacc2, ten_term + j, 10);
+        xsum_large lacc2;
+        lacc2.add(ten_term + j, 10);
+
+        xsum_small_accumulator sacc_sub;
+        xsum_add(&sacc_sub, ten_term + i, 10);
+        xsum_sub(&sacc_sub, &sacc2);
+        xsum_large lacc_sub;
+        lacc_sub.add(ten_term + i, 10);
+        lacc_sub.sub(lacc2);
+
+        xsum_small_accumulator sacc_diff;
+        xsum_add(&sacc_diff, ten_term + i, 10);
+        for (int k = 0; k < 10; ++k) {
+          xsum_add(&sacc_diff, -ten_term[j + k]);
+        }
+        double const d = xsum_round(&sacc_diff);
+        result(&sacc_sub, d, i / 11);
+        result(lacc_sub.get(), d, i / 11);
+
+        xsum_add(&sacc_sub, &sacc2);
+        check(xsum_compare(&sacc_sub, &sacc), 0, i / 11);
+      }
+
+      /* Scaling, checked against adding the scaled terms when they are all
+         exact, and undone by scaling back */
+      for (int const e : exps) {
+        bool exact = true;
+        xsum_small_accumulator sacc_ref2;
+        for (int k = 0; k < 10; ++k) {
+          double const t = std::ldexp(ten_term[i + k], e);
+          exact = exact && std::isfinite(t) &&
+                  std::ldexp(t, -e) == ten_term[i + k];
+          xsum_add(&sacc_ref2, t);
+        }
+        if (!exact) {
+          continue;
+        }
+
+        xsum_small_accumulator sacc_sc;
+        xsum_add(&sacc_sc, ten_term + i, 10);
+        check(xsum_ldexp(&sacc_sc, e), 1, i / 11);
+        check(xsum_compare(&sacc_sc, &sacc_ref2), 0, i / 11);
+        result(&sacc_sc, xsum_round(&sacc_ref2), i / 11);
+
+        xsum_large lacc_sc;
+        lacc_sc.add(ten_term + i, 10);
+        check(lacc_sc.ldexp(e), 1, i / 11);
+        result(lacc_sc.get(), xsum_round(&sacc_ref2), i / 11);
+
+        check(xsum_ldexp(&sacc_sc, -e), 1, i / 11);
+        check(xsum_compare(&sacc_sc, &sacc), 0, i / 11);
+      }
+    }
+
+    /* Scaling past the top of the accumulator gives an Inf, and a result
+       below the smallest denormalized number is rounded to nearest even */
+    double const inf = 1.0 / 0.0;
+    for (int k = 0; k < 2; ++k) {
+      double const sg = k == 0 ? 1.0 : -1.0;
+
+      xsum_small_accumulator sacc_o;
+      xsum_add(&sacc_o, sg * Lnormal);
+      check(xsum_ldexp(&sacc_o, 1), 1, 0);
+      result(&sacc_o, sg * inf, 0);
+      check(xsum_ldexp(&sacc_o, 100), 0, 0);
+      result(&sacc_o, sg * inf, 0);
+
+      xsum_large lacc_o;
+      lacc_o.add(sg * Lnormal);
+      check(lacc_o.ldexp(1 << 20), 0, 0);
+      result(lacc_o.get(), sg * inf, 0);
+
+      xsum_small_accumulator sacc_u;
+      xsum_add(&sacc_u, sg * 2 * Sdenorm);
+      check(xsum_ldexp(&sacc_u, -1), 1, 0);
+      result(&sacc_u, sg * Sdenorm, 0);
+      /* Half the smallest denormalized number is a tie, rounded to 0 */
+      check(xsum_ldexp(&sacc_u, -1), 0, 0);
+      result(&sacc_u, 0.0, 0);
+      check(xsum_ldexp(&sacc_u, 2), 1, 0);
+      result(&sacc_u, 0.0, 0);
+
+      xsum_small_accumulator sacc_u2;
+      xsum_add(&sacc_u2, sg * Snormal);
+      check(xsum_ldexp(&sacc_u2, -(1 << 20)), 0, 0);
+      check(xsum_ldexp(&sacc_u2, 1), 1, 0);
+      result(&sacc_u2, 0.0, 0);
+
+      /* Denormalized results, checked against std::ldexp, which rounds the
+         same way, and exact only if no bit was lost */
+      double const mults[] = {1, 3, 5, 7, 11, 0xfffff, 0x2bcdef123};
+      int const dexps[] = {-1, -2, -3, -33, -52, -53, -60};
+      for (double const m : mults) {
+        for (int const e : dexps) {
+          for (double const x : {m * Sdenorm, m * Snormal}) {
+            double const y = std::ldexp(sg * x, e);
+            xsum_small_accumulator sacc_d;
+            xsum_add(&sacc_d, sg * x);
+            check(xsum_ldexp(&sacc_d, e), std::ldexp(y, -e) == sg * x, 0);
+            result(&sacc_d, y, 0);
+          }
+        }
+      }
+
+      /* Bits of a sum of several terms below the smallest denormalized number
+         round up when above a half, even though none of the terms does */
+      xsum_small_accumulator sacc_s;
+      xsum_add(&sacc_s, sg * 8 * Sdenorm);
+      xsum_add(&sacc_s, sg * 3 * Sdenorm);
+      check(xsum_ldexp(&sacc_s, -3), 0, 0);
+      result(&sacc_s, sg * Sdenorm, 0);
+      xsum_small_accumulator sacc_t;
+      xsum_add(&sacc_t, sg * 8 * Sdenorm);
+      xsum_add(&sacc_t, sg * 5 * Sdenorm);
+      check(xsum_ldexp(&sacc_t, -3), 0, 0);
+      result(&sacc_t, sg * 2 * Sdenorm, 0);
+    }
+
+    /* Subtraction of accumulators close to their carry budget, whose chunks
+       would overflow if subtracted without propagating their carries.  The
+       value has a full mantissa and the low bits of its exponent all ones,
+       so it adds to the top of a chunk and the next one. */
+    {
+      double const x = std::ldexp(2.0 - std::ldexp(1.0, -52), 703 - 1023);
+      int const m = XSUM_SMALL_CARRY_BUDGET - 47;
+
+      xsum_small_accumulator sacc_a;
+      xsum_small_accumulator sacc_b;
+      xsum_large lacc_a;
+      xsum_large lacc_b;
+      xsum_window_accumulator wacc_a;
+      xsum_window_accumulator wacc_b;
+      for (int k = 0; k < m; ++k) {
+        xsum_add(&sacc_a, x);
+        xsum_add(&sacc_b, -x);
+        lacc_a.add(x);
+        lacc_b.add(-x);
+        xsum_add(&wacc_a, x);
+        xsum_add(&wacc_b, -x);
+      }
+      xsum_sub(&sacc_a, &sacc_b);
+      result(&sacc_a, 2.0 * m * x, 0);
+      lacc_a.sub(lacc_b);
+      result(lacc_a.get(), 2.0 * m * x, 0);
+      xsum_sub(&wacc_a, &wacc_b);
+      result(xsum_round_to_small_ptr(&wacc_a), 2.0 * m * x, 0);
+    }
+
+    /* Inf and NaN */
+    xsum_small_accumulator sacc_inf;
+    xsum_add(&sacc_inf, inf);
+    xsum_negate(&sacc_inf);
+    result(&sacc_inf, -inf, 0);
+    xsum_small_accumulator sacc_inf2;
+    xsum_add(&sacc_inf2, inf);
+    xsum_sub(&sacc_inf2, &sacc_inf);
+    result(&sacc_inf2, inf, 0);
+    xsum_sub(&sacc_inf, &sacc_inf);
+    result(&sacc_inf, inf - inf, 0);
+  }
+
+  std::printf("\nN: BINNED ACCUMULATOR TESTS\n");
+
+  {
+    /* The binned sum is not exact, so it is checked to be the same in any
+       order and grouping, and within its error bound of the exact sum */
+    auto check = [](double const r, double const s, int const i) {
+      ++total_small_test;
+      if (different(r, s)) {
+        ++small_test_fails;
+        std::printf(" \n-- TEST %d\n", i);
+        std::printf("   ANSWER: %.16le\n", s);
+        std::printf("binned: Result incorrect %.16le != %.16le\n", r, s);
+      }
+    };
+    auto bound = [](double const r, double const s, double const n,
+                    double const amax, int const fold, int const i) {
+      ++total_small_test;
+      double const e =
+          n * amax * std::ldexp(1.0, -(fold - 1) * XSUM_BIN_WIDTH) +
+          std::fabs(s) * pow2_52;
+      if (!(std::fabs(r - s) <= e) && different(r, s)) {
+        ++small_test_fails;
+        std::printf(" \n-- TEST %d\n", i);
+        std::printf("   ANSWER: %.16le\n", s);
+        std::printf("binned: Error too large %.16le != %.16le\n", r, s);
+      }
+    };
+
+    for (int fold = 1; fold <= XSUM_BIN_MAX_FOLD; ++fold) {
+      for (int i = 0; i < ten_term_size; i += 11) {
+        double const s = ten_term[i + 10];
+
+        xsum_binned_accumulator bacc(fold);
+        xsum_add(&bacc, ten_term + i, 10);
+        double const r = xsum_round(&bacc);
+
+        double amax = 0;
+        for (int j = 0; j < 10; ++j) {
+          amax = std::max(amax, std::fabs(ten_term[i + j]));
+        }
+        bound(r, s, 10, amax, fold, i / 11);
+
+        xsum_binned_accumulator bacc1(fold);
+        for (int j = 9; j >= 0; --j) {
+          xsum_add(&bacc1, ten_term[i + j]);
+        }
+        check(xsum_round(&bacc1), r, i / 11);
+
+        /* Merging partial sums, the larger values last */
+        xsum_binned_accumulator bacc2(fold);
+        for (int j = 0; j < 10; ++j) {
+          xsum_binned_accumulator part(fold);
+          xsum_add(&part, ten_term[i + (j + 3) % 10]);
+          xsum_add(&bacc2, &part);
+        }
+        check(xsum_round(&bacc2), r, i / 11);
+      }
+    }
+
+    /* Sums of denormalized numbers are exact */
+    for (int i = 0; i < three_term_size; i += 4) {
+      if (std::fabs(three_term[i]) < Snormal &&
+          std::fabs(three_term[i + 1]) < Snormal &&
+          std::fabs(three_term[i + 2]) < Snormal) {
+        xsum_binned_accumulator bacc;
+        xsum_add(&bacc, three_term + i, 3);
+        check(xsum_round(&bacc), three_term[i + 3], i / 4);
+      }
+    }
+
+    /* Values over most of the exponent range, summed in different orders,
+       blocks, and groupings, with the larger values coming late */
+    int const n = 1 << 17;
+    std::vector<double> v(n);
+    std::vector<double> w(n);
+    unsigned long long r = 88172645463325252ULL;
+    double amax = 0;
+    for (int k = 0; k < n; ++k) {
+      r ^= r << 13;
+      r ^= r >> 7;
+      r ^= r << 17;
+      double const f = static_cast<double>(r >> 11) / 9007199254740992.0;
+      int const e = -1000 + (1900 * k) / n + static_cast<int>(r % 60);
+      v[k] = std::ldexp((r & 1) ? f : -f, e);
+      w[k] = std::ldexp(1.0 - f, -e / 2);
+      amax = std::max(amax, std::fabs(v[k]));
+    }
+
+    xsum_large_accumulator lacc;
+    xsum_add(&lacc, v);
+    double const s = xsum_round(&lacc);
+
+    for (int fold = 1; fold <= XSUM_BIN_MAX_FOLD; ++fold) {
+      xsum_binned_accumulator bacc(fold);
+      xsum_add(&bacc, v);
+      double const rs = xsum_round(&bacc);
+      bound(rs, s, n, amax, fold, fold);
+
+      xsum_binned_accumulator bacc1(fold);
+      for (int k = n - 1; k >= 0; --k) {
+        xsum_add(&bacc1, v[k]);
+      }
+      check(xsum_round(&bacc1), rs, fold);
+
+      /* Parts of odd sizes, merged into the last one */
+      xsum_binned_accumulator bacc2(fold);
+      for (int k = 0; k < n; k += 1001) {
+        xsum_binned_accumulator part(fold);
+        xsum_add(&part, v.data() + k, std::min(1001, n - k));
+        xsum_add(&part, &bacc2);
+        bacc2 = part;
+      }
+      check(xsum_round(&bacc2), rs, fold);
+
+      /* Merging with more folds keeps the smaller number */
+      xsum_binned_accumulator bacc3(XSUM_BIN_MAX_FOLD);
+      xsum_add(&bacc3, v.data() + n / 2, n - n / 2);
+      xsum_binned_accumulator bacc4(fold);
+      xsum_add(&bacc4, v.data(), n / 2);
+      xsum_add(&bacc3, &bacc4);
+      check(xsum_round(&bacc3), rs, fold);
+
+      xsum_binned_accumulator bacc_d(fold);
+      xsum_add_dot(&bacc_d, v, w);
+      xsum_binned_accumulator bacc_d1(fold);
+      for (int k = n - 1; k >= 0; --k) {
+        xsum_add(&bacc_d1, v[k] * w[k]);
+      }
+      check(xsum_round(&bacc_d1), xsum_round(&bacc_d), fold);
+
+      xsum_binned_accumulator bacc_n(fold);
+      xsum_add_sqnorm(&bacc_n, v);
+      xsum_binned_accumulator bacc_n1(fold);
+      xsum_add_dot(&bacc_n1, v, v);
+      check(xsum_round(&bacc_n1), xsum_round(&bacc_n), fold);
+
+      /* Init keeps the number of folds */
+      xsum_init(&bacc);
+      check(xsum_round(&bacc), 0.0, fold);
+      check(bacc.fold, fold, fold);
+    }
+  }
+
+#ifdef __SIZEOF_INT128__
+  std::printf("\nO: 128-BIT CHUNK ACCUMULATOR TESTS\n");
+
+  for (int i = 0; i < one_term_size; ++i) {
+    double const s = one_term[i] * REP1;
+
+    xsum_small128_accumulator sacc;
+    xsum_large128_accumulator lacc;
+    for (int j = 0; j < REP1; ++j) {
+      xsum_add(&sacc, one_term[i]);
+      xsum_add(&lacc, one_term[i]);
+    }
+    xsum_small_accumulator r = xsum_round_to_small(&sacc);
+    result(&r, s, i);
+    r = xsum_round_to_small(&lacc);
+    result(&r, s, i);
+  }
+
+  for (int i = 0; i < ten_term_size; i += 11) {
+    double const s = ten_term[i + 10];
+
+    xsum_small128_accumulator sacc;
+    xsum_add(&sacc, ten_term + i, 10);
+    xsum_small_accumulator r = xsum_round_to_small(&sacc);
+    result(&r, s, i / 11);
+
+    xsum_large128_accumulator lacc;
+    for (int j = 0; j < 10; ++j) {
+      xsum_add(&lacc, ten_term[i + j]);
+    }
+    r = xsum_round_to_small(&lacc);
+    result(&r, s, i / 11);
+
+    /* Merging gives twice the sum */
+    xsum_small128_accumulator sacc2;
+    for (int j = 0; j < 10; ++j) {
+      xsum_add(&sacc2, ten_term[i + j]);
+    }
+    xsum_add(&sacc, &sacc2);
+    r = xsum_round_to_small(&sacc);
+    result(&r, s * 2, i / 11);
+
+    xsum_large128_accumulator lacc2;
+    xsum_add(&lacc2, ten_term + i, 10);
+    xsum_add(&lacc, &lacc2);
+    r = xsum_round_to_small(&lacc);
+    result(&r, s * 2, i / 11);
+  }
+
+  {
+    /* Values over most of the exponent range, and long runs of values with
+       the same exponent, against the large accumulator */
+    int const n = 1 << 17;
+    std::vector<double> v(n);
+    std::vector<double> w(n);
+    unsigned long long r = 88172645463325252ULL;
+    for (int k = 0; k < n; ++k) {
+      r ^= r << 13;
+      r ^= r >> 7;
+      r ^= r << 17;
+      double const f = static_cast<double>(r >> 11) / 9007199254740992.0;
+      int const e = (k < n / 2) ? -1000 + (1900 * k) / (n / 2) +
+                                      static_cast<int>(r % 60)
+                                : 700;
+      v[k] = std::ldexp((r & 1) ? 1 + f : -1 - f, e);
+      w[k] = std::ldexp(1.0 - f, -e / 2);
+    }
+
+    xsum_large_accumulator lacc;
+    xsum_add(&lacc, v);
+    double const s = xsum_round(&lacc);
+
+    xsum_small128_accumulator sacc1;
+    xsum_add(&sacc1, v);
+    xsum_small_accumulator sr = xsum_round_to_small(&sacc1);
+    result(&sr, s, 0);
+
+    xsum_large128_accumulator lacc1;
+    xsum_add(&lacc1, v);
+    sr = xsum_round_to_small(&lacc1);
+    result(&sr, s, 1);
+
+    /* Carries propagated every few adds */
+    xsum_small128_accumulator sacc2;
+    for (int k = n - 1; k >= 0; --k) {
+      if (sacc2.adds_until_propagate > 3) {
+        sacc2.adds_until_propagate = 3;
+      }
+      xsum_add(&sacc2, v[k]);
+    }
+    sr = xsum_round_to_small(&sacc2);
+    result(&sr, s, 2);
+
+    xsum_large_accumulator lacc_n;
+    xsum_add_sqnorm(&lacc_n, v);
+    double const s_n = xsum_round(&lacc_n);
+    xsum_small128_accumulator sacc_n;
+    xsum_add_sqnorm(&sacc_n, v);
+    sr = xsum_round_to_small(&sacc_n);
+    result(&sr, s_n, 3);
+    xsum_large128_accumulator lacc_n1;
+    xsum_add_sqnorm(&lacc_n1, v);
+    sr = xsum_round_to_small(&lacc_n1);
+    result(&sr, s_n, 4);
+
+    xsum_large_accumulator lacc_d;
+    xsum_add_dot(&lacc_d, v, w);
+    double const s_d = xsum_round(&lacc_d);
+    xsum_small128_accumulator sacc_d;
+    xsum_add_dot(&sacc_d, v, w);
+    sr = xsum_round_to_small(&sacc_d);
+    result(&sr, s_d, 5);
+    xsum_large128_accumulator lacc_d1;
+    xsum_add_dot(&lacc_d1, v.data(), w.data(), n);
+    sr = xsum_round_to_small(&lacc_d1);
+    result(&sr, s_d, 6);
+
+    /* Init clears them */
+    xsum_init(&sacc1);
+    xsum_init(&lacc1);
+    xsum_add(&sacc1, 1.0);
+    xsum_add(&lacc1, 1.0);
+    sr = xsum_round_to_small(&sacc1);
+    result(&sr, 1.0, 7);
+    sr = xsum_round_to_small(&lacc1);
+    result(&sr, 1.0, 8);
+  }
+#endif
+
+  std::printf("\nP: ACCUMULATOR FOR A RANGE OF EXPONENTS TESTS\n");
+
+  {
+    /* Sizes of the two ranges below */
+    ++total_small_test;
+    if (xsum_bounded_accumulator<-60, 60>::nchunks != 7 ||
+        xsum_bounded_accumulator<-1022, 1023>::nchunks != XSUM_SCHUNKS) {
+      ++small_test_fails;
+      std::printf(" \n-- TEST 0\n");
+      std::printf("bounded: Wrong number of chunks\n");
+    }
+  }
+
+  /* Most of these values are outside [2^-60, 2^61), and are added to the
+     small accumulator for them */
+  for (int i = 0; i < ten_term_size; i += 11) {
+    double const s = ten_term[i + 10];
+
+    xsum_bounded_accumulator<-60, 60> bacc;
+    xsum_add(&bacc, ten_term + i, 10);
+    xsum_small_accumulator r = xsum_round_to_small(&bacc);
+    result(&r, s, i / 11);
+
+    xsum_bounded_accumulator<-1022, 1023> bacc1;
+    for (int j = 0; j < 10; ++j) {
+      xsum_add(&bacc1, ten_term[i + j]);
+    }
+    r = xsum_round_to_small(&bacc1);
+    result(&r, s, i / 11);
+
+    /* Merging a copy gives twice the sum */
+    xsum_bounded_accumulator<-60, 60> bacc2(bacc);
+    xsum_add(&bacc, &bacc2);
+    r = xsum_round_to_small(&bacc);
+    result(&r, s * 2, i / 11);
+  }
+
+  {
+    /* Values in range, with a few outliers, against the large accumulator */
+    int const n = 1 << 17;
+    std::vector<double> v(n);
+    std::vector<double> w(n);
+    unsigned long long r = 88172645463325252ULL;
+    for (int k = 0; k < n; ++k) {
+      r ^= r << 13;
+      r ^= r >> 7;
+      r ^= r << 17;
+      double const f = static_cast<double>(r >> 11) / 9007199254740992.0;
+      int const e = (k % 997 == 0) ? static_cast<int>(r % 2000) - 1000
+                                   : -60 + static_cast<int>(r % 121);
+      v[k] = std::ldexp((r & 1) ? 1 + f : -1 - f, e);
+      w[k] = std::ldexp(1.0 - f, -e / 2);
+    }
+
+    xsum_large_accumulator lacc;
+    xsum_add(&lacc, v);
+    double const s = xsum_round(&lacc);
+
+    xsum_bounded_accumulator<-60, 60> bacc;
+    xsum_add(&bacc, v);
+    xsum_small_accumulator sr = xsum_round_to_small(&bacc);
+    result(&sr, s, 0);
+
+    xsum_bounded_accumulator<-60, 60> bacc1;
+    for (int k = n - 1; k >= 0; --k) {
+      xsum_add(&bacc1, v[k]);
+    }
+    sr = xsum_round_to_small(&bacc1);
+    result(&sr, s, 1);
+
+    /* Parts of odd sizes, merged into the last one */
+    xsum_bounded_accumulator<-60, 60> bacc2;
+    for (int k = 0; k < n; k += 1001) {
+      xsum_bounded_accumulator<-60, 60> part;
+      xsum_add(&part, v.data() + k, std::min(1001, n - k));
+      xsum_add(&part, &bacc2);
+      bacc2 = part;
+    }
+    sr = xsum_round_to_small(&bacc2);
+    result(&sr, s, 2);
+
+    xsum_large_accumulator lacc_n;
+    xsum_add_sqnorm(&lacc_n, v);
+    xsum_bounded_accumulator<-120, 120> bacc_n;
+    xsum_add_sqnorm(&bacc_n, v);
+    sr = xsum_round_to_small(&bacc_n);
+    result(&sr, xsum_round(&lacc_n), 3);
+
+    xsum_large_accumulator lacc_d;
+    xsum_add_dot(&lacc_d, v, w);
+    xsum_bounded_accumulator<-30, 30> bacc_d;
+    xsum_add_dot(&bacc_d, v, w);
+    sr = xsum_round_to_small(&bacc_d);
+    result(&sr, xsum_round(&lacc_d), 4);
+
+    /* Init clears the values outside the range too */
+    xsum_init(&bacc);
+    xsum_add(&bacc, 0.5);
+    sr = xsum_round_to_small(&bacc);
+    result(&sr, 0.5, 5);
+  }
+
+#if defined(__unix__) || defined(__APPLE__)
+  std::printf("\nQ: MORE THAN 2^31 TERMS TEST\n");
+
+  {
+    /* An anonymous mapping reads as zeros without taking memory, except for
+       the pages written to */
+    xsum_length const n = (static_cast<xsum_length>(1) << 31) + 5;
+    std::size_t const bytes = n * sizeof(double);
+    void *const p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p != MAP_FAILED) {
+      double *const v = static_cast<double *>(p);
+      v[0] = 1.0;
+      v[(static_cast<xsum_length>(1) << 31) - 1] = 2.0;
+      v[static_cast<xsum_length>(1) << 31] = 4.0;
+      v[n - 1] = 8.0;
+
+      xsum_small_accumulator sacc;
+      xsum_add(&sacc, v, n);
+      result(&sacc, 15.0, 0);
+
+      xsum_large_accumulator lacc;
+      xsum_add(&lacc, v, n);
+      result(&lacc, 15.0, 0);
+
+      munmap(p, bytes);
+    }
+  }
+#endif
+
+  std::printf("\nR: SNAPSHOT AND ROLLBACK TESTS\n");
+
+  {
+    for (int i = 0; i < ten_term_size; i += 11) {
+      double const s = ten_term[i + 10];
+
+      for (int j = 0; j < ten_term_size; j += 55) {
+        /* Undo the adds since the snapshot, then redo them, checked against
+           adding both sets of terms */
+        xsum_large_accumulator lacc_ref;
+        xsum_add(&lacc_ref, ten_term + i, 10);
+        xsum_add(&lacc_ref, ten_term + j, 10);
+        double const s2 = xsum_round(&lacc_ref);
+
+        xsum_large_accumulator lacc;
+        xsum_small_accumulator snap;
+        xsum_add(&lacc, ten_term + i, 10);
+        xsum_snapshot(&lacc, &snap);
+        xsum_add(&lacc, ten_term + j, 10);
+        xsum_rollback(&lacc, &snap);
+        result(&lacc, s, i / 11);
+        xsum_add(&lacc, ten_term + j, 10);
+        result(&lacc, s2, i / 11);
+
+        xsum_small_accumulator sacc;
+        xsum_small_accumulator ssnap;
+        xsum_add(&sacc, ten_term + i, 10);
+        xsum_snapshot(&sacc, &ssnap);
+        xsum_add(&sacc, ten_term + j, 10);
+        xsum_rollback(&sacc, &ssnap);
+        result(&sacc, s, i / 11);
+        xsum_add(&sacc, ten_term + j, 10);
+        result(&sacc, s2, i / 11);
+      }
+
+      xsum_large xlacc;
+      xlacc.add(ten_term + i, 10);
+      xsum_small_accumulator const snap = xlacc.snapshot();
+      xlacc.add(ten_term, ten_term_size);
+      xlacc.rollback(snap);
+      result(xlacc.get(), s, i / 11);
+
+      xsum_small xsacc;
+      xsacc.add(ten_term + i, 10);
+      xsum_small_accumulator const ssnap = xsacc.snapshot();
+      xsacc.add(ten_term, ten_term_size);
+      xsacc.rollback(ssnap);
+      result(xsacc.get(), s, i / 11);
+    }
+
+    /* Batches over most exponents, some rolled back to the snapshot before
+       them or to an earlier one, and Infs that are rolled back */
+    std::vector<double> v(20000);
+    unsigned long long r = 88172645463325252ULL;
+    for (auto &x : v) {
+      r ^= r << 13;
+      r ^= r >> 7;
+      r ^= r << 17;
+      double const f = static_cast<double>(r >> 11) / 4503599627370496.0 - 1;
+      x = std::ldexp(f, static_cast<int>(r % 2001) - 1000);
+    }
+
+    xsum_large_accumulator lacc;
+    xsum_large_accumulator lacc_ref;
+    xsum_small_accumulator snap0;
+    xsum_snapshot(&lacc, &snap0);
+    xsum_small_accumulator snap;
+    for (int k = 0; k < 20; ++k) {
+      double const *const b = v.data() + k * 1000;
+      xsum_snapshot(&lacc, &snap);
+      xsum_add(&lacc, b, 1000);
+      if (k % 3 == 1) {
+        xsum_add(&lacc, 1.0 / 0.0);
+        xsum_rollback(&lacc, &snap);
+      } else {
+        xsum_add(&lacc_ref, b, 1000);
+      }
+    }
+    result(&lacc, xsum_round(&lacc_ref), 1);
+
+    xsum_rollback(&lacc, &snap0);
+    result(&lacc, 0.0, 2);
+    xsum_add(&lacc, v);
+    xsum_large_accumulator lacc_all;
+    xsum_add(&lacc_all, v);
+    result(&lacc, xsum_round(&lacc_all), 3);
+  }
+
+  std::printf("\nS: INTEGER VALUES TESTS\n");
+
+  {
+    /* Blocks of integers up to 2^51 - 1 in magnitude, of integers and other
+       values, and of Infs, NaNs and -0, against adding the values one at a
+       time */
+    int const n = 1 << 14;
+    std::vector<double> v(n);
+    unsigned long long r = 88172645463325252ULL;
+    for (int k = 0; k < n; ++k) {
+      r ^= r << 13;
+      r ^= r >> 7;
+      r ^= r << 17;
+      int const block = k / 256;
+      switch (block % 4) {
+        case 0:
+          v[k] = static_cast<double>(static_cast<long long>(r >> 13) -
+                                     (1LL << 50));
+          break;
+        case 1:
+          v[k] = block % 8 == 1 ? 2251799813685247.0 : -2251799813685247.0;
+          break;
+        case 2:
+          v[k] = static_cast<double>(static_cast<int>(r % 2000) - 1000);
+          break;
+        default:
+          v[k] = static_cast<double>(r >> 11) / 9007199254740992.0;
+      }
+    }
+    /* An integer block with a value just out of range, or not an integer */
+    v[2 * 256 + 100] = 2251799813685248.0;
+    v[6 * 256 + 255] = 0.5;
+    /* Non-integers at the start and end of a group of 32 */
+    v[10 * 256 + 32] = -0.25;
+    v[14 * 256 + 63] = 1e300;
+
+    xsum_small_accumulator sacc_ref;
+    for (int k = 0; k < n; ++k) {
+      xsum_add(&sacc_ref, v[k]);
+    }
+    double const s = xsum_round(&sacc_ref);
+
+    for (int const start : {0, 1, 255, 256, 1000}) {
+      xsum_small_accumulator sacc_i;
+      for (int k = 0; k < start; ++k) {
+        xsum_add(&sacc_i, v[k]);
+      }
+      xsum_add(&sacc_i, v.data() + start, n - start);
+      result(&sacc_i, s, start);
+
+      xsum_large_accumulator lacc;
+      xsum_add(&lacc, v.data(), start);
+      xsum_add(&lacc, v.data() + start, n - start);
+      result(&lacc, s, start);
+    }
+
+    xsum_small xsacc;
+    xsacc.add(v);
+    result(xsacc.get(), s, 0);
+
+    std::vector<double> w(1000, -0.0);
+    xsum_small_accumulator sacc_z;
+    xsum_add(&sacc_z, w);
+    result(&sacc_z, 0.0, 1);
+    w[700] = 1.0 / 0.0;
+    xsum_large_accumulator lacc_inf;
+    xsum_add(&lacc_inf, w);
+    result(&lacc_inf, 1.0 / 0.0, 2);
+    w[10] = 0.0 / 0.0;
+    xsum_add(&lacc_inf, w);
+    result(&lacc_inf, 0.0 / 0.0, 3);
+  }
+
+  std::printf("\nT: CARRY BUDGET TESTS\n");
+
+  {
+    /* Accumulators with different budgets side by side, on runs of one value
+       that fill the chunks and on values of any magnitude */
+    int const n = 20000;
+    std::vector<double> v(n);
+    unsigned long long r = 88172645463325252ULL;
+    for (int k = 0; k < n; ++k) {
+      r ^= r << 13;
+      r ^= r >> 7;
+      r ^= r << 17;
+      if ((k / 5000) % 2 == 0) {
+        v[k] = k % 3 == 0 ? -1.9999999999999998 : 1.5;
+      } else {
+        v[k] = std::ldexp(static_cast<double>(r >> 11) / 9007199254740992.0,
+                          static_cast<int>(r % 400) - 200);
+      }
+    }
+
+    xsum_small_accumulator sacc_ref;
+    for (int k = 0; k < n; ++k) {
+      xsum_add(&sacc_ref, v[k]);
+    }
+    double const s = xsum_round(&sacc_ref);
+
+    xsum_small_budget_accumulator<2> sacc2;
+    xsum_small_budget_accumulator<255> sacc255;
+    xsum_large_budget_accumulator<2, 1> lacc2;
+    xsum_large_budget_accumulator<255, 8> lacc255;
+    bool within = true;
+    for (int k = 0; k < n; ++k) {
+      xsum_add(&sacc2, v[k]);
+      xsum_add(&lacc2, v[k]);
+      within = within && sacc2.adds_until_propagate <= 2 &&
+               lacc2.sacc.adds_until_propagate <= 2;
+    }
+    for (int ix = 0; ix < XSUM_LCHUNKS; ++ix) {
+      within = within && lacc2.lcount(ix) <= 2;
+    }
+    ++total_small_test;
+    if (!within || lacc255.count_bits != 8) {
+      ++small_test_fails;
+      std::printf(" \n-- TEST 0\n");
+      std::printf("budget: Carry budget not kept\n");
+    }
+    result(&sacc2, s, 1);
+    result(&lacc2, s, 2);
+
+    xsum_add(&sacc255, v);
+    xsum_add(&lacc255, v.data(), n);
+    result(&sacc255, s, 3);
+    result(&lacc255, s, 4);
+
+    xsum_small_budget_accumulator<2> sacc2b;
+    xsum_add(&sacc2b, v.data(), n / 2);
+    xsum_add(&sacc2b, v.data() + n / 2, n - n / 2);
+    xsum_add(&sacc2b, &sacc2);
+    result(&sacc2b, 2 * s, 5);
+
+    xsum_init(&lacc255);
+    xsum_add_sqnorm(&lacc255, v);
+    xsum_large_accumulator lacc_sq;
+    xsum_add_sqnorm(&lacc_sq, v);
+    result(&lacc255, xsum_round(&lacc_sq), 6);
+
+    /* An accumulator for a range of exponents with a budget of 2, which it
+       gives to the sum of the values outside the range */
+    xsum_bounded_accumulator<-60, 60> bacc2(2);
+    xsum_add(&bacc2, v);
+    within = bacc2.adds_until_propagate <= 2 && bacc2.outside &&
+             bacc2.outside->carry_budget == 2;
+    xsum_bounded_accumulator<-60, 60> bacc2b(bacc2);
+    xsum_add(&bacc2b, &bacc2);
+    within = within && bacc2b.carry_budget == 2;
+    ++total_small_test;
+    if (!within) {
+      ++small_test_fails;
+      std::printf(" \n-- TEST 7\n");
+      std::printf("budget: Carry budget not kept\n");
+    }
+    xsum_small_accumulator sacc_b = xsum_round_to_small(&bacc2);
+    result(&sacc_b, s, 7);
+    xsum_small_accumulator sacc_b2 = xsum_round_to_small(&bacc2b);
+    result(&sacc_b2, 2 * s, 8);
+  }
+
   if (small_test_fails || large_test_fails) {
     std::printf(
         "\nTotal number of tests = %d\n"
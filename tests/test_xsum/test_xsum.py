@@ -205,7 +205,7 @@ def result(acc, s, i, msg):
 
     total_test += 1
 
-    if isinstance(acc, xsum_small_accumulator) or isinstance(acc, xsum_large_accumulator):
+    if isinstance(acc, (xsum_small_accumulator, xsum_large_accumulator, xsum_binned_accumulator)):
         r = xsum_round(acc)
         r2 = xsum_round(acc)
     elif isinstance(acc, xsum_small) or isinstance(acc, xsum_large):
@@ -482,6 +482,39 @@ class XSUMModule:
             lacc.add(a)
             self.assertTrue(result(lacc, s, i, msg))
 
+    def test_binned(self):
+        """H: BINNED ACCUMULATOR TESTS"""
+
+        msg = "H: BINNED ACCUMULATOR TESTS"
+
+        rng = np.random.default_rng(1)
+        a = rng.uniform(-1, 1, 10000) * np.exp2(rng.integers(-40, 40, 10000))
+        for fold in range(1, 5):
+            bacc = xsum_binned_accumulator(fold)
+            xsum_add(bacc, a)
+            s = xsum_round(bacc)
+
+            # Reversed, one at a time
+            bacc1 = xsum_binned_accumulator(fold)
+            for x in a[::-1]:
+                xsum_add(bacc1, x)
+            self.assertTrue(result(bacc1, s, fold, msg))
+
+            # Shuffled, in two parts merged
+            b = rng.permutation(a)
+            bacc2 = xsum_binned_accumulator(fold)
+            xsum_add(bacc2, b[:3333])
+            bacc3 = xsum_binned_accumulator(fold)
+            xsum_add(bacc3, b[3333:])
+            xsum_add(bacc2, bacc3)
+            self.assertTrue(result(bacc2, s, fold, msg))
+
+            bacc4 = xsum_binned_accumulator(fold)
+            xsum_add_dot(bacc4, a, a)
+            bacc5 = xsum_binned_accumulator(fold)
+            xsum_add_sqnorm(bacc5, b)
+            self.assertTrue(result(bacc5, xsum_round(bacc4), fold, msg))
+
 
 class TestXSUMModule(XSUMModule, unittest.TestCase):
     @classmethod
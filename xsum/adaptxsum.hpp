@@ -0,0 +1,413 @@
+//
+// ADAPTXSUM.hpp
+//
+// LGPL Version 2.1 HEADER START
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+//
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+// MA 02110-1301  USA
+//
+// LGPL Version 2.1 HEADER END
+//
+
+//
+// Copyright (c) 2020, Regents of the University of Minnesota.
+// All rights reserved.
+//
+// Contributors:
+//    Yaser Afshar
+//
+
+#ifndef ADAPTXSUM_HPP
+#define ADAPTXSUM_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "xsum.hpp"
+
+namespace xsum {
+
+/* CONSTANTS FOR THE ADAPTIVE SUM. */
+
+/*! # of independent compensated sums, so that the loop vectorizes */
+static constexpr int XSUM_ADAPT_LANES = 16;
+/*! Below this # of values, the fallback uses the small accumulator */
+static constexpr xsum_length XSUM_ADAPT_SMALL = 256;
+/*! Below this # of values, the concurrent policy reruns instead, as starting
+ * a thread costs more than the exact sum */
+static constexpr xsum_length XSUM_ADAPT_CONCURRENT_MIN = 1 << 16;
+/*! # of values the concurrent exact sum adds between checks whether it is
+ * still needed */
+static constexpr xsum_length XSUM_ADAPT_BLOCK = 1 << 14;
+/*! Unit roundoff, 2^-53 */
+static constexpr xsum_flt XSUM_ADAPT_U = 1.0 / 9007199254740992.0;
+
+/*!
+ * \brief What the adaptive sum does when the compensated sum does not
+ * determine the result
+ *
+ * \c rerun adds the values again with a superaccumulator, after the
+ * compensated sum.  \c concurrent starts the superaccumulator sum in another
+ * thread at the same time as the compensated sum, and stops it when it is
+ * not needed, which hides its time when there is an idle core and the
+ * fallback is frequent.
+ */
+enum class xsum_adapt_policy { rerun, concurrent };
+
+/*!
+ * \brief Counts of the adaptive sums, and of those that fell back to a
+ * superaccumulator
+ *
+ * It is not thread safe; each thread should have its own.
+ */
+struct xsum_adapt_stats {
+  std::size_t calls = 0;
+  std::size_t fallbacks = 0;
+};
+
+/*!
+ * \brief Compensated sum of the values, with a bound on its error
+ *
+ * \param vec values
+ * \param n # of values
+ * \param result the compensated sum, rounded
+ * \return true if \c result is the exact sum correctly rounded, false if
+ *         the error bound does not tell
+ */
+bool xsum_compensated_sum(xsum_flt const *const vec, xsum_length const n,
+                          xsum_flt *const result);
+
+/*!
+ * \brief Compensated dot product of two vectors, with a bound on its error
+ *
+ * As for \c xsum_add_dot, each product is rounded, and it is the sum of the
+ * rounded products that is exact.
+ *
+ * \return true if \c result is the exact sum of the products correctly
+ *         rounded
+ */
+bool xsum_compensated_dot(xsum_flt const *const vec1,
+                          xsum_flt const *const vec2, xsum_length const n,
+                          xsum_flt *const result);
+
+/*!
+ * \brief Exact sum of the values, correctly rounded, at nearly the speed of a
+ * compensated sum when that determines the result
+ *
+ * The values are first added with a compensated sum that keeps a rigorous
+ * bound on its error.  When the rounding of the sum is not determined by it
+ * (cancellation, ties, results near zero or overflow, Inf or NaN), the values
+ * are added with a superaccumulator, as the policy says.
+ *
+ * \code
+ * xsum_adapt_stats stats;
+ * double const s = xsum_sum_adaptive(vec, xsum_adapt_policy::rerun, &stats);
+ * \endcode
+ */
+xsum_flt xsum_sum_adaptive(
+    xsum_flt const *const vec, xsum_length const n,
+    xsum_adapt_policy const policy = xsum_adapt_policy::rerun,
+    xsum_adapt_stats *const stats = nullptr);
+
+xsum_flt xsum_sum_adaptive(
+    std::vector<xsum_flt> const &vec,
+    xsum_adapt_policy const policy = xsum_adapt_policy::rerun,
+    xsum_adapt_stats *const stats = nullptr);
+
+/*!
+ * \brief Exact squared norm of a vector, correctly rounded, adaptively as
+ * \c xsum_sum_adaptive
+ */
+xsum_flt xsum_sqnorm_adaptive(
+    xsum_flt const *const vec, xsum_length const n,
+    xsum_adapt_policy const policy = xsum_adapt_policy::rerun,
+    xsum_adapt_stats *const stats = nullptr);
+
+xsum_flt xsum_sqnorm_adaptive(
+    std::vector<xsum_flt> const &vec,
+    xsum_adapt_policy const policy = xsum_adapt_policy::rerun,
+    xsum_adapt_stats *const stats = nullptr);
+
+/*!
+ * \brief Exact dot product of two vectors, correctly rounded, adaptively as
+ * \c xsum_sum_adaptive
+ */
+xsum_flt xsum_dot_adaptive(
+    xsum_flt const *const vec1, xsum_flt const *const vec2,
+    xsum_length const n,
+    xsum_adapt_policy const policy = xsum_adapt_policy::rerun,
+    xsum_adapt_stats *const stats = nullptr);
+
+xsum_flt xsum_dot_adaptive(
+    std::vector<xsum_flt> const &vec1, std::vector<xsum_flt> const &vec2,
+    xsum_adapt_policy const policy = xsum_adapt_policy::rerun,
+    xsum_adapt_stats *const stats = nullptr);
+
+/* ERROR-FREE SUM.  s + e is exactly a + b, when nothing overflows.  An
+   overflow makes e (and then the result) Inf or NaN, never a wrong finite
+   value. */
+static inline void xsum_two_sum(xsum_flt const a, xsum_flt const b,
+                                xsum_flt *const s, xsum_flt *const e) {
+  xsum_flt const t = a + b;
+  xsum_flt const z = t - a;
+  *e = (a - (t - z)) + (b - z);
+  *s = t;
+}
+
+/* FINISH A COMPENSATED SUM.  The exact sum is the sum of the lane sums and
+   of the m error terms of the error-free sums.  The
+   lane sums are added with error-free sums too, and the error terms are
+   added in floating point, c being their sum and a the sum of their
+   magnitudes.  For m u < 2^-10, the error of c is at most 2 m u a, so the
+   exact sum is within bound of r + c = res + t.  It rounds to res when
+   |t| + bound is less than half the gap below |res|, which is the smaller
+   of the two gaps around it.  Since half the gap is a power of two, the
+   comparison stays true for the exact |t| + bound.  A result of zero has no
+   gap below, and is never taken. */
+static bool xsum_adapt_finish(xsum_flt const *const s, xsum_flt c, xsum_flt a,
+                              xsum_flt const m, xsum_flt *const result) {
+  xsum_flt r = s[0];
+  for (int l = 1; l < XSUM_ADAPT_LANES; ++l) {
+    xsum_flt e;
+    xsum_two_sum(r, s[l], &r, &e);
+    c += e;
+    a += std::fabs(e);
+  }
+
+  xsum_flt res, t;
+  xsum_two_sum(r, c, &res, &t);
+  *result = res;
+
+  if (m * XSUM_ADAPT_U >= 1.0 / 1024) {
+    return false;
+  }
+  xsum_flt const bound = (2 * m * XSUM_ADAPT_U) * a;
+  if (!std::isfinite(res) || !std::isfinite(bound)) {
+    return false;
+  }
+  xsum_flt const ares = std::fabs(res);
+  xsum_flt const gap = ares - std::nextafter(ares, xsum_flt(0));
+  return std::fabs(t) + bound < gap / 2;
+}
+
+/* ADD VALUES TO THE LANES.  Each lane keeps a running sum, s, with error-free
+   sums, and the sum of their errors, c, and of the magnitudes of those, a.
+   Values past the last multiple of the # of lanes go to the first lane.  The
+   lanes are copied to locals, which the compiler knows do not alias vec, so
+   that the loop vectorizes. */
+static inline void xsum_adapt_lanes(xsum_flt *const s, xsum_flt *const c,
+                                    xsum_flt *const a,
+                                    xsum_flt const *const vec,
+                                    xsum_length const n) {
+  xsum_flt ls[XSUM_ADAPT_LANES];
+  xsum_flt lc[XSUM_ADAPT_LANES];
+  xsum_flt la[XSUM_ADAPT_LANES];
+  std::copy(s, s + XSUM_ADAPT_LANES, ls);
+  std::copy(c, c + XSUM_ADAPT_LANES, lc);
+  std::copy(a, a + XSUM_ADAPT_LANES, la);
+
+  xsum_length i = 0;
+  for (; i + XSUM_ADAPT_LANES <= n; i += XSUM_ADAPT_LANES) {
+    for (int l = 0; l < XSUM_ADAPT_LANES; ++l) {
+      xsum_flt e;
+      xsum_two_sum(ls[l], vec[i + l], &ls[l], &e);
+      lc[l] += e;
+      la[l] += std::fabs(e);
+    }
+  }
+  for (; i < n; ++i) {
+    xsum_flt e;
+    xsum_two_sum(ls[0], vec[i], &ls[0], &e);
+    lc[0] += e;
+    la[0] += std::fabs(e);
+  }
+
+  std::copy(ls, ls + XSUM_ADAPT_LANES, s);
+  std::copy(lc, lc + XSUM_ADAPT_LANES, c);
+  std::copy(la, la + XSUM_ADAPT_LANES, a);
+}
+
+bool xsum_compensated_sum(xsum_flt const *const vec, xsum_length const n,
+                          xsum_flt *const result) {
+  xsum_flt s[XSUM_ADAPT_LANES] = {};
+  xsum_flt c[XSUM_ADAPT_LANES] = {};
+  xsum_flt a[XSUM_ADAPT_LANES] = {};
+
+  xsum_adapt_lanes(s, c, a, vec, n);
+
+  for (int l = 1; l < XSUM_ADAPT_LANES; ++l) {
+    c[0] += c[l];
+    a[0] += a[l];
+  }
+
+  return xsum_adapt_finish(s, c[0], a[0],
+                           static_cast<xsum_flt>(n) + XSUM_ADAPT_LANES, result);
+}
+
+bool xsum_compensated_dot(xsum_flt const *const vec1,
+                          xsum_flt const *const vec2, xsum_length const n,
+                          xsum_flt *const result) {
+  xsum_flt s[XSUM_ADAPT_LANES] = {};
+  xsum_flt c[XSUM_ADAPT_LANES] = {};
+  xsum_flt a[XSUM_ADAPT_LANES] = {};
+
+  /* The products go through a buffer, so that the compiler does not fuse
+     them with the sums, which would add the exact products */
+  xsum_flt pr[XSUM_ADAPT_LANES * 32];
+  constexpr xsum_length m = XSUM_ADAPT_LANES * 32;
+  for (xsum_length i = 0; i < n; i += m) {
+    xsum_length const k = std::min(m, n - i);
+    for (xsum_length j = 0; j < k; ++j) {
+      pr[j] = vec1[i + j] * vec2[i + j];
+    }
+    xsum_adapt_lanes(s, c, a, pr, k);
+  }
+
+  for (int l = 1; l < XSUM_ADAPT_LANES; ++l) {
+    c[0] += c[l];
+    a[0] += a[l];
+  }
+
+  return xsum_adapt_finish(s, c[0], a[0],
+                           static_cast<xsum_flt>(n) + XSUM_ADAPT_LANES, result);
+}
+
+/* EXACT SUM FOR THE FALLBACK.  When there is a stop flag, the values are
+   added in blocks, and the sum is abandoned once the flag is set. */
+static xsum_flt xsum_adapt_exact(xsum_flt const *const vec1,
+                                 xsum_flt const *const vec2,
+                                 xsum_length const n,
+                                 std::atomic<bool> const *const stop) {
+  if (n < XSUM_ADAPT_SMALL) {
+    xsum_small_accumulator sacc;
+    if (vec2) {
+      xsum_add_dot(&sacc, vec1, vec2, n);
+    } else {
+      xsum_add(&sacc, vec1, n);
+    }
+    return xsum_round(&sacc);
+  }
+
+  std::unique_ptr<xsum_large_accumulator> lacc(new xsum_large_accumulator);
+  xsum_length const block = stop ? XSUM_ADAPT_BLOCK : n;
+  for (xsum_length i = 0; i < n; i += block) {
+    if (stop && stop->load(std::memory_order_relaxed)) {
+      return 0;
+    }
+    xsum_length const m = std::min(block, n - i);
+    if (vec2) {
+      xsum_add_dot(lacc.get(), vec1 + i, vec2 + i, m);
+    } else {
+      xsum_add(lacc.get(), vec1 + i, m);
+    }
+  }
+  return xsum_round(lacc.get());
+}
+
+/* ADAPTIVE SUM OR DOT PRODUCT.  vec2 is null for a sum. */
+static xsum_flt xsum_adapt(xsum_flt const *const vec1,
+                           xsum_flt const *const vec2, xsum_length const n,
+                           xsum_adapt_policy const policy,
+                           xsum_adapt_stats *const stats) {
+  if (stats) {
+    ++stats->calls;
+  }
+
+  xsum_flt r;
+  if (policy == xsum_adapt_policy::concurrent &&
+      n >= XSUM_ADAPT_CONCURRENT_MIN) {
+    std::atomic<bool> stop(false);
+    xsum_flt exact = 0;
+    std::thread th(
+        [&]() { exact = xsum_adapt_exact(vec1, vec2, n, &stop); });
+    bool const ok = vec2 ? xsum_compensated_dot(vec1, vec2, n, &r)
+                         : xsum_compensated_sum(vec1, n, &r);
+    if (ok) {
+      stop.store(true, std::memory_order_relaxed);
+    }
+    th.join();
+    if (ok) {
+      return r;
+    }
+    if (stats) {
+      ++stats->fallbacks;
+    }
+    return exact;
+  }
+
+  bool const ok = vec2 ? xsum_compensated_dot(vec1, vec2, n, &r)
+                       : xsum_compensated_sum(vec1, n, &r);
+  if (ok) {
+    return r;
+  }
+  if (stats) {
+    ++stats->fallbacks;
+  }
+  return xsum_adapt_exact(vec1, vec2, n, nullptr);
+}
+
+xsum_flt xsum_sum_adaptive(xsum_flt const *const vec, xsum_length const n,
+                           xsum_adapt_policy const policy,
+                           xsum_adapt_stats *const stats) {
+  return xsum_adapt(vec, nullptr, n, policy, stats);
+}
+
+xsum_flt xsum_sum_adaptive(std::vector<xsum_flt> const &vec,
+                           xsum_adapt_policy const policy,
+                           xsum_adapt_stats *const stats) {
+  return xsum_adapt(vec.data(), nullptr, static_cast<xsum_length>(vec.size()),
+                    policy, stats);
+}
+
+xsum_flt xsum_sqnorm_adaptive(xsum_flt const *const vec, xsum_length const n,
+                              xsum_adapt_policy const policy,
+                              xsum_adapt_stats *const stats) {
+  return xsum_adapt(vec, vec, n, policy, stats);
+}
+
+xsum_flt xsum_sqnorm_adaptive(std::vector<xsum_flt> const &vec,
+                              xsum_adapt_policy const policy,
+                              xsum_adapt_stats *const stats) {
+  return xsum_adapt(vec.data(), vec.data(),
+                    static_cast<xsum_length>(vec.size()), policy, stats);
+}
+
+xsum_flt xsum_dot_adaptive(xsum_flt const *const vec1,
+                           xsum_flt const *const vec2, xsum_length const n,
+                           xsum_adapt_policy const policy,
+                           xsum_adapt_stats *const stats) {
+  return xsum_adapt(vec1, vec2, n, policy, stats);
+}
+
+xsum_flt xsum_dot_adaptive(std::vector<xsum_flt> const &vec1,
+                           std::vector<xsum_flt> const &vec2,
+                           xsum_adapt_policy const policy,
+                           xsum_adapt_stats *const stats) {
+  xsum_length const n = static_cast<xsum_length>(vec1.size());
+  if (n > static_cast<xsum_length>(vec2.size())) {
+    return 0;
+  }
+  return xsum_adapt(vec1.data(), vec2.data(), n, policy, stats);
+}
+
+}  // namespace xsum
+
+#endif  // ADAPTXSUM_HPP
@@ -0,0 +1,287 @@
+//
+// DELTAXSUM.hpp
+//
+// LGPL Version 2.1 HEADER START
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+//
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+// MA 02110-1301  USA
+//
+// LGPL Version 2.1 HEADER END
+//
+
+//
+// Copyright (c) 2020, Regents of the University of Minnesota.
+// All rights reserved.
+//
+// Contributors:
+//    Yaser Afshar
+//
+
+#ifndef DELTAXSUM_HPP
+#define DELTAXSUM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "xsum.hpp"
+
+namespace xsum {
+
+/* CONSTANTS FOR THE DELTA ENCODING. */
+
+/*! Bit of the flags byte of a delta, set if the Inf field follows */
+static constexpr unsigned char XSUM_DELTA_INF = 1;
+/*! Bit of the flags byte of a delta, set if the NaN field follows */
+static constexpr unsigned char XSUM_DELTA_NAN = 2;
+/*! Bit of the flags byte of a delta, set if it holds the whole sum, which
+ * replaces that of the replica */
+static constexpr unsigned char XSUM_DELTA_FULL = 4;
+/*! Bound on the magnitude of a chunk of a delta.  After carry propagation,
+ * chunks are in [0, 2^32), or [-2^32, 2^32) for the top one, so the
+ * difference of two is less than 2^33 in magnitude. */
+static constexpr std::int64_t XSUM_DELTA_CHUNK_MAX = std::int64_t{1} << 33;
+
+/*!
+ * \brief Sender side of the replication of a sum, by deltas
+ *
+ * The encoder keeps the sum as of the last delta it made, in a small
+ * accumulator, with its carries propagated.  A delta is the difference of
+ * the chunks of the sum now, carry propagated too, and of those, for the
+ * chunks where they differ, with the Inf and NaN fields if they changed.  A
+ * replica that starts empty and adds all deltas made by the encoder, once
+ * each and in order, holds the same sum as the accumulator.
+ *
+ * Adding a sum never takes an Inf or NaN away, so when one goes away or
+ * changes (after xsum_rollback, or xsum_init), the delta is a full one
+ * instead, with the nonzero chunks of the sum and its Inf and NaN fields,
+ * which replaces the sum of the replica.
+ *
+ * A delta is written as bytes, which do not depend on the byte order of the
+ * machine,
+ *
+ *   byte 0: # of chunks that follow, at most XSUM_SCHUNKS
+ *   byte 1: flags, XSUM_DELTA_INF | XSUM_DELTA_NAN | XSUM_DELTA_FULL
+ *   Inf, then NaN, if in the flags, as varints
+ *   for each chunk, its index as a byte, then its difference as a varint
+ *
+ * where a varint is a zigzag-encoded integer in groups of 7 bits, lowest
+ * first, with the top bit of each byte set if more follow.  A delta with
+ * nothing in it is 2 bytes, and one for a few values of similar magnitude,
+ * which change a few chunks, some 10 to 20 bytes, against 560 bytes for a
+ * small accumulator or 40 kB for a large one.
+ *
+ * \code
+ * // sender
+ * xsum_delta_encoder enc;
+ * std::vector<unsigned char> buf;
+ * xsum_add(&lacc, vec, n);
+ * enc.encode(&lacc, buf);
+ * // replica
+ * xsum_apply_delta(&replica, buf.data(), buf.size());
+ * \endcode
+ */
+class xsum_delta_encoder {
+ public:
+  /*!
+   * \brief Construct a new xsum delta encoder object, for a sum of zero
+   *
+   */
+  xsum_delta_encoder();
+
+  /*!
+   * \brief Append the delta of the sum in acc since the last one to out
+   *
+   * For a large accumulator, this takes a snapshot of it (see
+   * xsum_snapshot), so it costs in proportion to the chunks used since the
+   * last delta.
+   *
+   * \return the # of bytes appended
+   */
+  template <typename accumulatorType>
+  std::size_t encode(accumulatorType *const acc,
+                     std::vector<unsigned char> &out);
+
+  /*!
+   * \brief Make the next delta a full one
+   *
+   * For a new replica, or one that has missed deltas.
+   */
+  void reset();
+
+ private:
+  xsum_small_accumulator _base;
+  bool _full;
+};
+
+/*!
+ * \brief Add a delta to an accumulator
+ *
+ * \param acc accumulator of the replica
+ * \param data bytes of the delta
+ * \param n # of bytes available, at least the size of the delta
+ * \return the # of bytes of the delta, so that deltas can be read one after
+ * another from a buffer
+ *
+ * A delta that is truncated or malformed throws \c std::runtime_error, and
+ * leaves the accumulator unchanged.
+ */
+template <typename accumulatorType>
+std::size_t xsum_apply_delta(accumulatorType *const acc,
+                             unsigned char const *const data,
+                             std::size_t const n);
+
+/* VARINTS.  A signed integer is zigzag encoded, so that small magnitudes of
+   either sign take few bytes, and written 7 bits at a time. */
+
+static void xsum_delta_put(std::vector<unsigned char> &out,
+                           std::int64_t const v) {
+  std::uint64_t u = (static_cast<std::uint64_t>(v) << 1) ^
+                    static_cast<std::uint64_t>(v >> 63);
+  while (u >= 0x80) {
+    out.push_back(static_cast<unsigned char>(u | 0x80));
+    u >>= 7;
+  }
+  out.push_back(static_cast<unsigned char>(u));
+}
+
+static std::int64_t xsum_delta_get(unsigned char const *const data,
+                                   std::size_t const n, std::size_t &i) {
+  std::uint64_t u = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (i == n) {
+      throw std::runtime_error("xsum delta: truncated");
+    }
+    unsigned char const b = data[i++];
+    u |= static_cast<std::uint64_t>(b & 0x7f) << shift;
+    if ((b & 0x80) == 0) {
+      return static_cast<std::int64_t>(u >> 1) ^
+             -static_cast<std::int64_t>(u & 1);
+    }
+  }
+  throw std::runtime_error("xsum delta: varint too long");
+}
+
+xsum_delta_encoder::xsum_delta_encoder() : _full(false) {}
+
+void xsum_delta_encoder::reset() { _full = true; }
+
+template <typename accumulatorType>
+std::size_t xsum_delta_encoder::encode(accumulatorType *const acc,
+                                       std::vector<unsigned char> &out) {
+  xsum_small_accumulator cur;
+  xsum_snapshot<accumulatorType>(acc, &cur);
+  xsum_carry_propagate<xsum_small_accumulator>(&cur);
+
+  std::size_t const start = out.size();
+  out.push_back(0);
+  out.push_back(0);
+
+  /* An Inf or NaN that goes away or changes cannot be added */
+  if ((_base.Inf != 0 && cur.Inf != _base.Inf) ||
+      (_base.NaN != 0 && cur.NaN != _base.NaN)) {
+    _full = true;
+  }
+  if (_full) {
+    _base = xsum_small_accumulator();
+  }
+
+  unsigned char flags = _full ? XSUM_DELTA_FULL : 0;
+  if (cur.Inf != _base.Inf) {
+    flags |= XSUM_DELTA_INF;
+    xsum_delta_put(out, cur.Inf);
+  }
+  if (cur.NaN != _base.NaN) {
+    flags |= XSUM_DELTA_NAN;
+    xsum_delta_put(out, cur.NaN);
+  }
+
+  unsigned char k = 0;
+  for (int i = 0; i < XSUM_SCHUNKS; ++i) {
+    if (cur.chunk[i] != _base.chunk[i]) {
+      out.push_back(static_cast<unsigned char>(i));
+      xsum_delta_put(out, cur.chunk[i] - _base.chunk[i]);
+      ++k;
+    }
+  }
+
+  out[start] = k;
+  out[start + 1] = flags;
+  _base = cur;
+  _full = false;
+  return out.size() - start;
+}
+
+template <typename accumulatorType>
+std::size_t xsum_apply_delta(accumulatorType *const acc,
+                             unsigned char const *const data,
+                             std::size_t const n) {
+  if (n < 2) {
+    throw std::runtime_error("xsum delta: truncated");
+  }
+  int const k = data[0];
+  unsigned char const flags = data[1];
+  if (k > XSUM_SCHUNKS ||
+      (flags & ~(XSUM_DELTA_INF | XSUM_DELTA_NAN | XSUM_DELTA_FULL)) != 0) {
+    throw std::runtime_error("xsum delta: malformed");
+  }
+
+  std::size_t i = 2;
+  xsum_small_accumulator d;
+  xsum_small_accumulator inf;
+  xsum_small_accumulator nan;
+  if (flags & XSUM_DELTA_INF) {
+    inf.Inf = xsum_delta_get(data, n, i);
+  }
+  if (flags & XSUM_DELTA_NAN) {
+    nan.NaN = xsum_delta_get(data, n, i);
+  }
+  for (int c = 0; c < k; ++c) {
+    if (i == n) {
+      throw std::runtime_error("xsum delta: truncated");
+    }
+    int const ix = data[i++];
+    std::int64_t const v = xsum_delta_get(data, n, i);
+    if (ix >= XSUM_SCHUNKS || v <= -XSUM_DELTA_CHUNK_MAX ||
+        v >= XSUM_DELTA_CHUNK_MAX) {
+      throw std::runtime_error("xsum delta: malformed");
+    }
+    d.chunk[ix] = v;
+  }
+
+  /* The chunks first, as adding an Inf or NaN leaves them out, and adding
+     chunks to a NaN does too.  The Inf and the NaN are added separately, as
+     adding an accumulator with an Inf leaves its NaN out */
+  if (flags & XSUM_DELTA_FULL) {
+    xsum_init<accumulatorType>(acc);
+  }
+  xsum_add<accumulatorType>(acc,
+                            static_cast<xsum_small_accumulator const *>(&d));
+  if (inf.Inf != 0) {
+    xsum_add<accumulatorType>(acc,
+                              static_cast<xsum_small_accumulator const *>(&inf));
+  }
+  if (nan.NaN != 0) {
+    xsum_add<accumulatorType>(acc,
+                              static_cast<xsum_small_accumulator const *>(&nan));
+  }
+  return i;
+}
+
+}  // namespace xsum
+
+#endif  // DELTAXSUM_HPP
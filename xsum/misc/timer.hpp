@@ -18,11 +18,31 @@
 #ifndef TIMER_HPP
 #define TIMER_HPP
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define UMUQ_TIMER_TSC
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 /*! \class umuqTimer
  *
  * \brief Start stopwatch timer class
@@ -132,4 +152,493 @@ inline void umuqTimer::print() {
     }
 }
 
+/*!
+ * \brief Read the tick counter
+ *
+ * It is the time stamp counter on x86, which costs a few nanoseconds to read, and the ticks of
+ * \c std::chrono::steady_clock elsewhere.
+ */
+inline std::uint64_t umuqTicks() {
+#ifdef UMUQ_TIMER_TSC
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+/*! \class umuqHardwareCounters
+ *
+ * \brief Hardware counters of the calling thread (cycles, instructions, and cache misses)
+ *
+ * They are read as one group with Linux \c perf_event_open. Where this is not available, or not allowed (see
+ * \c /proc/sys/kernel/perf_event_paranoid), the counters are disabled and read as zeros.
+ */
+class umuqHardwareCounters {
+   public:
+    /*! Number of counters */
+    static constexpr int numCounters = 3;
+
+    /*!
+     * \brief Construct a new umuqHardwareCounters object, and start counting for the calling thread
+     *
+     */
+    umuqHardwareCounters();
+
+    /*!
+     * \brief Destroy the umuqHardwareCounters object
+     *
+     */
+    ~umuqHardwareCounters();
+
+    umuqHardwareCounters(umuqHardwareCounters const &) = delete;
+    umuqHardwareCounters &operator=(umuqHardwareCounters const &) = delete;
+
+    /*!
+     * \brief Whether the counters could be opened
+     *
+     */
+    inline bool enabled() const;
+
+    /*!
+     * \brief Read the current values of the counters
+     *
+     * \param values Array of \c numCounters values
+     */
+    inline void read(std::uint64_t *values) const;
+
+    /*! Names of the counters */
+    static char const *const names[numCounters];
+
+   private:
+    /*! File descriptors of the counters, the first one leads the group */
+    int fd[numCounters];
+};
+
+char const *const umuqHardwareCounters::names[umuqHardwareCounters::numCounters] = {"cycles", "instructions",
+                                                                                     "cache-misses"};
+
+umuqHardwareCounters::umuqHardwareCounters() {
+    std::fill(fd, fd + numCounters, -1);
+#ifdef __linux__
+    std::uint64_t const configs[numCounters] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                PERF_COUNT_HW_CACHE_MISSES};
+    for (int i = 0; i < numCounters; i++) {
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = configs[i];
+        attr.disabled = i == 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        fd[i] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fd[0], 0));
+        if (fd[i] < 0) {
+            for (int j = 0; j < i; j++) {
+                close(fd[j]);
+            }
+            std::fill(fd, fd + numCounters, -1);
+            return;
+        }
+    }
+    ioctl(fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+umuqHardwareCounters::~umuqHardwareCounters() {
+#ifdef __linux__
+    for (int i = 0; i < numCounters; i++) {
+        if (fd[i] >= 0) {
+            close(fd[i]);
+        }
+    }
+#endif
+}
+
+inline bool umuqHardwareCounters::enabled() const { return fd[0] >= 0; }
+
+inline void umuqHardwareCounters::read(std::uint64_t *values) const {
+#ifdef __linux__
+    if (enabled()) {
+        /* The group is read as the number of counters followed by their values */
+        std::uint64_t buffer[numCounters + 1];
+        if (::read(fd[0], buffer, sizeof(buffer)) == static_cast<ssize_t>(sizeof(buffer))) {
+            std::copy(buffer + 1, buffer + 1 + numCounters, values);
+            return;
+        }
+    }
+#endif
+    std::fill(values, values + numCounters, 0);
+}
+
+/*!
+ * \brief Statistics of one named timer, in the tree of nested timers of a thread
+ *
+ */
+struct umuqTimerNode {
+    /*! Name of the timer */
+    char const *name;
+    /*! Index of the enclosing timer */
+    std::size_t parent;
+    /*! Indices of the timers nested in this one */
+    std::vector<std::size_t> children;
+    /*! Number of calls */
+    std::uint64_t calls = 0;
+    /*! Total, minimum, and maximum number of ticks of a call */
+    std::uint64_t ticks = 0;
+    std::uint64_t minTicks = ~std::uint64_t(0);
+    std::uint64_t maxTicks = 0;
+    /*! Total counts of the hardware counters */
+    std::uint64_t counters[umuqHardwareCounters::numCounters] = {};
+    /*! Number of threads with calls to this timer, set when merging the threads for the report */
+    std::size_t threads = 0;
+};
+
+/*! \class umuqThreadTimers
+ *
+ * \brief Tree of the nested timers of one thread
+ *
+ * Node 0 is the root, which is not a timer.  A timer started inside another one is a child of that one, so the same
+ * name at different places makes different nodes.
+ */
+class umuqThreadTimers {
+   public:
+    /*!
+     * \brief Construct a new umuqThreadTimers object
+     *
+     * \param withCounters Whether to read the hardware counters in each timer
+     */
+    explicit umuqThreadTimers(bool const withCounters);
+
+    /*!
+     * \brief Index of the child of the current node with this name, which is added if it is not there
+     *
+     */
+    inline std::size_t child(char const *name);
+
+    /*!
+     * \brief Remove all timers
+     *
+     */
+    void clear();
+
+   public:
+    /*! Nodes of the tree */
+    std::vector<umuqTimerNode> nodes;
+
+    /*! Index of the innermost running timer, or 0 */
+    std::size_t current;
+
+    /*! Hardware counters of the thread, if enabled */
+    std::unique_ptr<umuqHardwareCounters> hardwareCounters;
+};
+
+umuqThreadTimers::umuqThreadTimers(bool const withCounters) : current(0) {
+    clear();
+    if (withCounters) {
+        hardwareCounters.reset(new umuqHardwareCounters);
+        if (!hardwareCounters->enabled()) {
+            hardwareCounters.reset();
+        }
+    }
+}
+
+inline std::size_t umuqThreadTimers::child(char const *name) {
+    /* Names are usually string literals, so compare the pointers first */
+    for (std::size_t const i : nodes[current].children) {
+        if (nodes[i].name == name || std::strcmp(nodes[i].name, name) == 0) {
+            return i;
+        }
+    }
+    umuqTimerNode node;
+    node.name = name;
+    node.parent = current;
+    nodes.push_back(node);
+    nodes[current].children.push_back(nodes.size() - 1);
+    return nodes.size() - 1;
+}
+
+void umuqThreadTimers::clear() {
+    nodes.clear();
+    umuqTimerNode root;
+    root.name = "";
+    root.parent = 0;
+    nodes.push_back(root);
+    current = 0;
+}
+
+/*! \class umuqProfiler
+ *
+ * \brief Collection of the timers of all threads, and their summary report
+ *
+ * Each thread times into its own tree of timers, with no locking, which is registered here when the thread starts its
+ * first timer.  The trees outlive their threads.  \c report merges the trees of all threads by the path of names from
+ * the root, and prints for each timer its number of calls, total and mean time, share of the enclosing timer, number of
+ * threads, and the hardware counts if they are enabled.
+ *
+ * \note
+ * - \c report and \c reset read and change the trees of all threads, so they must only be called while no other thread
+ *   is timing, e.g. after joining them.
+ * - Names are kept as pointers, so they must outlive the report (string literals do).
+ */
+class umuqProfiler {
+   public:
+    /*!
+     * \brief Tree of timers of the calling thread
+     *
+     */
+    static umuqThreadTimers *threadTimers();
+
+    /*!
+     * \brief Enable or disable the hardware counters, for the threads that start their first timer afterwards
+     *
+     * \param flag Indicator flag (default is false, or true if the environment variable UMUQ_TIMER_COUNTERS is set)
+     */
+    static void enableHardwareCounters(bool const flag);
+
+    /*!
+     * \brief Number of ticks of \c umuqTicks per second
+     *
+     * With the time stamp counter, it is measured against \c std::chrono::steady_clock since the profiler started
+     * (for at least 50 ms).
+     */
+    static double ticksPerSecond();
+
+    /*!
+     * \brief Print the summary report of the timers of all threads
+     *
+     * \param os Output stream (default is std::cout)
+     */
+    static void report(std::ostream &os = std::cout);
+
+    /*!
+     * \brief Remove the timers of all threads
+     *
+     */
+    static void reset();
+
+   private:
+    umuqProfiler();
+
+    /*! The only profiler */
+    static umuqProfiler &instance();
+
+    /*! Merge node i of a thread tree into node m of the merged tree */
+    static void merge(umuqThreadTimers const &from, std::size_t const i, umuqThreadTimers &to, std::size_t const m);
+
+    /*! Print node i of the merged tree and the timers nested in it */
+    static void print(std::ostream &os, umuqThreadTimers const &tree, std::size_t const i, int const depth,
+                      double const tickSeconds, bool const withCounters);
+
+   private:
+    /*! Guards the list of threads */
+    std::mutex mutex;
+
+    /*! Trees of timers of all threads */
+    std::vector<std::shared_ptr<umuqThreadTimers>> threads;
+
+    /*! Whether new threads read the hardware counters */
+    std::atomic<bool> countersFlag;
+
+    /*! Ticks and time at the start, to measure the rate of the ticks */
+    std::uint64_t startTicks;
+    std::chrono::steady_clock::time_point startTime;
+};
+
+umuqProfiler::umuqProfiler()
+    : countersFlag(std::getenv("UMUQ_TIMER_COUNTERS") != nullptr),
+      startTicks(umuqTicks()),
+      startTime(std::chrono::steady_clock::now()) {}
+
+umuqProfiler &umuqProfiler::instance() {
+    static umuqProfiler profiler;
+    return profiler;
+}
+
+umuqThreadTimers *umuqProfiler::threadTimers() {
+    static thread_local umuqThreadTimers *timers = nullptr;
+    if (!timers) {
+        umuqProfiler &p = instance();
+        std::shared_ptr<umuqThreadTimers> t(new umuqThreadTimers(p.countersFlag.load()));
+        std::lock_guard<std::mutex> lock(p.mutex);
+        p.threads.push_back(t);
+        timers = t.get();
+    }
+    return timers;
+}
+
+void umuqProfiler::enableHardwareCounters(bool const flag) { instance().countersFlag.store(flag); }
+
+double umuqProfiler::ticksPerSecond() {
+#ifdef UMUQ_TIMER_TSC
+    umuqProfiler &p = instance();
+    std::chrono::duration<double> elapsedTime;
+    std::uint64_t ticks;
+    do {
+        ticks = umuqTicks();
+        elapsedTime = std::chrono::steady_clock::now() - p.startTime;
+    } while (elapsedTime.count() < 0.05);
+    return (ticks - p.startTicks) / elapsedTime.count();
+#else
+    return static_cast<double>(std::chrono::steady_clock::period::den) / std::chrono::steady_clock::period::num;
+#endif
+}
+
+void umuqProfiler::merge(umuqThreadTimers const &from, std::size_t const i, umuqThreadTimers &to,
+                         std::size_t const m) {
+    umuqTimerNode const &f = from.nodes[i];
+    {
+        umuqTimerNode &t = to.nodes[m];
+        if (f.calls) {
+            t.calls += f.calls;
+            t.ticks += f.ticks;
+            t.minTicks = std::min(t.minTicks, f.minTicks);
+            t.maxTicks = std::max(t.maxTicks, f.maxTicks);
+            for (int k = 0; k < umuqHardwareCounters::numCounters; k++) {
+                t.counters[k] += f.counters[k];
+            }
+            t.threads++;
+        }
+    }
+    for (std::size_t const c : f.children) {
+        to.current = m;
+        std::size_t const n = to.child(from.nodes[c].name);
+        merge(from, c, to, n);
+    }
+}
+
+void umuqProfiler::print(std::ostream &os, umuqThreadTimers const &tree, std::size_t const i, int const depth,
+                         double const tickSeconds, bool const withCounters) {
+    umuqTimerNode const &node = tree.nodes[i];
+    if (i) {
+        double const total = node.ticks * tickSeconds;
+        umuqTimerNode const &parent = tree.nodes[node.parent];
+        std::string const name = std::string(2 * (depth - 1), ' ') + node.name;
+        os << std::left << std::setw(32) << name << std::right << std::setw(10) << node.calls << std::fixed
+           << std::setprecision(6) << std::setw(14) << total << std::setprecision(3) << std::setw(14)
+           << 1e6 * total / node.calls << std::setw(14) << 1e6 * node.minTicks * tickSeconds << std::setw(14)
+           << 1e6 * node.maxTicks * tickSeconds << std::setprecision(1) << std::setw(9)
+           << (node.parent ? 100.0 * node.ticks / parent.ticks : 100.0) << std::setw(9) << node.threads;
+        if (withCounters) {
+            os << std::setw(16) << node.counters[0] << std::setw(16) << node.counters[1] << std::setprecision(2)
+               << std::setw(8) << (node.counters[0] ? static_cast<double>(node.counters[1]) / node.counters[0] : 0.0)
+               << std::setw(16) << node.counters[2];
+        }
+        os << std::defaultfloat << std::endl;
+    }
+    for (std::size_t const c : node.children) {
+        print(os, tree, c, depth + 1, tickSeconds, withCounters);
+    }
+}
+
+void umuqProfiler::report(std::ostream &os) {
+    umuqProfiler &p = instance();
+    double const tickSeconds = 1.0 / ticksPerSecond();
+
+    umuqThreadTimers merged(false);
+    bool withCounters = false;
+    {
+        std::lock_guard<std::mutex> lock(p.mutex);
+        for (auto const &t : p.threads) {
+            merge(*t, 0, merged, 0);
+            withCounters = withCounters || t->hardwareCounters;
+        }
+    }
+
+    os << std::left << std::setw(32) << "timer" << std::right << std::setw(10) << "calls" << std::setw(14)
+       << "total[s]" << std::setw(14) << "mean[us]" << std::setw(14) << "min[us]" << std::setw(14) << "max[us]"
+       << std::setw(9) << "%parent" << std::setw(9) << "threads";
+    if (withCounters) {
+        os << std::setw(16) << umuqHardwareCounters::names[0] << std::setw(16) << umuqHardwareCounters::names[1]
+           << std::setw(8) << "IPC" << std::setw(16) << umuqHardwareCounters::names[2];
+    }
+    os << std::endl;
+    print(os, merged, 0, 0, tickSeconds, withCounters);
+}
+
+void umuqProfiler::reset() {
+    umuqProfiler &p = instance();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    for (auto const &t : p.threads) {
+        t->clear();
+    }
+}
+
+/*! \class umuqScopedTimer
+ *
+ * \brief Named timer running from its construction to the end of its scope
+ *
+ * The time, and the hardware counts if enabled, are added to the timer of this name nested in the innermost running
+ * timer of the thread.
+ *
+ * \code
+ * {
+ *     umuqScopedTimer t("reduce");
+ *     {
+ *         umuqScopedTimer t2("add");
+ *         ...
+ *     }
+ * }
+ * umuqProfiler::report();
+ * \endcode
+ */
+class umuqScopedTimer {
+   public:
+    /*!
+     * \brief Construct a new umuqScopedTimer object, and start the timer
+     *
+     * \param name Name of the timer, which must outlive the report (e.g. a string literal)
+     */
+    explicit umuqScopedTimer(char const *name);
+
+    /*!
+     * \brief Destroy the umuqScopedTimer object, and stop the timer
+     *
+     */
+    ~umuqScopedTimer();
+
+    umuqScopedTimer(umuqScopedTimer const &) = delete;
+    umuqScopedTimer &operator=(umuqScopedTimer const &) = delete;
+
+   private:
+    /*! Tree of timers of the thread */
+    umuqThreadTimers *timers;
+
+    /*! Index of the node of the timer */
+    std::size_t node;
+
+    /*! Hardware counts at the start */
+    std::uint64_t startCounters[umuqHardwareCounters::numCounters];
+
+    /*! Ticks at the start */
+    std::uint64_t startTicks;
+};
+
+umuqScopedTimer::umuqScopedTimer(char const *name) : timers(umuqProfiler::threadTimers()) {
+    node = timers->child(name);
+    timers->current = node;
+    if (timers->hardwareCounters) {
+        timers->hardwareCounters->read(startCounters);
+    }
+    startTicks = umuqTicks();
+}
+
+umuqScopedTimer::~umuqScopedTimer() {
+    std::uint64_t const ticks = umuqTicks() - startTicks;
+    umuqTimerNode &n = timers->nodes[node];
+    if (timers->hardwareCounters) {
+        std::uint64_t counters[umuqHardwareCounters::numCounters];
+        timers->hardwareCounters->read(counters);
+        for (int k = 0; k < umuqHardwareCounters::numCounters; k++) {
+            n.counters[k] += counters[k] - startCounters[k];
+        }
+    }
+    n.calls++;
+    n.ticks += ticks;
+    n.minTicks = std::min(n.minTicks, ticks);
+    n.maxTicks = std::max(n.maxTicks, ticks);
+    timers->current = n.parent;
+}
+
 #endif  // TIMER_HPP
\ No newline at end of file
@@ -0,0 +1,536 @@
+//
+// WORKLOAD.hpp
+//
+// LGPL Version 2.1 HEADER START
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+//
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+// MA 02110-1301  USA
+//
+// LGPL Version 2.1 HEADER END
+//
+
+//
+// Copyright (c) 2020, Regents of the University of Minnesota.
+// All rights reserved.
+//
+// Contributors:
+//    Yaser Afshar
+//
+
+#ifndef WORKLOAD_HPP
+#define WORKLOAD_HPP
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../xsum.hpp"
+
+namespace xsum {
+
+/*!
+ * \brief Kind of values of a workload
+ *
+ * - \c uniform values in [-1, 1)
+ * - \c wide values with random signs and exponents in [min_exp, max_exp]
+ * - \c cancel pairs of wide values and their negations, and one value smaller
+ *   than all of them, which is the exact sum, in random order
+ * - \c denormal mostly denormalized numbers, and some of the smallest normal
+ *   numbers
+ * - \c narrow amounts in cents, up to a million, as in financial data
+ * - \c inf_nan uniform values, with a fraction of them replaced by +Inf, -Inf,
+ *   or NaN
+ * - \c integer whole numbers, up to a billion in magnitude, as counts or
+ *   amounts in cents stored as doubles
+ */
+enum class xsum_workload_kind {
+  uniform,
+  wide,
+  cancel,
+  denormal,
+  narrow,
+  inf_nan,
+  integer
+};
+
+/*!
+ * \brief Order of the values of a workload
+ *
+ * - \c generated as generated
+ * - \c shuffled in random order
+ * - \c sorted in increasing order
+ * - \c increasing in increasing order of magnitude
+ * - \c decreasing in decreasing order of magnitude, the worst for a plain sum,
+ *   as the small values are lost in the large partial sums
+ * - \c alternating positive and negative values in turn, each in decreasing
+ *   order of magnitude, so that the partial sums cancel again and again
+ *
+ * NaNs are sorted as if larger than any other value.
+ */
+enum class xsum_workload_order {
+  generated,
+  shuffled,
+  sorted,
+  increasing,
+  decreasing,
+  alternating
+};
+
+/*!
+ * \brief Parameters of a workload, which with its length determine its
+ * values
+ *
+ */
+struct xsum_workload_params {
+  /*! Kind of values */
+  xsum_workload_kind kind = xsum_workload_kind::uniform;
+  /*! Order of the values */
+  xsum_workload_order order = xsum_workload_order::generated;
+  /*! Seed of the random number generator */
+  std::uint64_t seed = 1;
+  /*! Range of the exponents of the wide and cancel values */
+  int min_exp = -500;
+  int max_exp = 500;
+  /*! Fraction of the inf_nan values that are Inf or NaN */
+  double special_fraction = 1e-6;
+};
+
+/* CONSTANTS FOR THE CACHE OF WORKLOADS. */
+
+/*! Magic string at the start of a cached workload */
+static constexpr char XSUM_WORKLOAD_MAGIC[8] = {'X', 'S', 'U', 'M',
+                                                'W', 'K', 'L', '\0'};
+/*! Version of the cache layout */
+static constexpr std::uint32_t XSUM_WORKLOAD_VERSION = 1;
+/*! Offset of the values in a cached workload */
+static constexpr std::size_t XSUM_WORKLOAD_HEADER_SIZE = 4096;
+
+/*!
+ * \brief Header of a cached workload
+ *
+ * The file is this header, padded with zeros to XSUM_WORKLOAD_HEADER_SIZE
+ * bytes, followed by the values, in the byte order of the machine.
+ */
+struct xsum_workload_header {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byte_order;
+  std::int64_t n;
+  xsum_workload_params params;
+  /*! Exact sum of the values, rounded */
+  xsum_flt sum;
+};
+
+/*!
+ * \brief Fill vec with n values of a workload
+ *
+ * The values depend only on n and the parameters.
+ */
+void xsum_workload_generate(xsum_flt *const vec, xsum_length const n,
+                            xsum_workload_params const &params);
+
+/*!
+ * \brief Input data for benchmarks, with its exact sum
+ *
+ * Without a cache directory, the values are generated in memory.  With one,
+ * they are mapped read-only from a file in it named after the length and the
+ * parameters, which is made the first time, so that very long workloads are
+ * generated once and then cost nothing to load.  A cached file is written
+ * under a temporary name and renamed when complete, so that processes
+ * running at the same time never see part of one.
+ *
+ * Errors with the cache throw \c std::runtime_error.
+ *
+ * \code
+ * xsum_workload_params p;
+ * p.kind = xsum_workload_kind::cancel;
+ * p.order = xsum_workload_order::decreasing;
+ * xsum_workload w(1000000000, p, "/scratch/xsum");
+ * // w.data(), w.size(), and w.sum()
+ * \endcode
+ */
+class xsum_workload {
+ public:
+  /*!
+   * \brief Construct a new xsum workload object
+   *
+   * \param n # of values
+   * \param params parameters of the values
+   * \param cache_dir directory of the cached workloads, or empty for none
+   */
+  xsum_workload(xsum_length const n, xsum_workload_params const &params,
+                std::string const &cache_dir = "");
+
+  ~xsum_workload();
+
+  xsum_workload(xsum_workload const &) = delete;
+  xsum_workload &operator=(xsum_workload const &) = delete;
+
+  /*! Values */
+  xsum_flt const *data() const;
+
+  /*! # of values */
+  xsum_length size() const;
+
+  /*! Exact sum of the values, rounded to the nearest floating-point number */
+  xsum_flt sum() const;
+
+  /*! Whether the values were found in the cache */
+  bool cached() const;
+
+  /*! File of the values in the cache, or empty */
+  std::string const &path() const;
+
+ private:
+  /* Map the cached file, return false if it is missing or does not match */
+  bool map(int const fd);
+
+  /* Close fd if not negative, remove the file tmp if not empty, and throw */
+  [[noreturn]] void fail(std::string const &what, int const fd,
+                         std::string const &tmp = std::string()) const;
+
+ private:
+  xsum_length _n;
+  xsum_workload_params _params;
+  std::string _path;
+  bool _cached;
+  std::vector<xsum_flt> _vec;
+  void *_map;
+  std::size_t _map_size;
+  xsum_flt const *_data;
+  xsum_flt _sum;
+};
+
+/* GENERATION */
+
+/* Key for sorting, with NaNs above everything else */
+static inline bool xsum_workload_less(xsum_flt const a, xsum_flt const b) {
+  return std::isnan(b) ? !std::isnan(a) : a < b;
+}
+
+static void xsum_workload_order_values(xsum_flt *const vec,
+                                       xsum_length const n,
+                                       xsum_workload_params const &params,
+                                       std::mt19937_64 &gen) {
+  xsum_flt *const e = vec + n;
+  switch (params.order) {
+    case xsum_workload_order::generated:
+      break;
+    case xsum_workload_order::shuffled:
+      std::shuffle(vec, e, gen);
+      break;
+    case xsum_workload_order::sorted:
+      std::sort(vec, e, xsum_workload_less);
+      break;
+    case xsum_workload_order::increasing:
+      std::sort(vec, e, [](xsum_flt const a, xsum_flt const b) {
+        return xsum_workload_less(std::fabs(a), std::fabs(b));
+      });
+      break;
+    case xsum_workload_order::decreasing:
+      std::sort(vec, e, [](xsum_flt const a, xsum_flt const b) {
+        return xsum_workload_less(std::fabs(b), std::fabs(a));
+      });
+      break;
+    case xsum_workload_order::alternating: {
+      /* Negative values (and NaNs) first, then positive values, each part
+         in decreasing order of magnitude, then merged in turn */
+      xsum_flt *const m = std::partition(vec, e, [](xsum_flt const a) {
+        return !(a >= 0);
+      });
+      auto const decreasing = [](xsum_flt const a, xsum_flt const b) {
+        return xsum_workload_less(std::fabs(b), std::fabs(a));
+      };
+      std::sort(vec, m, decreasing);
+      std::sort(m, e, decreasing);
+      std::vector<xsum_flt> neg(vec, m);
+      std::vector<xsum_flt> pos(m, e);
+      std::size_t i = 0;
+      std::size_t j = 0;
+      xsum_flt *p = vec;
+      while (i < pos.size() || j < neg.size()) {
+        if (i < pos.size()) {
+          *p++ = pos[i++];
+        }
+        if (j < neg.size()) {
+          *p++ = neg[j++];
+        }
+      }
+      break;
+    }
+  }
+}
+
+void xsum_workload_generate(xsum_flt *const vec, xsum_length const n,
+                            xsum_workload_params const &params) {
+  std::mt19937_64 gen(params.seed);
+  std::uniform_real_distribution<xsum_flt> uniform(-1.0, 1.0);
+  std::uniform_real_distribution<xsum_flt> mantissa(1.0, 2.0);
+  std::uniform_int_distribution<int> exponent(params.min_exp, params.max_exp);
+
+  /* Each value is drawn in separate statements, as the order in which the
+     arguments of a call are evaluated is not specified */
+  auto const wide = [&]() {
+    xsum_flt const m = mantissa(gen);
+    int const e = exponent(gen);
+    return std::ldexp(gen() & 1 ? m : -m, e);
+  };
+
+  switch (params.kind) {
+    case xsum_workload_kind::uniform:
+      for (xsum_length i = 0; i < n; ++i) {
+        vec[i] = uniform(gen);
+      }
+      break;
+
+    case xsum_workload_kind::wide:
+      for (xsum_length i = 0; i < n; ++i) {
+        vec[i] = wide();
+      }
+      break;
+
+    case xsum_workload_kind::cancel: {
+      if (n == 0) {
+        break;
+      }
+      /* The residual is below 2^min_exp, the smallest of the pairs */
+      vec[0] = std::ldexp(uniform(gen), params.min_exp);
+      xsum_length i = 1;
+      for (; i + 1 < n; i += 2) {
+        vec[i] = wide();
+        vec[i + 1] = -vec[i];
+      }
+      if (i < n) {
+        vec[i] = 0;
+      }
+      std::shuffle(vec, vec + n, gen);
+      break;
+    }
+
+    case xsum_workload_kind::denormal: {
+      std::uniform_int_distribution<xsum_int> denormal(1, XSUM_MANTISSA_MASK);
+      std::uniform_int_distribution<int> small(-1022, -1000);
+      for (xsum_length i = 0; i < n; ++i) {
+        fpunion u;
+        if (gen() % 10 != 0) {
+          u.intv = denormal(gen);
+        } else {
+          int const e = small(gen);
+          u.fltv = std::ldexp(mantissa(gen), e);
+        }
+        vec[i] = gen() & 1 ? u.fltv : -u.fltv;
+      }
+      break;
+    }
+
+    case xsum_workload_kind::narrow: {
+      std::uniform_int_distribution<std::int64_t> cents(-100000000, 100000000);
+      for (xsum_length i = 0; i < n; ++i) {
+        vec[i] = static_cast<xsum_flt>(cents(gen)) / 100;
+      }
+      break;
+    }
+
+    case xsum_workload_kind::inf_nan: {
+      xsum_flt const specials[3] = {std::numeric_limits<xsum_flt>::infinity(),
+                                    -std::numeric_limits<xsum_flt>::infinity(),
+                                    std::numeric_limits<xsum_flt>::quiet_NaN()};
+      std::uniform_real_distribution<xsum_flt> draw(0.0, 1.0);
+      for (xsum_length i = 0; i < n; ++i) {
+        vec[i] = draw(gen) < params.special_fraction ? specials[gen() % 3]
+                                                     : uniform(gen);
+      }
+      break;
+    }
+
+    case xsum_workload_kind::integer: {
+      std::uniform_int_distribution<std::int64_t> count(-1000000000,
+                                                        1000000000);
+      for (xsum_length i = 0; i < n; ++i) {
+        vec[i] = static_cast<xsum_flt>(count(gen));
+      }
+      break;
+    }
+  }
+
+  xsum_workload_order_values(vec, n, params, gen);
+}
+
+/* WORKLOAD */
+
+static xsum_flt xsum_workload_sum(xsum_flt const *const vec,
+                                  xsum_length const n) {
+  xsum_large_accumulator lacc;
+  xsum_add(&lacc, vec, n);
+  return xsum_round(&lacc);
+}
+
+xsum_workload::xsum_workload(xsum_length const n,
+                             xsum_workload_params const &params,
+                             std::string const &cache_dir)
+    : _n(n),
+      _params(params),
+      _cached(false),
+      _map(MAP_FAILED),
+      _map_size(XSUM_WORKLOAD_HEADER_SIZE + n * sizeof(xsum_flt)),
+      _data(nullptr),
+      _sum(0) {
+  static_assert(sizeof(xsum_workload_header) <= XSUM_WORKLOAD_HEADER_SIZE,
+                "header does not fit");
+
+  if (cache_dir.empty()) {
+    _vec.resize(n);
+    xsum_workload_generate(_vec.data(), n, params);
+    _data = _vec.data();
+    _sum = xsum_workload_sum(_data, n);
+    return;
+  }
+
+  char name[256];
+  std::snprintf(name, sizeof(name),
+                "/xsum_workload_k%d_o%d_n%lld_s%llu_e%d_%d_f%g.bin",
+                static_cast<int>(params.kind), static_cast<int>(params.order),
+                static_cast<long long>(n),
+                static_cast<unsigned long long>(params.seed), params.min_exp,
+                params.max_exp, params.special_fraction);
+  _path = cache_dir + name;
+
+  int fd = ::open(_path.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    if (map(fd)) {
+      _cached = true;
+      return;
+    }
+  }
+
+  /* Make the file under a temporary name, then rename it */
+  std::string const tmp = _path + ".tmp." + std::to_string(::getpid());
+  fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    fail("open " + tmp, fd);
+  }
+  if (::ftruncate(fd, static_cast<off_t>(_map_size)) != 0) {
+    fail("ftruncate " + tmp, fd, tmp);
+  }
+  void *const m =
+      ::mmap(nullptr, _map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (m == MAP_FAILED) {
+    fail("mmap " + tmp, fd, tmp);
+  }
+
+  xsum_flt *const vec = reinterpret_cast<xsum_flt *>(
+      static_cast<char *>(m) + XSUM_WORKLOAD_HEADER_SIZE);
+  xsum_workload_generate(vec, n, params);
+
+  xsum_workload_header *const h = static_cast<xsum_workload_header *>(m);
+  std::memcpy(h->magic, XSUM_WORKLOAD_MAGIC, sizeof(XSUM_WORKLOAD_MAGIC));
+  h->version = XSUM_WORKLOAD_VERSION;
+  h->byte_order = 0x01020304;
+  h->n = n;
+  h->params = params;
+  h->sum = xsum_workload_sum(vec, n);
+
+  int const err = ::msync(m, _map_size, MS_SYNC);
+  ::munmap(m, _map_size);
+  if (err != 0) {
+    fail("msync " + tmp, fd, tmp);
+  }
+  if (::rename(tmp.c_str(), _path.c_str()) != 0) {
+    fail("rename " + tmp, fd, tmp);
+  }
+
+  if (!map(fd)) {
+    fail("map " + _path, -1);
+  }
+}
+
+bool xsum_workload::map(int const fd) {
+  struct stat st;
+  bool ok = ::fstat(fd, &st) == 0 &&
+            static_cast<std::size_t>(st.st_size) == _map_size;
+  if (ok) {
+    _map = ::mmap(nullptr, _map_size, PROT_READ, MAP_SHARED, fd, 0);
+    ok = _map != MAP_FAILED;
+  }
+  ::close(fd);
+  if (!ok) {
+    return false;
+  }
+
+  xsum_workload_header const *const h =
+      static_cast<xsum_workload_header const *>(_map);
+  if (std::memcmp(h->magic, XSUM_WORKLOAD_MAGIC, sizeof(XSUM_WORKLOAD_MAGIC)) ||
+      h->version != XSUM_WORKLOAD_VERSION || h->byte_order != 0x01020304 ||
+      h->n != _n || h->params.kind != _params.kind ||
+      h->params.order != _params.order || h->params.seed != _params.seed ||
+      h->params.min_exp != _params.min_exp ||
+      h->params.max_exp != _params.max_exp ||
+      h->params.special_fraction != _params.special_fraction) {
+    ::munmap(_map, _map_size);
+    _map = MAP_FAILED;
+    return false;
+  }
+
+  _data = reinterpret_cast<xsum_flt const *>(static_cast<char const *>(_map) +
+                                             XSUM_WORKLOAD_HEADER_SIZE);
+  _sum = h->sum;
+  return true;
+}
+
+void xsum_workload::fail(std::string const &what, int const fd,
+                         std::string const &tmp) const {
+  std::string const msg = what + ": " + std::strerror(errno);
+  if (fd >= 0) {
+    ::close(fd);
+  }
+  if (!tmp.empty()) {
+    ::unlink(tmp.c_str());
+  }
+  throw std::runtime_error(msg);
+}
+
+xsum_workload::~xsum_workload() {
+  if (_map != MAP_FAILED) {
+    ::munmap(_map, _map_size);
+  }
+}
+
+xsum_flt const *xsum_workload::data() const { return _data; }
+
+xsum_length xsum_workload::size() const { return _n; }
+
+xsum_flt xsum_workload::sum() const { return _sum; }
+
+bool xsum_workload::cached() const { return _cached; }
+
+std::string const &xsum_workload::path() const { return _path; }
+
+}  // namespace xsum
+
+#endif  // WORKLOAD_HPP
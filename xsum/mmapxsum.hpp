@@ -0,0 +1,400 @@
+//
+// MMAPXSUM.hpp
+//
+// LGPL Version 2.1 HEADER START
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+//
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+// MA 02110-1301  USA
+//
+// LGPL Version 2.1 HEADER END
+//
+
+//
+// Copyright (c) 2020, Regents of the University of Minnesota.
+// All rights reserved.
+//
+// Contributors:
+//    Yaser Afshar
+//
+
+#ifndef MMAPXSUM_HPP
+#define MMAPXSUM_HPP
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "xsum.hpp"
+
+namespace xsum {
+
+/* CONSTANTS FOR THE MEMORY-MAPPED ARRAY. */
+
+/*! Magic string at the start of the file */
+static constexpr char XSUM_MMAP_MAGIC[8] = {'X', 'S', 'U', 'M',
+                                            'A', 'R', 'R', '\0'};
+/*! Version of the file layout */
+static constexpr std::uint32_t XSUM_MMAP_VERSION = 1;
+/*! Offset of the first accumulator in the file, so that the accumulators
+ * start on a page boundary */
+static constexpr std::size_t XSUM_MMAP_HEADER_SIZE = 4096;
+/*! Written as is, to tell the byte order of the machine that made the file */
+static constexpr std::uint32_t XSUM_MMAP_BYTE_ORDER = 0x01020304;
+
+/*!
+ * \brief Header at the start of a memory-mapped array file
+ *
+ * The file is this header, padded with zeros to XSUM_MMAP_HEADER_SIZE bytes,
+ * followed by \c count xsum_small_accumulator structures, as laid out in
+ * memory (chunks, Inf, NaN, adds_until_propagate, and carry_budget).  All
+ * fields are in the byte order of the machine, and a file is only opened by a
+ * machine with the same byte order and accumulator layout.  The file starts
+ * as all zeros, which is an empty accumulator with the default carry budget.
+ */
+struct xsum_mmap_header {
+  /*! XSUM_MMAP_MAGIC */
+  char magic[8];
+  /*! XSUM_MMAP_VERSION */
+  std::uint32_t version;
+  /*! XSUM_MMAP_BYTE_ORDER */
+  std::uint32_t byte_order;
+  /*! Offset of the first accumulator */
+  std::uint64_t header_size;
+  /*! # of accumulators */
+  std::uint64_t count;
+  /*! sizeof(xsum_small_accumulator) */
+  std::uint32_t accumulator_size;
+  /*! XSUM_SCHUNKS */
+  std::uint32_t schunks;
+  /*! # of checkpoints made so far */
+  std::uint64_t checkpoints;
+};
+
+/*!
+ * \brief How a memory-mapped array file is opened
+ *
+ * \c create makes a new file, or empties an existing one, \c open maps an
+ * existing file for reading and writing, and \c read_only maps an existing
+ * file for reading, which any number of processes can do at once.
+ */
+enum class xsum_mmap_mode { create, open, read_only };
+
+/*!
+ * \brief Array of small accumulators kept in a memory-mapped file
+ *
+ * The accumulators are used in place in the shared mapping, so a process
+ * that opens the file again continues from where the last one stopped,
+ * without reading or converting anything.  Changes reach the file when the
+ * system writes the pages back; \c sync and \c checkpoint force this.
+ *
+ * A new file is all zeros, which is a valid empty accumulator (with a carry
+ * propagation due at the first add), so creating even a very large array is
+ * immediate and the file stays sparse until used.
+ *
+ * Errors in opening, mapping, or syncing the file, and files that are not
+ * valid arrays, throw \c std::runtime_error.
+ *
+ * \code
+ * xsum_mmap_array a("sums.xsum", 1000000, xsum_mmap_mode::create);
+ * a.add(key, x);
+ * a.checkpoint();
+ * // later, or in another process
+ * xsum_mmap_array b("sums.xsum", 0, xsum_mmap_mode::read_only);
+ * double const s = b.round(key);
+ * \endcode
+ */
+class xsum_mmap_array {
+ public:
+  /*!
+   * \brief Construct a new xsum mmap array object, by mapping the file
+   *
+   * \param path file name
+   * \param n # of accumulators, for \c create, or the # expected in the file,
+   * where 0 accepts any
+   * \param mode how the file is opened
+   */
+  xsum_mmap_array(std::string const &path, std::size_t const n,
+                  xsum_mmap_mode const mode = xsum_mmap_mode::open);
+
+  /*!
+   * \brief Destroy the xsum mmap array object, by unmapping the file
+   *
+   * This does not wait for the changes to reach the file, \c checkpoint does.
+   */
+  ~xsum_mmap_array();
+
+  xsum_mmap_array(xsum_mmap_array const &) = delete;
+  xsum_mmap_array &operator=(xsum_mmap_array const &) = delete;
+
+  /*! # of accumulators */
+  std::size_t size() const;
+
+  /*! Whether the file is mapped read-only */
+  bool read_only() const;
+
+  /*!
+   * \brief Accumulators in the mapping
+   *
+   * They must not be modified if the file is mapped read-only.
+   */
+  xsum_small_accumulator *data();
+  xsum_small_accumulator const *data() const;
+
+  xsum_small_accumulator &operator[](std::size_t const i);
+  xsum_small_accumulator const &operator[](std::size_t const i) const;
+
+  /*!
+   * \brief Add a value, or a vector of values, to accumulator i
+   *
+   */
+  void add(std::size_t const i, xsum_flt const value);
+  void add(std::size_t const i, xsum_flt const *vec, xsum_length const n);
+
+  /*!
+   * \brief Round accumulator i to the nearest floating-point number
+   *
+   * This rounds a copy, so that it also works on a read-only mapping.
+   */
+  xsum_flt round(std::size_t const i) const;
+
+  /*!
+   * \brief Write the changes to accumulators i1 to i2-1 to the file
+   *
+   * \param wait if false, only start writing
+   */
+  void sync(std::size_t const i1, std::size_t const i2, bool const wait = true);
+
+  /*!
+   * \brief Write all changes to the file
+   *
+   */
+  void sync(bool const wait = true);
+
+  /*!
+   * \brief Write all changes to the file and wait, then count a checkpoint in
+   * the header and write that too
+   *
+   * The count in the header of a file is thus only ever updated once the
+   * accumulators it covers are in the file.
+   *
+   * \return the # of checkpoints made so far
+   */
+  std::uint64_t checkpoint();
+
+  /*! # of checkpoints recorded in the file */
+  std::uint64_t checkpoints() const;
+
+ private:
+  /* Throw a runtime_error for a failed system call */
+  [[noreturn]] void fail(char const *what) const;
+
+  /* msync the bytes from b to e of the mapping */
+  void msync_bytes(std::size_t b, std::size_t const e, bool const wait);
+
+ private:
+  std::string _path;
+  int _fd;
+  bool _read_only;
+  void *_map;
+  std::size_t _map_size;
+  xsum_mmap_header *_header;
+  xsum_small_accumulator *_acc;
+  std::size_t _n;
+};
+
+xsum_mmap_array::xsum_mmap_array(std::string const &path, std::size_t const n,
+                                 xsum_mmap_mode const mode)
+    : _path(path),
+      _fd(-1),
+      _read_only(mode == xsum_mmap_mode::read_only),
+      _map(MAP_FAILED),
+      _map_size(0),
+      _header(nullptr),
+      _acc(nullptr),
+      _n(n) {
+  static_assert(sizeof(xsum_mmap_header) <= XSUM_MMAP_HEADER_SIZE,
+                "header does not fit");
+
+  int const flags = mode == xsum_mmap_mode::create
+                        ? O_RDWR | O_CREAT | O_TRUNC
+                        : (_read_only ? O_RDONLY : O_RDWR);
+  _fd = ::open(path.c_str(), flags, 0644);
+  if (_fd < 0) {
+    fail("open");
+  }
+
+  if (mode == xsum_mmap_mode::create) {
+    _map_size = XSUM_MMAP_HEADER_SIZE + _n * sizeof(xsum_small_accumulator);
+    if (::ftruncate(_fd, static_cast<off_t>(_map_size)) != 0) {
+      fail("ftruncate");
+    }
+  } else {
+    struct stat st;
+    if (::fstat(_fd, &st) != 0) {
+      fail("fstat");
+    }
+    _map_size = static_cast<std::size_t>(st.st_size);
+    if (_map_size < XSUM_MMAP_HEADER_SIZE) {
+      ::close(_fd);
+      throw std::runtime_error(path + ": not an xsum array file");
+    }
+  }
+
+  _map = ::mmap(nullptr, _map_size,
+                _read_only ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED,
+                _fd, 0);
+  if (_map == MAP_FAILED) {
+    fail("mmap");
+  }
+
+  _header = static_cast<xsum_mmap_header *>(_map);
+  _acc = reinterpret_cast<xsum_small_accumulator *>(
+      static_cast<char *>(_map) + XSUM_MMAP_HEADER_SIZE);
+
+  if (mode == xsum_mmap_mode::create) {
+    std::memcpy(_header->magic, XSUM_MMAP_MAGIC, sizeof(XSUM_MMAP_MAGIC));
+    _header->version = XSUM_MMAP_VERSION;
+    _header->byte_order = XSUM_MMAP_BYTE_ORDER;
+    _header->header_size = XSUM_MMAP_HEADER_SIZE;
+    _header->count = _n;
+    _header->accumulator_size = sizeof(xsum_small_accumulator);
+    _header->schunks = XSUM_SCHUNKS;
+    _header->checkpoints = 0;
+    return;
+  }
+
+  /* Check that the file was made by this layout, on this kind of machine */
+  char const *why = nullptr;
+  if (std::memcmp(_header->magic, XSUM_MMAP_MAGIC, sizeof(XSUM_MMAP_MAGIC))) {
+    why = "not an xsum array file";
+  } else if (_header->version != XSUM_MMAP_VERSION) {
+    why = "unsupported version";
+  } else if (_header->byte_order != XSUM_MMAP_BYTE_ORDER ||
+             _header->header_size != XSUM_MMAP_HEADER_SIZE ||
+             _header->accumulator_size != sizeof(xsum_small_accumulator) ||
+             _header->schunks != XSUM_SCHUNKS) {
+    why = "accumulator layout differs from this machine";
+  } else if (_map_size != XSUM_MMAP_HEADER_SIZE +
+                              _header->count * sizeof(xsum_small_accumulator)) {
+    why = "file size does not match the header";
+  } else if (_n != 0 && _n != _header->count) {
+    why = "unexpected number of accumulators";
+  }
+  if (why) {
+    ::munmap(_map, _map_size);
+    ::close(_fd);
+    throw std::runtime_error(path + ": " + why);
+  }
+  _n = static_cast<std::size_t>(_header->count);
+}
+
+xsum_mmap_array::~xsum_mmap_array() {
+  ::munmap(_map, _map_size);
+  ::close(_fd);
+}
+
+void xsum_mmap_array::fail(char const *what) const {
+  std::string const msg = _path + ": " + what + ": " + std::strerror(errno);
+  if (_map != MAP_FAILED) {
+    ::munmap(_map, _map_size);
+  }
+  if (_fd >= 0) {
+    ::close(_fd);
+  }
+  throw std::runtime_error(msg);
+}
+
+std::size_t xsum_mmap_array::size() const { return _n; }
+
+bool xsum_mmap_array::read_only() const { return _read_only; }
+
+xsum_small_accumulator *xsum_mmap_array::data() { return _acc; }
+
+xsum_small_accumulator const *xsum_mmap_array::data() const { return _acc; }
+
+xsum_small_accumulator &xsum_mmap_array::operator[](std::size_t const i) {
+  return _acc[i];
+}
+
+xsum_small_accumulator const &xsum_mmap_array::operator[](
+    std::size_t const i) const {
+  return _acc[i];
+}
+
+void xsum_mmap_array::add(std::size_t const i, xsum_flt const value) {
+  xsum_add<xsum_small_accumulator>(_acc + i, value);
+}
+
+void xsum_mmap_array::add(std::size_t const i, xsum_flt const *vec,
+                          xsum_length const n) {
+  xsum_add<xsum_small_accumulator>(_acc + i, vec, n);
+}
+
+xsum_flt xsum_mmap_array::round(std::size_t const i) const {
+  xsum_small_accumulator sacc = _acc[i];
+  return xsum_round<xsum_small_accumulator>(&sacc);
+}
+
+void xsum_mmap_array::msync_bytes(std::size_t b, std::size_t const e,
+                                  bool const wait) {
+  if (_read_only || b >= e) {
+    return;
+  }
+  /* msync wants an address on a page boundary */
+  std::size_t const page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  b -= b % page;
+  if (::msync(static_cast<char *>(_map) + b, e - b,
+              wait ? MS_SYNC : MS_ASYNC) != 0) {
+    std::string const msg = _path + ": msync: " + std::strerror(errno);
+    throw std::runtime_error(msg);
+  }
+}
+
+void xsum_mmap_array::sync(std::size_t const i1, std::size_t const i2,
+                           bool const wait) {
+  msync_bytes(XSUM_MMAP_HEADER_SIZE + i1 * sizeof(xsum_small_accumulator),
+              XSUM_MMAP_HEADER_SIZE + i2 * sizeof(xsum_small_accumulator),
+              wait);
+}
+
+void xsum_mmap_array::sync(bool const wait) {
+  msync_bytes(0, _map_size, wait);
+}
+
+std::uint64_t xsum_mmap_array::checkpoint() {
+  if (_read_only) {
+    return _header->checkpoints;
+  }
+  sync(0, _n, true);
+  ++_header->checkpoints;
+  msync_bytes(0, sizeof(xsum_mmap_header), true);
+  return _header->checkpoints;
+}
+
+std::uint64_t xsum_mmap_array::checkpoints() const {
+  return _header->checkpoints;
+}
+
+}  // namespace xsum
+
+#endif  // MMAPXSUM_HPP
@@ -35,6 +35,8 @@
 
 #include <mpi.h>
 
+#include <cstddef>
+
 #include "xsum.hpp"
 
 namespace xsum {
@@ -42,8 +44,9 @@ namespace xsum {
 /*!
  * \brief Create a mpi type object
  *
- * \tparam T data type one of \c xsum_small_accumulator or
- *         \c xsum_large_accumulator \param datatype
+ * \tparam T data type one of \c xsum_small_accumulator,
+ *         \c xsum_large_accumulator, or \c xsum_binned_accumulator
+ * \param datatype
  */
 template <typename T>
 void create_mpi_type(MPI_Datatype &datatype);
@@ -51,8 +54,9 @@ void create_mpi_type(MPI_Datatype &datatype);
 /*!
  * \brief Create a mpi type object
  *
- * \tparam T data type one of \c xsum_small_accumulator or
- *         \c xsum_large_accumulator \return MPI_Datatype
+ * \tparam T data type one of \c xsum_small_accumulator,
+ *         \c xsum_large_accumulator, or \c xsum_binned_accumulator
+ * \return MPI_Datatype
  */
 template <typename T>
 MPI_Datatype create_mpi_type();
@@ -69,12 +73,14 @@ void destroy_mpi_type(T &datatype);
 /*!
  * \brief A user-defined xsum function
  *
- * This is a user-defined global xsum operation on \c xsum_small_accumulator or
- * \c xsum_large_accumulator type to an op handle that can subsequently be used
- * in \c MPI_Reduce, \c MPI_Allreduce, \c MPI_Reduce_scatter, and \c MPI_Scan.
+ * This is a user-defined global xsum operation on \c xsum_small_accumulator,
+ * \c xsum_large_accumulator, or \c xsum_binned_accumulator type to an op
+ * handle that can subsequently be used in \c MPI_Reduce, \c MPI_Allreduce,
+ * \c MPI_Reduce_scatter, and \c MPI_Scan.  The binned sum is not exact, but
+ * it is the same for any number of ranks and any reduction tree.
  *
- * \tparam T data type one of \c xsum_small_accumulator or
- *         \c xsum_large_accumulator
+ * \tparam T data type one of \c xsum_small_accumulator,
+ *         \c xsum_large_accumulator, or \c xsum_binned_accumulator
  * \param invec arrays of len elements that \c myXSUM function is combining.
  * \param inoutvec arrays of len elements that \c myXSUM function is combining.
  * \param len length
@@ -107,7 +113,8 @@ void create_mpi_type(MPI_Datatype &datatype) {
 template <>
 void create_mpi_type<xsum_small_accumulator>(
     MPI_Datatype &small_accumulator_type) {
-  int const lengths[4] = {XSUM_SCHUNKS, 1, 1, 1};
+  /* adds_until_propagate and carry_budget are two ints */
+  int const lengths[4] = {XSUM_SCHUNKS, 1, 1, 2};
   MPI_Aint const displacements[4] = {0, sizeof(xsum_schunk) * XSUM_SCHUNKS,
                                      sizeof(xsum_schunk) * (XSUM_SCHUNKS + 1),
                                      sizeof(xsum_schunk) * (XSUM_SCHUNKS + 2)};
@@ -121,8 +128,41 @@ void create_mpi_type<xsum_small_accumulator>(
 template <>
 void create_mpi_type<xsum_large_accumulator>(
     MPI_Datatype &large_accumulator_type) {
+#ifdef XSUM_LARGE_INTERLEAVED
+  /* {chunk, count} entry, resized to include its padding */
+  MPI_Datatype entry_type;
+  {
+    int const lengths[2] = {1, 1};
+    MPI_Aint const displacements[2] = {0, sizeof(xsum_lchunk)};
+    MPI_Datatype const types[2] = {MPI_INT64_T, MPI_INT16_T};
+    MPI_Datatype packed_entry_type;
+    MPI_Type_create_struct(2, lengths, displacements, types,
+                           &packed_entry_type);
+    MPI_Type_create_resized(packed_entry_type, 0, sizeof(xsum_lentry),
+                            &entry_type);
+    MPI_Type_free(&packed_entry_type);
+  }
   int const lengths[8] = {
-      XSUM_LCHUNKS, XSUM_LCHUNKS, XSUM_LCHUNKS / 64, 1, XSUM_SCHUNKS, 1, 1, 1};
+      XSUM_LCHUNKS, XSUM_LCHUNKS / 64, 1, XSUM_SCHUNKS, 1, 1, 2, 1};
+  MPI_Aint const d1 = sizeof(xsum_lentry) * XSUM_LCHUNKS;
+  MPI_Aint const d2 = d1 + sizeof(xsum_used) * XSUM_LCHUNKS / 64;
+  MPI_Aint const d3 = d2 + sizeof(xsum_used);
+  MPI_Aint const d4 = d3 + sizeof(xsum_schunk) * XSUM_SCHUNKS;
+  MPI_Aint const d5 = d4 + sizeof(xsum_schunk);
+  MPI_Aint const d6 = d5 + sizeof(xsum_schunk);
+  MPI_Aint const d7 = d3 + sizeof(xsum_small_accumulator);
+  MPI_Aint const displacements[8] = {0, d1, d2, d3, d4, d5, d6, d7};
+  MPI_Datatype const types[8] = {entry_type,  MPI_UINT64_T, MPI_UINT64_T,
+                                 MPI_INT64_T, MPI_INT64_T,  MPI_INT64_T,
+                                 MPI_INT,     MPI_INT};
+  MPI_Type_create_struct(8, lengths, displacements, types,
+                         &large_accumulator_type);
+  MPI_Type_commit(&large_accumulator_type);
+  MPI_Type_free(&entry_type);
+#else
+  int const lengths[9] = {XSUM_LCHUNKS, XSUM_LCHUNKS, XSUM_LCHUNKS / 64,
+                          1,            XSUM_SCHUNKS, 1,
+                          1,            2,            1};
   MPI_Aint const d1 = sizeof(xsum_lchunk) * XSUM_LCHUNKS;
   MPI_Aint const d2 = d1 + sizeof(xsum_lcount) * XSUM_LCHUNKS;
   MPI_Aint const d3 = d2 + sizeof(xsum_used) * XSUM_LCHUNKS / 64;
@@ -130,13 +170,36 @@ void create_mpi_type<xsum_large_accumulator>(
   MPI_Aint const d5 = d4 + sizeof(xsum_schunk) * XSUM_SCHUNKS;
   MPI_Aint const d6 = d5 + sizeof(xsum_schunk);
   MPI_Aint const d7 = d6 + sizeof(xsum_schunk);
-  MPI_Aint const displacements[8] = {0, d1, d2, d3, d4, d5, d6, d7};
-  MPI_Datatype const types[8] = {MPI_INT64_T,  MPI_INT16_T, MPI_UINT64_T,
+  MPI_Aint const d8 = d4 + sizeof(xsum_small_accumulator);
+  MPI_Aint const displacements[9] = {0, d1, d2, d3, d4, d5, d6, d7, d8};
+  MPI_Datatype const types[9] = {MPI_INT64_T,  MPI_INT16_T, MPI_UINT64_T,
                                  MPI_UINT64_T, MPI_INT64_T, MPI_INT64_T,
-                                 MPI_INT64_T,  MPI_INT};
-  MPI_Type_create_struct(8, lengths, displacements, types,
+                                 MPI_INT64_T,  MPI_INT,     MPI_INT};
+  MPI_Type_create_struct(9, lengths, displacements, types,
                          &large_accumulator_type);
   MPI_Type_commit(&large_accumulator_type);
+#endif
+}
+
+template <>
+void create_mpi_type<xsum_binned_accumulator>(
+    MPI_Datatype &binned_accumulator_type) {
+  int const lengths[5] = {XSUM_BIN_MAX_FOLD, XSUM_BIN_MAX_FOLD, 1, 1, 3};
+  MPI_Aint const displacements[5] = {
+      offsetof(xsum_binned_accumulator, primary),
+      offsetof(xsum_binned_accumulator, carry),
+      offsetof(xsum_binned_accumulator, Inf),
+      offsetof(xsum_binned_accumulator, NaN),
+      offsetof(xsum_binned_accumulator, index)};
+  MPI_Datatype const types[5] = {MPI_DOUBLE, MPI_INT64_T, MPI_INT64_T,
+                                 MPI_INT64_T, MPI_INT};
+  /* Resized to include the padding at the end */
+  MPI_Datatype packed_type;
+  MPI_Type_create_struct(5, lengths, displacements, types, &packed_type);
+  MPI_Type_create_resized(packed_type, 0, sizeof(xsum_binned_accumulator),
+                          &binned_accumulator_type);
+  MPI_Type_free(&packed_type);
+  MPI_Type_commit(&binned_accumulator_type);
 }
 
 template <typename T>
@@ -150,7 +213,8 @@ MPI_Datatype create_mpi_type() {
 template <>
 MPI_Datatype create_mpi_type<xsum_small_accumulator>() {
   MPI_Datatype small_accumulator_type;
-  int const lengths[4] = {XSUM_SCHUNKS, 1, 1, 1};
+  /* adds_until_propagate and carry_budget are two ints */
+  int const lengths[4] = {XSUM_SCHUNKS, 1, 1, 2};
   MPI_Aint const displacements[4] = {0, sizeof(xsum_schunk) * XSUM_SCHUNKS,
                                      sizeof(xsum_schunk) * (XSUM_SCHUNKS + 1),
                                      sizeof(xsum_schunk) * (XSUM_SCHUNKS + 2)};
@@ -165,25 +229,17 @@ MPI_Datatype create_mpi_type<xsum_small_accumulator>() {
 template <>
 MPI_Datatype create_mpi_type<xsum_large_accumulator>() {
   MPI_Datatype large_accumulator_type;
-  int const lengths[8] = {
-      XSUM_LCHUNKS, XSUM_LCHUNKS, XSUM_LCHUNKS / 64, 1, XSUM_SCHUNKS, 1, 1, 1};
-  MPI_Aint const d1 = sizeof(xsum_lchunk) * XSUM_LCHUNKS;
-  MPI_Aint const d2 = d1 + sizeof(xsum_lcount) * XSUM_LCHUNKS;
-  MPI_Aint const d3 = d2 + sizeof(xsum_used) * XSUM_LCHUNKS / 64;
-  MPI_Aint const d4 = d3 + sizeof(xsum_used);
-  MPI_Aint const d5 = d4 + sizeof(xsum_schunk) * XSUM_SCHUNKS;
-  MPI_Aint const d6 = d5 + sizeof(xsum_schunk);
-  MPI_Aint const d7 = d6 + sizeof(xsum_schunk);
-  MPI_Aint const displacements[8] = {0, d1, d2, d3, d4, d5, d6, d7};
-  MPI_Datatype const types[8] = {MPI_INT64_T,  MPI_INT16_T, MPI_UINT64_T,
-                                 MPI_UINT64_T, MPI_INT64_T, MPI_INT64_T,
-                                 MPI_INT64_T,  MPI_INT};
-  MPI_Type_create_struct(8, lengths, displacements, types,
-                         &large_accumulator_type);
-  MPI_Type_commit(&large_accumulator_type);
+  create_mpi_type<xsum_large_accumulator>(large_accumulator_type);
   return large_accumulator_type;
 }
 
+template <>
+MPI_Datatype create_mpi_type<xsum_binned_accumulator>() {
+  MPI_Datatype binned_accumulator_type;
+  create_mpi_type<xsum_binned_accumulator>(binned_accumulator_type);
+  return binned_accumulator_type;
+}
+
 template <typename T>
 void destroy_mpi_type(T &user_type) {
   std::cerr << "Not implemented on purpose!" << std::endl;
@@ -227,6 +283,18 @@ void myXSUM<xsum_large_accumulator>(void *invec, void *inoutvec, int *len,
   }
 }
 
+template <>
+void myXSUM<xsum_binned_accumulator>(void *invec, void *inoutvec, int *len,
+                                     MPI_Datatype * /* datatype*/) {
+  xsum_binned_accumulator *in = static_cast<xsum_binned_accumulator *>(invec);
+  xsum_binned_accumulator *inout =
+      static_cast<xsum_binned_accumulator *>(inoutvec);
+
+  for (int i = 0; i < *len; ++i, ++in, ++inout) {
+    xsum_add<xsum_binned_accumulator>(inout, in);
+  }
+}
+
 template <typename T>
 void create_XSUM(MPI_Op &XSUM) {
   std::cerr << "Not implemented on purpose!" << std::endl;
@@ -244,6 +312,11 @@ void create_XSUM<xsum_large_accumulator>(MPI_Op &XSUM) {
   MPI_Op_create(&myXSUM<xsum_large_accumulator>, true, &XSUM);
 }
 
+template <>
+void create_XSUM<xsum_binned_accumulator>(MPI_Op &XSUM) {
+  MPI_Op_create(&myXSUM<xsum_binned_accumulator>, true, &XSUM);
+}
+
 template <typename T>
 MPI_Op create_XSUM() {
   std::cerr << "Not implemented on purpose!" << std::endl;
@@ -266,6 +339,13 @@ MPI_Op create_XSUM<xsum_large_accumulator>() {
   return XSUM;
 }
 
+template <>
+MPI_Op create_XSUM<xsum_binned_accumulator>() {
+  MPI_Op XSUM;
+  MPI_Op_create(&myXSUM<xsum_binned_accumulator>, true, &XSUM);
+  return XSUM;
+}
+
 template <typename T>
 void destroy_XSUM(T &SSUM) {
   std::cerr << "Not implemented on purpose!" << std::endl;
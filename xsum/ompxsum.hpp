@@ -0,0 +1,91 @@
+//
+// OMPXSUM.hpp
+//
+// LGPL Version 2.1 HEADER START
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+//
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+// MA 02110-1301  USA
+//
+// LGPL Version 2.1 HEADER END
+//
+
+//
+// Copyright (c) 2020, Regents of the University of Minnesota.
+// All rights reserved.
+//
+// Contributors:
+//    Yaser Afshar
+//
+
+#ifndef OMPXSUM_HPP
+#define OMPXSUM_HPP
+
+#include "xsum.hpp"
+
+namespace xsum {
+
+/*!
+ * \brief OpenMP user-defined reductions on the superaccumulators
+ *
+ * With these, an accumulator can be used in a \c reduction clause, as
+ *
+ * \code
+ * xsum_large_accumulator lacc;
+ * #pragma omp parallel for reduction(xsum_large : lacc)
+ * for (int i = 0; i < n; ++i) {
+ *   xsum_add(&lacc, vec[i]);
+ * }
+ * \endcode
+ *
+ * Each thread starts from an empty accumulator.  The combiner merges the
+ * accumulator of a thread into the result with the accumulator add function,
+ * which for the large and windowed accumulators only visits the chunks in use
+ * before adding the small accumulators.  The carries of a small accumulator
+ * are propagated before it is merged, as adding its chunks counts as one
+ * add to the result.
+ *
+ * The reduction identifiers are \c xsum_small, \c xsum_large,
+ * \c xsum_window, and \c xsum_binned, for \c xsum_small_accumulator,
+ * \c xsum_large_accumulator, \c xsum_window_accumulator, and
+ * \c xsum_binned_accumulator.  The private binned accumulators have the
+ * number of folds of the original one, so the result does not depend on the
+ * number of threads or the schedule.  Without OpenMP, they are not declared.
+ */
+
+#ifdef _OPENMP
+#pragma omp declare reduction(                                                 \
+    xsum_small : xsum_small_accumulator : (                                    \
+        xsum_carry_propagate<xsum_small_accumulator>(&omp_in),                  \
+        xsum_add<xsum_small_accumulator>(&omp_out, &omp_in)))                  \
+    initializer(omp_priv = xsum_small_accumulator())
+
+#pragma omp declare reduction(                                                 \
+    xsum_large : xsum_large_accumulator : xsum_add<xsum_large_accumulator>(    \
+        &omp_out, &omp_in)) initializer(omp_priv = xsum_large_accumulator())
+
+#pragma omp declare reduction(                                                 \
+    xsum_window : xsum_window_accumulator : xsum_add<xsum_window_accumulator>( \
+        &omp_out, &omp_in)) initializer(omp_priv = xsum_window_accumulator())
+
+#pragma omp declare reduction(                                                 \
+    xsum_binned : xsum_binned_accumulator : xsum_add<xsum_binned_accumulator>( \
+        &omp_out, &omp_in))                                                    \
+    initializer(omp_priv = xsum_binned_accumulator(omp_orig.fold))
+#endif  // _OPENMP
+
+}  // namespace xsum
+
+#endif  // OMPXSUM_HPP
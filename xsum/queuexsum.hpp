@@ -0,0 +1,411 @@
+//
+// QUEUEXSUM.hpp
+//
+// LGPL Version 2.1 HEADER START
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+//
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+// MA 02110-1301  USA
+//
+// LGPL Version 2.1 HEADER END
+//
+
+//
+// Copyright (c) 2020, Regents of the University of Minnesota.
+// All rights reserved.
+//
+// Contributors:
+//    Yaser Afshar
+//
+
+#ifndef QUEUEXSUM_HPP
+#define QUEUEXSUM_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "xsum.hpp"
+
+namespace xsum {
+
+/* CONSTANTS FOR THE INGESTION QUEUE. */
+
+/*! Size of a cache line, the counters of the producer and of the consumer of a
+ * ring are kept this far apart so that they do not share one */
+static constexpr std::size_t XSUM_CACHE_LINE = 64;
+/*! Default # of values in the ring of each producer */
+static constexpr std::size_t XSUM_QUEUE_CAPACITY = 1 << 14;
+/*! Max # of values the consumer takes from one ring at a time */
+static constexpr std::size_t XSUM_QUEUE_BATCH = 1 << 12;
+/*! # of times the consumer finds the rings empty, yielding in between, before
+ * it goes to sleep */
+static constexpr int XSUM_QUEUE_SPINS = 256;
+/*! Longest time the consumer sleeps, in case a producer missed that it went to
+ * sleep */
+static constexpr std::chrono::milliseconds XSUM_QUEUE_PARK(10);
+
+/*!
+ * \brief What a producer does when its ring is full
+ *
+ * \c wait yields until the consumer has made room, and \c reject returns
+ * false from \c push, leaving it to the caller.  Values are never dropped, as
+ * the sum would no longer be exact.
+ */
+enum class xsum_backpressure { wait, reject };
+
+/*!
+ * \brief Single-producer single-consumer ring of floating-point values
+ *
+ * The capacity is a power of two.  The producer only writes the head and the
+ * consumer only writes the tail, and each keeps a copy of the other's counter
+ * that it refreshes only when the ring looks full or empty, so that adding a
+ * value is normally one store of the value and one of the head.
+ */
+class xsum_ring {
+ public:
+  explicit xsum_ring(std::size_t const capacity = XSUM_QUEUE_CAPACITY);
+
+  /*!
+   * \brief Add a value, from the producer thread
+   *
+   * \return false if the ring is full
+   */
+  bool push(xsum_flt const value);
+
+  /*!
+   * \brief Add up to \c max values to the accumulator, from the consumer
+   * thread, with the vector add function
+   *
+   * \return the # of values added
+   */
+  std::size_t drain(xsum_large_accumulator *const lacc, std::size_t const max);
+
+  /*! True if there are values in the ring, from the consumer thread */
+  bool ready();
+
+  /*! # of values added to the ring so far */
+  std::size_t pushed() const;
+  /*! # of values taken from the ring so far */
+  std::size_t drained() const;
+
+ private:
+  /* Producer side */
+  std::atomic<std::size_t> _head;
+  std::size_t _tail_cache;
+  char _pad1[XSUM_CACHE_LINE - sizeof(std::atomic<std::size_t>) -
+             sizeof(std::size_t)];
+
+  /* Consumer side */
+  std::atomic<std::size_t> _tail;
+  std::size_t _head_cache;
+  char _pad2[XSUM_CACHE_LINE - sizeof(std::atomic<std::size_t>) -
+             sizeof(std::size_t)];
+
+  /* Read only after construction */
+  std::size_t _mask;
+  std::unique_ptr<xsum_flt[]> _buf;
+};
+
+/*!
+ * \brief Ingestion queue feeding a large accumulator
+ *
+ * Each producer thread has its own ring, and a background consumer thread
+ * moves the values from the rings to a large accumulator in batches, with the
+ * vector add function.  \c flush waits until the values pushed so far have
+ * been added, and \c round and \c round_to_small flush before rounding.
+ *
+ * When the rings stay empty, the consumer goes to sleep.  A producer only
+ * wakes it when it finds it asleep, and checks this without a fence, so it may
+ * miss the consumer going to sleep; the consumer then wakes up by itself after
+ * \c XSUM_QUEUE_PARK.  \c flush, a full ring, and the destructor always wake
+ * it.
+ *
+ * Producer \c i must only be used by one thread at a time.
+ *
+ * \code
+ * xsum_queue q(2);
+ * // thread 0: q.push(0, x);  thread 1: q.push(1, y);
+ * double const s = q.round();
+ * \endcode
+ */
+class xsum_queue {
+ public:
+  /*!
+   * \brief Construct a new xsum queue object, and start its consumer thread
+   *
+   * \param nproducers # of producers, each with its own ring
+   * \param capacity # of values in each ring (rounded up to a power of two)
+   * \param policy what push does when the ring of a producer is full
+   */
+  explicit xsum_queue(int const nproducers,
+                      std::size_t const capacity = XSUM_QUEUE_CAPACITY,
+                      xsum_backpressure const policy = xsum_backpressure::wait);
+
+  /*!
+   * \brief Destroy the xsum queue object, after adding the values pushed so
+   * far and stopping the consumer thread
+   */
+  ~xsum_queue();
+
+  xsum_queue(xsum_queue const &) = delete;
+  xsum_queue &operator=(xsum_queue const &) = delete;
+
+  /*!
+   * \brief Add a value from a producer
+   *
+   * \param producer index of the producer, in [0, nproducers)
+   * \param value
+   * \return false if the value was rejected because the ring is full, which
+   * only happens with the \c xsum_backpressure::reject policy
+   */
+  bool push(int const producer, xsum_flt const value);
+
+  /*!
+   * \brief Wait until all values pushed before the call have been added to the
+   * accumulator
+   */
+  void flush();
+
+  /*!
+   * \brief Flush, and round the accumulator to the nearest floating-point
+   * number
+   */
+  xsum_flt round();
+
+  /*!
+   * \brief Flush, and round the accumulator to a small accumulator (for
+   * combining with others, as with MPI)
+   */
+  xsum_small_accumulator round_to_small();
+
+ private:
+  /* Loop of the consumer thread */
+  void consume();
+
+  /* Add what is in the rings to the accumulator, return # of values added */
+  std::size_t drain_all();
+
+  /* Sleep until woken up, or XSUM_QUEUE_PARK has passed */
+  void park();
+
+  /* Wake the consumer up if it is asleep */
+  void wake();
+
+ private:
+  xsum_backpressure const _policy;
+  std::vector<std::unique_ptr<xsum_ring>> _rings;
+  std::unique_ptr<xsum_large_accumulator> _lacc;
+  std::mutex _mutex;
+  std::mutex _park_mutex;
+  std::condition_variable _park;
+  std::atomic<bool> _sleeping;
+  std::atomic<bool> _stop;
+  std::thread _consumer;
+};
+
+/* RING */
+
+xsum_ring::xsum_ring(std::size_t const capacity)
+    : _head(0), _tail_cache(0), _tail(0), _head_cache(0) {
+  std::size_t n = 1;
+  while (n < capacity) {
+    n <<= 1;
+  }
+  _mask = n - 1;
+  _buf.reset(new xsum_flt[n]);
+}
+
+bool xsum_ring::push(xsum_flt const value) {
+  std::size_t const h = _head.load(std::memory_order_relaxed);
+  if (h - _tail_cache > _mask) {
+    _tail_cache = _tail.load(std::memory_order_acquire);
+    if (h - _tail_cache > _mask) {
+      return false;
+    }
+  }
+  _buf[h & _mask] = value;
+  _head.store(h + 1, std::memory_order_release);
+  return true;
+}
+
+std::size_t xsum_ring::drain(xsum_large_accumulator *const lacc,
+                             std::size_t const max) {
+  std::size_t const t = _tail.load(std::memory_order_relaxed);
+  if (_head_cache == t) {
+    _head_cache = _head.load(std::memory_order_acquire);
+    if (_head_cache == t) {
+      return 0;
+    }
+  }
+
+  std::size_t const n = std::min(_head_cache - t, max);
+
+  /* The values may wrap around the end of the buffer */
+  std::size_t const i = t & _mask;
+  std::size_t const n1 = std::min(n, _mask + 1 - i);
+  xsum_add(lacc, _buf.get() + i, static_cast<xsum_length>(n1));
+  if (n1 < n) {
+    xsum_add(lacc, _buf.get(), static_cast<xsum_length>(n - n1));
+  }
+
+  _tail.store(t + n, std::memory_order_release);
+  return n;
+}
+
+bool xsum_ring::ready() {
+  std::size_t const t = _tail.load(std::memory_order_relaxed);
+  if (_head_cache == t) {
+    _head_cache = _head.load(std::memory_order_acquire);
+  }
+  return _head_cache != t;
+}
+
+std::size_t xsum_ring::pushed() const {
+  return _head.load(std::memory_order_acquire);
+}
+
+std::size_t xsum_ring::drained() const {
+  return _tail.load(std::memory_order_acquire);
+}
+
+/* QUEUE */
+
+xsum_queue::xsum_queue(int const nproducers, std::size_t const capacity,
+                       xsum_backpressure const policy)
+    : _policy(policy),
+      _lacc(new xsum_large_accumulator),
+      _sleeping(false),
+      _stop(false) {
+  for (int i = 0; i < nproducers; ++i) {
+    _rings.emplace_back(new xsum_ring(capacity));
+  }
+  _consumer = std::thread(&xsum_queue::consume, this);
+}
+
+xsum_queue::~xsum_queue() {
+  {
+    std::lock_guard<std::mutex> lock(_park_mutex);
+    _stop.store(true, std::memory_order_release);
+  }
+  _park.notify_one();
+  _consumer.join();
+}
+
+bool xsum_queue::push(int const producer, xsum_flt const value) {
+  xsum_ring *const ring = _rings[producer].get();
+  while (!ring->push(value)) {
+    if (_policy == xsum_backpressure::reject) {
+      return false;
+    }
+    wake();
+    std::this_thread::yield();
+  }
+  if (_sleeping.load(std::memory_order_relaxed)) {
+    wake();
+  }
+  return true;
+}
+
+std::size_t xsum_queue::drain_all() {
+  /* Empty rings are found without taking the lock, which is only there for
+     the accumulator */
+  bool any = false;
+  for (auto &ring : _rings) {
+    any = any || ring->ready();
+  }
+  if (!any) {
+    return 0;
+  }
+
+  std::size_t n = 0;
+  std::lock_guard<std::mutex> lock(_mutex);
+  for (auto &ring : _rings) {
+    n += ring->drain(_lacc.get(), XSUM_QUEUE_BATCH);
+  }
+  return n;
+}
+
+void xsum_queue::park() {
+  std::unique_lock<std::mutex> lock(_park_mutex);
+  _sleeping.store(true, std::memory_order_seq_cst);
+  bool any = _stop.load(std::memory_order_acquire);
+  for (auto &ring : _rings) {
+    any = any || ring->ready();
+  }
+  if (!any) {
+    _park.wait_for(lock, XSUM_QUEUE_PARK);
+  }
+  _sleeping.store(false, std::memory_order_relaxed);
+}
+
+void xsum_queue::wake() {
+  {
+    std::lock_guard<std::mutex> lock(_park_mutex);
+  }
+  _park.notify_one();
+}
+
+void xsum_queue::consume() {
+  int spins = 0;
+  for (;;) {
+    if (drain_all() != 0) {
+      spins = 0;
+    } else if (_stop.load(std::memory_order_acquire)) {
+      /* Values pushed before the stop request are all in the rings now */
+      while (drain_all() != 0) {
+      }
+      return;
+    } else if (++spins < XSUM_QUEUE_SPINS) {
+      std::this_thread::yield();
+    } else {
+      /* Until it finds values again, the consumer goes back to sleep as soon
+         as it wakes up */
+      park();
+    }
+  }
+}
+
+void xsum_queue::flush() {
+  wake();
+  for (auto &ring : _rings) {
+    std::size_t const h = ring->pushed();
+    while (ring->drained() < h) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+xsum_flt xsum_queue::round() {
+  flush();
+  std::lock_guard<std::mutex> lock(_mutex);
+  return xsum_round(_lacc.get());
+}
+
+xsum_small_accumulator xsum_queue::round_to_small() {
+  flush();
+  std::lock_guard<std::mutex> lock(_mutex);
+  return xsum_round_to_small(_lacc.get());
+}
+
+}  // namespace xsum
+
+#endif  // QUEUEXSUM_HPP
@@ -0,0 +1,371 @@
+//
+// RANGEXSUM.hpp
+//
+// LGPL Version 2.1 HEADER START
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+//
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+// MA 02110-1301  USA
+//
+// LGPL Version 2.1 HEADER END
+//
+
+//
+// Copyright (c) 2020, Regents of the University of Minnesota.
+// All rights reserved.
+//
+// Contributors:
+//    Yaser Afshar
+//
+
+#ifndef RANGEXSUM_HPP
+#define RANGEXSUM_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xsum.hpp"
+
+namespace xsum {
+
+/* CONSTANTS FOR THE RANGE-SUM INDEX. */
+
+/*! Default # of values in a block.  The two partial blocks take most of the
+ * time of a query, and the tree is a seventh of the size of the array. */
+static constexpr xsum_length XSUM_RANGE_BLOCK = 1024;
+/*! Below this # of nodes on a level of the tree, it is built by one thread */
+static constexpr xsum_length XSUM_RANGE_PARALLEL_MIN = 64;
+/*! Magic string at the start of the file */
+static constexpr char XSUM_RANGE_MAGIC[8] = {'X', 'S', 'U', 'M',
+                                             'R', 'N', 'G', '\0'};
+/*! Version of the file layout, 2 since the carry budget of the accumulators
+ * was added where version 1 had padding */
+static constexpr std::uint32_t XSUM_RANGE_VERSION = 2;
+/*! Written as is, to tell the byte order of the machine that made the file */
+static constexpr std::uint32_t XSUM_RANGE_BYTE_ORDER = 0x01020304;
+
+/*!
+ * \brief Header at the start of a saved range-sum index
+ *
+ * The file is this header, followed by the 2 \c blocks small accumulators of
+ * the tree, as laid out in memory.  As for the memory-mapped array, a file is
+ * only loaded by a machine with the same byte order and accumulator layout.
+ */
+struct xsum_range_header {
+  /*! XSUM_RANGE_MAGIC */
+  char magic[8];
+  /*! XSUM_RANGE_VERSION */
+  std::uint32_t version;
+  /*! XSUM_RANGE_BYTE_ORDER */
+  std::uint32_t byte_order;
+  /*! # of values of the array */
+  std::uint64_t count;
+  /*! # of values in a block */
+  std::uint64_t block;
+  /*! # of blocks */
+  std::uint64_t blocks;
+  /*! sizeof(xsum_small_accumulator) */
+  std::uint32_t accumulator_size;
+  /*! XSUM_SCHUNKS */
+  std::uint32_t schunks;
+};
+
+/*!
+ * \brief Index of an immutable array for exact sums of its ranges
+ *
+ * The array is cut into blocks of \c block values, and the small accumulator
+ * of each block is a leaf of a segment tree, whose other nodes are the merge
+ * of their two children.  The sum of a range merges the O(log n) nodes that
+ * cover its full blocks, and adds the values of the two partial blocks at its
+ * ends, instead of all its values.  The tree takes 2 small accumulators per
+ * block, 1.1 bytes per value with the default block size.
+ *
+ * The index refers to the array and does not copy it, so the array must
+ * outlive it and not change.  A built index can be saved, and loaded again
+ * with the same array, which is not checked.  Queries do not change the
+ * index, and any number of threads can make them at once.
+ *
+ * Errors in reading or writing a file, and files that are not valid indexes,
+ * throw \c std::runtime_error.
+ *
+ * \code
+ * xsum_range_index idx(vec, n, XSUM_RANGE_BLOCK, 4);
+ * double const s = idx.sum(i, j);  // x[i] + ... + x[j-1]
+ * idx.save("x.xsumrng");
+ * // later
+ * xsum_range_index idx2("x.xsumrng", vec, n);
+ * \endcode
+ */
+class xsum_range_index {
+ public:
+  /*!
+   * \brief Construct a new xsum range index object, by building the tree
+   *
+   * \param vec values
+   * \param n # of values
+   * \param block # of values in a block, at least 1
+   * \param nthreads # of threads that build the tree
+   */
+  xsum_range_index(xsum_flt const *vec, xsum_length const n,
+                   xsum_length const block = XSUM_RANGE_BLOCK,
+                   int const nthreads = 1);
+
+  xsum_range_index(std::vector<xsum_flt> const &vec,
+                   xsum_length const block = XSUM_RANGE_BLOCK,
+                   int const nthreads = 1);
+
+  /*!
+   * \brief Construct a new xsum range index object, by loading a saved tree
+   *
+   * \param path file name
+   * \param vec values, the same as when the index was built
+   * \param n # of values, which must match the file
+   */
+  xsum_range_index(std::string const &path, xsum_flt const *vec,
+                   xsum_length const n);
+
+  /*! # of values */
+  xsum_length size() const;
+
+  /*! # of values in a block */
+  xsum_length block() const;
+
+  /*!
+   * \brief Add the values i to j-1 to an accumulator
+   *
+   * \param i first value, at most j
+   * \param j one past the last value, at most size()
+   * \param sacc accumulator, which is not initialized first
+   */
+  void add(xsum_length const i, xsum_length const j,
+           xsum_small_accumulator *const sacc) const;
+
+  /*!
+   * \brief Exact sum of the values i to j-1, correctly rounded
+   *
+   */
+  xsum_flt sum(xsum_length const i, xsum_length const j) const;
+
+  /*!
+   * \brief Write the tree to a file
+   *
+   */
+  void save(std::string const &path) const;
+
+ private:
+  /* Build the leaves and the other nodes of the tree */
+  void build(int const nthreads);
+
+  /* Call f(b, e) on nthreads parts of [b, e), in threads */
+  template <class F>
+  static void parallel_for(xsum_length const b, xsum_length const e,
+                           int const nthreads, F const &f);
+
+ private:
+  xsum_flt const *_vec;
+  xsum_length _n;
+  xsum_length _block;
+  xsum_length _blocks;
+  /* Node 1 is the root, and the children of node k are 2k and 2k+1.  The
+     leaves are nodes _blocks to 2 _blocks - 1.  Node 0 is not used. */
+  std::vector<xsum_small_accumulator> _tree;
+};
+
+xsum_range_index::xsum_range_index(xsum_flt const *vec, xsum_length const n,
+                                   xsum_length const block,
+                                   int const nthreads)
+    : _vec(vec),
+      _n(n),
+      _block(std::max<xsum_length>(block, 1)),
+      _blocks((n + _block - 1) / _block),
+      _tree(static_cast<std::size_t>(2 * _blocks)) {
+  build(std::max(nthreads, 1));
+}
+
+xsum_range_index::xsum_range_index(std::vector<xsum_flt> const &vec,
+                                   xsum_length const block,
+                                   int const nthreads)
+    : xsum_range_index(vec.data(), static_cast<xsum_length>(vec.size()),
+                       block, nthreads) {}
+
+xsum_range_index::xsum_range_index(std::string const &path,
+                                   xsum_flt const *vec, xsum_length const n)
+    : _vec(vec), _n(n), _block(1), _blocks(0) {
+  std::FILE *f = std::fopen(path.c_str(), "rb");
+  if (!f) {
+    throw std::runtime_error(path + ": open: " + std::strerror(errno));
+  }
+
+  /* Check that the file was made by this layout, for an array of n values */
+  xsum_range_header h;
+  char const *why = nullptr;
+  if (std::fread(&h, sizeof(h), 1, f) != 1 ||
+      std::memcmp(h.magic, XSUM_RANGE_MAGIC, sizeof(XSUM_RANGE_MAGIC))) {
+    why = "not an xsum range index file";
+  } else if (h.version != XSUM_RANGE_VERSION) {
+    why = "unsupported version";
+  } else if (h.byte_order != XSUM_RANGE_BYTE_ORDER ||
+             h.accumulator_size != sizeof(xsum_small_accumulator) ||
+             h.schunks != XSUM_SCHUNKS) {
+    why = "accumulator layout differs from this machine";
+  } else if (h.count != static_cast<std::uint64_t>(n)) {
+    why = "unexpected number of values";
+  } else if (h.block == 0 || h.blocks != (h.count + h.block - 1) / h.block) {
+    why = "inconsistent header";
+  } else {
+    _block = static_cast<xsum_length>(h.block);
+    _blocks = static_cast<xsum_length>(h.blocks);
+    _tree.resize(static_cast<std::size_t>(2 * _blocks));
+    if (std::fread(_tree.data(), sizeof(xsum_small_accumulator), _tree.size(),
+                   f) != _tree.size() ||
+        std::fgetc(f) != EOF) {
+      why = "file size does not match the header";
+    }
+  }
+  std::fclose(f);
+  if (why) {
+    throw std::runtime_error(path + ": " + why);
+  }
+}
+
+xsum_length xsum_range_index::size() const { return _n; }
+
+xsum_length xsum_range_index::block() const { return _block; }
+
+template <class F>
+void xsum_range_index::parallel_for(xsum_length const b, xsum_length const e,
+                                    int const nthreads, F const &f) {
+  xsum_length const m = e - b;
+  int const t = static_cast<int>(std::min<xsum_length>(
+      nthreads, std::max<xsum_length>(m / XSUM_RANGE_PARALLEL_MIN, 1)));
+  if (t == 1) {
+    f(b, e);
+    return;
+  }
+  std::vector<std::thread> threads;
+  threads.reserve(t - 1);
+  for (int k = 1; k < t; ++k) {
+    threads.emplace_back(f, b + m * k / t, b + m * (k + 1) / t);
+  }
+  f(b, b + m / t);
+  for (auto &th : threads) {
+    th.join();
+  }
+}
+
+void xsum_range_index::build(int const nthreads) {
+  if (_blocks == 0) {
+    return;
+  }
+
+  /* Leaves, a block each.  The carries of every node are propagated, since
+     adding one to another adds its chunks as they are, as one add */
+  parallel_for(0, _blocks, nthreads,
+               [this](xsum_length const b, xsum_length const e) {
+                 for (xsum_length k = b; k < e; ++k) {
+                   xsum_small_accumulator *const sacc = &_tree[_blocks + k];
+                   xsum_init(sacc);
+                   xsum_length const i = k * _block;
+                   xsum_add(sacc, _vec + i, std::min(_block, _n - i));
+                   xsum_carry_propagate<xsum_small_accumulator>(sacc);
+                 }
+               });
+
+  /* Nodes 2^l to 2^(l+1)-1 only depend on the leaves and on the nodes of
+     the levels below them, so each level is built at once, from the bottom */
+  xsum_length top = 1;
+  while (2 * top < _blocks) {
+    top *= 2;
+  }
+  for (xsum_length l = top; l >= 1; l /= 2) {
+    parallel_for(l, std::min(2 * l, _blocks), nthreads,
+                 [this](xsum_length const b, xsum_length const e) {
+                   for (xsum_length k = b; k < e; ++k) {
+                     _tree[k] = _tree[2 * k];
+                     xsum_add(&_tree[k], &_tree[2 * k + 1]);
+                     xsum_carry_propagate<xsum_small_accumulator>(&_tree[k]);
+                   }
+                 });
+  }
+}
+
+void xsum_range_index::add(xsum_length const i, xsum_length const j,
+                           xsum_small_accumulator *const sacc) const {
+  if (i >= j) {
+    return;
+  }
+
+  /* Full blocks bl to br-1, and the partial blocks around them */
+  xsum_length bl = (i + _block - 1) / _block;
+  xsum_length br = j / _block;
+  if (bl >= br) {
+    xsum_add(sacc, _vec + i, j - i);
+    return;
+  }
+  xsum_add(sacc, _vec + i, bl * _block - i);
+  xsum_add(sacc, _vec + br * _block, j - br * _block);
+
+  for (bl += _blocks, br += _blocks; bl < br; bl /= 2, br /= 2) {
+    if (bl & 1) {
+      xsum_add(sacc, &_tree[bl++]);
+    }
+    if (br & 1) {
+      xsum_add(sacc, &_tree[--br]);
+    }
+  }
+}
+
+xsum_flt xsum_range_index::sum(xsum_length const i,
+                               xsum_length const j) const {
+  xsum_small_accumulator sacc;
+  add(i, j, &sacc);
+  return xsum_round(&sacc);
+}
+
+void xsum_range_index::save(std::string const &path) const {
+  xsum_range_header h;
+  std::memset(&h, 0, sizeof(h));
+  std::memcpy(h.magic, XSUM_RANGE_MAGIC, sizeof(XSUM_RANGE_MAGIC));
+  h.version = XSUM_RANGE_VERSION;
+  h.byte_order = XSUM_RANGE_BYTE_ORDER;
+  h.count = static_cast<std::uint64_t>(_n);
+  h.block = static_cast<std::uint64_t>(_block);
+  h.blocks = static_cast<std::uint64_t>(_blocks);
+  h.accumulator_size = sizeof(xsum_small_accumulator);
+  h.schunks = XSUM_SCHUNKS;
+
+  std::FILE *f = std::fopen(path.c_str(), "wb");
+  if (!f) {
+    throw std::runtime_error(path + ": open: " + std::strerror(errno));
+  }
+  bool const ok =
+      std::fwrite(&h, sizeof(h), 1, f) == 1 &&
+      std::fwrite(_tree.data(), sizeof(xsum_small_accumulator), _tree.size(),
+                  f) == _tree.size();
+  if (std::fclose(f) != 0 || !ok) {
+    throw std::runtime_error(path + ": write: " + std::strerror(errno));
+  }
+}
+
+}  // namespace xsum
+
+#endif  // RANGEXSUM_HPP
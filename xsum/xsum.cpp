@@ -167,9 +167,17 @@ class py_xsum_large : public xsum_large {
 
 PYBIND11_MODULE(xsum, m) {
   PYBIND11_NUMPY_DTYPE(xsum_small_accumulator, chunk, Inf, NaN,
-                       adds_until_propagate);
+                       adds_until_propagate, carry_budget);
+#ifdef XSUM_LARGE_INTERLEAVED
+  PYBIND11_NUMPY_DTYPE(xsum_lentry, chunk, count);
+  PYBIND11_NUMPY_DTYPE(xsum_large_accumulator, entry, chunks_used, used_used,
+                       sacc, count_bits);
+#else
   PYBIND11_NUMPY_DTYPE(xsum_large_accumulator, chunk, count, chunks_used,
-                       used_used, sacc);
+                       used_used, sacc, count_bits);
+#endif
+  PYBIND11_NUMPY_DTYPE(xsum_binned_accumulator, primary, carry, Inf, NaN,
+                       index, fold, adds_until_renorm);
 
   pybind11::class_<xsum_small_accumulator>(m, "xsum_small_accumulator")
       .def(pybind11::init<>());
@@ -177,12 +185,20 @@ PYBIND11_MODULE(xsum, m) {
   pybind11::class_<xsum_large_accumulator>(m, "xsum_large_accumulator")
       .def(pybind11::init<>());
 
+  pybind11::class_<xsum_binned_accumulator>(m, "xsum_binned_accumulator")
+      .def(pybind11::init<>())
+      .def(pybind11::init<int const>())
+      .def_readonly("fold", &xsum_binned_accumulator::fold);
+
   m.def("xsum_init", &xsum_init<xsum_small_accumulator>,
         "Initilize the xsum_small_accumulator object");
 
   m.def("xsum_init", &xsum_init<xsum_large_accumulator>,
         "Initilize the xsum_large_accumulator object");
 
+  m.def("xsum_init", &xsum_init<xsum_binned_accumulator>,
+        "Initilize the xsum_binned_accumulator object");
+
   m.def("xsum_add",
         (void (*)(xsum_small_accumulator *const, xsum_flt const)) &
             xsum_add<xsum_small_accumulator>,
@@ -193,6 +209,11 @@ PYBIND11_MODULE(xsum, m) {
             xsum_add<xsum_large_accumulator>,
         "Add a value to the superaccumulator.");
 
+  m.def("xsum_add",
+        (void (*)(xsum_binned_accumulator *const, xsum_flt const)) &
+            xsum_add<xsum_binned_accumulator>,
+        "Add a value to the binned accumulator.");
+
   m.def("xsum_add",
         (void (*)(xsum_small_accumulator *const,
                   pybind11::array_t<xsum_flt> const &)) &
@@ -205,6 +226,12 @@ PYBIND11_MODULE(xsum, m) {
             py_xsum_add<xsum_large_accumulator>,
         "Add a vector of values to the superaccumulator.");
 
+  m.def("xsum_add",
+        (void (*)(xsum_binned_accumulator *const,
+                  pybind11::array_t<xsum_flt> const &)) &
+            py_xsum_add<xsum_binned_accumulator>,
+        "Add a vector of values to the binned accumulator.");
+
   m.def("xsum_add",
         (void (*)(xsum_small_accumulator *const,
                   xsum_small_accumulator const *const)) &
@@ -223,24 +250,39 @@ PYBIND11_MODULE(xsum, m) {
             xsum_add<xsum_large_accumulator>,
         "Add a small accumulator to the large superaccumulator.");
 
+  m.def("xsum_add",
+        (void (*)(xsum_binned_accumulator *const,
+                  xsum_binned_accumulator *const)) &
+            xsum_add<xsum_binned_accumulator>,
+        "Add a binned accumulator to the binned accumulator.");
+
   m.def("xsum_add_sqnorm", &py_xsum_add_sqnorm<xsum_small_accumulator>,
         "Add a squared norm of vector of values to the superaccumulator.");
 
   m.def("xsum_add_sqnorm", &py_xsum_add_sqnorm<xsum_large_accumulator>,
         "Add a squared norm of vector of values to the superaccumulator.");
 
+  m.def("xsum_add_sqnorm", &py_xsum_add_sqnorm<xsum_binned_accumulator>,
+        "Add a squared norm of vector of values to the binned accumulator.");
+
   m.def("xsum_add_dot", &py_xsum_add_dot<xsum_small_accumulator>,
         "Add dot product of two vectors of values to the superaccumulator.");
 
   m.def("xsum_add_dot", &py_xsum_add_dot<xsum_large_accumulator>,
         "Add dot product of two vectors of values to the superaccumulator.");
 
+  m.def("xsum_add_dot", &py_xsum_add_dot<xsum_binned_accumulator>,
+        "Add dot product of two vectors of values to the binned accumulator.");
+
   m.def("xsum_round", &xsum_round<xsum_small_accumulator>,
         "Return the results of rounding the superaccumulator.");
 
   m.def("xsum_round", &xsum_round<xsum_large_accumulator>,
         "Return the results of rounding the superaccumulator.");
 
+  m.def("xsum_round", &xsum_round<xsum_binned_accumulator>,
+        "Return the results of rounding the binned accumulator.");
+
   m.def("xsum_round_to_small", &xsum_round_to_small<xsum_large_accumulator>,
         "Return the results of rounding a large superaccumulator to a small "
         "superaccumulator.");
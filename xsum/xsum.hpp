@@ -76,6 +76,8 @@
 
 #include <algorithm>
 #include <bitset>
+#include <cmath>
+#include <complex>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
@@ -85,6 +87,70 @@
 #include <memory>
 #include <vector>
 
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+/* PRE-FETCH DISTANCES AND STREAMING OF LARGE INPUTS.  The distances are the
+   number of values ahead of the one being added that the vector functions of
+   the large accumulator ask the cache to fetch, for each input array (add_dot
+   reads two).  Zero disables the explicit pre-fetch.  If XSUM_STREAM_THRESHOLD
+   is non-zero, inputs of at least that many values are assumed to be read
+   once and not fit in cache, and are pre-fetched as non-temporal, so they do
+   not evict the chunks and counts of the accumulator.  Streaming is off by
+   default, since it slows down inputs that would have stayed in the last
+   level cache.  All can be set at compile time, e.g. -DXSUM_PREFETCH_ADD=0.
+   See benchmarks/bench_xsum.cpp. */
+#ifndef XSUM_PREFETCH_ADD
+#define XSUM_PREFETCH_ADD 512
+#endif
+#ifndef XSUM_PREFETCH_SQNORM
+#define XSUM_PREFETCH_SQNORM 512
+#endif
+#ifndef XSUM_PREFETCH_DOT
+#define XSUM_PREFETCH_DOT 256
+#endif
+#ifndef XSUM_STREAM_THRESHOLD
+#define XSUM_STREAM_THRESHOLD 0
+#endif
+
+/* CARRY BUDGETS.  XSUM_SMALL_CARRY_BUDGET is the number of values added to a
+   small accumulator between carry propagations, at most 2047 (the default),
+   which the 11 bits above the mantissa in a 64-bit chunk can hold, and at least
+   2, since a propagation leaves the budget less one for the adds after it.
+   XSUM_LARGE_COUNT_BITS sets the number of values added to a chunk of a large
+   accumulator before it is moved to the small accumulator, 2^bits, at most 12
+   (the default) for the same reason.  Smaller budgets are just as exact, at the
+   cost of more frequent propagations, and are there to compare on a given
+   machine and data, e.g. -DXSUM_SMALL_CARRY_BUDGET=255.  These are the
+   defaults, and xsum_small_budget_accumulator and xsum_large_budget_accumulator
+   take others as template parameters, which set fields of the accumulator
+   read only when carries are propagated or chunks moved, and
+   xsum_bounded_accumulator as a constructor argument.  The split of the
+   exponent into chunk index and position (XSUM_LOW_EXP_BITS) is not a build
+   option, since rounding takes the two chunks below the uppermost one to fill
+   a mantissa.  See benchmarks/bench_xsum.cpp. */
+#ifndef XSUM_SMALL_CARRY_BUDGET
+#define XSUM_SMALL_CARRY_BUDGET 2047
+#endif
+#ifndef XSUM_LARGE_COUNT_BITS
+#define XSUM_LARGE_COUNT_BITS 12
+#endif
+
+/* INTEGER FAST PATH.  The vector add functions of the small and large
+   accumulators look at their input in blocks of XSUM_INTEGER_BLOCK values.  A
+   block of integers of magnitude below 2^51 (counts, or amounts in cents) is
+   summed in a 64-bit integer, which is exact and cannot overflow for blocks
+   of up to 1024 values, and its sum is added to the accumulator once.  Other
+   blocks are added as usual, and are told apart by their first value in most
+   data.  A block that starts with integers is summed as integers up to the
+   first group of 32 values that is not all integers, and the rest of it is
+   added as usual.  0 disables it, e.g. -DXSUM_INTEGER_BLOCK=0.  See
+   benchmarks/bench_xsum.cpp. */
+#ifndef XSUM_INTEGER_BLOCK
+#define XSUM_INTEGER_BLOCK 256
+#endif
+
 namespace xsum {
 /* CONSTANTS DEFINING THE FLOATING POINT FORMAT. */
 
@@ -96,8 +162,9 @@ using xsum_int = std::int64_t;
 using xsum_uint = std::uint64_t;
 /*! Integer type for holding an exponent */
 using xsum_expint = std::int_fast16_t;
-/*! TYPE FOR LENGTHS OF ARRAYS.  Must be a signed integer type. */
-using xsum_length = int;
+/*! TYPE FOR LENGTHS OF ARRAYS.  Must be a signed integer type, 64 bits so
+ * that more than 2^31 values can be added in one call. */
+using xsum_length = std::int64_t;
 /*! Integer type of small accumulator chunk */
 using xsum_schunk = std::int64_t;
 /*! Integer type of large accumulator chunk, must be EXACTLY 64 bits in size */
@@ -106,6 +173,14 @@ using xsum_lchunk = std::uint64_t;
 using xsum_lcount = std::int_least16_t;
 /*! Unsigned type for holding used flags */
 using xsum_used = std::uint_fast64_t;
+#ifdef __SIZEOF_INT128__
+/*! Integer type of chunk of the small accumulator with 128-bit chunks */
+__extension__ using xsum_schunk128 = __int128;
+/*! Integer type of chunk of the large accumulator with 128-bit chunks */
+__extension__ using xsum_lchunk128 = unsigned __int128;
+/*! Signed int type of counts for the large accumulator with 128-bit chunks */
+using xsum_lcount128 = std::int32_t;
+#endif
 
 /*! UNION OF FLOATING AND INTEGER TYPES. */
 union fpunion {
@@ -159,18 +234,103 @@ static constexpr xsum_int XSUM_LOW_MANTISSA_MASK =
 static constexpr int XSUM_SMALL_CARRY_BITS =
     ((XSUM_SCHUNK_BITS - 1) - XSUM_MANTISSA_BITS);
 /*! # terms can add before need prop. */
-static constexpr int XSUM_SMALL_CARRY_TERMS =
-    ((1 << XSUM_SMALL_CARRY_BITS) - 1);
+static constexpr int XSUM_SMALL_CARRY_TERMS = XSUM_SMALL_CARRY_BUDGET;
+static_assert(XSUM_SMALL_CARRY_TERMS >= 2 &&
+                  XSUM_SMALL_CARRY_TERMS <= (1 << XSUM_SMALL_CARRY_BITS) - 1,
+              "XSUM_SMALL_CARRY_BUDGET must be in [2, 2047]");
 
 /* CONSTANTS DEFINING THE LARGE ACCUMULATOR FORMAT. */
 
 /*! Bits in chunk of the large accumulator */
 static constexpr int XSUM_LCHUNK_BITS = 64;
 /*! # of bits in count */
-static constexpr int XSUM_LCOUNT_BITS = (64 - XSUM_MANTISSA_BITS);
+static constexpr int XSUM_LCOUNT_BITS = XSUM_LARGE_COUNT_BITS;
+static_assert(XSUM_LCOUNT_BITS >= 1 &&
+                  XSUM_LCOUNT_BITS <= XSUM_LCHUNK_BITS - XSUM_MANTISSA_BITS,
+              "XSUM_LARGE_COUNT_BITS must be in [1, 12]");
 /*! # of chunks in large accumulator */
 static constexpr int XSUM_LCHUNKS = (1 << (XSUM_EXP_BITS + 1));
 
+/* CONSTANTS DEFINING THE WINDOWED ACCUMULATOR FORMAT. */
+
+/*! # of consecutive exponents in the window of a windowed accumulator */
+static constexpr int XSUM_WINDOW_EXPS = 256;
+/*! # of chunks, one per exponent in the window and sign, plus the trap chunk
+ * that all values outside the window map to */
+static constexpr int XSUM_WCHUNKS = 2 * XSUM_WINDOW_EXPS + 1;
+/*! Index of the trap chunk, whose count always stays at -1 */
+static constexpr int XSUM_WINDOW_TRAP = 2 * XSUM_WINDOW_EXPS;
+/*! Window base of an accumulator with no window yet (no exponent maps) */
+static constexpr xsum_expint XSUM_WINDOW_UNSET = 1 << (XSUM_EXP_BITS + 1);
+/*! # of values outside the window between checks whether to move it */
+static constexpr int XSUM_WINDOW_CHECK = 64;
+/*! # of squares or products computed at a time by the windowed accumulator */
+static constexpr int XSUM_WINDOW_BLOCK = 256;
+
+/* CONSTANTS DEFINING THE BINNED ACCUMULATOR FORMAT. */
+
+/*! # of bits of each bin of a binned accumulator */
+static constexpr int XSUM_BIN_WIDTH = 40;
+/*! Exponent of the unit of bin 0, the lowest bin a value can start in */
+static constexpr int XSUM_BIN_MIN_EXP = 1 - XSUM_EXP_BIAS;
+/*! Largest # of folds (consecutive bins kept) of a binned accumulator */
+static constexpr int XSUM_BIN_MAX_FOLD = 4;
+/*! Default # of folds */
+static constexpr int XSUM_BIN_FOLD = 3;
+/*! # of values that can be added to a fold before its carry is taken out */
+static constexpr int XSUM_BIN_ENDURANCE =
+    1 << (XSUM_MANTISSA_BITS - XSUM_BIN_WIDTH);
+/*! # of values (or squares or products) scanned for their largest exponent
+ * before they are added */
+static constexpr int XSUM_BIN_BLOCK = 256;
+
+#ifdef __SIZEOF_INT128__
+/* CONSTANTS DEFINING THE FORMATS WITH 128-BIT CHUNKS. */
+
+/*! # terms can add to a small accumulator with 128-bit chunks before need
+ * prop.  Its chunks have 74 bits to carry into, so the count is the limit. */
+static constexpr xsum_int XSUM_SMALL128_CARRY_TERMS = static_cast<xsum_int>(1)
+                                                      << 62;
+/*! # of bits in count of a large accumulator with 128-bit chunks */
+static constexpr int XSUM_LCOUNT128_BITS = 30;
+/*! # of squares or products computed at a time by the accumulators with
+ * 128-bit chunks */
+static constexpr int XSUM_BLOCK128 = 256;
+#endif
+
+/* CONSTANTS FOR ACCUMULATORS FOR A RANGE OF EXPONENTS. */
+
+/*! # of squares or products computed at a time by the accumulators for a
+ * range of exponents */
+static constexpr int XSUM_BOUNDED_BLOCK = 256;
+
+/* CONSTANTS FOR THE INTEGER FAST PATH. */
+
+/*! # of values checked for being integers at a time, 0 if not checked */
+static constexpr xsum_length XSUM_INTEGER_BLOCK_SIZE = XSUM_INTEGER_BLOCK;
+static_assert(XSUM_INTEGER_BLOCK_SIZE >= 0 && XSUM_INTEGER_BLOCK_SIZE <= 1024,
+              "XSUM_INTEGER_BLOCK must be in [0, 1024]");
+/*! Integer values summed as integers are less than this in magnitude, 2^51,
+ * so that adding XSUM_INTEGER_SHIFT to them is exact */
+static constexpr xsum_flt XSUM_INTEGER_MAX = 2251799813685248.0;
+/*! 1.5 * 2^52.  The sum of this and an integer x of magnitude below 2^51 has
+ * x in the low bits of its mantissa, and those of the shift above them */
+static constexpr xsum_flt XSUM_INTEGER_SHIFT = 6755399441055744.0;
+/*! # of values checked together for being integers, within a block */
+static constexpr xsum_length XSUM_INTEGER_GROUP = 32;
+
+/* CONSTANTS FOR BUFFERED ACCUMULATORS. */
+
+/*! Default # of values staged by a buffered accumulator before they are added
+ * with the vector add function */
+static constexpr int XSUM_BUFFER_SIZE = 256;
+
+/* CONSTANTS FOR SUMMING COMPLEX NUMBERS. */
+
+/*! # of complex values de-interleaved at a time (the real and imaginary
+ * buffers of this size stay in L1 cache) */
+static constexpr int XSUM_COMPLEX_BLOCK = 256;
+
 /*! DEBUG FLAG.  Set to non-zero for debug ouptut.  Ignored unless xsum.c is
  * compiled with -DDEBUG. */
 static constexpr int xsum_debug = 0;
@@ -190,28 +350,299 @@ struct xsum_small_accumulator {
   xsum_int NaN = 0;
   /*! Number of remaining adds before carry */
   int adds_until_propagate = XSUM_SMALL_CARRY_TERMS;
+  /*! Number of adds between carry propagations, or 0 for
+   * XSUM_SMALL_CARRY_TERMS, so that an accumulator of all zeros is empty */
+  int carry_budget = 0;
+};
+
+#ifdef XSUM_LARGE_INTERLEAVED
+/*!
+ * \brief A chunk of the large accumulator stored next to its count
+ *
+ */
+struct xsum_lentry {
+  /*! Chunk of the large accumulator */
+  xsum_lchunk chunk;
+  /*! Count of # adds remaining for the chunk, or -1 if not used yet or
+   * special. */
+  xsum_lcount count;
 };
+#endif
 
 /*!
  * \brief Large super accumulator
  *
+ * By default the chunks and their counts are kept in two separate arrays.
+ * Compiled with -DXSUM_LARGE_INTERLEAVED, each chunk is stored next to its
+ * count (16 bytes with padding), so that adding a value updates one cache
+ * line instead of two, at the cost of a larger accumulator (64 KiB instead of
+ * 40 KiB).  The chunks and counts are accessed through lchunk and lcount,
+ * which work with either layout.
  */
 struct xsum_large_accumulator {
   xsum_large_accumulator();
 
+  /*! Chunk ix of the large accumulator */
+  inline xsum_lchunk &lchunk(xsum_expint const ix) noexcept;
+  inline xsum_lchunk const &lchunk(xsum_expint const ix) const noexcept;
+
+  /*! Count of # adds remaining for chunk ix */
+  inline xsum_lcount &lcount(xsum_expint const ix) noexcept;
+  inline xsum_lcount const &lcount(xsum_expint const ix) const noexcept;
+
+#ifdef XSUM_LARGE_INTERLEAVED
+  /*! Chunks making up large accumulator, each with its count */
+  xsum_lentry entry[XSUM_LCHUNKS];
+#else
   /*! Chunks making up large accumulator */
   xsum_lchunk chunk[XSUM_LCHUNKS];
   /*! Counts of # adds remaining for chunks, or -1 if not used yet or special.
    */
   xsum_lcount count[XSUM_LCHUNKS];
+#endif
   /*! Bits indicate chunks in use */
   xsum_used chunks_used[XSUM_LCHUNKS / 64] = {};
   /*! Bits indicate chunk_used entries not 0 */
   xsum_used used_used = 0;
   /*! The small accumulator to condense into */
   xsum_small_accumulator sacc;
+  /*! A chunk is moved to the small accumulator after 2^count_bits adds */
+  int count_bits = XSUM_LCOUNT_BITS;
+};
+
+/*!
+ * \brief Small super accumulator with its own carry budget
+ *
+ * A small accumulator that propagates carries after CarryBudget adds instead
+ * of XSUM_SMALL_CARRY_BUDGET, so that accumulators with different budgets can
+ * be used side by side in one program.  It is a small accumulator, and is
+ * used with the same functions.
+ *
+ * \code
+ * xsum_small_budget_accumulator<255> sacc;
+ * xsum_add(&sacc, vec);
+ * \endcode
+ */
+template <int CarryBudget>
+struct xsum_small_budget_accumulator : xsum_small_accumulator {
+  static_assert(CarryBudget >= 2 &&
+                    CarryBudget <= (1 << XSUM_SMALL_CARRY_BITS) - 1,
+                "the carry budget must be in [2, 2047]");
+
+  /*! The accumulator the functions work on */
+  using base_type = xsum_small_accumulator;
+
+  xsum_small_budget_accumulator() {
+    carry_budget = CarryBudget;
+    adds_until_propagate = CarryBudget;
+  }
+};
+
+/*!
+ * \brief Large super accumulator with its own carry budgets
+ *
+ * A large accumulator that moves a chunk to its small accumulator after
+ * 2^CountBits adds, and whose small accumulator has a carry budget of
+ * CarryBudget, instead of the build options.  It is a large accumulator, and
+ * is used with the same functions.
+ */
+template <int CarryBudget, int CountBits>
+struct xsum_large_budget_accumulator : xsum_large_accumulator {
+  static_assert(CarryBudget >= 2 &&
+                    CarryBudget <= (1 << XSUM_SMALL_CARRY_BITS) - 1,
+                "the carry budget must be in [2, 2047]");
+  static_assert(CountBits >= 1 &&
+                    CountBits <= XSUM_LCHUNK_BITS - XSUM_MANTISSA_BITS,
+                "the count bits must be in [1, 12]");
+
+  /*! The accumulator the functions work on */
+  using base_type = xsum_large_accumulator;
+
+  xsum_large_budget_accumulator() {
+    sacc.carry_budget = CarryBudget;
+    sacc.adds_until_propagate = CarryBudget;
+    count_bits = CountBits;
+  }
+};
+
+/* CARRY BUDGET OF A SMALL ACCUMULATOR.  The # of adds between its carry
+   propagations. */
+
+static inline int xsum_carry_terms(xsum_small_accumulator const *const sacc) {
+  return sacc->carry_budget != 0 ? sacc->carry_budget : XSUM_SMALL_CARRY_TERMS;
+}
+
+/*!
+ * \brief Windowed large super accumulator
+ *
+ * A large accumulator whose chunks cover only a window of XSUM_WINDOW_EXPS
+ * consecutive exponents (for both signs), which keeps it small enough
+ * (about 5 KiB) to stay in the L1 cache.  The window is placed on the first
+ * non-zero value added.  Values outside the window are added exactly to the
+ * small accumulator, which is slower.  When such values keep coming, the
+ * window is moved to cover them as well as the exponents in use if they all
+ * fit in it, or else to cover just them if they fit and outnumber the values
+ * inside it.  Rounding only visits the chunks in use.
+ */
+struct xsum_window_accumulator {
+  xsum_window_accumulator();
+
+  /*! Chunks for exponent base + i / 2, for positive values when i is even
+   * and negative ones when it is odd, then the trap chunk */
+  xsum_lchunk chunk[XSUM_WCHUNKS];
+  /*! Counts of # adds remaining for chunks, or -1 if not used yet or special.
+   */
+  xsum_lcount count[XSUM_WCHUNKS];
+  /*! Bits indicate chunks in use */
+  xsum_used chunks_used[(XSUM_WCHUNKS + 63) / 64] = {};
+  /*! Lowest exponent in the window, or XSUM_WINDOW_UNSET */
+  xsum_expint base = XSUM_WINDOW_UNSET;
+  /*! Lowest and highest exponents of the values outside the window */
+  xsum_expint miss_lo = XSUM_EXP_MASK;
+  xsum_expint miss_hi = 0;
+  /*! # of values added since the window was placed */
+  xsum_int adds = 0;
+  /*! # of those that were outside the window */
+  xsum_int misses = 0;
+  /*! The small accumulator to condense into */
+  xsum_small_accumulator sacc;
+};
+
+/*!
+ * \brief Binned accumulator
+ *
+ * A reproducible, but not exact, accumulator.  Values are split along a fixed
+ * grid of bins of XSUM_BIN_WIDTH bits, and only the \c fold bins below the
+ * largest value added are kept.  The part of each value in a bin is rounded to
+ * an integer multiple of its unit, so bits below the lowest bin kept are
+ * rounded off.  Since the parts only depend on the value and the grid, and the
+ * first bin only on the largest value, the sum is the same in any order and
+ * for any grouping of partial sums.  The error is at most n * max|x| *
+ * 2^-((fold - 1) * XSUM_BIN_WIDTH) for n values, plus the final rounding.
+ * Denormalized values can have bits below the lowest bin kept, whose unit is
+ * 2^(XSUM_BIN_MIN_EXP - (fold - 1) * XSUM_BIN_WIDTH), so with fold 1 or 2 the
+ * error is at most n times half that unit, 2^-1023 or 2^-1063, if larger.
+ * With more folds that bin is below 2^-1074, and they are kept exactly.
+ */
+struct xsum_binned_accumulator {
+  xsum_binned_accumulator() = default;
+  /*! \param fold # of bins kept, from 1 to XSUM_BIN_MAX_FOLD */
+  explicit xsum_binned_accumulator(int const fold);
+
+  /*! Sums of the parts in each fold, in units of its bin */
+  xsum_flt primary[XSUM_BIN_MAX_FOLD] = {};
+  /*! Carries out of the primaries, in units of 2^XSUM_BIN_WIDTH of the bin */
+  xsum_int carry[XSUM_BIN_MAX_FOLD] = {};
+  /*! If non-zero, +Inf, -Inf, or NaN */
+  xsum_int Inf = 0;
+  /*! If non-zero, a NaN value with payload */
+  xsum_int NaN = 0;
+  /*! Bin of the first fold */
+  int index = 0;
+  /*! # of folds in use */
+  int fold = XSUM_BIN_FOLD;
+  /*! Number of remaining adds before the carries are taken out */
+  int adds_until_renorm = XSUM_BIN_ENDURANCE;
+};
+
+#ifdef __SIZEOF_INT128__
+/*!
+ * \brief Small super accumulator with 128-bit chunks
+ *
+ * The chunks are laid out as for the small accumulator, but each has 74 bits
+ * above the mantissa to carry into instead of 11, so that carries are only
+ * propagated when it is rounded.  Only available where the compiler has
+ * __int128 (GCC and Clang on 64-bit targets).
+ */
+struct xsum_small128_accumulator {
+  /*! Chunks making up small accumulator */
+  xsum_schunk128 chunk[XSUM_SCHUNKS] = {};
+  /*! If non-zero, +Inf, -Inf, or NaN */
+  xsum_int Inf = 0;
+  /*! If non-zero, a NaN value with payload */
+  xsum_int NaN = 0;
+  /*! Number of remaining adds before carry */
+  xsum_int adds_until_propagate = XSUM_SMALL128_CARRY_TERMS;
+};
+
+/*!
+ * \brief Large super accumulator with 128-bit chunks
+ *
+ * A large accumulator whose chunks take 2^XSUM_LCOUNT128_BITS values before
+ * they are moved to its small accumulator, instead of 4096, which also has
+ * 128-bit chunks.  It takes 80 KiB instead of 40 KiB.
+ */
+struct xsum_large128_accumulator {
+  xsum_large128_accumulator();
+
+  /*! Chunks making up large accumulator */
+  xsum_lchunk128 chunk[XSUM_LCHUNKS];
+  /*! Counts of # adds remaining for chunks, or -1 if not used yet or special.
+   */
+  xsum_lcount128 count[XSUM_LCHUNKS];
+  /*! Bits indicate chunks in use */
+  xsum_used chunks_used[XSUM_LCHUNKS / 64] = {};
+  /*! The small accumulator to condense into */
+  xsum_small128_accumulator sacc;
+};
+#endif
+
+/*!
+ * \brief Small super accumulator for values in a range of exponents
+ *
+ * A small accumulator that keeps only the chunks that values x with
+ * 2^MinExp <= |x| < 2^(MaxExp + 1) add to, and two more to carry into, so
+ * that it is smaller and carries are propagated over fewer chunks (7 instead
+ * of 67 for [2^-60, 2^61)).  Other non-zero values are added to a small
+ * accumulator allocated for the first of them, which is slower.  The free
+ * functions are overloaded for it rather than specialized, so they are called
+ * without template arguments.
+ */
+template <int MinExp, int MaxExp>
+struct xsum_bounded_accumulator {
+  static_assert(MinExp >= 1 - XSUM_EXP_BIAS && MaxExp <= XSUM_EXP_BIAS &&
+                    MinExp <= MaxExp,
+                "the range must be within the normalized exponents");
+
+  /*! Biased exponents of the lowest and highest values in range */
+  static constexpr xsum_expint exp_lo = MinExp + XSUM_EXP_BIAS;
+  static constexpr xsum_expint exp_hi = MaxExp + XSUM_EXP_BIAS;
+  /*! Index in a small accumulator of the lowest chunk kept */
+  static constexpr int base = exp_lo >> XSUM_LOW_EXP_BITS;
+  /*! # of chunks kept */
+  static constexpr int nchunks = (exp_hi >> XSUM_LOW_EXP_BITS) - base + 4;
+
+  xsum_bounded_accumulator() = default;
+  /*! \param carry_budget # of adds between carry propagations, from 2 to
+   * 2047 */
+  explicit xsum_bounded_accumulator(int const carry_budget);
+  xsum_bounded_accumulator(xsum_bounded_accumulator const &other);
+  xsum_bounded_accumulator &operator=(xsum_bounded_accumulator const &other);
+
+  /*! Chunks base to base + nchunks - 1 of a small accumulator */
+  xsum_schunk chunk[nchunks] = {};
+  /*! If non-zero, +Inf, -Inf, or NaN */
+  xsum_int Inf = 0;
+  /*! If non-zero, a NaN value with payload */
+  xsum_int NaN = 0;
+  /*! Number of remaining adds before carry */
+  int adds_until_propagate = XSUM_SMALL_CARRY_TERMS;
+  /*! Number of adds between carry propagations, or 0 for
+   * XSUM_SMALL_CARRY_TERMS, as for the small accumulator, which the sum of
+   * the values outside the range also uses */
+  int carry_budget = 0;
+  /*! Sum of the values outside the range, or null if there was none */
+  std::unique_ptr<xsum_small_accumulator> outside;
 };
 
+/* CARRY BUDGET OF AN ACCUMULATOR FOR A RANGE OF EXPONENTS. */
+
+template <int MinExp, int MaxExp>
+static inline int xsum_carry_terms(
+    xsum_bounded_accumulator<MinExp, MaxExp> const *const bacc) {
+  return bacc->carry_budget != 0 ? bacc->carry_budget : XSUM_SMALL_CARRY_TERMS;
+}
+
 /*!
  * \brief Small superaccumulator class
  *
@@ -292,6 +723,63 @@ class xsum_small {
   void add_dot(std::vector<xsum_flt> const &vec1,
                std::vector<xsum_flt> const &vec2);
 
+  /*!
+   * \brief Add a vector of complex numbers to a pair of superaccumulators.
+   *
+   * The real parts are added to this superaccumulator and the imaginary parts
+   * to \p imag. The interleaved data is read only once.
+   *
+   * \param imag superaccumulator for the imaginary parts
+   * \param vec vector of complex numbers
+   * \param n vector length
+   */
+  void add(xsum_small &imag, std::complex<xsum_flt> const *vec,
+           xsum_length const n);
+  void add(xsum_small &imag, std::vector<std::complex<xsum_flt>> const &vec);
+
+  /*!
+   * \brief Add squared norm of a vector of complex numbers (sum of the squared
+   * magnitudes of its elements) to a superaccumulator.
+   *
+   * \param vec vector of complex numbers
+   * \param n vector length
+   */
+  void add_sqnorm(std::complex<xsum_flt> const *vec, xsum_length const n);
+  void add_sqnorm(std::vector<std::complex<xsum_flt>> const &vec);
+
+  /*!
+   * \brief Add dot product of vectors of complex numbers (sum of products of
+   * corresponding elements, without conjugation) to a pair of
+   * superaccumulators.
+   *
+   * The real part is added to this superaccumulator and the imaginary part to
+   * \p imag. Each of the four real products is rounded, as in add_dot.
+   *
+   * \param imag superaccumulator for the imaginary part
+   * \param vec1 vector of complex numbers
+   * \param vec2 vector of complex numbers
+   * \param n vector length
+   */
+  void add_dot(xsum_small &imag, std::complex<xsum_flt> const *vec1,
+               std::complex<xsum_flt> const *vec2, xsum_length const n);
+  void add_dot(xsum_small &imag, std::vector<std::complex<xsum_flt>> const &vec1,
+               std::vector<std::complex<xsum_flt>> const &vec2);
+
+  /*!
+   * \brief Add dot product of vectors of complex numbers, conjugating the
+   * elements of the first vector, to a pair of superaccumulators.
+   *
+   * \param imag superaccumulator for the imaginary part
+   * \param vec1 vector of complex numbers (conjugated)
+   * \param vec2 vector of complex numbers
+   * \param n vector length
+   */
+  void add_dotc(xsum_small &imag, std::complex<xsum_flt> const *vec1,
+                std::complex<xsum_flt> const *vec2, xsum_length const n);
+  void add_dotc(xsum_small &imag,
+                std::vector<std::complex<xsum_flt>> const &vec1,
+                std::vector<std::complex<xsum_flt>> const &vec2);
+
   /*!
    * \brief Return the results of rounding a superaccumulator.
    *
@@ -303,6 +791,65 @@ class xsum_small {
    */
   xsum_flt round();
 
+  /*!
+   * \brief Sign of the sum, without rounding
+   *
+   * The superaccumulator may be modified by carry propagation, as by round,
+   * but only when its uppermost non-zero chunk is too small to decide.
+   *
+   * \return -1, 0, or 1 (0 for a NaN)
+   */
+  int sign();
+
+  /*!
+   * \brief Whether the sum is exactly zero, without rounding
+   *
+   */
+  bool is_zero();
+
+  /*!
+   * \brief Compare the sum with that of another small accumulator, without
+   * rounding
+   *
+   * \return -1, 0, or 1 as this sum is smaller than, equal to, or larger than
+   * the other one (0 if either is a NaN)
+   */
+  int compare(xsum_small &other);
+
+  /*!
+   * \brief Negate the sum
+   *
+   */
+  void negate();
+
+  /*!
+   * \brief Subtract the sum of another small accumulator, exactly
+   *
+   */
+  void sub(xsum_small_accumulator const *value);
+  void sub(xsum_small const &xvalue);
+
+  /*!
+   * \brief Multiply the sum by 2^exp, exactly, by shifting the chunks
+   *
+   * \return false if bits below the smallest denormalized number were
+   * discarded, or if the result is too large for the superaccumulator, which
+   * then holds an Inf
+   */
+  bool ldexp(int const exp);
+
+  /*!
+   * \brief Save the sum, to go back to it with rollback
+   *
+   */
+  xsum_small_accumulator snapshot();
+
+  /*!
+   * \brief Set the sum back to one saved by snapshot
+   *
+   */
+  void rollback(xsum_small_accumulator const &snap);
+
   /*!
    * \brief Display a superaccumulator.
    *
@@ -445,6 +992,31 @@ class xsum_large {
   void add_dot(std::vector<xsum_flt> const &vec1,
                std::vector<xsum_flt> const &vec2);
 
+  /* ADD A VECTOR OF COMPLEX NUMBERS TO A PAIR OF LARGE ACCUMULATORS.  The real
+   * parts go to this accumulator and the imaginary parts to imag.
+   */
+  void add(xsum_large &imag, std::complex<xsum_flt> const *vec,
+           xsum_length const n);
+  void add(xsum_large &imag, std::vector<std::complex<xsum_flt>> const &vec);
+
+  /* ADD SQUARED NORM OF VECTOR OF COMPLEX NUMBERS TO LARGE ACCUMULATOR.
+   */
+  void add_sqnorm(std::complex<xsum_flt> const *vec, xsum_length const n);
+  void add_sqnorm(std::vector<std::complex<xsum_flt>> const &vec);
+
+  /* ADD DOT PRODUCT OF VECTORS OF COMPLEX NUMBERS TO A PAIR OF LARGE
+   * ACCUMULATORS, without (add_dot) or with (add_dotc) conjugating vec1.
+   */
+  void add_dot(xsum_large &imag, std::complex<xsum_flt> const *vec1,
+               std::complex<xsum_flt> const *vec2, xsum_length const n);
+  void add_dot(xsum_large &imag, std::vector<std::complex<xsum_flt>> const &vec1,
+               std::vector<std::complex<xsum_flt>> const &vec2);
+  void add_dotc(xsum_large &imag, std::complex<xsum_flt> const *vec1,
+                std::complex<xsum_flt> const *vec2, xsum_length const n);
+  void add_dotc(xsum_large &imag,
+                std::vector<std::complex<xsum_flt>> const &vec1,
+                std::vector<std::complex<xsum_flt>> const &vec2);
+
   /*
    * RETURN THE RESULT OF ROUNDING A SMALL ACCUMULATOR.  The rounding mode
    * is to nearest, with ties to even.  The small accumulator may be modified
@@ -456,6 +1028,41 @@ class xsum_large {
   xsum_small_accumulator round_to_small();
   xsum_small_accumulator round_to_small(xsum_large_accumulator *const lacc);
 
+  /*
+   * SIGN OF THE SUM, AND WHETHER IT IS ZERO, without rounding.  The sign is
+   * -1, 0, or 1 (0 for a NaN).
+   */
+  int sign();
+  bool is_zero();
+
+  /*!
+   * \brief Compare the sum with that of another large accumulator, without
+   * rounding
+   *
+   * \return -1, 0, or 1 as this sum is smaller than, equal to, or larger than
+   * the other one (0 if either is a NaN)
+   */
+  int compare(xsum_large &other);
+
+  /*
+   * NEGATE THE SUM, SUBTRACT THE SUM OF ANOTHER ACCUMULATOR, OR MULTIPLY IT BY
+   * 2^exp, exactly.  These work on the small accumulator, after adding the
+   * chunks in use to it.  ldexp returns false if the result is not exact.
+   */
+  void negate();
+  void sub(xsum_small_accumulator const *value);
+  void sub(xsum_large &value);
+  bool ldexp(int const exp);
+
+  /*
+   * SAVE THE SUM, OR SET IT BACK TO A SAVED SUM.  The snapshot is a small
+   * accumulator.  Taking one adds the chunks in use to the small accumulator
+   * and marks them unused, so that a rollback only clears the chunks used
+   * since, which costs in proportion to the adds in between.
+   */
+  xsum_small_accumulator snapshot();
+  void rollback(xsum_small_accumulator const &snap);
+
   xsum_small_accumulator *round_to_small_ptr();
   xsum_small_accumulator *round_to_small_ptr(
       xsum_large_accumulator *const lacc);
@@ -536,6 +1143,77 @@ class xsum_large {
   std::shared_ptr<xsum_large_accumulator> _lacc;
 };
 
+/*!
+ * \brief Superaccumulator with a buffer for values added one at a time
+ *
+ * Values added one at a time are stored in a buffer of N values, which is
+ * added with the vector add function of the accumulator when it is full, or
+ * before the accumulator is used in any other way.  This gives code that adds
+ * one value at a time the speed of the vector add function.
+ *
+ * \tparam accumulatorType one of \c xsum_small_accumulator,
+ *         \c xsum_large_accumulator, or \c xsum_window_accumulator
+ * \tparam N # of values in the buffer
+ */
+template <typename accumulatorType, int N = XSUM_BUFFER_SIZE>
+class xsum_buffered {
+ public:
+  /*!
+   * \brief Construct a new xsum buffered object
+   *
+   */
+  xsum_buffered();
+
+  /*!
+   * \brief Replaces the accumulator object, and empties the buffer
+   *
+   */
+  void reset();
+
+  /*!
+   * \brief Add a single value, to the buffer
+   *
+   * \param value
+   */
+  inline void add(xsum_flt const value);
+
+  /*
+   * ADD A VECTOR OF FLOATING-POINT NUMBERS, after the values in the buffer.
+   */
+  void add(xsum_flt const *vec, xsum_length const n);
+  void add(std::vector<xsum_flt> const &vec);
+
+  /* ADD A SMALL ACCUMULATOR. */
+  void add(xsum_small_accumulator const *const value);
+
+  /*!
+   * \brief Add the values in the buffer to the accumulator
+   *
+   */
+  void flush();
+
+  /*
+   * RETURN THE RESULT OF ROUNDING THE ACCUMULATOR, after flushing.  The
+   * rounding mode is to nearest, with ties to even.
+   */
+  xsum_flt round();
+
+  xsum_small_accumulator round_to_small();
+
+  /*!
+   * \brief Returns a pointer to the accumulator object, after flushing
+   *
+   * \return accumulatorType*
+   */
+  accumulatorType *get();
+
+ private:
+  /* # of values in the buffer */
+  int _n;
+  xsum_flt _buf[N];
+  std::shared_ptr<accumulatorType> _acc;
+};
+
 /* EXACT SUM FUNCTIONS */
 template <typename accumulatorType>
 static int xsum_carry_propagate(accumulatorType *const acc) {
@@ -543,6 +1221,10 @@ static int xsum_carry_propagate(accumulatorType *const acc) {
   std::abort();
 }
 
+template <>
+int xsum_carry_propagate<xsum_small_accumulator>(
+    xsum_small_accumulator *const sacc);
+
 template <typename accumulatorType>
 static inline void xsum_small_add_inf_nan(accumulatorType *const acc,
                                           xsum_int const ivalue) {
@@ -612,94 +1294,297 @@ static inline void xsum_add_value_inf_nan(accumulatorType *const acc,
   std::abort();
 }
 
+/* The functions on any other accumulator type, such as
+   xsum_small_budget_accumulator, are those on the accumulator it derives
+   from, its base_type. */
+
 template <typename accumulatorType>
-void xsum_init(accumulatorType *const acc);
+void xsum_init(accumulatorType *const acc) {
+  xsum_init<typename accumulatorType::base_type>(acc);
+}
 
 template <typename accumulatorType>
-void xsum_add(accumulatorType *const acc, xsum_flt const value);
+void xsum_add(accumulatorType *const acc, xsum_flt const value) {
+  xsum_add<typename accumulatorType::base_type>(acc, value);
+}
 
 template <typename accumulatorType>
 void xsum_add(accumulatorType *const acc, xsum_flt const *const vec,
-              xsum_length const n);
+              xsum_length const n) {
+  xsum_add<typename accumulatorType::base_type>(acc, vec, n);
+}
 
 template <typename accumulatorType>
-void xsum_add(accumulatorType *const acc, std::vector<xsum_flt> const &vec);
+void xsum_add(accumulatorType *const acc, std::vector<xsum_flt> const &vec) {
+  xsum_add<typename accumulatorType::base_type>(acc, vec);
+}
 
 template <typename accumulatorType>
 void xsum_add(accumulatorType *const acc,
-              xsum_small_accumulator const *const value);
+              xsum_small_accumulator const *const value) {
+  xsum_add<typename accumulatorType::base_type>(acc, value);
+}
 
 template <typename accumulatorType>
-void xsum_add(accumulatorType *const acc, accumulatorType *const value);
+void xsum_add(accumulatorType *const acc, accumulatorType *const value) {
+  xsum_add<typename accumulatorType::base_type>(acc, value);
+}
 
 template <typename accumulatorType>
 void xsum_add(accumulatorType *const acc, accumulatorType const *const vec,
-              xsum_length const n);
+              xsum_length const n) {
+  xsum_add<typename accumulatorType::base_type>(acc, vec, n);
+}
 
 template <typename accumulatorType>
 void xsum_add_sqnorm(accumulatorType *const acc, xsum_flt const *const vec,
-                     xsum_length const n);
+                     xsum_length const n) {
+  xsum_add_sqnorm<typename accumulatorType::base_type>(acc, vec, n);
+}
 
 template <typename accumulatorType>
 void xsum_add_sqnorm(accumulatorType *const acc,
-                     std::vector<xsum_flt> const &vec);
+                     std::vector<xsum_flt> const &vec) {
+  xsum_add_sqnorm<typename accumulatorType::base_type>(acc, vec);
+}
 
 template <typename accumulatorType>
 void xsum_add_dot(accumulatorType *const acc, xsum_flt const *const vec1,
-                  xsum_flt const *const vec2, xsum_length const n);
+                  xsum_flt const *const vec2, xsum_length const n) {
+  xsum_add_dot<typename accumulatorType::base_type>(acc, vec1, vec2, n);
+}
 
 template <typename accumulatorType>
 void xsum_add_dot(accumulatorType *const acc, std::vector<xsum_flt> const &vec1,
-                  std::vector<xsum_flt> const &vec2);
+                  std::vector<xsum_flt> const &vec2) {
+  xsum_add_dot<typename accumulatorType::base_type>(acc, vec1, vec2);
+}
 
 template <typename accumulatorType>
-xsum_flt xsum_round(accumulatorType *const acc);
+void xsum_add(accumulatorType *const acc_real, accumulatorType *const acc_imag,
+              std::complex<xsum_flt> const *const vec, xsum_length const n);
 
 template <typename accumulatorType>
-static xsum_small_accumulator *xsum_round_to_small_ptr(
-    accumulatorType *const acc);
+void xsum_add(accumulatorType *const acc_real, accumulatorType *const acc_imag,
+              std::vector<std::complex<xsum_flt>> const &vec);
 
 template <typename accumulatorType>
-xsum_small_accumulator xsum_round_to_small(accumulatorType *const acc);
+void xsum_add_sqnorm(accumulatorType *const acc,
+                     std::complex<xsum_flt> const *const vec,
+                     xsum_length const n);
 
-template <typename T>
-static void print_binary(T const d);
+template <typename accumulatorType>
+void xsum_add_sqnorm(accumulatorType *const acc,
+                     std::vector<std::complex<xsum_flt>> const &vec);
 
-// Implementation
+template <typename accumulatorType>
+void xsum_add_dot(accumulatorType *const acc_real,
+                  accumulatorType *const acc_imag,
+                  std::complex<xsum_flt> const *const vec1,
+                  std::complex<xsum_flt> const *const vec2,
+                  xsum_length const n);
 
-xsum_large_accumulator::xsum_large_accumulator() {
-  std::fill(count, count + XSUM_LCHUNKS, -1);
-}
+template <typename accumulatorType>
+void xsum_add_dot(accumulatorType *const acc_real,
+                  accumulatorType *const acc_imag,
+                  std::vector<std::complex<xsum_flt>> const &vec1,
+                  std::vector<std::complex<xsum_flt>> const &vec2);
 
-/* INITIALIZE A SMALL ACCUMULATOR TO ZERO. */
+template <typename accumulatorType>
+void xsum_add_dotc(accumulatorType *const acc_real,
+                   accumulatorType *const acc_imag,
+                   std::complex<xsum_flt> const *const vec1,
+                   std::complex<xsum_flt> const *const vec2,
+                   xsum_length const n);
 
-xsum_small::xsum_small() : _sacc(new xsum_small_accumulator) {}
+template <typename accumulatorType>
+void xsum_add_dotc(accumulatorType *const acc_real,
+                   accumulatorType *const acc_imag,
+                   std::vector<std::complex<xsum_flt>> const &vec1,
+                   std::vector<std::complex<xsum_flt>> const &vec2);
 
-xsum_small::xsum_small(xsum_small_accumulator const &sacc)
-    : _sacc(new xsum_small_accumulator) {
-  std::copy(sacc.chunk, sacc.chunk + XSUM_SCHUNKS, _sacc->chunk);
-  _sacc->Inf = sacc.Inf;
-  _sacc->NaN = sacc.NaN;
-  _sacc->adds_until_propagate = sacc.adds_until_propagate;
+template <typename accumulatorType>
+xsum_flt xsum_round(accumulatorType *const acc) {
+  return xsum_round<typename accumulatorType::base_type>(acc);
 }
 
-xsum_small::xsum_small(xsum_small_accumulator const *sacc)
-    : _sacc(new xsum_small_accumulator) {
-  if (sacc) {
-    std::copy(sacc->chunk, sacc->chunk + XSUM_SCHUNKS, _sacc->chunk);
-    _sacc->Inf = sacc->Inf;
-    _sacc->NaN = sacc->NaN;
-    _sacc->adds_until_propagate = sacc->adds_until_propagate;
-  }
+template <typename accumulatorType>
+static xsum_small_accumulator *xsum_round_to_small_ptr(
+    accumulatorType *const acc);
+
+template <typename accumulatorType>
+xsum_small_accumulator xsum_round_to_small(accumulatorType *const acc) {
+  return xsum_round_to_small<typename accumulatorType::base_type>(acc);
 }
 
-void xsum_small::reset() { _sacc.reset(new xsum_small_accumulator); }
+template <typename accumulatorType>
+int xsum_sign(accumulatorType *const acc) {
+  return xsum_sign<typename accumulatorType::base_type>(acc);
+}
+
+template <typename accumulatorType>
+bool xsum_is_zero(accumulatorType *const acc) {
+  return xsum_is_zero<typename accumulatorType::base_type>(acc);
+}
+
+template <typename accumulatorType>
+int xsum_compare(accumulatorType *const acc1, accumulatorType *const acc2) {
+  return xsum_compare<typename accumulatorType::base_type>(acc1, acc2);
+}
+
+template <typename accumulatorType>
+void xsum_negate(accumulatorType *const acc) {
+  xsum_negate<typename accumulatorType::base_type>(acc);
+}
+
+template <typename accumulatorType>
+void xsum_sub(accumulatorType *const acc,
+              xsum_small_accumulator const *const value) {
+  xsum_sub<typename accumulatorType::base_type>(acc, value);
+}
+
+template <typename accumulatorType>
+void xsum_sub(accumulatorType *const acc, accumulatorType *const value) {
+  xsum_sub<typename accumulatorType::base_type>(acc, value);
+}
+
+template <typename accumulatorType>
+bool xsum_ldexp(accumulatorType *const acc, int const exp) {
+  return xsum_ldexp<typename accumulatorType::base_type>(acc, exp);
+}
+
+template <typename accumulatorType>
+void xsum_snapshot(accumulatorType *const acc,
+                   xsum_small_accumulator *const snap) {
+  xsum_snapshot<typename accumulatorType::base_type>(acc, snap);
+}
+
+template <typename accumulatorType>
+void xsum_rollback(accumulatorType *const acc,
+                   xsum_small_accumulator const *const snap) {
+  xsum_rollback<typename accumulatorType::base_type>(acc, snap);
+}
+
+template <typename T>
+static void print_binary(T const d);
+
+/* The vector functions of the large accumulator are also the kernels of the
+   xsum_large class, so they are declared before its implementation, as is the
+   vector add of the small accumulator for the xsum_small class. */
+
+template <>
+void xsum_add<xsum_small_accumulator>(xsum_small_accumulator *const sacc,
+                                      xsum_flt const *const vec,
+                                      xsum_length const c);
+
+template <>
+void xsum_add<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
+                                      xsum_flt const *const vec,
+                                      xsum_length const n);
+
+template <>
+void xsum_add_sqnorm<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
+                                             xsum_flt const *const vec,
+                                             xsum_length const n);
+
+template <>
+void xsum_add_dot<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
+                                          xsum_flt const *const vec1,
+                                          xsum_flt const *const vec2,
+                                          xsum_length const n);
+
+// Implementation
+
+xsum_large_accumulator::xsum_large_accumulator() {
+  for (int ix = 0; ix < XSUM_LCHUNKS; ++ix) {
+    lcount(ix) = -1;
+  }
+}
+
+xsum_window_accumulator::xsum_window_accumulator() {
+  std::fill(count, count + XSUM_WCHUNKS, -1);
+}
+
+xsum_binned_accumulator::xsum_binned_accumulator(int const fold)
+    : fold(std::min(std::max(fold, 1), XSUM_BIN_MAX_FOLD)) {}
+
+#ifdef __SIZEOF_INT128__
+xsum_large128_accumulator::xsum_large128_accumulator() {
+  std::fill(count, count + XSUM_LCHUNKS, -1);
+}
+#endif
+
+#ifdef XSUM_LARGE_INTERLEAVED
+inline xsum_lchunk &xsum_large_accumulator::lchunk(
+    xsum_expint const ix) noexcept {
+  return entry[ix].chunk;
+}
+
+inline xsum_lchunk const &xsum_large_accumulator::lchunk(
+    xsum_expint const ix) const noexcept {
+  return entry[ix].chunk;
+}
+
+inline xsum_lcount &xsum_large_accumulator::lcount(
+    xsum_expint const ix) noexcept {
+  return entry[ix].count;
+}
+
+inline xsum_lcount const &xsum_large_accumulator::lcount(
+    xsum_expint const ix) const noexcept {
+  return entry[ix].count;
+}
+#else
+inline xsum_lchunk &xsum_large_accumulator::lchunk(
+    xsum_expint const ix) noexcept {
+  return chunk[ix];
+}
+
+inline xsum_lchunk const &xsum_large_accumulator::lchunk(
+    xsum_expint const ix) const noexcept {
+  return chunk[ix];
+}
+
+inline xsum_lcount &xsum_large_accumulator::lcount(
+    xsum_expint const ix) noexcept {
+  return count[ix];
+}
+
+inline xsum_lcount const &xsum_large_accumulator::lcount(
+    xsum_expint const ix) const noexcept {
+  return count[ix];
+}
+#endif
+
+/* INITIALIZE A SMALL ACCUMULATOR TO ZERO. */
+
+xsum_small::xsum_small() : _sacc(new xsum_small_accumulator) {}
+
+xsum_small::xsum_small(xsum_small_accumulator const &sacc)
+    : _sacc(new xsum_small_accumulator) {
+  std::copy(sacc.chunk, sacc.chunk + XSUM_SCHUNKS, _sacc->chunk);
+  _sacc->Inf = sacc.Inf;
+  _sacc->NaN = sacc.NaN;
+  _sacc->adds_until_propagate = sacc.adds_until_propagate;
+}
+
+xsum_small::xsum_small(xsum_small_accumulator const *sacc)
+    : _sacc(new xsum_small_accumulator) {
+  if (sacc) {
+    std::copy(sacc->chunk, sacc->chunk + XSUM_SCHUNKS, _sacc->chunk);
+    _sacc->Inf = sacc->Inf;
+    _sacc->NaN = sacc->NaN;
+    _sacc->adds_until_propagate = sacc->adds_until_propagate;
+  }
+}
+
+void xsum_small::reset() { _sacc.reset(new xsum_small_accumulator); }
 
 void xsum_small::init() {
   std::fill(_sacc->chunk, _sacc->chunk + XSUM_SCHUNKS, 0);
   _sacc->Inf = 0;
   _sacc->NaN = 0;
-  _sacc->adds_until_propagate = XSUM_SMALL_CARRY_TERMS;
+  _sacc->adds_until_propagate = xsum_carry_terms(_sacc.get());
 }
 
 void xsum_small::add(xsum_flt const value) {
@@ -745,60 +1630,11 @@ void xsum_small::add(xsum_small const &xvalue) {
 }
 
 void xsum_small::add(xsum_flt const *v, xsum_length const n) {
-  if (n == 0) {
-    return;
-  }
-
-  xsum_flt const *vec = v;
-  xsum_length c = n;
-  while (c > 1) {
-    if (_sacc->adds_until_propagate == 0) {
-      carry_propagate();
-    }
-
-    xsum_length const m =
-        c - ((1 <= _sacc->adds_until_propagate) ? c - 1
-                                                : _sacc->adds_until_propagate);
-
-    add_no_carry(vec, m + 1);
-
-    _sacc->adds_until_propagate -= m;
-
-    vec += m;
-    c -= m;
-  }
-
-  xsum_flt const f = *vec;
-  add(f);
+  xsum_add<xsum_small_accumulator>(_sacc.get(), v, n);
 }
 
 void xsum_small::add(std::vector<xsum_flt> const &v) {
-  xsum_length c = static_cast<xsum_length>(v.size());
-  if (c == 0) {
-    return;
-  }
-
-  xsum_flt const *vec = v.data();
-
-  while (c > 1) {
-    if (_sacc->adds_until_propagate == 0) {
-      carry_propagate();
-    }
-
-    xsum_length const m =
-        c - ((1 <= _sacc->adds_until_propagate) ? c - 1
-                                                : _sacc->adds_until_propagate);
-
-    add_no_carry(vec, m + 1);
-
-    _sacc->adds_until_propagate -= m;
-
-    vec += m;
-    c -= m;
-  }
-
-  xsum_flt const f = *vec;
-  add(f);
+  add(v.data(), static_cast<xsum_length>(v.size()));
 }
 
 void xsum_small::add_sqnorm(xsum_flt const *v, xsum_length const n) {
@@ -1414,7 +2250,7 @@ int xsum_small::carry_propagate() {
       std::cout << "number is zero (1)\n";
     }
 
-    _sacc->adds_until_propagate = XSUM_SMALL_CARRY_TERMS - 1;
+    _sacc->adds_until_propagate = xsum_carry_terms(_sacc.get()) - 1;
 
     /* Return index of uppermost non-zero chunk. */
     return 0;
@@ -1531,7 +2367,7 @@ int xsum_small::carry_propagate() {
       std::cout << "number is zero (2)\n";
     }
 
-    _sacc->adds_until_propagate = XSUM_SMALL_CARRY_TERMS - 1;
+    _sacc->adds_until_propagate = xsum_carry_terms(_sacc.get()) - 1;
 
     /* Return index of uppermost non-zero chunk. */
     return 0;
@@ -1558,7 +2394,7 @@ int xsum_small::carry_propagate() {
   /* We can now add one less than the total allowed terms before the
      next carry propagate. */
 
-  _sacc->adds_until_propagate = XSUM_SMALL_CARRY_TERMS - 1;
+  _sacc->adds_until_propagate = xsum_carry_terms(_sacc.get()) - 1;
 
   /* Return index of uppermost non-zero chunk. */
   return uix;
@@ -1707,8 +2543,14 @@ inline void xsum_small::add_no_carry(xsum_small_accumulator const *value) {
     return;
   }
 
+  /* Adding the chunks of value counts as one add, so they are added after
+     propagating the carries of a copy, which leaves them less than 2^32 in
+     magnitude. */
+  xsum_small_accumulator v = *value;
+  xsum_carry_propagate<xsum_small_accumulator>(&v);
+
   xsum_schunk *sc = _sacc->chunk;
-  xsum_schunk const *vc = value->chunk;
+  xsum_schunk const *vc = v.chunk;
   for (int i = 0; i < XSUM_SCHUNKS; ++i) {
     sc[i] += vc[i];
   }
@@ -1747,8 +2589,10 @@ xsum_large::xsum_large() : _lacc(new xsum_large_accumulator) {}
 
 xsum_large::xsum_large(xsum_large_accumulator const &lacc)
     : _lacc(new xsum_large_accumulator) {
-  std::copy(lacc.chunk, lacc.chunk + XSUM_LCHUNKS, _lacc->chunk);
-  std::copy(lacc.count, lacc.count + XSUM_LCHUNKS, _lacc->count);
+  for (int ix = 0; ix < XSUM_LCHUNKS; ++ix) {
+    _lacc->lchunk(ix) = lacc.lchunk(ix);
+    _lacc->lcount(ix) = lacc.lcount(ix);
+  }
   std::copy(lacc.chunks_used, lacc.chunks_used + XSUM_LCHUNKS / 64,
             _lacc->chunks_used);
   _lacc->used_used = lacc.used_used;
@@ -1761,8 +2605,10 @@ xsum_large::xsum_large(xsum_large_accumulator const &lacc)
 xsum_large::xsum_large(xsum_large_accumulator const *lacc)
     : _lacc(new xsum_large_accumulator) {
   if (lacc) {
-    std::copy(lacc->chunk, lacc->chunk + XSUM_LCHUNKS, _lacc->chunk);
-    std::copy(lacc->count, lacc->count + XSUM_LCHUNKS, _lacc->count);
+    for (int ix = 0; ix < XSUM_LCHUNKS; ++ix) {
+      _lacc->lchunk(ix) = lacc->lchunk(ix);
+      _lacc->lcount(ix) = lacc->lcount(ix);
+    }
     std::copy(lacc->chunks_used, lacc->chunks_used + XSUM_LCHUNKS / 64,
               _lacc->chunks_used);
     _lacc->used_used = lacc->used_used;
@@ -1797,13 +2643,15 @@ xsum_large::xsum_large(xsum_small const *sacc) : xsum_large(sacc->get()) {}
 void xsum_large::reset() { _lacc.reset(new xsum_large_accumulator); }
 
 void xsum_large::init() {
-  std::fill(_lacc->count, _lacc->count + XSUM_LCHUNKS, -1);
+  for (int ix = 0; ix < XSUM_LCHUNKS; ++ix) {
+    _lacc->lcount(ix) = -1;
+  }
   std::fill(_lacc->chunks_used, _lacc->chunks_used + XSUM_LCHUNKS / 64, 0);
   _lacc->used_used = 0;
   std::fill(_lacc->sacc.chunk, _lacc->sacc.chunk + XSUM_SCHUNKS, 0);
   _lacc->sacc.Inf = 0;
   _lacc->sacc.NaN = 0;
-  _lacc->sacc.adds_until_propagate = XSUM_SMALL_CARRY_TERMS;
+  _lacc->sacc.adds_until_propagate = xsum_carry_terms(&_lacc->sacc);
 }
 
 void xsum_large::add(xsum_flt const value) {
@@ -1821,7 +2669,7 @@ void xsum_large::add(xsum_flt const value) {
   xsum_expint const ix = u.uintv >> XSUM_MANTISSA_BITS;
 
   /* Find the count for this chunk, and subtract one. */
-  xsum_lcount const count = _lacc->count[ix] - 1;
+  xsum_lcount const count = _lacc->lcount(ix) - 1;
 
   if (count < 0) {
     /* If the decremented count is negative, it's either a special
@@ -1832,8 +2680,8 @@ void xsum_large::add(xsum_flt const value) {
   } else {
     /* Store the decremented count of additions allowed before transfer,
        and add this value to the chunk. */
-    _lacc->count[ix] = count;
-    _lacc->chunk[ix] += u.uintv;
+    _lacc->lcount(ix) = count;
+    _lacc->lchunk(ix) += u.uintv;
   }
 }
 
@@ -1862,1052 +2710,2513 @@ void xsum_large::add(xsum_large &value) {
 }
 
 void xsum_large::add(xsum_flt const *vec, xsum_length const n) {
-  if (n == 0) {
-    return;
-  }
-
   if (xsum_debug) {
     std::cout << "LARGE ADD OF " << n << " VALUES\n";
   }
+  xsum_add<xsum_large_accumulator>(_lacc.get(), vec, n);
+}
 
-  /* Version that's been manually optimized:  Loop unrolled, pre-fetch
-     attempted, branches eliminated, ... */
-  fpunion u1;
-  fpunion u2;
+void xsum_large::add(std::vector<xsum_flt> const &vec) {
+  add(vec.data(), static_cast<xsum_length>(vec.size()));
+}
 
-  int count1;
-  int count2;
+void xsum_large::add_sqnorm(xsum_flt const *vec, xsum_length const n) {
+  if (xsum_debug) {
+    std::cout << "LARGE ADD_SQNORM OF " << n << " VALUES\n";
+  }
+  xsum_add_sqnorm<xsum_large_accumulator>(_lacc.get(), vec, n);
+}
 
-  xsum_expint ix1;
-  xsum_expint ix2;
+void xsum_large::add_sqnorm(std::vector<xsum_flt> const &vec) {
+  add_sqnorm(vec.data(), static_cast<xsum_length>(vec.size()));
+}
 
-  xsum_flt const *v = vec;
+void xsum_large::add_dot(xsum_flt const *vec1, xsum_flt const *vec2,
+                         xsum_length const n) {
+  if (xsum_debug) {
+    std::cout << "LARGE ADD_DOT OF " << n << " VALUES\n";
+  }
+  xsum_add_dot<xsum_large_accumulator>(_lacc.get(), vec1, vec2, n);
+}
 
-  /* Unrolled loop processing two values each time around.  The loop is
-     done as two nested loops, arranged so that the inner one will have
-     no branches except for the one looping back.  This is achieved by
-     a trick for combining three tests for negativity into one.  The
-     last one or two values are not done here, so that the pre-fetching
-     will not go past the end of the array (which would probably be OK,
-     but is technically not allowed). */
+void xsum_large::add_dot(std::vector<xsum_flt> const &vec1,
+                         std::vector<xsum_flt> const &vec2) {
+  xsum_length const n = static_cast<xsum_length>(vec1.size());
+  if (n == 0 || n > static_cast<xsum_length>(vec2.size())) {
+    return;
+  }
+  add_dot(vec1.data(), vec2.data(), n);
+}
 
-  /* leave out last one or two, terminate when negative, for trick */
-  xsum_length m = n - 3;
-  while (m >= 0) {
-    /* Loop processing two values at a time until we're done, or until
-       one (or both) of the values result in a chunk needing to be processed.
-       Updates are done here for both of these chunks, even though it is not
-       yet known whether these updates ought to have been done.  We hope
-       this allows for better memory pre-fetch and instruction scheduling. */
-    do {
-      u1.fltv = *v++;
-      u2.fltv = *v++;
+xsum_flt xsum_large::round() {
+  if (xsum_debug) {
+    std::cout << "Rounding large accumulator\n";
+  }
 
-      ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
-      count1 = _lacc->count[ix1] - 1;
-      _lacc->count[ix1] = count1;
-      _lacc->chunk[ix1] += u1.uintv;
+  xsum_used *p = _lacc->chunks_used;
+  xsum_used *e = p + XSUM_LCHUNKS / 64;
 
-      ix2 = u2.uintv >> XSUM_MANTISSA_BITS;
-      count2 = _lacc->count[ix2] - 1;
-      _lacc->count[ix2] = count2;
-      _lacc->chunk[ix2] += u2.uintv;
+  /* Very quickly skip some unused low-order blocks of chunks
+     by looking at the used_used flags. */
 
-      m -= 2;
-    } while ((static_cast<xsum_length>(count1) |
-              static_cast<xsum_length>(count2) | m) >= 0);
-    /* ... equivalent to while (count1 >= 0 && count2 >= 0 && m >= 0) */
+  xsum_used uu = _lacc->used_used;
+  if ((uu & 0xffffffff) == 0) {
+    uu >>= 32;
+    p += 32;
+  }
 
-    /* See if we were actually supposed to update these chunks.  If not,
-           back out the changes and then process the chunks as they ought to
-           have been processed. */
+  if ((uu & 0xffff) == 0) {
+    uu >>= 16;
+    p += 16;
+  }
 
-    if (count1 < 0 || count2 < 0) {
-      _lacc->count[ix2] = count2 + 1;
-      _lacc->chunk[ix2] -= u2.uintv;
+  if ((uu & 0xff) == 0) {
+    p += 8;
+  }
 
-      if (count1 < 0) {
-        _lacc->count[ix1] = count1 + 1;
-        _lacc->chunk[ix1] -= u1.uintv;
+  /* Loop over remaining blocks of chunks. */
+  xsum_used u;
+  int ix;
+  do {
+    /* Loop to quickly find the next non-zero block of used flags, or finish
+       up if we've added all the used blocks to the small accumulator. */
 
-        add_value_inf_nan(ix1, u1.uintv);
+    for (;;) {
+      u = *p;
+      if (u != 0) {
+        break;
+      }
 
-        count2 = _lacc->count[ix2] - 1;
+      ++p;
+      if (p == e) {
+        return sround();
       }
 
-      if (count2 < 0) {
-        add_value_inf_nan(ix2, u2.uintv);
-      } else {
-        _lacc->count[ix2] = count2;
-        _lacc->chunk[ix2] += u2.uintv;
+      u = *p;
+      if (u != 0) {
+        break;
       }
-    }
-  }
 
-  /* Process the last one or two values, without pre-fetching. */
+      ++p;
+      if (p == e) {
+        return sround();
+      }
 
-  m += 3;
-  for (;;) {
-    u1.fltv = *v++;
-    ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
-    count1 = _lacc->count[ix1] - 1;
+      u = *p;
+      if (u != 0) {
+        break;
+      }
+
+      ++p;
+      if (p == e) {
+        return sround();
+      }
+
+      u = *p;
+      if (u != 0) {
+        break;
+      }
+
+      ++p;
+      if (p == e) {
+        return sround();
+      }
+    }
+
+    /* Find and process the chunks in this block that are used.  We skip
+       forward based on the chunks_used flags until we're within eight
+       bits of a chunk that is in use. */
+
+    ix = (p - _lacc->chunks_used) << 6;
+    if ((u & 0xffffffff) == 0) {
+      u >>= 32;
+      ix += 32;
+    }
+
+    if ((u & 0xffff) == 0) {
+      u >>= 16;
+      ix += 16;
+    }
+
+    if ((u & 0xff) == 0) {
+      u >>= 8;
+      ix += 8;
+    }
+
+    do {
+      if (_lacc->lcount(ix) >= 0) {
+        add_lchunk_to_small(ix);
+      }
+
+      ++ix;
+      u >>= 1;
+    } while (u != 0);
+
+    ++p;
+  } while (p != e);
+
+  /* Finish now that all blocks have been added to the small accumulator
+     by calling the small accumulator rounding function. */
+  return sround();
+}
+
+xsum_small_accumulator xsum_large::round_to_small() {
+  xsum_used const *p = _lacc->chunks_used;
+  xsum_used const *e = p + XSUM_LCHUNKS / 64;
+
+  /* Very quickly skip some unused low-order blocks of chunks
+     by looking at the used_used flags. */
+  xsum_used uu = _lacc->used_used;
+
+  if ((uu & 0xffffffff) == 0) {
+    uu >>= 32;
+    p += 32;
+  }
+  if ((uu & 0xffff) == 0) {
+    uu >>= 16;
+    p += 16;
+  }
+  if ((uu & 0xff) == 0) {
+    p += 8;
+  }
+
+  xsum_small_accumulator sacc;
+
+  /* Loop over remaining blocks of chunks. */
+  xsum_used u;
+  int ix;
+  do {
+    /* Loop to quickly find the next non-zero block of used flags, or finish
+       up if we've added all the used blocks to the small accumulator. */
+
+    for (;;) {
+      u = *p;
+      if (u != 0) {
+        break;
+      }
+
+      ++p;
+      if (p == e) {
+        std::copy(_lacc->sacc.chunk, _lacc->sacc.chunk + XSUM_SCHUNKS,
+                  sacc.chunk);
+        sacc.Inf = _lacc->sacc.Inf;
+        sacc.NaN = _lacc->sacc.NaN;
+        sacc.adds_until_propagate = _lacc->sacc.adds_until_propagate;
+        return sacc;
+      }
+
+      u = *p;
+      if (u != 0) {
+        break;
+      }
+
+      ++p;
+      if (p == e) {
+        std::copy(_lacc->sacc.chunk, _lacc->sacc.chunk + XSUM_SCHUNKS,
+                  sacc.chunk);
+        sacc.Inf = _lacc->sacc.Inf;
+        sacc.NaN = _lacc->sacc.NaN;
+        sacc.adds_until_propagate = _lacc->sacc.adds_until_propagate;
+        return sacc;
+      }
+
+      u = *p;
+      if (u != 0) {
+        break;
+      }
+
+      ++p;
+      if (p == e) {
+        std::copy(_lacc->sacc.chunk, _lacc->sacc.chunk + XSUM_SCHUNKS,
+                  sacc.chunk);
+        sacc.Inf = _lacc->sacc.Inf;
+        sacc.NaN = _lacc->sacc.NaN;
+        sacc.adds_until_propagate = _lacc->sacc.adds_until_propagate;
+        return sacc;
+      }
+
+      u = *p;
+      if (u != 0) {
+        break;
+      }
+
+      ++p;
+      if (p == e) {
+        std::copy(_lacc->sacc.chunk, _lacc->sacc.chunk + XSUM_SCHUNKS,
+                  sacc.chunk);
+        sacc.Inf = _lacc->sacc.Inf;
+        sacc.NaN = _lacc->sacc.NaN;
+        sacc.adds_until_propagate = _lacc->sacc.adds_until_propagate;
+        return sacc;
+      }
+    }
+
+    /* Find and process the chunks in this block that are used.  We skip
+       forward based on the chunks_used flags until we're within eight
+       bits of a chunk that is in use. */
+
+    ix = (p - _lacc->chunks_used) << 6;
+    if ((u & 0xffffffff) == 0) {
+      u >>= 32;
+      ix += 32;
+    }
+
+    if ((u & 0xffff) == 0) {
+      u >>= 16;
+      ix += 16;
+    }
+
+    if ((u & 0xff) == 0) {
+      u >>= 8;
+      ix += 8;
+    }
+
+    do {
+      if (_lacc->lcount(ix) >= 0) {
+        add_lchunk_to_small(ix);
+      }
+
+      ++ix;
+      u >>= 1;
+    } while (u != 0);
+
+    ++p;
+  } while (p != e);
+
+  /* Finish now that all blocks have been added to the small accumulator
+     by calling the small accumulator rounding function. */
+  std::copy(_lacc->sacc.chunk, _lacc->sacc.chunk + XSUM_SCHUNKS, sacc.chunk);
+  sacc.Inf = _lacc->sacc.Inf;
+  sacc.NaN = _lacc->sacc.NaN;
+  sacc.adds_until_propagate = _lacc->sacc.adds_until_propagate;
+  return sacc;
+}
+
+xsum_small_accumulator xsum_large::round_to_small(
+    xsum_large_accumulator *const lacc) {
+  xsum_used const *p = lacc->chunks_used;
+  xsum_used const *e = p + XSUM_LCHUNKS / 64;
+
+  /* Very quickly skip some unused low-order blocks of chunks
+     by looking at the used_used flags. */
+  xsum_used uu = lacc->used_used;
+
+  if ((uu & 0xffffffff) == 0) {
+    uu >>= 32;
+    p += 32;
+  }
+  if ((uu & 0xffff) == 0) {
+    uu >>= 16;
+    p += 16;
+  }
+  if ((uu & 0xff) == 0) {
+    p += 8;
+  }
+
+  xsum_small_accumulator sacc;
+
+  /* Loop over remaining blocks of chunks. */
+  xsum_used u;
+  int ix;
+  do {
+    /* Loop to quickly find the next non-zero block of used flags, or finish
+       up if we've added all the used blocks to the small accumulator. */
+
+    for (;;) {
+      u = *p;
+      if (u != 0) {
+        break;
+      }
+
+      ++p;
+      if (p == e) {
+        std::copy(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS,
+                  sacc.chunk);
+        sacc.Inf = lacc->sacc.Inf;
+        sacc.NaN = lacc->sacc.NaN;
+        sacc.adds_until_propagate = lacc->sacc.adds_until_propagate;
+        return sacc;
+      }
+
+      u = *p;
+      if (u != 0) {
+        break;
+      }
+
+      ++p;
+      if (p == e) {
+        std::copy(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS,
+                  sacc.chunk);
+        sacc.Inf = lacc->sacc.Inf;
+        sacc.NaN = lacc->sacc.NaN;
+        sacc.adds_until_propagate = lacc->sacc.adds_until_propagate;
+        return sacc;
+      }
+
+      u = *p;
+      if (u != 0) {
+        break;
+      }
+
+      ++p;
+      if (p == e) {
+        std::copy(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS,
+                  sacc.chunk);
+        sacc.Inf = lacc->sacc.Inf;
+        sacc.NaN = lacc->sacc.NaN;
+        sacc.adds_until_propagate = lacc->sacc.adds_until_propagate;
+        return sacc;
+      }
+
+      u = *p;
+      if (u != 0) {
+        break;
+      }
+
+      ++p;
+      if (p == e) {
+        std::copy(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS,
+                  sacc.chunk);
+        sacc.Inf = lacc->sacc.Inf;
+        sacc.NaN = lacc->sacc.NaN;
+        sacc.adds_until_propagate = lacc->sacc.adds_until_propagate;
+        return sacc;
+      }
+    }
+
+    /* Find and process the chunks in this block that are used.  We skip
+       forward based on the chunks_used flags until we're within eight
+       bits of a chunk that is in use. */
+
+    ix = (p - lacc->chunks_used) << 6;
+    if ((u & 0xffffffff) == 0) {
+      u >>= 32;
+      ix += 32;
+    }
+
+    if ((u & 0xffff) == 0) {
+      u >>= 16;
+      ix += 16;
+    }
+
+    if ((u & 0xff) == 0) {
+      u >>= 8;
+      ix += 8;
+    }
+
+    do {
+      if (lacc->lcount(ix) >= 0) {
+        add_lchunk_to_small(ix);
+      }
+
+      ++ix;
+      u >>= 1;
+    } while (u != 0);
+
+    ++p;
+  } while (p != e);
+
+  /* Finish now that all blocks have been added to the small accumulator
+     by calling the small accumulator rounding function. */
+  std::copy(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS, sacc.chunk);
+  sacc.Inf = lacc->sacc.Inf;
+  sacc.NaN = lacc->sacc.NaN;
+  sacc.adds_until_propagate = lacc->sacc.adds_until_propagate;
+  return sacc;
+}
+
+xsum_small_accumulator *xsum_large::round_to_small_ptr() {
+  xsum_used const *p = _lacc->chunks_used;
+  xsum_used const *e = p + XSUM_LCHUNKS / 64;
+
+  /* Very quickly skip some unused low-order blocks of chunks
+     by looking at the used_used flags. */
+  xsum_used uu = _lacc->used_used;
+
+  if ((uu & 0xffffffff) == 0) {
+    uu >>= 32;
+    p += 32;
+  }
+  if ((uu & 0xffff) == 0) {
+    uu >>= 16;
+    p += 16;
+  }
+  if ((uu & 0xff) == 0) {
+    p += 8;
+  }
+
+  /* Loop over remaining blocks of chunks. */
+  xsum_used u;
+  int ix;
+  do {
+    /* Loop to quickly find the next non-zero block of used flags, or finish
+       up if we've added all the used blocks to the small accumulator. */
+
+    for (;;) {
+      u = *p;
+      if (u != 0) {
+        break;
+      }
+
+      ++p;
+      if (p == e) {
+        return &_lacc->sacc;
+      }
+
+      u = *p;
+      if (u != 0) {
+        break;
+      }
+
+      ++p;
+      if (p == e) {
+        return &_lacc->sacc;
+      }
+
+      u = *p;
+      if (u != 0) {
+        break;
+      }
+
+      ++p;
+      if (p == e) {
+        return &_lacc->sacc;
+      }
+
+      u = *p;
+      if (u != 0) {
+        break;
+      }
+
+      ++p;
+      if (p == e) {
+        return &_lacc->sacc;
+      }
+    }
+
+    /* Find and process the chunks in this block that are used.  We skip
+       forward based on the chunks_used flags until we're within eight
+       bits of a chunk that is in use. */
+
+    ix = (p - _lacc->chunks_used) << 6;
+    if ((u & 0xffffffff) == 0) {
+      u >>= 32;
+      ix += 32;
+    }
+
+    if ((u & 0xffff) == 0) {
+      u >>= 16;
+      ix += 16;
+    }
+
+    if ((u & 0xff) == 0) {
+      u >>= 8;
+      ix += 8;
+    }
+
+    do {
+      if (_lacc->lcount(ix) >= 0) {
+        add_lchunk_to_small(ix);
+      }
+
+      ++ix;
+      u >>= 1;
+    } while (u != 0);
+
+    ++p;
+  } while (p != e);
+
+  /* Finish now that all blocks have been added to the small accumulator
+     by calling the small accumulator rounding function. */
+  return &_lacc->sacc;
+}
+
+xsum_small_accumulator *xsum_large::round_to_small_ptr(
+    xsum_large_accumulator *const lacc) {
+  xsum_used const *p = lacc->chunks_used;
+  xsum_used const *e = p + XSUM_LCHUNKS / 64;
+
+  /* Very quickly skip some unused low-order blocks of chunks
+     by looking at the used_used flags. */
+  xsum_used uu = lacc->used_used;
+
+  if ((uu & 0xffffffff) == 0) {
+    uu >>= 32;
+    p += 32;
+  }
+  if ((uu & 0xffff) == 0) {
+    uu >>= 16;
+    p += 16;
+  }
+  if ((uu & 0xff) == 0) {
+    p += 8;
+  }
+
+  /* Loop over remaining blocks of chunks. */
+  xsum_used u;
+  int ix;
+  do {
+    /* Loop to quickly find the next non-zero block of used flags, or finish
+       up if we've added all the used blocks to the small accumulator. */
+
+    for (;;) {
+      u = *p;
+      if (u != 0) {
+        break;
+      }
+
+      ++p;
+      if (p == e) {
+        return &lacc->sacc;
+      }
+
+      u = *p;
+      if (u != 0) {
+        break;
+      }
+
+      ++p;
+      if (p == e) {
+        return &lacc->sacc;
+      }
+
+      u = *p;
+      if (u != 0) {
+        break;
+      }
+
+      ++p;
+      if (p == e) {
+        return &lacc->sacc;
+      }
+
+      u = *p;
+      if (u != 0) {
+        break;
+      }
+
+      ++p;
+      if (p == e) {
+        return &lacc->sacc;
+      }
+    }
+
+    /* Find and process the chunks in this block that are used.  We skip
+       forward based on the chunks_used flags until we're within eight
+       bits of a chunk that is in use. */
+
+    ix = (p - lacc->chunks_used) << 6;
+    if ((u & 0xffffffff) == 0) {
+      u >>= 32;
+      ix += 32;
+    }
+
+    if ((u & 0xffff) == 0) {
+      u >>= 16;
+      ix += 16;
+    }
+
+    if ((u & 0xff) == 0) {
+      u >>= 8;
+      ix += 8;
+    }
+
+    do {
+      if (lacc->lcount(ix) >= 0) {
+        add_lchunk_to_small(ix);
+      }
+
+      ++ix;
+      u >>= 1;
+    } while (u != 0);
+
+    ++p;
+  } while (p != e);
+
+  /* Finish now that all blocks have been added to the small accumulator
+     by calling the small accumulator rounding function. */
+  return &lacc->sacc;
+}
+
+void xsum_large::display() {
+  std::cout << "Large accumulator:\n";
+
+  int dots = 0;
+  for (int i = XSUM_LCHUNKS - 1; i >= 0; --i) {
+    if (_lacc->lcount(i) < 0) {
+      if (!dots) {
+        std::cout << "            ...\n";
+      }
+      dots = 1;
+    } else {
+      std::cout << (i & 0x800 ? '-' : '+') << std::setw(4) << (i & 0x7ff) << " "
+                << std::setw(5) << _lacc->lcount(i) << " "
+                << std::bitset<XSUM_LCHUNK_BITS - 32>(
+                       static_cast<std::int64_t>(_lacc->lchunk(i)) >> 32)
+                << " "
+                << std::bitset<32>(static_cast<std::int64_t>(_lacc->lchunk(i)) &
+                                   0xffffffff)
+                << "\n";
+      dots = 0;
+    }
+  }
+
+  std::cout << "\nWithin the large accumulator:  ";
+
+  sdisplay();
+}
+
+void xsum_large::sdisplay() {
+  std::cout << "Small accumulator:" << (_lacc->sacc.Inf ? "  Inf" : "")
+            << (_lacc->sacc.NaN ? "  NaN" : "") << "\n";
+
+  for (int i = XSUM_SCHUNKS - 1, dots = 0; i >= 0; --i) {
+    if (_lacc->sacc.chunk[i] == 0) {
+      if (!dots) {
+        dots = 1;
+        std::cout << "            ...\n";
+      }
+    } else {
+      std::cout << std::setw(5) << i << " " << std::setw(5)
+                << static_cast<int>((i << XSUM_LOW_EXP_BITS) - XSUM_EXP_BIAS -
+                                    XSUM_MANTISSA_BITS)
+                << " "
+                << std::bitset<XSUM_SCHUNK_BITS - 32>(
+                       static_cast<std::int64_t>(_lacc->sacc.chunk[i] >> 32))
+                << " "
+                << std::bitset<32>(static_cast<std::int64_t>(
+                       _lacc->sacc.chunk[i] & 0xffffffff))
+                << "\n";
+      dots = 0;
+    }
+  }
+  std::cout << "\n";
+}
+
+int xsum_large::chunks_used() {
+  int c = 0;
+  for (int i = 0; i < XSUM_LCHUNKS; ++i) {
+    if (_lacc->lcount(i) >= 0) {
+      ++c;
+    }
+  }
+  return c;
+}
+
+int xsum_large::carry_propagate() {
+  if (xsum_debug) {
+    std::cout << "Carry propagating in small accumulator\n";
+  }
+
+  /* Set u to the index of the uppermost non-zero (for now) chunk, or
+     return with value 0 if there is none. */
+
+  bool found = false;
+
+  int u = XSUM_SCHUNKS - 1;
+  switch (XSUM_SCHUNKS & 0x3) {
+    case 3:
+      if (_lacc->sacc.chunk[u] != 0) {
+        found = true;
+        break;
+      }
+      --u;
+    case 2:
+      if (_lacc->sacc.chunk[u] != 0) {
+        found = true;
+        break;
+      }
+      --u;
+    case 1:
+      if (_lacc->sacc.chunk[u] != 0) {
+        found = true;
+        break;
+      }
+      --u;
+    case 0:;
+  }
+
+  if (!found) {
+    do {
+      if (_lacc->sacc.chunk[u - 3] | _lacc->sacc.chunk[u - 2] |
+          _lacc->sacc.chunk[u - 1] | _lacc->sacc.chunk[u]) {
+        found = true;
+        break;
+      }
+      u -= 4;
+    } while (u >= 0);
+  }
+
+  if (found) {
+    while (_lacc->sacc.chunk[u] == 0) {
+      --u;
+    }
+  } else {
+    if (xsum_debug) {
+      std::cout << "number is zero (1)\n";
+    }
+
+    _lacc->sacc.adds_until_propagate = xsum_carry_terms(&_lacc->sacc) - 1;
+
+    /* Return index of uppermost non-zero chunk. */
+    return 0;
+  }
+
+  if (xsum_debug) {
+    std::cout << "u: \n" << u;
+  }
+
+  /* Carry propagate, starting at the low-order chunks.  Note that the
+     loop limit of u may be increased inside the loop. */
+
+  /* indicates that a non-zero chunk has not been found yet */
+  int uix = -1;
+
+  /* Quickly skip over unused low-order chunks.  Done here at the start
+     on the theory that there are often many unused low-order chunks,
+     justifying some overhead to begin, but later stretches of unused
+     chunks may not be as large. */
+
+  int i = 0;
+  int const e = u - 3;
+  while (i <= e) {
+    if (_lacc->sacc.chunk[i] | _lacc->sacc.chunk[i + 1] |
+        _lacc->sacc.chunk[i + 2] | _lacc->sacc.chunk[i + 3]) {
+      break;
+    }
+    i += 4;
+  }
+
+  xsum_schunk c;
+
+  do {
+    bool nonzero = false;
+
+    /* Find the next non-zero chunk, or break out of loop if there is none. */
+    do {
+      c = _lacc->sacc.chunk[i];
+
+      if (c != 0) {
+        nonzero = true;
+        break;
+      }
+
+      ++i;
+
+      if (i > u) {
+        break;
+      }
+
+      c = _lacc->sacc.chunk[i];
+
+      if (c != 0) {
+        nonzero = true;
+        break;
+      }
+
+      ++i;
+    } while (i <= u);
+
+    if (!nonzero) {
+      break;
+    }
+
+    /* Propagate possible carry from this chunk to next chunk up. */
+    xsum_schunk const chigh = c >> XSUM_LOW_MANTISSA_BITS;
+    if (chigh == 0) {
+      uix = i;
+      ++i;
+      /* no need to change this chunk */
+      continue;
+    }
+
+    if (u == i) {
+      if (chigh == -1) {
+        uix = i;
+        /* don't propagate -1 into the region of all zeros above */
+        break;
+      }
+
+      /* we will change chunk[u+1], so we'll need to look at it */
+      u = i + 1;
+    }
+
+    xsum_schunk const clow = c & XSUM_LOW_MANTISSA_MASK;
+
+    if (clow != 0) {
+      uix = i;
+    }
+
+    /* We now change chunk[i] and add to chunk[i+1]. Note that i+1 should be
+       in range (no bigger than XSUM_CHUNKS-1) because the number of chunks
+       is big enough to hold any sum, and we do not store redundant chunks
+       with values 0 or -1 above previously non-zero chunks. */
+
+    if (xsum_debug) {
+      if (i + 1 >= XSUM_SCHUNKS) {
+        std::abort();
+      }
+    }
+
+    _lacc->sacc.chunk[i++] = clow;
+    _lacc->sacc.chunk[i] += chigh;
+  } while (i <= u);
+
+  if (xsum_debug) {
+    std::cout << "  uix: " << uix << "  new u: " << u << "\n";
+  }
+
+  /* Check again for the number being zero, since carry propagation might
+   have created zero from something that initially looked non-zero. */
+
+  if (uix < 0) {
+    if (xsum_debug) {
+      std::cout << "number is zero (2)\n";
+    }
+
+    _lacc->sacc.adds_until_propagate = xsum_carry_terms(&_lacc->sacc) - 1;
+
+    /* Return index of uppermost non-zero chunk. */
+    return 0;
+  }
+
+  /* While the uppermost chunk is negative, with value -1, combine it with
+     the chunk below (if there is one) to produce the same number but with
+     one fewer non-zero chunks. */
+
+  while (_lacc->sacc.chunk[uix] == -1 && uix > 0) {
+    _lacc->sacc.chunk[uix] = 0;
+    --uix;
+    // @yafshar solution
+    // _lacc->sacc.chunk[uix] +=
+    // static_cast<xsum_schunk>(static_cast<xsum_lchunk>(-1) <<
+    // XSUM_LOW_MANTISSA_BITS); Neal solution A shift of a negative number is
+    // undefined according to the standard, so do a multiply - it's all
+    // presumably constant-folded by the compiler.
+    _lacc->sacc.chunk[uix] +=
+        static_cast<xsum_schunk>(-1) *
+        (static_cast<xsum_schunk>(1) << XSUM_LOW_MANTISSA_BITS);
+  }
+
+  /* We can now add one less than the total allowed terms before the
+     next carry propagate. */
+
+  _lacc->sacc.adds_until_propagate = xsum_carry_terms(&_lacc->sacc) - 1;
+
+  /* Return index of uppermost non-zero chunk. */
+  return uix;
+}
+
+inline void xsum_large::add_no_carry(
+    xsum_small_accumulator const *const value) {
+  if (value->Inf != 0) {
+    if (_lacc->sacc.Inf == 0) {
+      _lacc->sacc.Inf = value->Inf;
+    } else if (_lacc->sacc.Inf != value->Inf) {
+      fpunion u;
+      u.intv = value->Inf;
+
+      /* result will be a NaN */
+      u.fltv = u.fltv - u.fltv;
+
+      _lacc->sacc.Inf = u.intv;
+    }
+    return;
+  }
+
+  if (value->NaN != 0) {
+    if ((_lacc->sacc.NaN & XSUM_MANTISSA_MASK) <
+        (value->NaN & XSUM_MANTISSA_MASK)) {
+      _lacc->sacc.NaN = value->NaN;
+    }
+    return;
+  }
+
+  /* Adding the chunks of value counts as one add, so they are added after
+     propagating the carries of a copy, which leaves them less than 2^32 in
+     magnitude. */
+  xsum_small_accumulator v = *value;
+  xsum_carry_propagate<xsum_small_accumulator>(&v);
+
+  xsum_schunk *sc = _lacc->sacc.chunk;
+  xsum_schunk const *vc = v.chunk;
+  for (int i = 0; i < XSUM_SCHUNKS; ++i) {
+    sc[i] += vc[i];
+  }
+}
+
+xsum_flt xsum_large::sround() {
+  if (xsum_debug) {
+    std::cout << "Rounding small accumulator\n";
+  }
+
+  /* See if we have a NaN from one of the numbers being a NaN, in which
+     case we return the NaN with largest payload. */
+
+  fpunion u;
+
+  if (_lacc->sacc.NaN != 0) {
+    u.intv = _lacc->sacc.NaN;
+    return u.fltv;
+  }
+
+  /* Otherwise, if any number was infinite, we return +Inf, -Inf, or a Nan
+     (if both +Inf and -Inf occurred).  Note that we do NOT return NaN if
+     we have both an infinite number and a sum of other numbers that
+     overflows with opposite sign, since there is no real ambiguity in
+     such a case. */
+
+  if (_lacc->sacc.Inf != 0) {
+    u.intv = _lacc->sacc.Inf;
+    return u.fltv;
+  }
+
+  /* If none of the numbers summed were infinite or NaN, we proceed to
+     propagate carries, as a preliminary to finding the magnitude of
+     the sum.  This also ensures that the sign of the result can be
+     determined from the uppermost non-zero chunk.
+     We also find the index, i, of this uppermost non-zero chunk, as
+     the value returned by xsum_carry_propagate, and set ivalue to
+     sacc->chunk[i].  Note that ivalue will not be 0 or -1, unless
+     i is 0 (the lowest chunk), in which case it will be handled by
+     the code for denormalized numbers. */
+
+  int i = carry_propagate();
+
+  if (xsum_debug) {
+    display();
+  }
+
+  xsum_int ivalue = _lacc->sacc.chunk[i];
+
+  /* Handle a possible denormalized number, including zero. */
+
+  if (i <= 1) {
+    /* Check for zero value, in which case we can return immediately. */
+
+    if (ivalue == 0) {
+      return 0.0;
+    }
+
+    /* Check if it is actually a denormalized number.  It always is if only
+       the lowest chunk is non-zero. If the highest non-zero chunk is
+       the next-to-lowest, we check the magnitude of the absolute value.
+       Note that the real exponent is 1 (not 0), so we need to shift right
+       by 1 here, which also means there will be no overflow from the left
+       shift below (but must view absolute value as unsigned). */
+
+    if (i == 0) {
+      u.intv = ivalue >= 0 ? ivalue : -ivalue;
+      u.intv >>= 1;
+      if (ivalue < 0) {
+        u.intv |= XSUM_SIGN_MASK;
+      }
+      return u.fltv;
+    } else {
+      /* Note: Left shift of -ve number is undefined, so do a multiply
+         instead, which is probably optimized to a shift. */
+
+      u.intv =
+          ivalue * (static_cast<xsum_int>(1) << (XSUM_LOW_MANTISSA_BITS - 1)) +
+          (_lacc->sacc.chunk[0] >> 1);
+
+      if (u.intv < 0) {
+        if (u.intv > -(static_cast<xsum_int>(1) << XSUM_MANTISSA_BITS)) {
+          u.intv = (-u.intv) | XSUM_SIGN_MASK;
+          return u.fltv;
+        }
+      } else {
+        if (u.uintv < static_cast<xsum_uint>(1) << XSUM_MANTISSA_BITS) {
+          return u.fltv;
+        }
+      }
+      /* otherwise, it's not actually denormalized, so fall through to below */
+    }
+  }
+
+  /* Find the location of the uppermost 1 bit in the absolute value of the
+   upper chunk by converting it (as a signed integer) to a floating point
+   value, and looking at the exponent.  Then set 'more' to the number of
+   bits from the lower chunk (and maybe the next lower) that are needed
+   to fill out the mantissa of the result, plus an extra bit to help decide
+   on rounding.  For negative numbers, it may turn out later that we need
+   another bit because negating a negative value may carry out of the top
+   here, but not once more bits are shifted into the bottom later on. */
+
+  u.fltv = static_cast<xsum_flt>(ivalue);
+
+  int e = (u.uintv >> XSUM_MANTISSA_BITS) & XSUM_EXP_MASK;
+  int more = 1 + XSUM_MANTISSA_BITS + XSUM_EXP_BIAS - e;
+
+  if (xsum_debug) {
+    std::cout << "e: " << e << ", more: " << more << ", ivalue: " << std::hex
+              << std::setfill('0') << std::setw(16)
+              << static_cast<long long>(ivalue) << "\n";
+  }
+
+  /* Change 'ivalue' to put in 'more' bits from lower chunks into the bottom.
+     Also set 'j' to the index of the lowest chunk from which these bits came,
+     and 'lower' to the remaining bits of that chunk not now in 'ivalue'.
+     We make sure that 'lower' initially has at least one bit in it, which
+     we can later move into 'ivalue' if it turns out that one more bit is
+     needed. */
+
+  /* multiply, since << of negative undefined */
+  ivalue *= static_cast<xsum_int>(1) << more;
+
+  if (xsum_debug) {
+    std::cout << "after ivalue <<= more, ivalue: " << std::hex
+              << std::setfill('0') << std::setw(16)
+              << static_cast<long long>(ivalue) << "\n";
+  }
+
+  int j = i - 1;
+
+  /* must exist, since denormalized if i==0 */
+  xsum_schunk lower = _lacc->sacc.chunk[j];
+
+  if (more >= XSUM_LOW_MANTISSA_BITS) {
+    more -= XSUM_LOW_MANTISSA_BITS;
+    ivalue += lower << more;
+    if (xsum_debug) {
+      std::cout << "after ivalue += lower << more, ivalue: " << std::hex
+                << std::setfill('0') << std::setw(16)
+                << static_cast<long long>(ivalue) << "\n";
+    }
+
+    --j;
+
+    lower = ((j < 0) ? 0 : _lacc->sacc.chunk[j]);
+  }
+
+  ivalue += lower >> (XSUM_LOW_MANTISSA_BITS - more);
+  lower &= (static_cast<xsum_schunk>(1) << (XSUM_LOW_MANTISSA_BITS - more)) - 1;
+
+  if (xsum_debug) {
+    std::cout << "j: " << j << ", new e: " << e
+              << ", new |ivalue|: " << std::hex << std::setfill('0')
+              << std::setw(16)
+              << static_cast<long long>(ivalue < 0 ? -ivalue : ivalue)
+              << ", lower: " << std::hex << std::setfill('0') << std::setw(16)
+              << static_cast<long long>(lower) << "\n";
+  }
+
+  /* Check for a negative 'ivalue' that when negated doesn't contain a full
+     mantissa's worth of bits, plus one to help rounding.  If so, move one
+     more bit into 'ivalue' from 'lower' (and remove it from 'lower').
+     Note that more than one additional bit will not be required because
+     xsum_carry_propagate ensures the uppermost non-zero chunk is not -1. */
+
+  if (ivalue < 0 && ((-ivalue) & (static_cast<xsum_int>(1)
+                                  << (XSUM_MANTISSA_BITS + 1))) == 0) {
+    int const pos = static_cast<xsum_schunk>(1)
+                    << (XSUM_LOW_MANTISSA_BITS - 1 - more);
+    /* note that left shift undefined if ivalue is negative */
+    ivalue *= 2;
+    if (lower & pos) {
+      ivalue |= 1;
+      lower &= ~pos;
+    }
+    --e;
+  }
+
+  if (xsum_debug) {
+    std::cout << "j: " << j << ", new e: " << e
+              << ", new |ivalue|: " << std::hex << std::setfill('0')
+              << std::setw(16)
+              << static_cast<long long>(ivalue < 0 ? -ivalue : ivalue)
+              << ", lower: " << std::hex << std::setfill('0') << std::setw(16)
+              << static_cast<long long>(lower) << "\n";
+  }
+
+  /* Set u.intv to have just the correct sign bit (rest zeros), and 'ivalue'
+     to now have the absolute value of the mantissa. */
+
+  if (ivalue >= 0) {
+    u.intv = 0;
+  } else {
+    ivalue = -ivalue;
+    u.intv = XSUM_SIGN_MASK;
+  }
+
+  if (xsum_debug) {
+    if ((ivalue >> (XSUM_MANTISSA_BITS + 1)) != 1) {
+      std::abort();
+    }
+  }
+
+  /* Round to nearest, with ties to even. At this point, 'ivalue' has the
+     absolute value of the number to be rounded, including an extra bit at
+     the bottom.  Bits below that are in 'lower' and in the chunks
+     indexed by 'j' and below.  Note that the bits in 'lower' and the chunks
+     below add to the magnitude of the remainder if the number is positive,
+     but subtract from this magnitude if the number is negative.
+     This code goes to done_rounding if it finds that just discarding lower
+     order bits is correct, and to round_away_from_zero if instead the
+     magnitude should be increased by one in the lowest bit. */
+
+  /* extra bit is 0 */
+  if ((ivalue & 1) == 0) {
+    if (xsum_debug) {
+      std::cout << "round toward zero, since remainder magnitude is < 1/2\n";
+    }
+
+    goto done_rounding;
+  }
+
+  /* number is positive */
+  if (u.intv == 0) {
+    /* low bit 1 (odd) */
+    if ((ivalue & 2) != 0) {
+      if (xsum_debug) {
+        std::cout
+            << "round away from zero, since magnitude >= 1/2, goes to even\n";
+      }
+
+      goto round_away_from_zero;
+    }
+
+    if (lower != 0) {
+      if (xsum_debug) {
+        std::cout
+            << "round away from zero, since magnitude > 1/2 (from 'lower')\n";
+      }
+
+      goto round_away_from_zero;
+    }
+  }
+  /* number is negative */
+  else {
+    /* low bit 0 (even) */
+    if ((ivalue & 2) == 0) {
+      if (xsum_debug) {
+        std::cout
+            << "round toward zero, since magnitude <= 1/2, goes to even\n";
+      }
+
+      goto done_rounding;
+    }
+
+    if (lower != 0) {
+      if (xsum_debug) {
+        std::cout
+            << "round toward zero, since magnitude < 1/2 (from 'lower')\n";
+      }
+
+      goto done_rounding;
+    }
+  }
+
+  /* If we get here, 'lower' is zero.  We need to look at chunks lower down
+     to see if any are non-zero. */
+
+  while (j > 0) {
+    --j;
+
+    if (_lacc->sacc.chunk[j] != 0) {
+      lower = 1;
+      break;
+    }
+  }
+
+  /* number is positive, low bit 0 (even) */
+  if (u.intv == 0) {
+    if (lower != 0) {
+      if (xsum_debug) {
+        std::cout
+            << "round away from zero, since magnitude > 1/2 (low chunks)\n";
+      }
+
+      goto round_away_from_zero;
+    } else {
+      if (xsum_debug) {
+        std::cout << "round toward zero, magnitude == 1/2 (low chunks)\n";
+      }
+
+      goto done_rounding;
+    }
+  } else /* number is negative, low bit 1 (odd) */
+  {
+    if (lower != 0) {
+      if (xsum_debug) {
+        std::cout << "round toward zero, since magnitude < 1/2 (low chunks)\n";
+      }
+
+      goto done_rounding;
+    } else {
+      if (xsum_debug) {
+        std::cout << "round away from zero, magnitude == 1/2 (low chunks)\n";
+      }
+
+      goto round_away_from_zero;
+    }
+  }
+
+round_away_from_zero:
+  /* Round away from zero, then check for carry having propagated out the
+     top, and shift if so. */
+  ivalue += 2;
+  if (ivalue & (static_cast<xsum_int>(1) << (XSUM_MANTISSA_BITS + 2))) {
+    ivalue >>= 1;
+    ++e;
+  }
+
+done_rounding:;
 
-    if (count1 < 0) {
-      add_value_inf_nan(ix1, u1.uintv);
-    } else {
-      _lacc->count[ix1] = count1;
-      _lacc->chunk[ix1] += u1.uintv;
-    }
+  /* Get rid of the bottom bit that was used to decide on rounding. */
 
-    --m;
-    if (m == 0) {
-      break;
+  ivalue >>= 1;
+
+  /* Adjust to the true exponent, accounting for where this chunk is. */
+
+  e += (i << XSUM_LOW_EXP_BITS) - XSUM_EXP_BIAS - XSUM_MANTISSA_BITS;
+
+  /* If exponent has overflowed, change to plus or minus Inf and return. */
+
+  if (e >= XSUM_EXP_MASK) {
+    u.intv |= static_cast<xsum_int>(XSUM_EXP_MASK) << XSUM_MANTISSA_BITS;
+    if (xsum_debug) {
+      std::cout << "Final rounded result: " << std::scientific
+                << std::setprecision(17) << u.fltv << " (overflowed)\n  ";
+      print_binary<double>(u.fltv);
     }
+    return u.fltv;
   }
-}
 
-void xsum_large::add(std::vector<xsum_flt> const &vec) {
-  xsum_length const n = static_cast<xsum_length>(vec.size());
-  if (n == 0) {
-    return;
-  }
+  /* Put exponent and mantissa into u.intv, which already has the sign,
+     then return u.fltv. */
+
+  u.intv += static_cast<xsum_int>(e) << XSUM_MANTISSA_BITS;
+  u.intv += ivalue & XSUM_MANTISSA_MASK; /* mask out the implicit 1 bit */
 
   if (xsum_debug) {
-    std::cout << "LARGE ADD OF " << n << " VALUES\n";
+    if ((ivalue >> XSUM_MANTISSA_BITS) != 1) {
+      std::abort();
+    }
+    std::cout << "Final rounded result: " << std::scientific
+              << std::setprecision(17) << u.fltv << "\n  ";
+    print_binary<double>(u.fltv);
   }
 
-  /* Version that's been manually optimized:  Loop unrolled, pre-fetch
-     attempted, branches eliminated, ... */
-  fpunion u1;
-  fpunion u2;
-
-  int count1;
-  int count2;
-
-  xsum_expint ix1;
-  xsum_expint ix2;
+  return u.fltv;
+}
 
-  xsum_flt const *v = vec.data();
+void xsum_large::add_lchunk_to_small(xsum_expint const ix) {
+  xsum_expint const count = _lacc->lcount(ix);
 
-  /* Unrolled loop processing two values each time around.  The loop is
-     done as two nested loops, arranged so that the inner one will have
-     no branches except for the one looping back.  This is achieved by
-     a trick for combining three tests for negativity into one.  The
-     last one or two values are not done here, so that the pre-fetching
-     will not go past the end of the array (which would probably be OK,
-     but is technically not allowed). */
+  /* Add to the small accumulator only if the count is not -1, which
+     indicates a chunk that contains nothing yet. */
+  if (count >= 0) {
+    /* Propagate carries in the small accumulator if necessary. */
 
-  /* leave out last one or two, terminate when negative, for trick */
-  xsum_length m = n - 3;
-  while (m >= 0) {
-    /* Loop processing two values at a time until we're done, or until
-       one (or both) of the values result in a chunk needing to be processed.
-       Updates are done here for both of these chunks, even though it is not
-       yet known whether these updates ought to have been done.  We hope
-       this allows for better memory pre-fetch and instruction scheduling. */
-    do {
-      u1.fltv = *v++;
-      u2.fltv = *v++;
+    if (_lacc->sacc.adds_until_propagate == 0) {
+      carry_propagate();
+    }
 
-      ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
-      count1 = _lacc->count[ix1] - 1;
-      _lacc->count[ix1] = count1;
-      _lacc->chunk[ix1] += u1.uintv;
+    /* Get the chunk we will add.  Note that this chunk is the integer sum
+       of entire 64-bit floating-point representations, with sign, exponent,
+       and mantissa, but we want only the sum of the mantissas. */
 
-      ix2 = u2.uintv >> XSUM_MANTISSA_BITS;
-      count2 = _lacc->count[ix2] - 1;
-      _lacc->count[ix2] = count2;
-      _lacc->chunk[ix2] += u2.uintv;
+    xsum_lchunk chunk = _lacc->lchunk(ix);
 
-      m -= 2;
-    } while ((static_cast<xsum_length>(count1) |
-              static_cast<xsum_length>(count2) | m) >= 0);
-    /* ... equivalent to while (count1 >= 0 && count2 >= 0 && m >= 0) */
+    if (xsum_debug) {
+      std::cout << "Adding chunk " << static_cast<int>(ix)
+                << " to small accumulator (count " << static_cast<int>(count)
+                << ", chunk " << std::hex << std::setfill('0') << std::setw(16)
+                << static_cast<long long>(chunk) << ")\n";
+    }
 
-    /* See if we were actually supposed to update these chunks.  If not,
-           back out the changes and then process the chunks as they ought to
-           have been processed. */
+    /* The chunk holds the sum of 2^count_bits - count values, whose
+       sign and exponent parts are all the same, equal to the index.  We
+       subtract that many copies of the index (shifted to the position of
+       the sign and exponent) to leave only the sum of the mantissas.  With
+       the default of 12 count bits, a full chunk has these bits overflow
+       out the top on their own, and the subtraction does the same modulo
+       2^64. */
+    chunk -= static_cast<xsum_lchunk>(
+                 ((xsum_lchunk{1} << _lacc->count_bits) - count) * ix)
+             << XSUM_MANTISSA_BITS;
 
-    if (count1 < 0 || count2 < 0) {
-      _lacc->count[ix2] = count2 + 1;
-      _lacc->chunk[ix2] -= u2.uintv;
+    /* Find the exponent for this chunk from the low bits of the index,
+       and split it into low and high parts, for accessing the small
+       accumulator.  Noting that for denormalized numbers where the
+       exponent part is zero, the actual exponent is 1 (before subtracting
+       the bias), not zero. */
 
-      if (count1 < 0) {
-        _lacc->count[ix1] = count1 + 1;
-        _lacc->chunk[ix1] -= u1.uintv;
+    xsum_expint const exp = ix & XSUM_EXP_MASK;
+    xsum_expint const low_exp = ((exp == 0) ? 1 : (exp & XSUM_LOW_EXP_MASK));
+    xsum_expint const high_exp = ((exp == 0) ? 0 : (exp >> XSUM_LOW_EXP_BITS));
 
-        add_value_inf_nan(ix1, u1.uintv);
+    /* Split the mantissa into three parts, for three consecutive chunks in
+       the small accumulator.  Except for denormalized numbers, add in the sum
+       of all the implicit 1 bits that are above the actual mantissa bits. */
 
-        count2 = _lacc->count[ix2] - 1;
-      }
+    xsum_uint const low_chunk = (chunk << low_exp) & XSUM_LOW_MANTISSA_MASK;
+    xsum_uint mid_chunk = chunk >> (XSUM_LOW_MANTISSA_BITS - low_exp);
 
-      if (count2 < 0) {
-        add_value_inf_nan(ix2, u2.uintv);
-      } else {
-        _lacc->count[ix2] = count2;
-        _lacc->chunk[ix2] += u2.uintv;
-      }
+    /* normalized */
+    if (exp != 0) {
+      mid_chunk += static_cast<xsum_lchunk>((1 << _lacc->count_bits) - count)
+                   << (XSUM_MANTISSA_BITS - XSUM_LOW_MANTISSA_BITS + low_exp);
     }
-  }
 
-  /* Process the last one or two values, without pre-fetching. */
+    xsum_uint const high_chunk = mid_chunk >> XSUM_LOW_MANTISSA_BITS;
+    mid_chunk &= XSUM_LOW_MANTISSA_MASK;
 
-  m += 3;
-  for (;;) {
-    u1.fltv = *v++;
-    ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
-    count1 = _lacc->count[ix1] - 1;
+    if (xsum_debug) {
+      std::cout << "chunk div: low " << std::bitset<64>(low_chunk) << "\n"
+                << "           mid " << std::bitset<64>(mid_chunk) << "\n"
+                << "           high " << std::bitset<64>(high_chunk) << "\n";
 
-    if (count1 < 0) {
-      add_value_inf_nan(ix1, u1.uintv);
-    } else {
-      _lacc->count[ix1] = count1;
-      _lacc->chunk[ix1] += u1.uintv;
+      /* Add or subtract the three parts of the mantissa from three small
+         accumulator chunks, according to the sign that is part of the index. */
+      std::cout << "Small chunks " << static_cast<int>(high_exp) << ", "
+                << static_cast<int>(high_exp) + 1 << ", "
+                << static_cast<int>(high_exp) + 2
+                << " before add or subtract:\n"
+                << std::bitset<64>(_lacc->sacc.chunk[high_exp]) << "\n"
+                << std::bitset<64>(_lacc->sacc.chunk[high_exp + 1]) << "\n"
+                << std::bitset<64>(_lacc->sacc.chunk[high_exp + 2]) << "\n";
     }
 
-    --m;
-    if (m == 0) {
-      break;
+    if (ix & (1 << XSUM_EXP_BITS)) {
+      _lacc->sacc.chunk[high_exp] -= low_chunk;
+      _lacc->sacc.chunk[high_exp + 1] -= mid_chunk;
+      _lacc->sacc.chunk[high_exp + 2] -= high_chunk;
+    } else {
+      _lacc->sacc.chunk[high_exp] += low_chunk;
+      _lacc->sacc.chunk[high_exp + 1] += mid_chunk;
+      _lacc->sacc.chunk[high_exp + 2] += high_chunk;
     }
-  }
-}
 
-void xsum_large::add_sqnorm(xsum_flt const *vec, xsum_length const n) {
-  if (n == 0) {
-    return;
-  }
+    if (xsum_debug) {
+      std::cout << "Small chunks " << static_cast<int>(high_exp) << ", "
+                << static_cast<int>(high_exp) + 1 << ", "
+                << static_cast<int>(high_exp) + 2 << " after add or subtract:\n"
+                << std::bitset<64>(_lacc->sacc.chunk[high_exp]) << "\n"
+                << std::bitset<64>(_lacc->sacc.chunk[high_exp + 1]) << "\n"
+                << std::bitset<64>(_lacc->sacc.chunk[high_exp + 2]) << "\n";
+    }
 
-  if (xsum_debug) {
-    std::cout << "LARGE ADD_SQNORM OF " << n << " VALUES\n";
+    /* The above additions/subtractions reduce by one the number we can
+       do before we need to do carry propagation again. */
+    _lacc->sacc.adds_until_propagate -= 1;
   }
 
-  fpunion u1;
-  fpunion u2;
-
-  int count1;
-  int count2;
-
-  xsum_expint ix1;
-  xsum_expint ix2;
+  /* We now clear the chunk to zero, and set the count to the number
+     of adds we can do before the mantissa would overflow.  We also
+     set the bit in chunks_used to indicate that this chunk is in use
+     (if that is enabled). */
 
-  xsum_flt const *v = vec;
+  _lacc->lchunk(ix) = 0;
+  _lacc->lcount(ix) = 1 << _lacc->count_bits;
+  _lacc->chunks_used[ix >> 6] |= static_cast<xsum_used>(1) << (ix & 0x3f);
+  _lacc->used_used |= static_cast<xsum_used>(1) << (ix >> 6);
+}
 
-  /* Unrolled loop processing two squares each time around.  The loop is
-     done as two nested loops, arranged so that the inner one will have
-     no branches except for the one looping back.  This is achieved by
-     a trick for combining three tests for negativity into one.  The
-     last one or two squares are not done here, so that the pre-fetching
-     will not go past the end of the array (which would probably be OK,
-     but is technically not allowed). */
+inline void xsum_large::add_value_inf_nan(xsum_expint const ix,
+                                          xsum_lchunk const uintv) {
+  if ((ix & XSUM_EXP_MASK) == XSUM_EXP_MASK) {
+    add_inf_nan(uintv);
+  } else {
+    add_lchunk_to_small(ix);
+    _lacc->lcount(ix) -= 1;
+    _lacc->lchunk(ix) += uintv;
+  }
+}
 
-  /* leave out last one or two, terminate when negative, for trick */
-  xsum_length m = n - 3;
+void xsum_large::add_inf_nan(xsum_int const ivalue) {
+  xsum_int const mantissa = ivalue & XSUM_MANTISSA_MASK;
 
-  while (m >= 0) {
-    /* Loop processing two squares at a time until we're done, or until
-       one (or both) of them result in a chunk needing to be processed.
-       Updates are done here for both of these chunks, even though it is not
-       yet known whether these updates ought to have been done.  We hope
-       this allows for better memory pre-fetch and instruction scheduling. */
-    do {
-      u1.fltv = *v * *v;
-      ++v;
-      u2.fltv = *v * *v;
-      ++v;
+  /* Inf */
+  if (mantissa == 0) {
+    if (_lacc->sacc.Inf == 0) {
+      /* no previous Inf */
+      _lacc->sacc.Inf = ivalue;
+    } else if (_lacc->sacc.Inf != ivalue) {
+      fpunion u;
 
-      ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
-      count1 = _lacc->count[ix1] - 1;
-      _lacc->count[ix1] = count1;
-      _lacc->chunk[ix1] += u1.uintv;
+      /* previous Inf was opposite sign */
+      u.intv = ivalue;
 
-      ix2 = u2.uintv >> XSUM_MANTISSA_BITS;
-      count2 = _lacc->count[ix2] - 1;
-      _lacc->count[ix2] = count2;
-      _lacc->chunk[ix2] += u2.uintv;
+      /* result will be a NaN */
+      u.fltv = u.fltv - u.fltv;
 
-      m -= 2;
-    } while ((static_cast<xsum_length>(count1) |
-              static_cast<xsum_length>(count2) | m) >= 0);
-    /* ... equivalent to while (count1 >= 0 && count2 >= 0 && m >= 0) */
+      _lacc->sacc.Inf = u.intv;
+    }
+  }
+  /* NaN */
+  else {
+    /* Choose the NaN with the bigger payload and clear its sign.  Using <=
+       ensures that we will choose the first NaN over the previous zero. */
+    if ((_lacc->sacc.NaN & XSUM_MANTISSA_MASK) <= mantissa) {
+      _lacc->sacc.NaN = ivalue & ~XSUM_SIGN_MASK;
+    }
+  }
+}
 
-    /* See if we were actually supposed to update these chunks.  If not,
-       back out the changes and then process the chunks as they ought to
-       have been processed. */
+inline xsum_large_accumulator *xsum_large::get() const noexcept {
+  return _lacc.get();
+}
 
-    if (count1 < 0 || count2 < 0) {
-      _lacc->count[ix2] = count2 + 1;
-      _lacc->chunk[ix2] -= u2.uintv;
+// AUXILLARY
 
-      if (count1 < 0) {
-        _lacc->count[ix1] = count1 + 1;
-        _lacc->chunk[ix1] -= u1.uintv;
+/*!
+ * \brief Hint the cache to fetch the line holding \p p for reading.
+ *
+ * \param p address to fetch, which must be inside the array being read
+ * \param stream if true the line is fetched as non-temporal (used once)
+ */
+static inline void xsum_prefetch(void const *const p, bool const stream) {
+#if defined(__GNUC__) || defined(__clang__)
+  if (stream) {
+    __builtin_prefetch(p, 0, 0);
+  } else {
+    __builtin_prefetch(p, 0, 3);
+  }
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  _mm_prefetch(static_cast<char const *>(p), stream ? _MM_HINT_NTA : _MM_HINT_T0);
+#else
+  (void)p;
+  (void)stream;
+#endif
+}
 
-        add_value_inf_nan(ix1, u1.uintv);
+template <>
+int xsum_carry_propagate<xsum_small_accumulator>(
+    xsum_small_accumulator *const sacc) {
+  /* Set u to the index of the uppermost non-zero (for now) chunk, or
+     return with value 0 if there is none. */
 
-        count2 = _lacc->count[ix2] - 1;
+  bool found = false;
+  int u = XSUM_SCHUNKS - 1;
+  switch (XSUM_SCHUNKS & 0x3) {
+    case 3: {
+      if (sacc->chunk[u] != 0) {
+        found = true;
+        break;
       }
-
-      if (count2 < 0) {
-        add_value_inf_nan(ix2, u2.uintv);
-      } else {
-        _lacc->count[ix2] = count2;
-        _lacc->chunk[ix2] += u2.uintv;
+      --u;
+    }
+    case 2: {
+      if (sacc->chunk[u] != 0) {
+        found = true;
+        break;
+      }
+      --u;
+    }
+    case 1: {
+      if (sacc->chunk[u] != 0) {
+        found = true;
+        break;
       }
+      --u;
     }
+    case 0:;
   }
+  do {
+    if (sacc->chunk[u - 3] | sacc->chunk[u - 2] | sacc->chunk[u - 1] |
+        sacc->chunk[u]) {
+      found = true;
+      break;
+    }
+    u -= 4;
+  } while (u >= 0);
 
-  /* Process the last one or two squares, without pre-fetching. */
+  if (found) {
+    while (sacc->chunk[u] == 0) {
+      --u;
+    }
+  } else {
+    sacc->adds_until_propagate = xsum_carry_terms(sacc) - 1;
+    /* Return index of uppermost non-zero chunk. */
+    return 0;
+  }
 
-  m += 3;
-  for (;;) {
-    u1.fltv = *v * *v;
-    ++v;
+  // xsum_schunk c, clow, chigh;
+  // int i, u, uix;
 
-    ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
+  /* Carry propagate, starting at the low-order chunks.  Note that the
+   loop limit of u may be increased inside the loop. */
 
-    count1 = _lacc->count[ix1] - 1;
-    if (count1 < 0) {
-      add_value_inf_nan(ix1, u1.uintv);
-    } else {
-      _lacc->count[ix1] = count1;
-      _lacc->chunk[ix1] += u1.uintv;
-    }
+  /* indicates that a non-zero chunk has not been found yet */
+  int uix = -1;
 
-    --m;
-    if (m == 0) {
+  /* Quickly skip over unused low-order chunks.  Done here at the start
+     on the theory that there are often many unused low-order chunks,
+     justifying some overhead to begin, but later stretches of unused
+     chunks may not be as large. */
+  int i = 0;
+  int const e = u - 3;
+  while (i <= e) {
+    if (sacc->chunk[i] | sacc->chunk[i + 1] | sacc->chunk[i + 2] |
+        sacc->chunk[i + 3]) {
       break;
     }
-  }
-}
-
-void xsum_large::add_sqnorm(std::vector<xsum_flt> const &vec) {
-  xsum_length const n = static_cast<xsum_length>(vec.size());
-  if (n == 0) {
-    return;
-  }
-
-  if (xsum_debug) {
-    std::cout << "LARGE ADD_SQNORM OF " << n << " VALUES\n";
+    i += 4;
   }
 
-  fpunion u1;
-  fpunion u2;
+  xsum_schunk c;
 
-  int count1;
-  int count2;
+  do {
+    /* Find the next non-zero chunk, or break out of loop if there is none. */
+    bool nonzero = false;
 
-  xsum_expint ix1;
-  xsum_expint ix2;
+    do {
+      c = sacc->chunk[i];
+      if (c != 0) {
+        nonzero = true;
+        break;
+      }
+      ++i;
 
-  xsum_flt const *v = vec.data();
+      if (i > u) {
+        break;
+      }
 
-  /* Unrolled loop processing two squares each time around.  The loop is
-     done as two nested loops, arranged so that the inner one will have
-     no branches except for the one looping back.  This is achieved by
-     a trick for combining three tests for negativity into one.  The
-     last one or two squares are not done here, so that the pre-fetching
-     will not go past the end of the array (which would probably be OK,
-     but is technically not allowed). */
+      c = sacc->chunk[i];
+      if (c != 0) {
+        nonzero = true;
+        break;
+      }
+      ++i;
+    } while (i <= u);
 
-  /* leave out last one or two, terminate when negative, for trick */
-  xsum_length m = n - 3;
+    if (!nonzero) {
+      break;
+    }
 
-  while (m >= 0) {
-    /* Loop processing two squares at a time until we're done, or until
-       one (or both) of them result in a chunk needing to be processed.
-       Updates are done here for both of these chunks, even though it is not
-       yet known whether these updates ought to have been done.  We hope
-       this allows for better memory pre-fetch and instruction scheduling. */
-    do {
-      u1.fltv = *v * *v;
-      ++v;
-      u2.fltv = *v * *v;
-      ++v;
+    /* Propagate possible carry from this chunk to next chunk up. */
+    xsum_schunk const chigh = c >> XSUM_LOW_MANTISSA_BITS;
 
-      ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
-      count1 = _lacc->count[ix1] - 1;
-      _lacc->count[ix1] = count1;
-      _lacc->chunk[ix1] += u1.uintv;
+    if (chigh == 0) {
+      uix = i;
+      ++i;
+      /* no need to change this chunk */
+      continue;
+    }
 
-      ix2 = u2.uintv >> XSUM_MANTISSA_BITS;
-      count2 = _lacc->count[ix2] - 1;
-      _lacc->count[ix2] = count2;
-      _lacc->chunk[ix2] += u2.uintv;
+    if (u == i) {
+      if (chigh == -1) {
+        uix = i;
+        /* don't propagate -1 into the region of all zeros above */
+        break;
+      }
 
-      m -= 2;
-    } while ((static_cast<xsum_length>(count1) |
-              static_cast<xsum_length>(count2) | m) >= 0);
-    /* ... equivalent to while (count1 >= 0 && count2 >= 0 && m >= 0) */
+      /* we will change chunk[u+1], so we'll need to look at it */
+      u = i + 1;
+    }
 
-    /* See if we were actually supposed to update these chunks.  If not,
-       back out the changes and then process the chunks as they ought to
-       have been processed. */
+    xsum_schunk const clow = c & XSUM_LOW_MANTISSA_MASK;
+    if (clow != 0) {
+      uix = i;
+    }
 
-    if (count1 < 0 || count2 < 0) {
-      _lacc->count[ix2] = count2 + 1;
-      _lacc->chunk[ix2] -= u2.uintv;
+    /* We now change chunk[i] and add to chunk[i+1]. Note that i+1 should be
+       in range (no bigger than XSUM_CHUNKS-1) because the number of chunks
+       is big enough to hold any sum, and we do not store redundant chunks
+       with values 0 or -1 above previously non-zero chunks. */
 
-      if (count1 < 0) {
-        _lacc->count[ix1] = count1 + 1;
-        _lacc->chunk[ix1] -= u1.uintv;
+    if (xsum_debug && i + 1 >= XSUM_SCHUNKS) {
+      std::abort();
+    }
+    sacc->chunk[i++] = clow;
+    sacc->chunk[i] += chigh;
+  } while (i <= u);
 
-        add_value_inf_nan(ix1, u1.uintv);
+  /* Check again for the number being zero, since carry propagation might
+     have created zero from something that initially looked non-zero. */
+  if (uix < 0) {
+    sacc->adds_until_propagate = xsum_carry_terms(sacc) - 1;
+    /* Return index of uppermost non-zero chunk. */
+    return 0;
+  }
 
-        count2 = _lacc->count[ix2] - 1;
-      }
+  /* While the uppermost chunk is negative, with value -1, combine it with
+     the chunk below (if there is one) to produce the same number but with
+     one fewer non-zero chunks. */
 
-      if (count2 < 0) {
-        add_value_inf_nan(ix2, u2.uintv);
-      } else {
-        _lacc->count[ix2] = count2;
-        _lacc->chunk[ix2] += u2.uintv;
-      }
-    }
+  while (sacc->chunk[uix] == -1 && uix > 0) {
+    /* A shift of a negative number is undefined according to the standard, so
+       do a multiply - it's all presumably constant-folded by the compiler. */
+    sacc->chunk[uix--] = 0;
+    sacc->chunk[uix] += static_cast<xsum_schunk>(-1) *
+                        (static_cast<xsum_schunk>(1) << XSUM_LOW_MANTISSA_BITS);
   }
 
-  /* Process the last one or two squares, without pre-fetching. */
+  /* We can now add one less than the total allowed terms before the
+   next carry propagate. */
+  sacc->adds_until_propagate = xsum_carry_terms(sacc) - 1;
 
-  m += 3;
-  for (;;) {
-    u1.fltv = *v * *v;
-    ++v;
+  /* Return index of uppermost non-zero chunk. */
+  return uix;
+}
 
-    ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
+/* ADD AN INF OR NAN TO THE Inf AND NaN FIELDS OF AN ACCUMULATOR.  Shared by
+   the small and the binned accumulators. */
 
-    count1 = _lacc->count[ix1] - 1;
-    if (count1 < 0) {
-      add_value_inf_nan(ix1, u1.uintv);
-    } else {
-      _lacc->count[ix1] = count1;
-      _lacc->chunk[ix1] += u1.uintv;
+static inline void xsum_add_inf_nan_fields(xsum_int *const Inf,
+                                           xsum_int *const NaN,
+                                           xsum_int const ivalue) {
+  xsum_int const mantissa = ivalue & XSUM_MANTISSA_MASK;
+
+  /* Inf */
+  if (mantissa == 0) {
+    /* no previous Inf */
+    if (*Inf == 0) {
+      *Inf = ivalue;
     }
+    /* previous Inf was opposite sign */
+    else if (*Inf != ivalue) {
+      fpunion u;
+      u.intv = ivalue;
 
-    --m;
-    if (m == 0) {
-      break;
+      /* result will be a NaN */
+      u.fltv = u.fltv - u.fltv;
+
+      *Inf = u.intv;
+    }
+  }
+  /* NaN */
+  else {
+    /* Choose the NaN with the bigger payload and clear its sign. Using <=
+       ensures that we will choose the first NaN over the previous zero. */
+    if ((*NaN & XSUM_MANTISSA_MASK) <= mantissa) {
+      *NaN = ivalue & ~XSUM_SIGN_MASK;
     }
   }
 }
 
-void xsum_large::add_dot(xsum_flt const *vec1, xsum_flt const *vec2,
-                         xsum_length const n) {
-  if (n == 0) {
-    return;
+template <>
+inline void xsum_small_add_inf_nan<xsum_small_accumulator>(
+    xsum_small_accumulator *const sacc, xsum_int const ivalue) {
+  xsum_add_inf_nan_fields(&sacc->Inf, &sacc->NaN, ivalue);
+}
+
+template <>
+inline void xsum_add_no_carry<xsum_small_accumulator>(
+    xsum_small_accumulator *const sacc, xsum_flt const value) {
+  /* Extract exponent and mantissa. */
+  fpunion u;
+  u.fltv = value;
+
+  xsum_int const ivalue = u.intv;
+  xsum_int mantissa = ivalue & XSUM_MANTISSA_MASK;
+  xsum_expint exp = (ivalue >> XSUM_MANTISSA_BITS) & XSUM_EXP_MASK;
+
+  /* Categorize number as normal, denormalized, or Inf/NaN according to
+     the value of the exponent field. */
+
+  /* normalized */
+  /* OR in implicit 1 bit at top of mantissa */
+  if (exp != 0 && exp != XSUM_EXP_MASK) {
+    mantissa |= static_cast<xsum_int>(1) << XSUM_MANTISSA_BITS;
+  }
+  /* zero or denormalized */
+  /* If it's a zero (positive or negative), we do nothing. */
+  else if (exp == 0) {
+    if (mantissa == 0) {
+      return;
+    }
+    /* Denormalized mantissa has no implicit 1, but exponent is 1 not 0. */
+    exp = 1;
   }
-
-  if (xsum_debug) {
-    std::cout << "LARGE ADD_DOT OF " << n << " VALUES\n";
+  /* Inf or NaN */
+  /* Just update flags in accumulator structure. */
+  else {
+    xsum_small_add_inf_nan<xsum_small_accumulator>(sacc, ivalue);
+    return;
   }
 
-  /* Version that's been manually optimized:  Loop unrolled, pre-fetch
-     attempted, branches eliminated, ... */
+  /* Separate high part of exponent, used as index of chunk, and low
+     part of exponent, giving position within chunk. */
 
-  fpunion u1;
-  fpunion u2;
+  xsum_expint const low_exp = exp & XSUM_LOW_EXP_MASK;
+  xsum_expint const high_exp = exp >> XSUM_LOW_EXP_BITS;
 
-  int count1;
-  int count2;
+  xsum_schunk *chunk_ptr = sacc->chunk + high_exp;
 
-  xsum_expint ix1;
-  xsum_expint ix2;
+  xsum_schunk const chunk0 = chunk_ptr[0];
+  xsum_schunk const chunk1 = chunk_ptr[1];
 
-  xsum_flt const *v1 = vec1;
-  xsum_flt const *v2 = vec2;
+  /* Separate mantissa into two parts, after shifting, and add to (or
+     subtract from) this chunk and the next higher chunk (which always
+     exists since there are three extra ones at the top). */
+  xsum_int const low_mantissa =
+      (static_cast<xsum_uint>(mantissa) << low_exp) & XSUM_LOW_MANTISSA_MASK;
+  xsum_int const high_mantissa = mantissa >> (XSUM_LOW_MANTISSA_BITS - low_exp);
 
-  /* Unrolled loop processing two products each time around.  The loop is
-     done as two nested loops, arranged so that the inner one will have
-     no branches except for the one looping back.  This is achieved by
-     a trick for combining three tests for negativity into one.  The
-     last one or two products are not done here, so that the pre-fetching
-     will not go past the end of the array (which would probably be OK,
-     but is technically not allowed). */
+  /* Add or subtract to or from the two affected chunks. */
+  if (ivalue < 0) {
+    chunk_ptr[0] = chunk0 - low_mantissa;
+    chunk_ptr[1] = chunk1 - high_mantissa;
+  } else {
+    chunk_ptr[0] = chunk0 + low_mantissa;
+    chunk_ptr[1] = chunk1 + high_mantissa;
+  }
+}
 
-  /* leave out last one or two, terminate when negative, for trick */
-  xsum_length m = n - 3;
+template <>
+inline void xsum_add_no_carry<xsum_small_accumulator>(
+    xsum_small_accumulator *const sacc,
+    xsum_small_accumulator const *const value) {
+  if (value->Inf != 0) {
+    /* no previous Inf */
+    if (sacc->Inf == 0) {
+      sacc->Inf = value->Inf;
+    }
+    /* previous Inf had opposite sign */
+    else if (sacc->Inf != value->Inf) {
+      fpunion u;
+      u.intv = value->Inf;
 
-  while (m >= 0) {
-    /* Loop processing two products at a time until we're done, or until
-       one (or both) of them result in a chunk needing to be processed.
-       Updates are done here for both of these chunks, even though it is not
-       yet known whether these updates ought to have been done.  We hope
-       this allows for better memory pre-fetch and instruction scheduling. */
-    do {
-      u1.fltv = *v1 * *v2;
-      ++v1;
-      ++v2;
+      /* result will be a NaN */
+      u.fltv = u.fltv - u.fltv;
 
-      u2.fltv = *v1 * *v2;
-      ++v1;
-      ++v2;
+      sacc->Inf = u.intv;
+    }
+    return;
+  }
+  if (value->NaN != 0 || sacc->NaN != 0) {
+    if (value->NaN != 0) {
+      if ((sacc->NaN & XSUM_MANTISSA_MASK) <
+          (value->NaN & XSUM_MANTISSA_MASK)) {
+        sacc->NaN = value->NaN;
+      }
+    }
+    return;
+  }
 
-      ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
-      count1 = _lacc->count[ix1] - 1;
-      _lacc->count[ix1] = count1;
-      _lacc->chunk[ix1] += u1.uintv;
+  /* Adding the chunks of value counts as one add, so they are added after
+     propagating the carries of a copy, which leaves them less than 2^32 in
+     magnitude. */
+  xsum_small_accumulator v = *value;
+  xsum_carry_propagate<xsum_small_accumulator>(&v);
 
-      ix2 = u2.uintv >> XSUM_MANTISSA_BITS;
-      count2 = _lacc->count[ix2] - 1;
-      _lacc->count[ix2] = count2;
-      _lacc->chunk[ix2] += u2.uintv;
+  xsum_schunk *sacc_chunk = sacc->chunk;
+  xsum_schunk const *const value_chunk = v.chunk;
+  for (int i = 0; i < XSUM_SCHUNKS; ++i) {
+    sacc_chunk[i] += value_chunk[i];
+  }
+}
 
-      m -= 2;
-    } while ((static_cast<xsum_length>(count1) |
-              static_cast<xsum_length>(count2) | m) >= 0);
-    /* ... equivalent to while (count1 >= 0 && count2 >= 0 && m >= 0) */
+/* ADD ONE VALUE TO THE CHUNKS OF A SMALL ACCUMULATOR, WITHOUT BRANCHES.  Used
+   by the vector functions.  A zero or denormalized number is taken to have
+   exponent one and no implicit 1 bit, so that a zero adds nothing.  An Inf or
+   NaN adds nothing either, but sets all bits of special, so that the caller
+   can look for them after its loop.  The chunks are xsum_schunk, or
+   xsum_schunk128 for the small accumulator with 128-bit chunks. */
 
-    /* See if we were actually supposed to update these chunks.  If not,
-       back out the changes and then process the chunks as they ought to
-       have been processed. */
+template <typename chunkType>
+static inline void xsum_small_add_branchless(chunkType *const chunk,
+                                             xsum_int const ivalue,
+                                             xsum_int &special) {
+  xsum_expint const exp = (ivalue >> XSUM_MANTISSA_BITS) & XSUM_EXP_MASK;
 
-    if (count1 < 0 || count2 < 0) {
-      _lacc->count[ix2] = count2 + 1;
-      _lacc->chunk[ix2] -= u2.uintv;
+  /* All ones for Inf or NaN */
+  xsum_int const inf_nan = -static_cast<xsum_int>(exp == XSUM_EXP_MASK);
+  special |= inf_nan;
 
-      if (count1 < 0) {
-        _lacc->count[ix1] = count1 + 1;
-        _lacc->chunk[ix1] -= u1.uintv;
+  xsum_int const mantissa =
+      ((ivalue & XSUM_MANTISSA_MASK) |
+       (static_cast<xsum_int>(exp != 0) << XSUM_MANTISSA_BITS)) &
+      ~inf_nan;
 
-        add_value_inf_nan(ix1, u1.uintv);
+  xsum_expint const e = exp + (exp == 0);
+  xsum_expint const low_exp = e & XSUM_LOW_EXP_MASK;
+  xsum_expint const high_exp = e >> XSUM_LOW_EXP_BITS;
 
-        count2 = _lacc->count[ix2] - 1;
-      }
+  xsum_int const low_mantissa =
+      (static_cast<xsum_uint>(mantissa) << low_exp) & XSUM_LOW_MANTISSA_MASK;
+  xsum_int const high_mantissa = mantissa >> (XSUM_LOW_MANTISSA_BITS - low_exp);
 
-      if (count2 < 0) {
-        add_value_inf_nan(ix2, u2.uintv);
-      } else {
-        _lacc->count[ix2] = count2;
-        _lacc->chunk[ix2] += u2.uintv;
-      }
-    }
-  }
+  /* All ones for a negative value, to negate both parts */
+  xsum_int const sign = ivalue >> (XSUM_SCHUNK_BITS - 1);
 
-  /* Process the last one or two products, without pre-fetching. */
+  chunk[high_exp] += (low_mantissa ^ sign) - sign;
+  chunk[high_exp + 1] += (high_mantissa ^ sign) - sign;
+}
 
-  m += 3;
-  for (;;) {
-    u1.fltv = *v1 * *v2;
-    ++v1;
-    ++v2;
+/* ADD AN INF OR NAN TO A SMALL ACCUMULATOR, and ignore any other value.  Used
+   by the vector functions after their loop, if it saw an Inf or NaN. */
 
-    ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
+static inline void xsum_small_add_if_inf_nan(xsum_small_accumulator *const sacc,
+                                             xsum_flt const value) {
+  fpunion u;
+  u.fltv = value;
+  if (((u.intv >> XSUM_MANTISSA_BITS) & XSUM_EXP_MASK) == XSUM_EXP_MASK) {
+    xsum_small_add_inf_nan<xsum_small_accumulator>(sacc, u.intv);
+  }
+}
 
-    count1 = _lacc->count[ix1] - 1;
-    if (count1 < 0) {
-      add_value_inf_nan(ix1, u1.uintv);
-    } else {
-      _lacc->count[ix1] = count1;
-      _lacc->chunk[ix1] += u1.uintv;
-    }
+/* ADD THE CHUNKS OF A SECOND STREAM TO A SMALL ACCUMULATOR. */
 
-    --m;
-    if (m == 0) {
-      break;
-    }
+static inline void xsum_small_add_chunks(xsum_small_accumulator *const sacc,
+                                         xsum_schunk const *const chunk) {
+  for (int i = 0; i < XSUM_SCHUNKS; ++i) {
+    sacc->chunk[i] += chunk[i];
   }
 }
 
-void xsum_large::add_dot(std::vector<xsum_flt> const &vec1,
-                         std::vector<xsum_flt> const &vec2) {
-  xsum_length const n = static_cast<xsum_length>(vec1.size());
-  if (n == 0 || n > static_cast<xsum_length>(vec2.size())) {
-    return;
-  }
+/* ADD A VECTOR OF FLOATING-POINT NUMBERS TO A SMALL ACCUMULATOR, WITHOUT
+   CARRIES.  As for the other no-carry vector functions, the last of the n
+   values is left for the caller.
 
-  if (xsum_debug) {
-    std::cout << "LARGE ADD_DOT OF " << n << " VALUES\n";
+   Version that's been manually optimized: the values are added without
+   branches, in a loop unrolled four times.  The values at even positions go
+   to the chunks of the accumulator, and those at odd positions to a local
+   array of chunks, added in at the end, so that two consecutive values with
+   similar exponents do not wait on each other's update of the same chunk.
+   Inf and NaN are looked for only if the loop saw one.  The # of values must
+   not be more than the adds_until_propagate of the accumulator, which then
+   also bounds the sums in the local array. */
+
+template <>
+inline void xsum_add_no_carry<xsum_small_accumulator>(
+    xsum_small_accumulator *const sacc, xsum_flt const *const vec,
+    xsum_length const n) {
+  xsum_length const m = n - 1;
+  if (m <= 0) {
+    return;
   }
 
-  /* Version that's been manually optimized:  Loop unrolled, pre-fetch
-     attempted, branches eliminated, ... */
+  xsum_schunk chunk2[XSUM_SCHUNKS] = {};
+  xsum_int special = 0;
 
   fpunion u1;
   fpunion u2;
+  fpunion u3;
+  fpunion u4;
 
-  int count1;
-  int count2;
-
-  xsum_expint ix1;
-  xsum_expint ix2;
-
-  xsum_flt const *v1 = vec1.data();
-  xsum_flt const *v2 = vec2.data();
-
-  /* Unrolled loop processing two products each time around.  The loop is
-     done as two nested loops, arranged so that the inner one will have
-     no branches except for the one looping back.  This is achieved by
-     a trick for combining three tests for negativity into one.  The
-     last one or two products are not done here, so that the pre-fetching
-     will not go past the end of the array (which would probably be OK,
-     but is technically not allowed). */
-
-  /* leave out last one or two, terminate when negative, for trick */
-  xsum_length m = n - 3;
-
-  while (m >= 0) {
-    /* Loop processing two products at a time until we're done, or until
-       one (or both) of them result in a chunk needing to be processed.
-       Updates are done here for both of these chunks, even though it is not
-       yet known whether these updates ought to have been done.  We hope
-       this allows for better memory pre-fetch and instruction scheduling. */
-    do {
-      u1.fltv = *v1 * *v2;
-      ++v1;
-      ++v2;
-
-      u2.fltv = *v1 * *v2;
-      ++v1;
-      ++v2;
-
-      ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
-      count1 = _lacc->count[ix1] - 1;
-      _lacc->count[ix1] = count1;
-      _lacc->chunk[ix1] += u1.uintv;
-
-      ix2 = u2.uintv >> XSUM_MANTISSA_BITS;
-      count2 = _lacc->count[ix2] - 1;
-      _lacc->count[ix2] = count2;
-      _lacc->chunk[ix2] += u2.uintv;
-
-      m -= 2;
-    } while ((static_cast<xsum_length>(count1) |
-              static_cast<xsum_length>(count2) | m) >= 0);
-    /* ... equivalent to while (count1 >= 0 && count2 >= 0 && m >= 0) */
+  xsum_flt const *v = vec;
+  xsum_flt const *const e = vec + m;
 
-    /* See if we were actually supposed to update these chunks.  If not,
-       back out the changes and then process the chunks as they ought to
-       have been processed. */
+  for (; v + 4 <= e; v += 4) {
+    u1.fltv = v[0];
+    u2.fltv = v[1];
+    u3.fltv = v[2];
+    u4.fltv = v[3];
+    xsum_small_add_branchless(sacc->chunk, u1.intv, special);
+    xsum_small_add_branchless(chunk2, u2.intv, special);
+    xsum_small_add_branchless(sacc->chunk, u3.intv, special);
+    xsum_small_add_branchless(chunk2, u4.intv, special);
+  }
+  for (; v < e; ++v) {
+    u1.fltv = *v;
+    xsum_small_add_branchless(sacc->chunk, u1.intv, special);
+  }
 
-    if (count1 < 0 || count2 < 0) {
-      _lacc->count[ix2] = count2 + 1;
-      _lacc->chunk[ix2] -= u2.uintv;
+  xsum_small_add_chunks(sacc, chunk2);
 
-      if (count1 < 0) {
-        _lacc->count[ix1] = count1 + 1;
-        _lacc->chunk[ix1] -= u1.uintv;
+  if (special) {
+    for (v = vec; v < e; ++v) {
+      xsum_small_add_if_inf_nan(sacc, *v);
+    }
+  }
+}
 
-        add_value_inf_nan(ix1, u1.uintv);
+template <>
+inline void xsum_add_no_carry<xsum_small_accumulator>(
+    xsum_small_accumulator *const sacc, xsum_small_accumulator const *const vec,
+    xsum_length const n) {
+  xsum_small_accumulator const *const f = vec;
+  for (xsum_length i = 0; i < n - 1; ++i) {
+    xsum_add_no_carry<xsum_small_accumulator>(sacc, &f[i]);
+  }
+}
 
-        count2 = _lacc->count[ix2] - 1;
-      }
+/* ADD SQUARED NORM OF A VECTOR TO A SMALL ACCUMULATOR, WITHOUT CARRIES.  As
+   for xsum_add_no_carry above.  The squares are not negative, and clearing
+   their sign bit (which could only be set for a NaN) lets the compiler drop
+   the negation. */
 
-      if (count2 < 0) {
-        add_value_inf_nan(ix2, u2.uintv);
-      } else {
-        _lacc->count[ix2] = count2;
-        _lacc->chunk[ix2] += u2.uintv;
-      }
-    }
+template <>
+inline void xsum_add_sqnorm_no_carry<xsum_small_accumulator>(
+    xsum_small_accumulator *const sacc, xsum_flt const *const vec,
+    xsum_length const n) {
+  xsum_length const m = n - 1;
+  if (m <= 0) {
+    return;
   }
 
-  /* Process the last one or two products, without pre-fetching. */
+  xsum_schunk chunk2[XSUM_SCHUNKS] = {};
+  xsum_int special = 0;
 
-  m += 3;
-  for (;;) {
-    u1.fltv = *v1 * *v2;
-    ++v1;
-    ++v2;
+  fpunion u1;
+  fpunion u2;
+  fpunion u3;
+  fpunion u4;
 
-    ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
+  xsum_flt const *v = vec;
+  xsum_flt const *const e = vec + m;
+
+  for (; v + 4 <= e; v += 4) {
+    u1.fltv = v[0] * v[0];
+    u2.fltv = v[1] * v[1];
+    u3.fltv = v[2] * v[2];
+    u4.fltv = v[3] * v[3];
+    xsum_small_add_branchless(sacc->chunk, u1.intv & ~XSUM_SIGN_MASK,
+                              special);
+    xsum_small_add_branchless(chunk2, u2.intv & ~XSUM_SIGN_MASK, special);
+    xsum_small_add_branchless(sacc->chunk, u3.intv & ~XSUM_SIGN_MASK,
+                              special);
+    xsum_small_add_branchless(chunk2, u4.intv & ~XSUM_SIGN_MASK, special);
+  }
+  for (; v < e; ++v) {
+    u1.fltv = *v * *v;
+    xsum_small_add_branchless(sacc->chunk, u1.intv & ~XSUM_SIGN_MASK,
+                              special);
+  }
 
-    count1 = _lacc->count[ix1] - 1;
-    if (count1 < 0) {
-      add_value_inf_nan(ix1, u1.uintv);
-    } else {
-      _lacc->count[ix1] = count1;
-      _lacc->chunk[ix1] += u1.uintv;
-    }
+  xsum_small_add_chunks(sacc, chunk2);
 
-    --m;
-    if (m == 0) {
-      break;
+  if (special) {
+    for (v = vec; v < e; ++v) {
+      xsum_small_add_if_inf_nan(sacc, *v * *v);
     }
   }
 }
 
-xsum_flt xsum_large::round() {
-  if (xsum_debug) {
-    std::cout << "Rounding large accumulator\n";
-  }
-
-  xsum_used *p = _lacc->chunks_used;
-  xsum_used *e = p + XSUM_LCHUNKS / 64;
-
-  /* Very quickly skip some unused low-order blocks of chunks
-     by looking at the used_used flags. */
+/* ADD DOT PRODUCT OF VECTORS TO A SMALL ACCUMULATOR, WITHOUT CARRIES.  As for
+   xsum_add_no_carry above. */
 
-  xsum_used uu = _lacc->used_used;
-  if ((uu & 0xffffffff) == 0) {
-    uu >>= 32;
-    p += 32;
+template <>
+inline void xsum_add_dot_no_carry<xsum_small_accumulator>(
+    xsum_small_accumulator *const sacc, xsum_flt const *const vec1,
+    xsum_flt const *const vec2, xsum_length const n) {
+  xsum_length const m = n - 1;
+  if (m <= 0) {
+    return;
   }
 
-  if ((uu & 0xffff) == 0) {
-    uu >>= 16;
-    p += 16;
-  }
+  xsum_schunk chunk2[XSUM_SCHUNKS] = {};
+  xsum_int special = 0;
 
-  if ((uu & 0xff) == 0) {
-    p += 8;
+  fpunion u1;
+  fpunion u2;
+  fpunion u3;
+  fpunion u4;
+
+  xsum_flt const *v1 = vec1;
+  xsum_flt const *v2 = vec2;
+  xsum_flt const *const e1 = vec1 + m;
+
+  for (; v1 + 4 <= e1; v1 += 4, v2 += 4) {
+    u1.fltv = v1[0] * v2[0];
+    u2.fltv = v1[1] * v2[1];
+    u3.fltv = v1[2] * v2[2];
+    u4.fltv = v1[3] * v2[3];
+    xsum_small_add_branchless(sacc->chunk, u1.intv, special);
+    xsum_small_add_branchless(chunk2, u2.intv, special);
+    xsum_small_add_branchless(sacc->chunk, u3.intv, special);
+    xsum_small_add_branchless(chunk2, u4.intv, special);
+  }
+  for (; v1 < e1; ++v1, ++v2) {
+    u1.fltv = *v1 * *v2;
+    xsum_small_add_branchless(sacc->chunk, u1.intv, special);
   }
 
-  /* Loop over remaining blocks of chunks. */
-  xsum_used u;
-  int ix;
-  do {
-    /* Loop to quickly find the next non-zero block of used flags, or finish
-       up if we've added all the used blocks to the small accumulator. */
+  xsum_small_add_chunks(sacc, chunk2);
 
-    for (;;) {
-      u = *p;
-      if (u != 0) {
-        break;
-      }
+  if (special) {
+    for (v1 = vec1, v2 = vec2; v1 < e1; ++v1, ++v2) {
+      xsum_small_add_if_inf_nan(sacc, *v1 * *v2);
+    }
+  }
+}
 
-      ++p;
-      if (p == e) {
-        return sround();
-      }
+template <>
+void xsum_init<xsum_small_accumulator>(xsum_small_accumulator *const sacc) {
+  std::fill(sacc->chunk, sacc->chunk + XSUM_SCHUNKS, 0);
+  sacc->Inf = 0;
+  sacc->NaN = 0;
+  sacc->adds_until_propagate = xsum_carry_terms(sacc);
+}
 
-      u = *p;
-      if (u != 0) {
-        break;
-      }
+template <>
+void xsum_init<xsum_large_accumulator>(xsum_large_accumulator *const lacc) {
+  for (int ix = 0; ix < XSUM_LCHUNKS; ++ix) {
+    lacc->lcount(ix) = -1;
+  }
+  std::fill(lacc->chunks_used, lacc->chunks_used + XSUM_LCHUNKS / 64, 0);
+  lacc->used_used = 0;
+  std::fill(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS, 0);
+  lacc->sacc.Inf = 0;
+  lacc->sacc.NaN = 0;
+  lacc->sacc.adds_until_propagate = xsum_carry_terms(&lacc->sacc);
+}
 
-      ++p;
-      if (p == e) {
-        return sround();
-      }
+template <>
+void xsum_add<xsum_small_accumulator>(xsum_small_accumulator *const sacc,
+                                      xsum_flt const value) {
+  if (sacc->adds_until_propagate == 0) {
+    xsum_carry_propagate<xsum_small_accumulator>(sacc);
+  }
 
-      u = *p;
-      if (u != 0) {
-        break;
-      }
+  xsum_add_no_carry<xsum_small_accumulator>(sacc, value);
 
-      ++p;
-      if (p == e) {
-        return sround();
-      }
+  --sacc->adds_until_propagate;
+}
 
-      u = *p;
-      if (u != 0) {
-        break;
-      }
+/* ADD A SUM OF FLOATING-POINT REPRESENTATIONS TO A SMALL ACCUMULATOR.  The
+   chunk is the integer sum of entire 64-bit floating-point representations,
+   with sign, exponent, and mantissa, all having the sign and exponent given by
+   the index ix, and count is the number of further values that could have been
+   summed, out of 2^count_bits, before the mantissas would overflow.  Only the
+   sum of the mantissas is added to the small accumulator.  Used by the large
+   and the windowed accumulators. */
+
+static inline void xsum_small_add_lchunk(xsum_small_accumulator *const sacc,
+                                         xsum_lchunk chunk,
+                                         xsum_expint const count,
+                                         xsum_expint const ix,
+                                         int const count_bits) {
+  /* Propagate carries in the small accumulator if necessary. */
+  if (sacc->adds_until_propagate == 0) {
+    xsum_carry_propagate<xsum_small_accumulator>(sacc);
+  }
 
-      ++p;
-      if (p == e) {
-        return sround();
-      }
-    }
+  /* The chunk holds the sum of 2^count_bits - count values, whose
+     sign and exponent parts are all the same, equal to the index.  We
+     subtract that many copies of the index (shifted to the position of
+     the sign and exponent) to leave only the sum of the mantissas.  With
+     the default of 12 count bits, a full chunk has these bits overflow
+     out the top on their own, and the subtraction does the same modulo
+     2^64. */
+  chunk -= static_cast<xsum_lchunk>(
+               ((xsum_lchunk{1} << count_bits) - count) * ix)
+           << XSUM_MANTISSA_BITS;
 
-    /* Find and process the chunks in this block that are used.  We skip
-       forward based on the chunks_used flags until we're within eight
-       bits of a chunk that is in use. */
+  /* Find the exponent for this chunk from the low bits of the index,
+     and split it into low and high parts, for accessing the small
+     accumulator.  Noting that for denormalized numbers where the
+     exponent part is zero, the actual exponent is 1 (before subtracting
+     the bias), not zero. */
 
-    ix = (p - _lacc->chunks_used) << 6;
-    if ((u & 0xffffffff) == 0) {
-      u >>= 32;
-      ix += 32;
-    }
+  xsum_expint low_exp;
+  xsum_expint high_exp;
 
-    if ((u & 0xffff) == 0) {
-      u >>= 16;
-      ix += 16;
-    }
+  xsum_expint const exp = ix & XSUM_EXP_MASK;
+  if (exp == 0) {
+    low_exp = 1;
+    high_exp = 0;
+  } else {
+    low_exp = exp & XSUM_LOW_EXP_MASK;
+    high_exp = exp >> XSUM_LOW_EXP_BITS;
+  }
 
-    if ((u & 0xff) == 0) {
-      u >>= 8;
-      ix += 8;
-    }
+  /* Split the mantissa into three parts, for three consecutive chunks in
+     the small accumulator.  Except for denormalized numbers, add in the sum
+     of all the implicit 1 bits that are above the actual mantissa bits. */
+  xsum_uint const low_chunk = (chunk << low_exp) & XSUM_LOW_MANTISSA_MASK;
+  xsum_uint mid_chunk = chunk >> (XSUM_LOW_MANTISSA_BITS - low_exp);
 
-    do {
-      if (_lacc->count[ix] >= 0) {
-        add_lchunk_to_small(ix);
-      }
+  /* normalized */
+  if (exp != 0) {
+    mid_chunk += static_cast<xsum_lchunk>((1 << count_bits) - count)
+                 << (XSUM_MANTISSA_BITS - XSUM_LOW_MANTISSA_BITS + low_exp);
+  }
 
-      ++ix;
-      u >>= 1;
-    } while (u != 0);
+  xsum_uint const high_chunk = mid_chunk >> XSUM_LOW_MANTISSA_BITS;
+  mid_chunk &= XSUM_LOW_MANTISSA_MASK;
 
-    ++p;
-  } while (p != e);
+  /* Add or subtract the three parts of the mantissa from three small
+     accumulator chunks, according to the sign that is part of the index. */
 
-  /* Finish now that all blocks have been added to the small accumulator
-     by calling the small accumulator rounding function. */
-  return sround();
-}
+  if (ix & (1 << XSUM_EXP_BITS)) {
+    sacc->chunk[high_exp] -= low_chunk;
+    sacc->chunk[high_exp + 1] -= mid_chunk;
+    sacc->chunk[high_exp + 2] -= high_chunk;
+  } else {
+    sacc->chunk[high_exp] += low_chunk;
+    sacc->chunk[high_exp + 1] += mid_chunk;
+    sacc->chunk[high_exp + 2] += high_chunk;
+  }
 
-xsum_small_accumulator xsum_large::round_to_small() {
-  xsum_used const *p = _lacc->chunks_used;
-  xsum_used const *e = p + XSUM_LCHUNKS / 64;
+  /* The above additions/subtractions reduce by one the number we can
+     do before we need to do carry propagation again. */
+  --sacc->adds_until_propagate;
+}
 
-  /* Very quickly skip some unused low-order blocks of chunks
-     by looking at the used_used flags. */
-  xsum_used uu = _lacc->used_used;
+template <>
+inline void xsum_add_lchunk_to_small<xsum_large_accumulator>(
+    xsum_large_accumulator *const lacc, xsum_expint const ix) {
+  xsum_expint const count = lacc->lcount(ix);
 
-  if ((uu & 0xffffffff) == 0) {
-    uu >>= 32;
-    p += 32;
-  }
-  if ((uu & 0xffff) == 0) {
-    uu >>= 16;
-    p += 16;
-  }
-  if ((uu & 0xff) == 0) {
-    p += 8;
+  /* Add to the small accumulator only if the count is not -1, which
+     indicates a chunk that contains nothing yet. */
+  if (count >= 0) {
+    xsum_small_add_lchunk(&lacc->sacc, lacc->lchunk(ix), count, ix,
+                          lacc->count_bits);
   }
 
-  xsum_small_accumulator sacc;
-
-  /* Loop over remaining blocks of chunks. */
-  xsum_used u;
-  int ix;
-  do {
-    /* Loop to quickly find the next non-zero block of used flags, or finish
-       up if we've added all the used blocks to the small accumulator. */
+  /* We now clear the chunk to zero, and set the count to the number
+     of adds we can do before the mantissa would overflow.  We also
+     set the bit in chunks_used to indicate that this chunk is in use
+     (if that is enabled). */
 
-    for (;;) {
-      u = *p;
-      if (u != 0) {
-        break;
-      }
+  lacc->lchunk(ix) = 0;
+  lacc->lcount(ix) = 1 << lacc->count_bits;
+  lacc->chunks_used[ix >> 6] |= static_cast<xsum_used>(1) << (ix & 0x3f);
+  lacc->used_used |= static_cast<xsum_used>(1) << (ix >> 6);
+}
 
-      ++p;
-      if (p == e) {
-        std::copy(_lacc->sacc.chunk, _lacc->sacc.chunk + XSUM_SCHUNKS,
-                  sacc.chunk);
-        sacc.Inf = _lacc->sacc.Inf;
-        sacc.NaN = _lacc->sacc.NaN;
-        sacc.adds_until_propagate = _lacc->sacc.adds_until_propagate;
-        return sacc;
-      }
+template <>
+inline void xsum_add_value_inf_nan<xsum_large_accumulator>(
+    xsum_large_accumulator *const lacc, xsum_expint const ix,
+    xsum_lchunk const uintv) {
+  if ((ix & XSUM_EXP_MASK) == XSUM_EXP_MASK) {
+    xsum_small_add_inf_nan<xsum_small_accumulator>(&lacc->sacc, uintv);
+  } else {
+    xsum_add_lchunk_to_small(lacc, ix);
+    --lacc->lcount(ix);
+    lacc->lchunk(ix) += uintv;
+  }
+}
 
-      u = *p;
-      if (u != 0) {
-        break;
-      }
+template <>
+void xsum_add<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
+                                      xsum_flt const value) {
+  fpunion u;
+  u.fltv = value;
+  xsum_expint const ix = u.uintv >> XSUM_MANTISSA_BITS;
+  int const count = lacc->lcount(ix) - 1;
+  if (count < 0) {
+    xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix, u.uintv);
+  } else {
+    lacc->lcount(ix) = count;
+    lacc->lchunk(ix) += u.uintv;
+  }
+}
 
-      ++p;
-      if (p == e) {
-        std::copy(_lacc->sacc.chunk, _lacc->sacc.chunk + XSUM_SCHUNKS,
-                  sacc.chunk);
-        sacc.Inf = _lacc->sacc.Inf;
-        sacc.NaN = _lacc->sacc.NaN;
-        sacc.adds_until_propagate = _lacc->sacc.adds_until_propagate;
-        return sacc;
-      }
+/* WHETHER A VALUE IS AN INTEGER OF MAGNITUDE BELOW 2^51.  Not an Inf or NaN.
+ */
 
-      u = *p;
-      if (u != 0) {
-        break;
-      }
+static inline bool xsum_is_integer(xsum_flt const x) {
+  return std::fabs(x) < XSUM_INTEGER_MAX &&
+         (x + XSUM_INTEGER_SHIFT) - XSUM_INTEGER_SHIFT == x;
+}
 
-      ++p;
-      if (p == e) {
-        std::copy(_lacc->sacc.chunk, _lacc->sacc.chunk + XSUM_SCHUNKS,
-                  sacc.chunk);
-        sacc.Inf = _lacc->sacc.Inf;
-        sacc.NaN = _lacc->sacc.NaN;
-        sacc.adds_until_propagate = _lacc->sacc.adds_until_propagate;
-        return sacc;
-      }
+/* SUM OF THE INTEGERS AT THE START OF A BLOCK.  The n values are summed in
+   groups of XSUM_INTEGER_GROUP, each checked for being all integers of
+   magnitude below 2^51 before the next is summed.  Returns the # of values
+   before the first group that is not, whose exact sum is put in sum.  The 2^51
+   limit comes from the shift: adding XSUM_INTEGER_SHIFT to such an integer x
+   is exact, and the bits of the result, less those of the shift, are x as a
+   64-bit integer.  A value that is not an integer is rounded by the addition,
+   which the subtraction shows.  Larger integers, up to 2^53, are summed
+   exactly by the usual path.  Unlike a conversion to a 64-bit integer, this
+   vectorizes without AVX-512.  With n at most 1024, the sum is less than 2^61
+   in magnitude. */
+
+static inline xsum_length xsum_integer_sum(xsum_flt const *const vec,
+                                           xsum_length const n,
+                                           std::int64_t *const sum) {
+  fpunion shift;
+  shift.fltv = XSUM_INTEGER_SHIFT;
+  std::int64_t s = 0;
+  xsum_length i = 0;
+  while (i < n) {
+    xsum_length const e = std::min(i + XSUM_INTEGER_GROUP, n);
+    std::int64_t bad = 0;
+    std::int64_t g = 0;
+    for (xsum_length j = i; j < e; ++j) {
+      xsum_flt const x = vec[j];
+      fpunion t;
+      t.fltv = x + XSUM_INTEGER_SHIFT;
+      bad |= !(std::fabs(x) < XSUM_INTEGER_MAX) |
+             (t.fltv - XSUM_INTEGER_SHIFT != x);
+      g += t.intv - shift.intv;
+    }
+    if (bad != 0) {
+      break;
+    }
+    s += g;
+    i = e;
+  }
+  *sum = s;
+  return i;
+}
 
-      u = *p;
-      if (u != 0) {
-        break;
-      }
+/* ADD VALUES, SUMMING RUNS OF INTEGERS AS INTEGERS.  Each block of values that
+   starts with an integer of magnitude below 2^51 is summed as integers up to
+   the first group that has another value, and the rest of the block is added
+   with the values that follow.  The values between runs of integers are
+   added with add, in as few calls as possible.  The sum of a run is added as
+   two doubles, its high 32 bits scaled by 2^32 and its low 32 bits, which are
+   both exact. */
 
-      ++p;
-      if (p == e) {
-        std::copy(_lacc->sacc.chunk, _lacc->sacc.chunk + XSUM_SCHUNKS,
-                  sacc.chunk);
-        sacc.Inf = _lacc->sacc.Inf;
-        sacc.NaN = _lacc->sacc.NaN;
-        sacc.adds_until_propagate = _lacc->sacc.adds_until_propagate;
-        return sacc;
-      }
+template <typename accumulatorType>
+static void xsum_add_integer_blocks(
+    accumulatorType *const acc, xsum_flt const *const vec, xsum_length const n,
+    void (*add)(accumulatorType *const, xsum_flt const *const,
+                xsum_length const)) {
+  xsum_length b = 0;
+  for (xsum_length i = 0; i < n; i += XSUM_INTEGER_BLOCK_SIZE) {
+    xsum_length const m = std::min(XSUM_INTEGER_BLOCK_SIZE, n - i);
+    if (!xsum_is_integer(vec[i])) {
+      continue;
+    }
+    std::int64_t s;
+    xsum_length const k = xsum_integer_sum(vec + i, m, &s);
+    if (k == 0) {
+      continue;
+    }
+    add(acc, vec + b, i - b);
+    b = i + k;
+    if (s != 0) {
+      xsum_add<accumulatorType>(
+          acc, static_cast<xsum_flt>(s >> 32) * 4294967296.0);
+      xsum_add<accumulatorType>(acc,
+                                static_cast<xsum_flt>(s & 0xffffffff));
     }
+  }
+  add(acc, vec + b, n - b);
+}
 
-    /* Find and process the chunks in this block that are used.  We skip
-       forward based on the chunks_used flags until we're within eight
-       bits of a chunk that is in use. */
+/* ADD A VECTOR OF VALUES TO A SMALL ACCUMULATOR.  Without the integer fast
+   path. */
 
-    ix = (p - _lacc->chunks_used) << 6;
-    if ((u & 0xffffffff) == 0) {
-      u >>= 32;
-      ix += 32;
+static void xsum_small_add_vector(xsum_small_accumulator *const sacc,
+                                  xsum_flt const *const vec,
+                                  xsum_length const c) {
+  if (c == 0) {
+    return;
+  }
+  xsum_flt const *v = vec;
+  xsum_length n = c;
+  while (n > 1) {
+    if (sacc->adds_until_propagate == 0) {
+      xsum_carry_propagate<xsum_small_accumulator>(sacc);
     }
+    xsum_length const m = (n - 1 <= sacc->adds_until_propagate)
+                              ? n - 1
+                              : sacc->adds_until_propagate;
+    xsum_add_no_carry<xsum_small_accumulator>(sacc, v, m + 1);
+    sacc->adds_until_propagate -= m;
+    v += m;
+    n -= m;
+  }
+  xsum_add(sacc, *v);
+}
 
-    if ((u & 0xffff) == 0) {
-      u >>= 16;
-      ix += 16;
-    }
+template <>
+void xsum_add<xsum_small_accumulator>(xsum_small_accumulator *const sacc,
+                                      xsum_flt const *const vec,
+                                      xsum_length const c) {
+  if (XSUM_INTEGER_BLOCK_SIZE > 0) {
+    xsum_add_integer_blocks(sacc, vec, c, xsum_small_add_vector);
+  } else {
+    xsum_small_add_vector(sacc, vec, c);
+  }
+}
 
-    if ((u & 0xff) == 0) {
-      u >>= 8;
-      ix += 8;
-    }
+/* ADD A VECTOR OF VALUES TO A LARGE ACCUMULATOR.  Without the integer fast
+   path. */
 
-    do {
-      if (_lacc->count[ix] >= 0) {
-        add_lchunk_to_small(ix);
-      }
+static void xsum_large_add_vector(xsum_large_accumulator *const lacc,
+                                  xsum_flt const *const vec,
+                                  xsum_length const n) {
+  if (n == 0) {
+    return;
+  }
 
-      ++ix;
-      u >>= 1;
-    } while (u != 0);
+  xsum_flt const *v = vec;
 
-    ++p;
-  } while (p != e);
+  bool const stream =
+      XSUM_STREAM_THRESHOLD > 0 && n >= XSUM_STREAM_THRESHOLD;
 
-  /* Finish now that all blocks have been added to the small accumulator
-     by calling the small accumulator rounding function. */
-  std::copy(_lacc->sacc.chunk, _lacc->sacc.chunk + XSUM_SCHUNKS, sacc.chunk);
-  sacc.Inf = _lacc->sacc.Inf;
-  sacc.NaN = _lacc->sacc.NaN;
-  sacc.adds_until_propagate = _lacc->sacc.adds_until_propagate;
-  return sacc;
-}
+  /* Version that's been manually optimized:  Loop unrolled, pre-fetch
+     attempted, branches eliminated, ... */
 
-xsum_small_accumulator xsum_large::round_to_small(
-    xsum_large_accumulator *const lacc) {
-  xsum_used const *p = lacc->chunks_used;
-  xsum_used const *e = p + XSUM_LCHUNKS / 64;
+  /* Unrolled loop processing two values each time around.  The loop is
+     done as two nested loops, arranged so that the inner one will have
+     no branches except for the one looping back.  This is achieved by
+     a trick for combining three tests for negativity into one.  The
+     last one or two values are not done here, so that the pre-fetching
+     will not go past the end of the array (which would probably be OK,
+     but is technically not allowed). */
 
-  /* Very quickly skip some unused low-order blocks of chunks
-     by looking at the used_used flags. */
-  xsum_used uu = lacc->used_used;
+  fpunion u1;
+  fpunion u2;
 
-  if ((uu & 0xffffffff) == 0) {
-    uu >>= 32;
-    p += 32;
-  }
-  if ((uu & 0xffff) == 0) {
-    uu >>= 16;
-    p += 16;
-  }
-  if ((uu & 0xff) == 0) {
-    p += 8;
-  }
+  int count1;
+  int count2;
 
-  xsum_small_accumulator sacc;
+  xsum_expint ix1;
+  xsum_expint ix2;
 
-  /* Loop over remaining blocks of chunks. */
-  xsum_used u;
-  int ix;
-  do {
-    /* Loop to quickly find the next non-zero block of used flags, or finish
-       up if we've added all the used blocks to the small accumulator. */
+  /* leave out last one or two, terminate when negative, for trick */
+  xsum_length m = n - 3;
+
+  while (m >= 0) {
+    /* Loop processing two values at a time until we're done, or until
+       one (or both) of the values result in a chunk needing to be processed.
+       Updates are done here for both of these chunks, even though it is not
+       yet known whether these updates ought to have been done.  We hope
+       this allows for better memory pre-fetch and instruction scheduling. */
 
     for (;;) {
-      u = *p;
-      if (u != 0) {
-        break;
+      /* At least m + 3 values are left, so this stays inside the array */
+      if (XSUM_PREFETCH_ADD > 0) {
+        xsum_prefetch(v + (m < XSUM_PREFETCH_ADD ? m : XSUM_PREFETCH_ADD),
+                      stream);
       }
 
-      ++p;
-      if (p == e) {
-        std::copy(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS,
-                  sacc.chunk);
-        sacc.Inf = lacc->sacc.Inf;
-        sacc.NaN = lacc->sacc.NaN;
-        sacc.adds_until_propagate = lacc->sacc.adds_until_propagate;
-        return sacc;
-      }
+      u1.fltv = *v++;
+      u2.fltv = *v++;
 
-      u = *p;
-      if (u != 0) {
-        break;
-      }
+      ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
+      count1 = lacc->lcount(ix1) - 1;
+      lacc->lcount(ix1) = count1;
+      lacc->lchunk(ix1) += u1.uintv;
 
-      ++p;
-      if (p == e) {
-        std::copy(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS,
-                  sacc.chunk);
-        sacc.Inf = lacc->sacc.Inf;
-        sacc.NaN = lacc->sacc.NaN;
-        sacc.adds_until_propagate = lacc->sacc.adds_until_propagate;
-        return sacc;
-      }
+      ix2 = u2.uintv >> XSUM_MANTISSA_BITS;
+      count2 = lacc->lcount(ix2) - 1;
+      lacc->lcount(ix2) = count2;
+      lacc->lchunk(ix2) += u2.uintv;
 
-      u = *p;
-      if (u != 0) {
+      m -= 2;
+
+      /* ... equivalent to while (count1 >= 0 && count2 >= 0 && m >= 0) */
+      if ((static_cast<xsum_length>(count1) | static_cast<xsum_length>(count2) |
+           m) < 0) {
         break;
       }
+    }
 
-      ++p;
-      if (p == e) {
-        std::copy(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS,
-                  sacc.chunk);
-        sacc.Inf = lacc->sacc.Inf;
-        sacc.NaN = lacc->sacc.NaN;
-        sacc.adds_until_propagate = lacc->sacc.adds_until_propagate;
-        return sacc;
-      }
+    /* See if we were actually supposed to update these chunks.  If not,
+       back out the changes and then process the chunks as they ought to
+       have been processed. */
+    if (count1 < 0 || count2 < 0) {
+      lacc->lcount(ix2) = count2 + 1;
+      lacc->lchunk(ix2) -= u2.uintv;
 
-      u = *p;
-      if (u != 0) {
-        break;
+      if (count1 < 0) {
+        lacc->lcount(ix1) = count1 + 1;
+        lacc->lchunk(ix1) -= u1.uintv;
+        xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix1, u1.uintv);
+        count2 = lacc->lcount(ix2) - 1;
       }
 
-      ++p;
-      if (p == e) {
-        std::copy(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS,
-                  sacc.chunk);
-        sacc.Inf = lacc->sacc.Inf;
-        sacc.NaN = lacc->sacc.NaN;
-        sacc.adds_until_propagate = lacc->sacc.adds_until_propagate;
-        return sacc;
+      if (count2 < 0) {
+        xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix2, u2.uintv);
+      } else {
+        lacc->lcount(ix2) = count2;
+        lacc->lchunk(ix2) += u2.uintv;
       }
     }
+  }
 
-    /* Find and process the chunks in this block that are used.  We skip
-       forward based on the chunks_used flags until we're within eight
-       bits of a chunk that is in use. */
+  /* Process the last one or two values, without pre-fetching. */
+  m += 3;
+  for (;;) {
+    u1.fltv = *v++;
+    ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
+    count1 = lacc->lcount(ix1) - 1;
 
-    ix = (p - lacc->chunks_used) << 6;
-    if ((u & 0xffffffff) == 0) {
-      u >>= 32;
-      ix += 32;
+    if (count1 < 0) {
+      xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix1, u1.uintv);
+    } else {
+      lacc->lcount(ix1) = count1;
+      lacc->lchunk(ix1) += u1.uintv;
     }
 
-    if ((u & 0xffff) == 0) {
-      u >>= 16;
-      ix += 16;
+    --m;
+    if (m == 0) {
+      break;
     }
+  }
+}
 
-    if ((u & 0xff) == 0) {
-      u >>= 8;
-      ix += 8;
-    }
+template <>
+void xsum_add<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
+                                      xsum_flt const *const vec,
+                                      xsum_length const n) {
+  if (XSUM_INTEGER_BLOCK_SIZE > 0) {
+    xsum_add_integer_blocks(lacc, vec, n, xsum_large_add_vector);
+  } else {
+    xsum_large_add_vector(lacc, vec, n);
+  }
+}
 
-    do {
-      if (lacc->count[ix] >= 0) {
-        add_lchunk_to_small(ix);
-      }
+template <>
+void xsum_add<xsum_small_accumulator>(xsum_small_accumulator *const sacc,
+                                      std::vector<xsum_flt> const &vec) {
+  xsum_add<xsum_small_accumulator>(sacc, vec.data(),
+                                   static_cast<xsum_length>(vec.size()));
+}
 
-      ++ix;
-      u >>= 1;
-    } while (u != 0);
+template <>
+void xsum_add<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
+                                      std::vector<xsum_flt> const &vec) {
+  xsum_add<xsum_large_accumulator>(lacc, vec.data(),
+                                   static_cast<xsum_length>(vec.size()));
+}
 
-    ++p;
-  } while (p != e);
+template <>
+void xsum_add<xsum_small_accumulator>(
+    xsum_small_accumulator *const sacc,
+    xsum_small_accumulator const *const value) {
+  if (sacc->adds_until_propagate == 0) {
+    xsum_carry_propagate<xsum_small_accumulator>(sacc);
+  }
 
-  /* Finish now that all blocks have been added to the small accumulator
-     by calling the small accumulator rounding function. */
-  std::copy(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS, sacc.chunk);
-  sacc.Inf = lacc->sacc.Inf;
-  sacc.NaN = lacc->sacc.NaN;
-  sacc.adds_until_propagate = lacc->sacc.adds_until_propagate;
+  xsum_add_no_carry<xsum_small_accumulator>(sacc, value);
+
+  --sacc->adds_until_propagate;
+}
+
+template <>
+void xsum_add<xsum_small_accumulator>(xsum_small_accumulator *const sacc,
+                                      xsum_small_accumulator *const value) {
+  if (sacc->adds_until_propagate == 0) {
+    xsum_carry_propagate<xsum_small_accumulator>(sacc);
+  }
+
+  xsum_add_no_carry<xsum_small_accumulator>(sacc, value);
+
+  --sacc->adds_until_propagate;
+}
+
+template <>
+void xsum_add<xsum_large_accumulator>(
+    xsum_large_accumulator *const lacc,
+    xsum_small_accumulator const *const value) {
+  if (lacc->sacc.adds_until_propagate == 0) {
+    xsum_carry_propagate<xsum_small_accumulator>(&lacc->sacc);
+  }
+
+  xsum_add_no_carry<xsum_small_accumulator>(&lacc->sacc, value);
+
+  --lacc->sacc.adds_until_propagate;
+}
+
+/* ROUND A SMALL ACCUMULATOR TO A SMALL ACCUMULATOR.  Nothing to do, so that
+   generic code can treat all accumulators alike. */
+
+template <>
+xsum_small_accumulator *xsum_round_to_small_ptr<xsum_small_accumulator>(
+    xsum_small_accumulator *const sacc) {
   return sacc;
 }
 
-xsum_small_accumulator *xsum_large::round_to_small_ptr() {
-  xsum_used const *p = _lacc->chunks_used;
-  xsum_used const *e = p + XSUM_LCHUNKS / 64;
+template <>
+xsum_small_accumulator xsum_round_to_small<xsum_small_accumulator>(
+    xsum_small_accumulator *const sacc) {
+  return *xsum_round_to_small_ptr<xsum_small_accumulator>(sacc);
+}
 
-  /* Very quickly skip some unused low-order blocks of chunks
-     by looking at the used_used flags. */
-  xsum_used uu = _lacc->used_used;
+template <>
+xsum_small_accumulator *xsum_round_to_small_ptr<xsum_large_accumulator>(
+    xsum_large_accumulator *const lacc) {
+  xsum_used *p = lacc->chunks_used;
+  xsum_used *e = p + XSUM_LCHUNKS / 64;
+
+  /* Very quickly skip some unused low-order blocks of chunks by looking
+     at the used_used flags. */
+
+  xsum_used uu = lacc->used_used;
 
   if ((uu & 0xffffffff) == 0) {
     uu >>= 32;
@@ -2921,9 +5230,9 @@ xsum_small_accumulator *xsum_large::round_to_small_ptr() {
     p += 8;
   }
 
-  /* Loop over remaining blocks of chunks. */
   xsum_used u;
-  int ix;
+
+  /* Loop over remaining blocks of chunks. */
   do {
     /* Loop to quickly find the next non-zero block of used flags, or finish
        up if we've added all the used blocks to the small accumulator. */
@@ -2936,7 +5245,7 @@ xsum_small_accumulator *xsum_large::round_to_small_ptr() {
 
       ++p;
       if (p == e) {
-        return &_lacc->sacc;
+        return &lacc->sacc;
       }
 
       u = *p;
@@ -2946,7 +5255,7 @@ xsum_small_accumulator *xsum_large::round_to_small_ptr() {
 
       ++p;
       if (p == e) {
-        return &_lacc->sacc;
+        return &lacc->sacc;
       }
 
       u = *p;
@@ -2956,7 +5265,7 @@ xsum_small_accumulator *xsum_large::round_to_small_ptr() {
 
       ++p;
       if (p == e) {
-        return &_lacc->sacc;
+        return &lacc->sacc;
       }
 
       u = *p;
@@ -2966,54 +5275,56 @@ xsum_small_accumulator *xsum_large::round_to_small_ptr() {
 
       ++p;
       if (p == e) {
-        return &_lacc->sacc;
+        return &lacc->sacc;
       }
     }
 
     /* Find and process the chunks in this block that are used.  We skip
        forward based on the chunks_used flags until we're within eight
-       bits of a chunk that is in use. */
+        bits of a chunk that is in use. */
+
+    int ix = (p - lacc->chunks_used) << 6;
 
-    ix = (p - _lacc->chunks_used) << 6;
     if ((u & 0xffffffff) == 0) {
       u >>= 32;
       ix += 32;
     }
-
     if ((u & 0xffff) == 0) {
       u >>= 16;
       ix += 16;
     }
-
     if ((u & 0xff) == 0) {
       u >>= 8;
       ix += 8;
     }
 
     do {
-      if (_lacc->count[ix] >= 0) {
-        add_lchunk_to_small(ix);
+      if (lacc->lcount(ix) >= 0) {
+        xsum_add_lchunk_to_small<xsum_large_accumulator>(lacc, ix);
       }
-
       ++ix;
       u >>= 1;
     } while (u != 0);
 
     ++p;
+
   } while (p != e);
 
   /* Finish now that all blocks have been added to the small accumulator
      by calling the small accumulator rounding function. */
-  return &_lacc->sacc;
+
+  return &lacc->sacc;
 }
 
-xsum_small_accumulator *xsum_large::round_to_small_ptr(
+template <>
+xsum_small_accumulator xsum_round_to_small<xsum_large_accumulator>(
     xsum_large_accumulator *const lacc) {
-  xsum_used const *p = lacc->chunks_used;
-  xsum_used const *e = p + XSUM_LCHUNKS / 64;
+  xsum_used *p = lacc->chunks_used;
+  xsum_used *e = p + XSUM_LCHUNKS / 64;
+
+  /* Very quickly skip some unused low-order blocks of chunks by looking
+     at the used_used flags. */
 
-  /* Very quickly skip some unused low-order blocks of chunks
-     by looking at the used_used flags. */
   xsum_used uu = lacc->used_used;
 
   if ((uu & 0xffffffff) == 0) {
@@ -3028,9 +5339,11 @@ xsum_small_accumulator *xsum_large::round_to_small_ptr(
     p += 8;
   }
 
-  /* Loop over remaining blocks of chunks. */
+  xsum_small_accumulator sacc;
+
   xsum_used u;
-  int ix;
+
+  /* Loop over remaining blocks of chunks. */
   do {
     /* Loop to quickly find the next non-zero block of used flags, or finish
        up if we've added all the used blocks to the small accumulator. */
@@ -3043,7 +5356,12 @@ xsum_small_accumulator *xsum_large::round_to_small_ptr(
 
       ++p;
       if (p == e) {
-        return &lacc->sacc;
+        std::copy(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS,
+                  sacc.chunk);
+        sacc.Inf = lacc->sacc.Inf;
+        sacc.NaN = lacc->sacc.NaN;
+        sacc.adds_until_propagate = lacc->sacc.adds_until_propagate;
+        return sacc;
       }
 
       u = *p;
@@ -3053,7 +5371,12 @@ xsum_small_accumulator *xsum_large::round_to_small_ptr(
 
       ++p;
       if (p == e) {
-        return &lacc->sacc;
+        std::copy(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS,
+                  sacc.chunk);
+        sacc.Inf = lacc->sacc.Inf;
+        sacc.NaN = lacc->sacc.NaN;
+        sacc.adds_until_propagate = lacc->sacc.adds_until_propagate;
+        return sacc;
       }
 
       u = *p;
@@ -3063,7 +5386,12 @@ xsum_small_accumulator *xsum_large::round_to_small_ptr(
 
       ++p;
       if (p == e) {
-        return &lacc->sacc;
+        std::copy(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS,
+                  sacc.chunk);
+        sacc.Inf = lacc->sacc.Inf;
+        sacc.NaN = lacc->sacc.NaN;
+        sacc.adds_until_propagate = lacc->sacc.adds_until_propagate;
+        return sacc;
       }
 
       u = *p;
@@ -3073,360 +5401,467 @@ xsum_small_accumulator *xsum_large::round_to_small_ptr(
 
       ++p;
       if (p == e) {
-        return &lacc->sacc;
+        std::copy(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS,
+                  sacc.chunk);
+        sacc.Inf = lacc->sacc.Inf;
+        sacc.NaN = lacc->sacc.NaN;
+        sacc.adds_until_propagate = lacc->sacc.adds_until_propagate;
+        return sacc;
       }
     }
 
     /* Find and process the chunks in this block that are used.  We skip
        forward based on the chunks_used flags until we're within eight
-       bits of a chunk that is in use. */
+        bits of a chunk that is in use. */
+
+    int ix = (p - lacc->chunks_used) << 6;
 
-    ix = (p - lacc->chunks_used) << 6;
     if ((u & 0xffffffff) == 0) {
       u >>= 32;
       ix += 32;
     }
-
     if ((u & 0xffff) == 0) {
       u >>= 16;
       ix += 16;
     }
-
     if ((u & 0xff) == 0) {
       u >>= 8;
       ix += 8;
     }
 
     do {
-      if (lacc->count[ix] >= 0) {
-        add_lchunk_to_small(ix);
+      if (lacc->lcount(ix) >= 0) {
+        xsum_add_lchunk_to_small<xsum_large_accumulator>(lacc, ix);
       }
-
       ++ix;
       u >>= 1;
     } while (u != 0);
 
     ++p;
+
   } while (p != e);
 
   /* Finish now that all blocks have been added to the small accumulator
      by calling the small accumulator rounding function. */
-  return &lacc->sacc;
+  std::copy(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS, sacc.chunk);
+  sacc.Inf = lacc->sacc.Inf;
+  sacc.NaN = lacc->sacc.NaN;
+  sacc.adds_until_propagate = lacc->sacc.adds_until_propagate;
+  return sacc;
 }
 
-void xsum_large::display() {
-  std::cout << "Large accumulator:\n";
+template <>
+void xsum_add<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
+                                      xsum_large_accumulator *const value) {
+  xsum_small_accumulator const *const sacc = xsum_round_to_small_ptr(value);
+  xsum_add(lacc, sacc);
+}
 
-  int dots = 0;
-  for (int i = XSUM_LCHUNKS - 1; i >= 0; --i) {
-    if (_lacc->count[i] < 0) {
-      if (!dots) {
-        std::cout << "            ...\n";
-      }
-      dots = 1;
-    } else {
-      std::cout << (i & 0x800 ? '-' : '+') << std::setw(4) << (i & 0x7ff) << " "
-                << std::setw(5) << _lacc->count[i] << " "
-                << std::bitset<XSUM_LCHUNK_BITS - 32>(
-                       static_cast<std::int64_t>(_lacc->chunk[i]) >> 32)
-                << " "
-                << std::bitset<32>(static_cast<std::int64_t>(_lacc->chunk[i]) &
-                                   0xffffffff)
-                << "\n";
-      dots = 0;
+template <>
+void xsum_add<xsum_small_accumulator>(xsum_small_accumulator *const sacc,
+                                      xsum_small_accumulator const *const vec,
+                                      xsum_length const c) {
+  if (c == 0) {
+    return;
+  }
+  xsum_small_accumulator const *v = vec;
+  xsum_length n = c;
+  while (n > 1) {
+    if (sacc->adds_until_propagate == 0) {
+      xsum_carry_propagate<xsum_small_accumulator>(sacc);
     }
+    xsum_length const m = (n - 1 <= sacc->adds_until_propagate)
+                              ? n - 1
+                              : sacc->adds_until_propagate;
+    xsum_add_no_carry<xsum_small_accumulator>(sacc, v, m + 1);
+    sacc->adds_until_propagate -= m;
+    v += m;
+    n -= m;
   }
-
-  std::cout << "\nWithin the large accumulator:  ";
-
-  sdisplay();
+  xsum_add<xsum_small_accumulator>(sacc, v);
 }
 
-void xsum_large::sdisplay() {
-  std::cout << "Small accumulator:" << (_lacc->sacc.Inf ? "  Inf" : "")
-            << (_lacc->sacc.NaN ? "  NaN" : "") << "\n";
-
-  for (int i = XSUM_SCHUNKS - 1, dots = 0; i >= 0; --i) {
-    if (_lacc->sacc.chunk[i] == 0) {
-      if (!dots) {
-        dots = 1;
-        std::cout << "            ...\n";
-      }
-    } else {
-      std::cout << std::setw(5) << i << " " << std::setw(5)
-                << static_cast<int>((i << XSUM_LOW_EXP_BITS) - XSUM_EXP_BIAS -
-                                    XSUM_MANTISSA_BITS)
-                << " "
-                << std::bitset<XSUM_SCHUNK_BITS - 32>(
-                       static_cast<std::int64_t>(_lacc->sacc.chunk[i] >> 32))
-                << " "
-                << std::bitset<32>(static_cast<std::int64_t>(
-                       _lacc->sacc.chunk[i] & 0xffffffff))
-                << "\n";
-      dots = 0;
-    }
+template <>
+void xsum_add_sqnorm<xsum_small_accumulator>(xsum_small_accumulator *const sacc,
+                                             xsum_flt const *const vec,
+                                             xsum_length const c) {
+  if (c == 0) {
+    return;
   }
-  std::cout << "\n";
-}
 
-int xsum_large::chunks_used() {
-  int c = 0;
-  for (int i = 0; i < XSUM_LCHUNKS; ++i) {
-    if (_lacc->count[i] >= 0) {
-      ++c;
+  xsum_flt const *v = vec;
+  xsum_length n = c;
+  while (n > 1) {
+    if (sacc->adds_until_propagate == 0) {
+      xsum_carry_propagate<xsum_small_accumulator>(sacc);
     }
+
+    xsum_length const m = n - 1 <= sacc->adds_until_propagate
+                              ? n - 1
+                              : sacc->adds_until_propagate;
+    xsum_add_sqnorm_no_carry<xsum_small_accumulator>(sacc, v, m + 1);
+    sacc->adds_until_propagate -= m;
+    v += m;
+    n -= m;
   }
-  return c;
+
+  xsum_add(sacc, *v * *v);
 }
 
-int xsum_large::carry_propagate() {
-  if (xsum_debug) {
-    std::cout << "Carry propagating in small accumulator\n";
+template <>
+void xsum_add_sqnorm<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
+                                             xsum_flt const *const vec,
+                                             xsum_length const n) {
+  if (n == 0) {
+    return;
   }
 
-  /* Set u to the index of the uppermost non-zero (for now) chunk, or
-     return with value 0 if there is none. */
+  xsum_flt const *v = vec;
+
+  bool const stream =
+      XSUM_STREAM_THRESHOLD > 0 && n >= XSUM_STREAM_THRESHOLD;
+
+  /* Unrolled loop processing two squares each time around.  The loop is
+     done as two nested loops, arranged so that the inner one will have
+     no branches except for the one looping back.  This is achieved by
+     a trick for combining three tests for negativity into one.  The
+     last one or two squares are not done here, so that the pre-fetching
+     will not go past the end of the array (which would probably be OK,
+     but is technically not allowed). */
+
+  fpunion u1;
+  fpunion u2;
+
+  int count1;
+  int count2;
+
+  xsum_expint ix1;
+  xsum_expint ix2;
+
+  /* leave out last one or two, terminate when negative, for trick */
+  xsum_length m = n - 3;
+  while (m >= 0) {
+    /* Loop processing two squares at a time until we're done, or until
+       one (or both) of them result in a chunk needing to be processed.
+       Updates are done here for both of these chunks, even though it is not
+       yet known whether these updates ought to have been done.  We hope
+       this allows for better memory pre-fetch and instruction scheduling. */
+
+    for (;;) {
+      if (XSUM_PREFETCH_SQNORM > 0) {
+        xsum_prefetch(
+            v + (m < XSUM_PREFETCH_SQNORM ? m : XSUM_PREFETCH_SQNORM), stream);
+      }
+
+      u1.fltv = *v * *v;
+      ++v;
+      u2.fltv = *v * *v;
+      ++v;
+
+      ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
+      count1 = lacc->lcount(ix1) - 1;
+      lacc->lcount(ix1) = count1;
+      lacc->lchunk(ix1) += u1.uintv;
+
+      ix2 = u2.uintv >> XSUM_MANTISSA_BITS;
+      count2 = lacc->lcount(ix2) - 1;
+      lacc->lcount(ix2) = count2;
+      lacc->lchunk(ix2) += u2.uintv;
 
-  bool found = false;
+      m -= 2;
 
-  int u = XSUM_SCHUNKS - 1;
-  switch (XSUM_SCHUNKS & 0x3) {
-    case 3:
-      if (_lacc->sacc.chunk[u] != 0) {
-        found = true;
-        break;
-      }
-      --u;
-    case 2:
-      if (_lacc->sacc.chunk[u] != 0) {
-        found = true;
+      /* ... equivalent to while (count1 >= 0 && count2 >= 0 && m >= 0) */
+      /* ... while (((xsum_length)count1 | (xsum_length)count2 | m) >= 0); */
+      if ((static_cast<xsum_length>(count1) | static_cast<xsum_length>(count2) |
+           m) < 0) {
         break;
       }
-      --u;
-    case 1:
-      if (_lacc->sacc.chunk[u] != 0) {
-        found = true;
-        break;
+    }
+
+    /* See if we were actually supposed to update these chunks.  If not,
+       back out the changes and then process the chunks as they ought to
+       have been processed. */
+    if (count1 < 0 || count2 < 0) {
+      lacc->lcount(ix2) = count2 + 1;
+      lacc->lchunk(ix2) -= u2.uintv;
+
+      if (count1 < 0) {
+        lacc->lcount(ix1) = count1 + 1;
+        lacc->lchunk(ix1) -= u1.uintv;
+        xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix1, u1.uintv);
+        count2 = lacc->lcount(ix2) - 1;
       }
-      --u;
-    case 0:;
-  }
 
-  if (!found) {
-    do {
-      if (_lacc->sacc.chunk[u - 3] | _lacc->sacc.chunk[u - 2] |
-          _lacc->sacc.chunk[u - 1] | _lacc->sacc.chunk[u]) {
-        found = true;
-        break;
+      if (count2 < 0) {
+        xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix2, u2.uintv);
+      } else {
+        lacc->lcount(ix2) = count2;
+        lacc->lchunk(ix2) += u2.uintv;
       }
-      u -= 4;
-    } while (u >= 0);
+    }
   }
 
-  if (found) {
-    while (_lacc->sacc.chunk[u] == 0) {
-      --u;
-    }
-  } else {
-    if (xsum_debug) {
-      std::cout << "number is zero (1)\n";
-    }
+  /* Process the last one or two squares, without pre-fetching. */
+  m += 3;
+  for (;;) {
+    u1.fltv = *v * *v;
+    ++v;
 
-    _lacc->sacc.adds_until_propagate = XSUM_SMALL_CARRY_TERMS - 1;
+    ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
+    count1 = lacc->lcount(ix1) - 1;
+    if (count1 < 0) {
+      xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix1, u1.uintv);
+    } else {
+      lacc->lcount(ix1) = count1;
+      lacc->lchunk(ix1) += u1.uintv;
+    }
 
-    /* Return index of uppermost non-zero chunk. */
-    return 0;
+    --m;
+    if (m == 0) {
+      break;
+    }
   }
+}
 
-  if (xsum_debug) {
-    std::cout << "u: \n" << u;
+template <>
+void xsum_add_sqnorm<xsum_small_accumulator>(xsum_small_accumulator *const sacc,
+                                             std::vector<xsum_flt> const &vec) {
+  xsum_length n = static_cast<xsum_length>(vec.size());
+  if (n == 0) {
+    return;
   }
 
-  /* Carry propagate, starting at the low-order chunks.  Note that the
-     loop limit of u may be increased inside the loop. */
-
-  /* indicates that a non-zero chunk has not been found yet */
-  int uix = -1;
-
-  /* Quickly skip over unused low-order chunks.  Done here at the start
-     on the theory that there are often many unused low-order chunks,
-     justifying some overhead to begin, but later stretches of unused
-     chunks may not be as large. */
+  xsum_flt const *v = vec.data();
 
-  int i = 0;
-  int const e = u - 3;
-  while (i <= e) {
-    if (_lacc->sacc.chunk[i] | _lacc->sacc.chunk[i + 1] |
-        _lacc->sacc.chunk[i + 2] | _lacc->sacc.chunk[i + 3]) {
-      break;
+  while (n > 1) {
+    if (sacc->adds_until_propagate == 0) {
+      xsum_carry_propagate<xsum_small_accumulator>(sacc);
     }
-    i += 4;
-  }
 
-  xsum_schunk c;
+    xsum_length const m = n - 1 <= sacc->adds_until_propagate
+                              ? n - 1
+                              : sacc->adds_until_propagate;
+    xsum_add_sqnorm_no_carry<xsum_small_accumulator>(sacc, v, m + 1);
+    sacc->adds_until_propagate -= m;
+    v += m;
+    n -= m;
+  }
 
-  do {
-    bool nonzero = false;
+  xsum_add(sacc, *v * *v);
+}
 
-    /* Find the next non-zero chunk, or break out of loop if there is none. */
-    do {
-      c = _lacc->sacc.chunk[i];
+template <>
+void xsum_add_sqnorm<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
+                                             std::vector<xsum_flt> const &vec) {
+  xsum_add_sqnorm<xsum_large_accumulator>(lacc, vec.data(),
+                                          static_cast<xsum_length>(vec.size()));
+}
 
-      if (c != 0) {
-        nonzero = true;
-        break;
-      }
+template <>
+void xsum_add_dot<xsum_small_accumulator>(xsum_small_accumulator *const sacc,
+                                          xsum_flt const *const vec1,
+                                          xsum_flt const *const vec2,
+                                          xsum_length const c) {
+  if (c == 0) {
+    return;
+  }
 
-      ++i;
+  xsum_flt const *v1 = vec1;
+  xsum_flt const *v2 = vec2;
+  xsum_length n = c;
 
-      if (i > u) {
-        break;
-      }
+  while (n > 1) {
+    if (sacc->adds_until_propagate == 0) {
+      xsum_carry_propagate<xsum_small_accumulator>(sacc);
+    }
+    xsum_length const m = n - 1 <= sacc->adds_until_propagate
+                              ? n - 1
+                              : sacc->adds_until_propagate;
+    xsum_add_dot_no_carry<xsum_small_accumulator>(sacc, v1, v2, m + 1);
+    sacc->adds_until_propagate -= m;
+    v1 += m;
+    v2 += m;
+    n -= m;
+  }
 
-      c = _lacc->sacc.chunk[i];
+  xsum_add(sacc, *v1 * *v2);
+}
 
-      if (c != 0) {
-        nonzero = true;
-        break;
-      }
+template <>
+void xsum_add_dot<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
+                                          xsum_flt const *const vec1,
+                                          xsum_flt const *const vec2,
+                                          xsum_length const n) {
+  if (n == 0) {
+    return;
+  }
 
-      ++i;
-    } while (i <= u);
+  xsum_flt const *v1 = vec1;
+  xsum_flt const *v2 = vec2;
 
-    if (!nonzero) {
-      break;
-    }
+  bool const stream =
+      XSUM_STREAM_THRESHOLD > 0 && n >= XSUM_STREAM_THRESHOLD;
 
-    /* Propagate possible carry from this chunk to next chunk up. */
-    xsum_schunk const chigh = c >> XSUM_LOW_MANTISSA_BITS;
-    if (chigh == 0) {
-      uix = i;
-      ++i;
-      /* no need to change this chunk */
-      continue;
-    }
+  /* Version that's been manually optimized:  Loop unrolled, pre-fetch
+     attempted, branches eliminated, ... */
 
-    if (u == i) {
-      if (chigh == -1) {
-        uix = i;
-        /* don't propagate -1 into the region of all zeros above */
-        break;
-      }
+  fpunion u1;
+  fpunion u2;
 
-      /* we will change chunk[u+1], so we'll need to look at it */
-      u = i + 1;
-    }
+  int count1;
+  int count2;
 
-    xsum_schunk const clow = c & XSUM_LOW_MANTISSA_MASK;
+  xsum_expint ix1;
+  xsum_expint ix2;
 
-    if (clow != 0) {
-      uix = i;
-    }
+  /* Unrolled loop processing two products each time around.  The loop is
+     done as two nested loops, arranged so that the inner one will have
+     no branches except for the one looping back.  This is achieved by
+     a trick for combining three tests for negativity into one.  The
+     last one or two products are not done here, so that the pre-fetching
+     will not go past the end of the array (which would probably be OK,
+     but is technically not allowed). */
 
-    /* We now change chunk[i] and add to chunk[i+1]. Note that i+1 should be
-       in range (no bigger than XSUM_CHUNKS-1) because the number of chunks
-       is big enough to hold any sum, and we do not store redundant chunks
-       with values 0 or -1 above previously non-zero chunks. */
+  /* leave out last one or two, terminate when negative, for trick */
+  xsum_length m = n - 3;
+  while (m >= 0) {
+    /* Loop processing two products at a time until we're done, or until
+       one (or both) of them result in a chunk needing to be processed.
+       Updates are done here for both of these chunks, even though it is not
+       yet known whether these updates ought to have been done.  We hope
+       this allows for better memory pre-fetch and instruction scheduling. */
 
-    if (xsum_debug) {
-      if (i + 1 >= XSUM_SCHUNKS) {
-        std::abort();
+    for (;;) {
+      /* Two input streams, each needs its own pre-fetch */
+      if (XSUM_PREFETCH_DOT > 0) {
+        xsum_length const d = m < XSUM_PREFETCH_DOT ? m : XSUM_PREFETCH_DOT;
+        xsum_prefetch(v1 + d, stream);
+        xsum_prefetch(v2 + d, stream);
       }
-    }
 
-    _lacc->sacc.chunk[i++] = clow;
-    _lacc->sacc.chunk[i] += chigh;
-  } while (i <= u);
+      u1.fltv = *v1 * *v2;
+      ++v1;
+      ++v2;
+      u2.fltv = *v1 * *v2;
+      ++v1;
+      ++v2;
 
-  if (xsum_debug) {
-    std::cout << "  uix: " << uix << "  new u: " << u << "\n";
-  }
+      ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
+      count1 = lacc->lcount(ix1) - 1;
+      lacc->lcount(ix1) = count1;
+      lacc->lchunk(ix1) += u1.uintv;
 
-  /* Check again for the number being zero, since carry propagation might
-   have created zero from something that initially looked non-zero. */
+      ix2 = u2.uintv >> XSUM_MANTISSA_BITS;
+      count2 = lacc->lcount(ix2) - 1;
+      lacc->lcount(ix2) = count2;
+      lacc->lchunk(ix2) += u2.uintv;
 
-  if (uix < 0) {
-    if (xsum_debug) {
-      std::cout << "number is zero (2)\n";
+      m -= 2;
+
+      /* ... equivalent to while (count1 >= 0 && count2 >= 0 && m >= 0) */
+      /* ... while (((xsum_length)count1 | (xsum_length)count2 | m) >= 0); */
+      if ((static_cast<xsum_length>(count1) | static_cast<xsum_length>(count2) |
+           m) < 0) {
+        break;
+      }
     }
 
-    _lacc->sacc.adds_until_propagate = XSUM_SMALL_CARRY_TERMS - 1;
+    /* See if we were actually supposed to update these chunks.  If not,
+       back out the changes and then process the chunks as they ought to
+       have been processed. */
 
-    /* Return index of uppermost non-zero chunk. */
-    return 0;
-  }
+    if (count1 < 0 || count2 < 0) {
+      lacc->lcount(ix2) = count2 + 1;
+      lacc->lchunk(ix2) -= u2.uintv;
 
-  /* While the uppermost chunk is negative, with value -1, combine it with
-     the chunk below (if there is one) to produce the same number but with
-     one fewer non-zero chunks. */
+      if (count1 < 0) {
+        lacc->lcount(ix1) = count1 + 1;
+        lacc->lchunk(ix1) -= u1.uintv;
+        xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix1, u1.uintv);
+        count2 = lacc->lcount(ix2) - 1;
+      }
 
-  while (_lacc->sacc.chunk[uix] == -1 && uix > 0) {
-    _lacc->sacc.chunk[uix] = 0;
-    --uix;
-    // @yafshar solution
-    // _lacc->sacc.chunk[uix] +=
-    // static_cast<xsum_schunk>(static_cast<xsum_lchunk>(-1) <<
-    // XSUM_LOW_MANTISSA_BITS); Neal solution A shift of a negative number is
-    // undefined according to the standard, so do a multiply - it's all
-    // presumably constant-folded by the compiler.
-    _lacc->sacc.chunk[uix] +=
-        static_cast<xsum_schunk>(-1) *
-        (static_cast<xsum_schunk>(1) << XSUM_LOW_MANTISSA_BITS);
+      if (count2 < 0) {
+        xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix2, u2.uintv);
+      } else {
+        lacc->lcount(ix2) = count2;
+        lacc->lchunk(ix2) += u2.uintv;
+      }
+    }
   }
 
-  /* We can now add one less than the total allowed terms before the
-     next carry propagate. */
+  /* Process the last one or two products, without pre-fetching. */
+  m += 3;
+  for (;;) {
+    u1.fltv = *v1 * *v2;
+    ++v1;
+    ++v2;
 
-  _lacc->sacc.adds_until_propagate = XSUM_SMALL_CARRY_TERMS - 1;
+    ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
+    count1 = lacc->lcount(ix1) - 1;
+    if (count1 < 0) {
+      xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix1, u1.uintv);
+    } else {
+      lacc->lcount(ix1) = count1;
+      lacc->lchunk(ix1) += u1.uintv;
+    }
 
-  /* Return index of uppermost non-zero chunk. */
-  return uix;
+    --m;
+    if (m == 0) {
+      break;
+    }
+  }
 }
 
-inline void xsum_large::add_no_carry(
-    xsum_small_accumulator const *const value) {
-  if (value->Inf != 0) {
-    if (_lacc->sacc.Inf == 0) {
-      _lacc->sacc.Inf = value->Inf;
-    } else if (_lacc->sacc.Inf != value->Inf) {
-      fpunion u;
-      u.intv = value->Inf;
-
-      /* result will be a NaN */
-      u.fltv = u.fltv - u.fltv;
-
-      _lacc->sacc.Inf = u.intv;
-    }
+template <>
+void xsum_add_dot<xsum_small_accumulator>(xsum_small_accumulator *const sacc,
+                                          std::vector<xsum_flt> const &vec1,
+                                          std::vector<xsum_flt> const &vec2) {
+  xsum_length n = static_cast<xsum_length>(vec1.size());
+  if (n == 0 || n > static_cast<xsum_length>(vec2.size())) {
     return;
   }
 
-  if (value->NaN != 0) {
-    if ((_lacc->sacc.NaN & XSUM_MANTISSA_MASK) <
-        (value->NaN & XSUM_MANTISSA_MASK)) {
-      _lacc->sacc.NaN = value->NaN;
+  xsum_flt const *v1 = vec1.data();
+  xsum_flt const *v2 = vec2.data();
+
+  while (n > 1) {
+    if (sacc->adds_until_propagate == 0) {
+      xsum_carry_propagate<xsum_small_accumulator>(sacc);
     }
-    return;
+    xsum_length const m = n - 1 <= sacc->adds_until_propagate
+                              ? n - 1
+                              : sacc->adds_until_propagate;
+    xsum_add_dot_no_carry<xsum_small_accumulator>(sacc, v1, v2, m + 1);
+    sacc->adds_until_propagate -= m;
+    v1 += m;
+    v2 += m;
+    n -= m;
   }
 
-  xsum_schunk *sc = _lacc->sacc.chunk;
-  xsum_schunk const *vc = value->chunk;
-  for (int i = 0; i < XSUM_SCHUNKS; ++i) {
-    sc[i] += vc[i];
-  }
+  xsum_add(sacc, *v1 * *v2);
 }
 
-xsum_flt xsum_large::sround() {
-  if (xsum_debug) {
-    std::cout << "Rounding small accumulator\n";
+template <>
+void xsum_add_dot<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
+                                          std::vector<xsum_flt> const &vec1,
+                                          std::vector<xsum_flt> const &vec2) {
+  xsum_length const n = static_cast<xsum_length>(vec1.size());
+  if (n == 0 || n > static_cast<xsum_length>(vec2.size())) {
+    return;
   }
+  xsum_add_dot<xsum_large_accumulator>(lacc, vec1.data(), vec2.data(), n);
+}
 
-  /* See if we have a NaN from one of the numbers being a NaN, in which
-     case we return the NaN with largest payload. */
-
+template <>
+xsum_flt xsum_round<xsum_small_accumulator>(
+    xsum_small_accumulator *const sacc) {
   fpunion u;
 
-  if (_lacc->sacc.NaN != 0) {
-    u.intv = _lacc->sacc.NaN;
+  /* See if we have a NaN from one of the numbers being a NaN, in which
+     case we return the NaN with largest payload. */
+  if (sacc->NaN != 0) {
+    u.intv = sacc->NaN;
     return u.fltv;
   }
 
@@ -3435,9 +5870,8 @@ xsum_flt xsum_large::sround() {
      we have both an infinite number and a sum of other numbers that
      overflows with opposite sign, since there is no real ambiguity in
      such a case. */
-
-  if (_lacc->sacc.Inf != 0) {
-    u.intv = _lacc->sacc.Inf;
+  if (sacc->Inf != 0) {
+    u.intv = sacc->Inf;
     return u.fltv;
   }
 
@@ -3445,36 +5879,30 @@ xsum_flt xsum_large::sround() {
      propagate carries, as a preliminary to finding the magnitude of
      the sum.  This also ensures that the sign of the result can be
      determined from the uppermost non-zero chunk.
+
      We also find the index, i, of this uppermost non-zero chunk, as
      the value returned by xsum_carry_propagate, and set ivalue to
      sacc->chunk[i].  Note that ivalue will not be 0 or -1, unless
      i is 0 (the lowest chunk), in which case it will be handled by
      the code for denormalized numbers. */
 
-  int i = carry_propagate();
-
-  if (xsum_debug) {
-    display();
-  }
+  int i = xsum_carry_propagate<xsum_small_accumulator>(sacc);
 
-  xsum_int ivalue = _lacc->sacc.chunk[i];
+  xsum_int ivalue = sacc->chunk[i];
 
   /* Handle a possible denormalized number, including zero. */
-
   if (i <= 1) {
     /* Check for zero value, in which case we can return immediately. */
-
     if (ivalue == 0) {
       return 0.0;
     }
 
     /* Check if it is actually a denormalized number.  It always is if only
-       the lowest chunk is non-zero. If the highest non-zero chunk is
-       the next-to-lowest, we check the magnitude of the absolute value.
+       the lowest chunk is non-zero.  If the highest non-zero chunk is the
+       next-to-lowest, we check the magnitude of the absolute value.
        Note that the real exponent is 1 (not 0), so we need to shift right
        by 1 here, which also means there will be no overflow from the left
        shift below (but must view absolute value as unsigned). */
-
     if (i == 0) {
       u.intv = ivalue >= 0 ? ivalue : -ivalue;
       u.intv >>= 1;
@@ -3482,21 +5910,20 @@ xsum_flt xsum_large::sround() {
         u.intv |= XSUM_SIGN_MASK;
       }
       return u.fltv;
-    } else {
-      /* Note: Left shift of -ve number is undefined, so do a multiply
-         instead, which is probably optimized to a shift. */
-
+    }
+    /* Note: Left shift of -ve number is undefined, so do a multiply instead,
+       which is probably optimized to a shift. */
+    else {
       u.intv =
           ivalue * (static_cast<xsum_int>(1) << (XSUM_LOW_MANTISSA_BITS - 1)) +
-          (_lacc->sacc.chunk[0] >> 1);
-
+          (sacc->chunk[0] >> 1);
       if (u.intv < 0) {
         if (u.intv > -(static_cast<xsum_int>(1) << XSUM_MANTISSA_BITS)) {
           u.intv = (-u.intv) | XSUM_SIGN_MASK;
           return u.fltv;
         }
       } else {
-        if (u.uintv < static_cast<xsum_uint>(1) << XSUM_MANTISSA_BITS) {
+        if (u.uintv < static_cast<xsum_int>(1) << XSUM_MANTISSA_BITS) {
           return u.fltv;
         }
       }
@@ -3505,25 +5932,18 @@ xsum_flt xsum_large::sround() {
   }
 
   /* Find the location of the uppermost 1 bit in the absolute value of the
-   upper chunk by converting it (as a signed integer) to a floating point
-   value, and looking at the exponent.  Then set 'more' to the number of
-   bits from the lower chunk (and maybe the next lower) that are needed
-   to fill out the mantissa of the result, plus an extra bit to help decide
-   on rounding.  For negative numbers, it may turn out later that we need
-   another bit because negating a negative value may carry out of the top
-   here, but not once more bits are shifted into the bottom later on. */
+     upper chunk by converting it (as a signed integer) to a floating point
+     value, and looking at the exponent.  Then set 'more' to the number of
+     bits from the lower chunk (and maybe the next lower) that are needed
+     to fill out the mantissa of the result, plus an extra bit to help decide
+     on rounding.  For negative numbers, it may turn out later that we need
+     another bit because negating a negative value may carry out of the top
+     here, but not once more bits are shifted into the bottom later on. */
 
   u.fltv = static_cast<xsum_flt>(ivalue);
-
   int e = (u.uintv >> XSUM_MANTISSA_BITS) & XSUM_EXP_MASK;
   int more = 1 + XSUM_MANTISSA_BITS + XSUM_EXP_BIAS - e;
 
-  if (xsum_debug) {
-    std::cout << "e: " << e << ", more: " << more << ", ivalue: " << std::hex
-              << std::setfill('0') << std::setw(16)
-              << static_cast<long long>(ivalue) << "\n";
-  }
-
   /* Change 'ivalue' to put in 'more' bits from lower chunks into the bottom.
      Also set 'j' to the index of the lowest chunk from which these bits came,
      and 'lower' to the remaining bits of that chunk not now in 'ivalue'.
@@ -3533,44 +5953,19 @@ xsum_flt xsum_large::sround() {
 
   /* multiply, since << of negative undefined */
   ivalue *= static_cast<xsum_int>(1) << more;
-
-  if (xsum_debug) {
-    std::cout << "after ivalue <<= more, ivalue: " << std::hex
-              << std::setfill('0') << std::setw(16)
-              << static_cast<long long>(ivalue) << "\n";
-  }
-
   int j = i - 1;
-
   /* must exist, since denormalized if i==0 */
-  xsum_schunk lower = _lacc->sacc.chunk[j];
-
+  xsum_schunk lower = sacc->chunk[j];
   if (more >= XSUM_LOW_MANTISSA_BITS) {
     more -= XSUM_LOW_MANTISSA_BITS;
     ivalue += lower << more;
-    if (xsum_debug) {
-      std::cout << "after ivalue += lower << more, ivalue: " << std::hex
-                << std::setfill('0') << std::setw(16)
-                << static_cast<long long>(ivalue) << "\n";
-    }
-
     --j;
-
-    lower = ((j < 0) ? 0 : _lacc->sacc.chunk[j]);
+    lower = j < 0 ? 0 : sacc->chunk[j];
   }
 
   ivalue += lower >> (XSUM_LOW_MANTISSA_BITS - more);
   lower &= (static_cast<xsum_schunk>(1) << (XSUM_LOW_MANTISSA_BITS - more)) - 1;
 
-  if (xsum_debug) {
-    std::cout << "j: " << j << ", new e: " << e
-              << ", new |ivalue|: " << std::hex << std::setfill('0')
-              << std::setw(16)
-              << static_cast<long long>(ivalue < 0 ? -ivalue : ivalue)
-              << ", lower: " << std::hex << std::setfill('0') << std::setw(16)
-              << static_cast<long long>(lower) << "\n";
-  }
-
   /* Check for a negative 'ivalue' that when negated doesn't contain a full
      mantissa's worth of bits, plus one to help rounding.  If so, move one
      more bit into 'ivalue' from 'lower' (and remove it from 'lower').
@@ -3590,15 +5985,6 @@ xsum_flt xsum_large::sround() {
     --e;
   }
 
-  if (xsum_debug) {
-    std::cout << "j: " << j << ", new e: " << e
-              << ", new |ivalue|: " << std::hex << std::setfill('0')
-              << std::setw(16)
-              << static_cast<long long>(ivalue < 0 ? -ivalue : ivalue)
-              << ", lower: " << std::hex << std::setfill('0') << std::setw(16)
-              << static_cast<long long>(lower) << "\n";
-  }
-
   /* Set u.intv to have just the correct sign bit (rest zeros), and 'ivalue'
      to now have the absolute value of the mantissa. */
 
@@ -3609,10 +5995,8 @@ xsum_flt xsum_large::sround() {
     u.intv = XSUM_SIGN_MASK;
   }
 
-  if (xsum_debug) {
-    if ((ivalue >> (XSUM_MANTISSA_BITS + 1)) != 1) {
-      std::abort();
-    }
+  if (xsum_debug && (ivalue >> (XSUM_MANTISSA_BITS + 1)) != 1) {
+    std::abort();
   }
 
   /* Round to nearest, with ties to even. At this point, 'ivalue' has the
@@ -3621,16 +6005,13 @@ xsum_flt xsum_large::sround() {
      indexed by 'j' and below.  Note that the bits in 'lower' and the chunks
      below add to the magnitude of the remainder if the number is positive,
      but subtract from this magnitude if the number is negative.
+
      This code goes to done_rounding if it finds that just discarding lower
      order bits is correct, and to round_away_from_zero if instead the
      magnitude should be increased by one in the lowest bit. */
 
   /* extra bit is 0 */
   if ((ivalue & 1) == 0) {
-    if (xsum_debug) {
-      std::cout << "round toward zero, since remainder magnitude is < 1/2\n";
-    }
-
     goto done_rounding;
   }
 
@@ -3638,20 +6019,9 @@ xsum_flt xsum_large::sround() {
   if (u.intv == 0) {
     /* low bit 1 (odd) */
     if ((ivalue & 2) != 0) {
-      if (xsum_debug) {
-        std::cout
-            << "round away from zero, since magnitude >= 1/2, goes to even\n";
-      }
-
       goto round_away_from_zero;
     }
-
     if (lower != 0) {
-      if (xsum_debug) {
-        std::cout
-            << "round away from zero, since magnitude > 1/2 (from 'lower')\n";
-      }
-
       goto round_away_from_zero;
     }
   }
@@ -3659,70 +6029,42 @@ xsum_flt xsum_large::sround() {
   else {
     /* low bit 0 (even) */
     if ((ivalue & 2) == 0) {
-      if (xsum_debug) {
-        std::cout
-            << "round toward zero, since magnitude <= 1/2, goes to even\n";
-      }
-
       goto done_rounding;
     }
-
     if (lower != 0) {
-      if (xsum_debug) {
-        std::cout
-            << "round toward zero, since magnitude < 1/2 (from 'lower')\n";
-      }
-
       goto done_rounding;
     }
   }
 
   /* If we get here, 'lower' is zero.  We need to look at chunks lower down
      to see if any are non-zero. */
-
   while (j > 0) {
     --j;
-
-    if (_lacc->sacc.chunk[j] != 0) {
+    if (sacc->chunk[j] != 0) {
       lower = 1;
       break;
     }
   }
 
   /* number is positive, low bit 0 (even) */
-  if (u.intv == 0) {
-    if (lower != 0) {
-      if (xsum_debug) {
-        std::cout
-            << "round away from zero, since magnitude > 1/2 (low chunks)\n";
-      }
-
+  if (u.intv == 0) {
+    if (lower != 0) {
       goto round_away_from_zero;
     } else {
-      if (xsum_debug) {
-        std::cout << "round toward zero, magnitude == 1/2 (low chunks)\n";
-      }
-
       goto done_rounding;
     }
-  } else /* number is negative, low bit 1 (odd) */
-  {
+  }
+  /* number is negative, low bit 1 (odd) */
+  else {
     if (lower != 0) {
-      if (xsum_debug) {
-        std::cout << "round toward zero, since magnitude < 1/2 (low chunks)\n";
-      }
-
       goto done_rounding;
     } else {
-      if (xsum_debug) {
-        std::cout << "round away from zero, magnitude == 1/2 (low chunks)\n";
-      }
-
       goto round_away_from_zero;
     }
   }
 
 round_away_from_zero:
+
   /* Round away from zero, then check for carry having propagated out the
      top, and shift if so. */
   ivalue += 2;
@@ -3734,888 +6076,1127 @@ round_away_from_zero:
 done_rounding:;
 
   /* Get rid of the bottom bit that was used to decide on rounding. */
-
   ivalue >>= 1;
 
   /* Adjust to the true exponent, accounting for where this chunk is. */
-
   e += (i << XSUM_LOW_EXP_BITS) - XSUM_EXP_BIAS - XSUM_MANTISSA_BITS;
 
   /* If exponent has overflowed, change to plus or minus Inf and return. */
-
   if (e >= XSUM_EXP_MASK) {
     u.intv |= static_cast<xsum_int>(XSUM_EXP_MASK) << XSUM_MANTISSA_BITS;
-    if (xsum_debug) {
-      std::cout << "Final rounded result: " << std::scientific
-                << std::setprecision(17) << u.fltv << " (overflowed)\n  ";
-      print_binary<double>(u.fltv);
-    }
     return u.fltv;
   }
 
   /* Put exponent and mantissa into u.intv, which already has the sign,
      then return u.fltv. */
-
   u.intv += static_cast<xsum_int>(e) << XSUM_MANTISSA_BITS;
-  u.intv += ivalue & XSUM_MANTISSA_MASK; /* mask out the implicit 1 bit */
 
-  if (xsum_debug) {
-    if ((ivalue >> XSUM_MANTISSA_BITS) != 1) {
-      std::abort();
-    }
-    std::cout << "Final rounded result: " << std::scientific
-              << std::setprecision(17) << u.fltv << "\n  ";
-    print_binary<double>(u.fltv);
+  /* mask out the implicit 1 bit */
+  u.intv += ivalue & XSUM_MANTISSA_MASK;
+
+  if (xsum_debug && (ivalue >> XSUM_MANTISSA_BITS) != 1) {
+    std::abort();
   }
 
   return u.fltv;
 }
 
-void xsum_large::add_lchunk_to_small(xsum_expint const ix) {
-  xsum_expint const count = _lacc->count[ix];
+template <>
+xsum_flt xsum_round<xsum_large_accumulator>(
+    xsum_large_accumulator *const lacc) {
+  return xsum_round<xsum_small_accumulator>(xsum_round_to_small_ptr(lacc));
+}
 
-  /* Add to the small accumulator only if the count is not -1, which
-     indicates a chunk that contains nothing yet. */
-  if (count >= 0) {
-    /* Propagate carries in the small accumulator if necessary. */
+/* WINDOWED ACCUMULATOR */
+
+/* INDEX OF THE CHUNK FOR A VALUE IN A WINDOWED ACCUMULATOR.  The sign is
+   put below the exponent, so that the chunks for the positive and negative
+   values with one exponent are next to each other.
+   This is the trap chunk if the exponent of the value is outside the window,
+   so that the vector add function can handle such values in the same way as
+   chunks needing to be processed.  No branches. */
+
+static inline int xsum_window_index(xsum_expint const base,
+                                    xsum_uint const uintv) {
+  xsum_uint const off =
+      ((uintv >> (XSUM_MANTISSA_BITS - 1) & (XSUM_EXP_MASK << 1)) |
+       uintv >> 63) -
+      static_cast<xsum_uint>(2 * base);
+  return off < static_cast<xsum_uint>(2 * XSUM_WINDOW_EXPS)
+             ? static_cast<int>(off)
+             : XSUM_WINDOW_TRAP;
+}
 
-    if (_lacc->sacc.adds_until_propagate == 0) {
-      carry_propagate();
-    }
+/* ADD CHUNK i OF A WINDOWED ACCUMULATOR TO ITS SMALL ACCUMULATOR, and clear it
+   for further adds, as for the large accumulator. */
 
-    /* Get the chunk we will add.  Note that this chunk is the integer sum
-       of entire 64-bit floating-point representations, with sign, exponent,
-       and mantissa, but we want only the sum of the mantissas. */
+static inline void xsum_window_lchunk_to_small(
+    xsum_window_accumulator *const wacc, int const i) {
+  xsum_expint const count = wacc->count[i];
+  if (count >= 0) {
+    xsum_expint const ix =
+        ((i & 1) << XSUM_EXP_BITS) | (wacc->base + (i >> 1));
+    xsum_small_add_lchunk(&wacc->sacc, wacc->chunk[i], count, ix,
+                          XSUM_LCOUNT_BITS);
+  }
+  wacc->chunk[i] = 0;
+  wacc->count[i] = 1 << XSUM_LCOUNT_BITS;
+  wacc->chunks_used[i >> 6] |= static_cast<xsum_used>(1) << (i & 0x3f);
+}
 
-    xsum_lchunk chunk = _lacc->chunk[ix];
+/* ADD ALL CHUNKS IN USE OF A WINDOWED ACCUMULATOR TO ITS SMALL ACCUMULATOR. */
 
-    if (xsum_debug) {
-      std::cout << "Adding chunk " << static_cast<int>(ix)
-                << " to small accumulator (count " << static_cast<int>(count)
-                << ", chunk " << std::hex << std::setfill('0') << std::setw(16)
-                << static_cast<long long>(chunk) << ")\n";
+static void xsum_window_flush(xsum_window_accumulator *const wacc) {
+  for (int w = 0; w < (XSUM_WCHUNKS + 63) / 64; ++w) {
+    xsum_used u = wacc->chunks_used[w];
+    for (int i = w << 6; u != 0; ++i, u >>= 1) {
+      if (u & 1) {
+        xsum_window_lchunk_to_small(wacc, i);
+      }
     }
+  }
+}
 
-    /* If we added the maximum number of values to 'chunk', the sum of
-       the sign and exponent parts (all the same, equal to the index) will
-       have overflowed out the top, leaving only the sum of the mantissas.
-       If the count of how many more terms we could have summed is greater
-       than zero, we therefore add this count times the index (shifted to
-       the position of the sign and exponent) to get the unwanted bits to
-       overflow out the top. */
-    if (count > 0) {
-      chunk += static_cast<xsum_lchunk>(count * ix) << XSUM_MANTISSA_BITS;
-    }
+/* PLACE THE WINDOW OF A WINDOWED ACCUMULATOR so that it covers exponents lo to
+   hi, or is centered on them if there are too many.  The chunks in use for the
+   old window are first added to the small accumulator. */
+
+static void xsum_window_place(xsum_window_accumulator *const wacc,
+                              xsum_expint const lo, xsum_expint const hi) {
+  if (wacc->base != XSUM_WINDOW_UNSET) {
+    xsum_window_flush(wacc);
+    std::fill(wacc->count, wacc->count + XSUM_WINDOW_TRAP, -1);
+    std::fill(wacc->chunks_used,
+              wacc->chunks_used + (XSUM_WCHUNKS + 63) / 64, 0);
+  }
+
+  xsum_expint base = hi - lo < XSUM_WINDOW_EXPS
+                         ? lo - (XSUM_WINDOW_EXPS - 1 - (hi - lo)) / 2
+                         : (lo + hi) / 2 - XSUM_WINDOW_EXPS / 2;
+  if (base < 0) {
+    base = 0;
+  } else if (base > XSUM_EXP_MASK + 1 - XSUM_WINDOW_EXPS) {
+    base = XSUM_EXP_MASK + 1 - XSUM_WINDOW_EXPS;
+  }
+
+  wacc->base = base;
+  wacc->miss_lo = XSUM_EXP_MASK;
+  wacc->miss_hi = 0;
+  wacc->adds = 0;
+  wacc->misses = 0;
+}
 
-    /* Find the exponent for this chunk from the low bits of the index,
-       and split it into low and high parts, for accessing the small
-       accumulator.  Noting that for denormalized numbers where the
-       exponent part is zero, the actual exponent is 1 (before subtracting
-       the bias), not zero. */
+static inline void xsum_window_add1(xsum_window_accumulator *const wacc,
+                                    xsum_uint const uintv);
 
-    xsum_expint const exp = ix & XSUM_EXP_MASK;
-    xsum_expint const low_exp = ((exp == 0) ? 1 : (exp & XSUM_LOW_EXP_MASK));
-    xsum_expint const high_exp = ((exp == 0) ? 0 : (exp >> XSUM_LOW_EXP_BITS));
+/* ADD A VALUE OUTSIDE THE WINDOW OF A WINDOWED ACCUMULATOR.  It is added
+   exactly to the small accumulator.  Every XSUM_WINDOW_CHECK such values, the
+   window is placed to cover them as well as the chunks in use, if they all
+   fit, or else is moved to them if they fit and are more than half of the
+   values added since the window was placed.  Moving the window for values
+   that would not fit in it either would only add the cost of flushing it.
+   Zeros, Inf and NaN do not count. */
 
-    /* Split the mantissa into three parts, for three consecutive chunks in
-       the small accumulator.  Except for denormalized numbers, add in the sum
-       of all the implicit 1 bits that are above the actual mantissa bits. */
+static void xsum_window_add_outside(xsum_window_accumulator *const wacc,
+                                    xsum_uint const uintv) {
+  xsum_expint const exp = (uintv >> XSUM_MANTISSA_BITS) & XSUM_EXP_MASK;
 
-    xsum_uint const low_chunk = (chunk << low_exp) & XSUM_LOW_MANTISSA_MASK;
-    xsum_uint mid_chunk = chunk >> (XSUM_LOW_MANTISSA_BITS - low_exp);
+  if (exp == XSUM_EXP_MASK) {
+    xsum_small_add_inf_nan<xsum_small_accumulator>(&wacc->sacc, uintv);
+    return;
+  }
 
-    /* normalized */
-    if (exp != 0) {
-      mid_chunk += static_cast<xsum_lchunk>((1 << XSUM_LCOUNT_BITS) - count)
-                   << (XSUM_MANTISSA_BITS - XSUM_LOW_MANTISSA_BITS + low_exp);
-    }
+  if ((uintv & ~XSUM_SIGN_MASK) == 0) {
+    return;
+  }
 
-    xsum_uint const high_chunk = mid_chunk >> XSUM_LOW_MANTISSA_BITS;
-    mid_chunk &= XSUM_LOW_MANTISSA_MASK;
+  /* The first non-zero value places the window. */
+  if (wacc->base == XSUM_WINDOW_UNSET) {
+    xsum_window_place(wacc, exp, exp);
+    xsum_window_add1(wacc, uintv);
+    return;
+  }
 
-    if (xsum_debug) {
-      std::cout << "chunk div: low " << std::bitset<64>(low_chunk) << "\n"
-                << "           mid " << std::bitset<64>(mid_chunk) << "\n"
-                << "           high " << std::bitset<64>(high_chunk) << "\n";
+  fpunion u;
+  u.uintv = uintv;
+  xsum_add<xsum_small_accumulator>(&wacc->sacc, u.fltv);
 
-      /* Add or subtract the three parts of the mantissa from three small
-         accumulator chunks, according to the sign that is part of the index. */
-      std::cout << "Small chunks " << static_cast<int>(high_exp) << ", "
-                << static_cast<int>(high_exp) + 1 << ", "
-                << static_cast<int>(high_exp) + 2
-                << " before add or subtract:\n"
-                << std::bitset<64>(_lacc->sacc.chunk[high_exp]) << "\n"
-                << std::bitset<64>(_lacc->sacc.chunk[high_exp + 1]) << "\n"
-                << std::bitset<64>(_lacc->sacc.chunk[high_exp + 2]) << "\n";
-    }
+  wacc->miss_lo = std::min(wacc->miss_lo, exp);
+  wacc->miss_hi = std::max(wacc->miss_hi, exp);
 
-    if (ix & (1 << XSUM_EXP_BITS)) {
-      _lacc->sacc.chunk[high_exp] -= low_chunk;
-      _lacc->sacc.chunk[high_exp + 1] -= mid_chunk;
-      _lacc->sacc.chunk[high_exp + 2] -= high_chunk;
-    } else {
-      _lacc->sacc.chunk[high_exp] += low_chunk;
-      _lacc->sacc.chunk[high_exp + 1] += mid_chunk;
-      _lacc->sacc.chunk[high_exp + 2] += high_chunk;
-    }
+  ++wacc->misses;
+  if (wacc->misses % XSUM_WINDOW_CHECK != 0) {
+    return;
+  }
 
-    if (xsum_debug) {
-      std::cout << "Small chunks " << static_cast<int>(high_exp) << ", "
-                << static_cast<int>(high_exp) + 1 << ", "
-                << static_cast<int>(high_exp) + 2 << " after add or subtract:\n"
-                << std::bitset<64>(_lacc->sacc.chunk[high_exp]) << "\n"
-                << std::bitset<64>(_lacc->sacc.chunk[high_exp + 1]) << "\n"
-                << std::bitset<64>(_lacc->sacc.chunk[high_exp + 2]) << "\n";
+  xsum_expint lo = wacc->miss_lo;
+  xsum_expint hi = wacc->miss_hi;
+  for (int i = 0; i < XSUM_WINDOW_TRAP; ++i) {
+    if (wacc->chunks_used[i >> 6] & (static_cast<xsum_used>(1) << (i & 0x3f))) {
+      xsum_expint const e = wacc->base + (i >> 1);
+      lo = std::min(lo, e);
+      hi = std::max(hi, e);
     }
-
-    /* The above additions/subtractions reduce by one the number we can
-       do before we need to do carry propagation again. */
-    _lacc->sacc.adds_until_propagate -= 1;
   }
 
-  /* We now clear the chunk to zero, and set the count to the number
-     of adds we can do before the mantissa would overflow.  We also
-     set the bit in chunks_used to indicate that this chunk is in use
-     (if that is enabled). */
-
-  _lacc->chunk[ix] = 0;
-  _lacc->count[ix] = 1 << XSUM_LCOUNT_BITS;
-  _lacc->chunks_used[ix >> 6] |= static_cast<xsum_used>(1) << (ix & 0x3f);
-  _lacc->used_used |= static_cast<xsum_used>(1) << (ix >> 6);
+  if (hi - lo < XSUM_WINDOW_EXPS) {
+    xsum_window_place(wacc, lo, hi);
+  } else if (2 * wacc->misses > wacc->adds &&
+             wacc->miss_hi - wacc->miss_lo < XSUM_WINDOW_EXPS) {
+    xsum_window_place(wacc, wacc->miss_lo, wacc->miss_hi);
+  }
 }
 
-inline void xsum_large::add_value_inf_nan(xsum_expint const ix,
-                                          xsum_lchunk const uintv) {
-  if ((ix & XSUM_EXP_MASK) == XSUM_EXP_MASK) {
-    add_inf_nan(uintv);
+/* ADD A VALUE TO CHUNK i OF A WINDOWED ACCUMULATOR WHOSE COUNT IS NEGATIVE
+   after decrementing, because it is the trap chunk, is for Inf or NaN, has not
+   been used yet, or needs to be transferred to the small accumulator. */
+
+static inline void xsum_window_add_value_inf_nan(
+    xsum_window_accumulator *const wacc, int const i, xsum_uint const uintv) {
+  if (i == XSUM_WINDOW_TRAP) {
+    xsum_window_add_outside(wacc, uintv);
+  } else if (((uintv >> XSUM_MANTISSA_BITS) & XSUM_EXP_MASK) ==
+             XSUM_EXP_MASK) {
+    xsum_small_add_inf_nan<xsum_small_accumulator>(&wacc->sacc, uintv);
   } else {
-    add_lchunk_to_small(ix);
-    _lacc->count[ix] -= 1;
-    _lacc->chunk[ix] += uintv;
+    xsum_window_lchunk_to_small(wacc, i);
+    --wacc->count[i];
+    wacc->chunk[i] += uintv;
   }
 }
 
-void xsum_large::add_inf_nan(xsum_int const ivalue) {
-  xsum_int const mantissa = ivalue & XSUM_MANTISSA_MASK;
-
-  /* Inf */
-  if (mantissa == 0) {
-    if (_lacc->sacc.Inf == 0) {
-      /* no previous Inf */
-      _lacc->sacc.Inf = ivalue;
-    } else if (_lacc->sacc.Inf != ivalue) {
-      fpunion u;
-
-      /* previous Inf was opposite sign */
-      u.intv = ivalue;
-
-      /* result will be a NaN */
-      u.fltv = u.fltv - u.fltv;
-
-      _lacc->sacc.Inf = u.intv;
-    }
-  }
-  /* NaN */
-  else {
-    /* Choose the NaN with the bigger payload and clear its sign.  Using <=
-       ensures that we will choose the first NaN over the previous zero. */
-    if ((_lacc->sacc.NaN & XSUM_MANTISSA_MASK) <= mantissa) {
-      _lacc->sacc.NaN = ivalue & ~XSUM_SIGN_MASK;
-    }
+static inline void xsum_window_add1(xsum_window_accumulator *const wacc,
+                                    xsum_uint const uintv) {
+  int const i = xsum_window_index(wacc->base, uintv);
+  int const count = wacc->count[i] - 1;
+  if (count < 0) {
+    xsum_window_add_value_inf_nan(wacc, i, uintv);
+  } else {
+    wacc->count[i] = count;
+    wacc->chunk[i] += uintv;
   }
 }
 
-inline xsum_large_accumulator *xsum_large::get() const noexcept {
-  return _lacc.get();
+template <>
+void xsum_init<xsum_window_accumulator>(xsum_window_accumulator *const wacc) {
+  *wacc = xsum_window_accumulator();
 }
 
-// AUXILLARY
-
 template <>
-int xsum_carry_propagate<xsum_small_accumulator>(
-    xsum_small_accumulator *const sacc) {
-  /* Set u to the index of the uppermost non-zero (for now) chunk, or
-     return with value 0 if there is none. */
-
-  bool found = false;
-  int u = XSUM_SCHUNKS - 1;
-  switch (XSUM_SCHUNKS & 0x3) {
-    case 3: {
-      if (sacc->chunk[u] != 0) {
-        found = true;
-        break;
-      }
-      --u;
-    }
-    case 2: {
-      if (sacc->chunk[u] != 0) {
-        found = true;
-        break;
-      }
-      --u;
-    }
-    case 1: {
-      if (sacc->chunk[u] != 0) {
-        found = true;
-        break;
-      }
-      --u;
-    }
-    case 0:;
-  }
-  do {
-    if (sacc->chunk[u - 3] | sacc->chunk[u - 2] | sacc->chunk[u - 1] |
-        sacc->chunk[u]) {
-      found = true;
-      break;
-    }
-    u -= 4;
-  } while (u >= 0);
+void xsum_add<xsum_window_accumulator>(xsum_window_accumulator *const wacc,
+                                       xsum_flt const value) {
+  fpunion u;
+  u.fltv = value;
+  ++wacc->adds;
+  xsum_window_add1(wacc, u.uintv);
+}
 
-  if (found) {
-    while (sacc->chunk[u] == 0) {
-      --u;
-    }
-  } else {
-    sacc->adds_until_propagate = XSUM_SMALL_CARRY_TERMS - 1;
-    /* Return index of uppermost non-zero chunk. */
-    return 0;
+template <>
+void xsum_add<xsum_window_accumulator>(xsum_window_accumulator *const wacc,
+                                       xsum_flt const *const vec,
+                                       xsum_length const n) {
+  if (n == 0) {
+    return;
   }
 
-  // xsum_schunk c, clow, chigh;
-  // int i, u, uix;
-
-  /* Carry propagate, starting at the low-order chunks.  Note that the
-   loop limit of u may be increased inside the loop. */
+  wacc->adds += n;
 
-  /* indicates that a non-zero chunk has not been found yet */
-  int uix = -1;
+  xsum_flt const *v = vec;
 
-  /* Quickly skip over unused low-order chunks.  Done here at the start
-     on the theory that there are often many unused low-order chunks,
-     justifying some overhead to begin, but later stretches of unused
-     chunks may not be as large. */
-  int i = 0;
-  int const e = u - 3;
-  while (i <= e) {
-    if (sacc->chunk[i] | sacc->chunk[i + 1] | sacc->chunk[i + 2] |
-        sacc->chunk[i + 3]) {
-      break;
-    }
-    i += 4;
-  }
+  /* Unrolled loop processing two values each time around, as for the large
+     accumulator.  Values outside the window map to the trap chunk, whose
+     count is always negative, so they end the inner loop like chunks that
+     need to be processed. */
 
-  xsum_schunk c;
+  fpunion u1;
+  fpunion u2;
 
-  do {
-    /* Find the next non-zero chunk, or break out of loop if there is none. */
-    bool nonzero = false;
+  int count1;
+  int count2;
 
-    do {
-      c = sacc->chunk[i];
-      if (c != 0) {
-        nonzero = true;
-        break;
-      }
-      ++i;
+  int i1;
+  int i2;
 
-      if (i > u) {
-        break;
-      }
+  /* leave out last one or two, terminate when negative, for trick */
+  xsum_length m = n - 3;
+  while (m >= 0) {
+    /* The window may have moved while adding the last two values */
+    xsum_expint const base = wacc->base;
 
-      c = sacc->chunk[i];
-      if (c != 0) {
-        nonzero = true;
-        break;
-      }
-      ++i;
-    } while (i <= u);
+    for (;;) {
+      u1.fltv = *v++;
+      u2.fltv = *v++;
 
-    if (!nonzero) {
-      break;
-    }
+      i1 = xsum_window_index(base, u1.uintv);
+      count1 = wacc->count[i1] - 1;
+      wacc->count[i1] = count1;
+      wacc->chunk[i1] += u1.uintv;
 
-    /* Propagate possible carry from this chunk to next chunk up. */
-    xsum_schunk const chigh = c >> XSUM_LOW_MANTISSA_BITS;
+      i2 = xsum_window_index(base, u2.uintv);
+      count2 = wacc->count[i2] - 1;
+      wacc->count[i2] = count2;
+      wacc->chunk[i2] += u2.uintv;
 
-    if (chigh == 0) {
-      uix = i;
-      ++i;
-      /* no need to change this chunk */
-      continue;
-    }
+      m -= 2;
 
-    if (u == i) {
-      if (chigh == -1) {
-        uix = i;
-        /* don't propagate -1 into the region of all zeros above */
+      /* ... equivalent to while (count1 >= 0 && count2 >= 0 && m >= 0) */
+      if ((static_cast<xsum_length>(count1) | static_cast<xsum_length>(count2) |
+           m) < 0) {
         break;
       }
-
-      /* we will change chunk[u+1], so we'll need to look at it */
-      u = i + 1;
     }
 
-    xsum_schunk const clow = c & XSUM_LOW_MANTISSA_MASK;
-    if (clow != 0) {
-      uix = i;
-    }
+    /* Back out both updates, and add the two values one at a time, since
+       adding the first may move the window. */
 
-    /* We now change chunk[i] and add to chunk[i+1]. Note that i+1 should be
-       in range (no bigger than XSUM_CHUNKS-1) because the number of chunks
-       is big enough to hold any sum, and we do not store redundant chunks
-       with values 0 or -1 above previously non-zero chunks. */
+    if (count1 < 0 || count2 < 0) {
+      wacc->count[i2] = count2 + 1;
+      wacc->chunk[i2] -= u2.uintv;
+      wacc->count[i1] = count1 + 1;
+      wacc->chunk[i1] -= u1.uintv;
 
-    if (xsum_debug && i + 1 >= XSUM_SCHUNKS) {
-      std::abort();
+      xsum_window_add1(wacc, u1.uintv);
+      xsum_window_add1(wacc, u2.uintv);
     }
-    sacc->chunk[i++] = clow;
-    sacc->chunk[i] += chigh;
-  } while (i <= u);
-
-  /* Check again for the number being zero, since carry propagation might
-     have created zero from something that initially looked non-zero. */
-  if (uix < 0) {
-    sacc->adds_until_propagate = XSUM_SMALL_CARRY_TERMS - 1;
-    /* Return index of uppermost non-zero chunk. */
-    return 0;
   }
 
-  /* While the uppermost chunk is negative, with value -1, combine it with
-     the chunk below (if there is one) to produce the same number but with
-     one fewer non-zero chunks. */
+  /* Process the last one or two values. */
 
-  while (sacc->chunk[uix] == -1 && uix > 0) {
-    /* A shift of a negative number is undefined according to the standard, so
-       do a multiply - it's all presumably constant-folded by the compiler. */
-    sacc->chunk[uix--] = 0;
-    sacc->chunk[uix] += static_cast<xsum_schunk>(-1) *
-                        (static_cast<xsum_schunk>(1) << XSUM_LOW_MANTISSA_BITS);
+  for (m += 3; m > 0; --m) {
+    u1.fltv = *v++;
+    xsum_window_add1(wacc, u1.uintv);
   }
+}
 
-  /* We can now add one less than the total allowed terms before the
-   next carry propagate. */
-  sacc->adds_until_propagate = XSUM_SMALL_CARRY_TERMS - 1;
+template <>
+void xsum_add<xsum_window_accumulator>(xsum_window_accumulator *const wacc,
+                                       std::vector<xsum_flt> const &vec) {
+  xsum_add<xsum_window_accumulator>(wacc, vec.data(),
+                                    static_cast<xsum_length>(vec.size()));
+}
 
-  /* Return index of uppermost non-zero chunk. */
-  return uix;
+template <>
+void xsum_add<xsum_window_accumulator>(
+    xsum_window_accumulator *const wacc,
+    xsum_small_accumulator const *const value) {
+  xsum_add<xsum_small_accumulator>(&wacc->sacc, value);
 }
 
 template <>
-inline void xsum_small_add_inf_nan<xsum_small_accumulator>(
-    xsum_small_accumulator *const sacc, xsum_int const ivalue) {
-  xsum_int const mantissa = ivalue & XSUM_MANTISSA_MASK;
+xsum_small_accumulator *xsum_round_to_small_ptr<xsum_window_accumulator>(
+    xsum_window_accumulator *const wacc) {
+  xsum_window_flush(wacc);
+  return &wacc->sacc;
+}
 
-  /* Inf */
-  if (mantissa == 0) {
-    /* no previous Inf */
-    if (sacc->Inf == 0) {
-      sacc->Inf = ivalue;
-    }
-    /* previous Inf was opposite sign */
-    else if (sacc->Inf != ivalue) {
-      fpunion u;
-      u.intv = ivalue;
+template <>
+xsum_small_accumulator xsum_round_to_small<xsum_window_accumulator>(
+    xsum_window_accumulator *const wacc) {
+  return *xsum_round_to_small_ptr<xsum_window_accumulator>(wacc);
+}
 
-      /* result will be a NaN */
-      u.fltv = u.fltv - u.fltv;
+template <>
+void xsum_add<xsum_window_accumulator>(xsum_window_accumulator *const wacc,
+                                       xsum_window_accumulator *const value) {
+  xsum_add<xsum_window_accumulator>(
+      wacc, xsum_round_to_small_ptr<xsum_window_accumulator>(value));
+}
 
-      sacc->Inf = u.intv;
+/* SQUARED NORMS AND DOT PRODUCTS.  The squares or products are computed a
+   block at a time into a buffer that stays in cache, and added with the vector
+   add function. */
+
+template <>
+void xsum_add_sqnorm<xsum_window_accumulator>(
+    xsum_window_accumulator *const wacc, xsum_flt const *const vec,
+    xsum_length const n) {
+  xsum_flt sq[XSUM_WINDOW_BLOCK];
+  xsum_flt const *v = vec;
+  for (xsum_length i = 0; i < n; i += XSUM_WINDOW_BLOCK) {
+    xsum_length const m = std::min<xsum_length>(n - i, XSUM_WINDOW_BLOCK);
+    for (xsum_length j = 0; j < m; ++j, ++v) {
+      sq[j] = *v * *v;
     }
+    xsum_add<xsum_window_accumulator>(wacc, sq, m);
   }
-  /* NaN */
-  else {
-    /* Choose the NaN with the bigger payload and clear its sign. Using <=
-       ensures that we will choose the first NaN over the previous zero. */
-    if ((sacc->NaN & XSUM_MANTISSA_MASK) <= mantissa) {
-      sacc->NaN = ivalue & ~XSUM_SIGN_MASK;
+}
+
+template <>
+void xsum_add_sqnorm<xsum_window_accumulator>(
+    xsum_window_accumulator *const wacc, std::vector<xsum_flt> const &vec) {
+  xsum_add_sqnorm<xsum_window_accumulator>(
+      wacc, vec.data(), static_cast<xsum_length>(vec.size()));
+}
+
+template <>
+void xsum_add_dot<xsum_window_accumulator>(xsum_window_accumulator *const wacc,
+                                           xsum_flt const *const vec1,
+                                           xsum_flt const *const vec2,
+                                           xsum_length const n) {
+  xsum_flt pr[XSUM_WINDOW_BLOCK];
+  xsum_flt const *v1 = vec1;
+  xsum_flt const *v2 = vec2;
+  for (xsum_length i = 0; i < n; i += XSUM_WINDOW_BLOCK) {
+    xsum_length const m = std::min<xsum_length>(n - i, XSUM_WINDOW_BLOCK);
+    for (xsum_length j = 0; j < m; ++j, ++v1, ++v2) {
+      pr[j] = *v1 * *v2;
     }
+    xsum_add<xsum_window_accumulator>(wacc, pr, m);
   }
 }
 
 template <>
-inline void xsum_add_no_carry<xsum_small_accumulator>(
-    xsum_small_accumulator *const sacc, xsum_flt const value) {
-  /* Extract exponent and mantissa. */
+void xsum_add_dot<xsum_window_accumulator>(
+    xsum_window_accumulator *const wacc, std::vector<xsum_flt> const &vec1,
+    std::vector<xsum_flt> const &vec2) {
+  xsum_length const n = static_cast<xsum_length>(vec1.size());
+  if (n == 0 || n > static_cast<xsum_length>(vec2.size())) {
+    return;
+  }
+  xsum_add_dot<xsum_window_accumulator>(wacc, vec1.data(), vec2.data(), n);
+}
+
+template <>
+xsum_flt xsum_round<xsum_window_accumulator>(
+    xsum_window_accumulator *const wacc) {
+  return xsum_round<xsum_small_accumulator>(
+      xsum_round_to_small_ptr<xsum_window_accumulator>(wacc));
+}
+
+/* BINNED ACCUMULATOR */
+
+/* Adding 1.5 * 2^52 and subtracting it again rounds a value below 2^51 in
+   magnitude to an integer, with ties to even.  With 1.5 * 2^(52 + width), it
+   rounds to a multiple of 2^width. */
+static constexpr xsum_flt XSUM_BIN_ROUND = 6755399441055744.0;
+static constexpr xsum_flt XSUM_BIN_CARRY_ROUND =
+    XSUM_BIN_ROUND * static_cast<xsum_flt>(1LL << XSUM_BIN_WIDTH);
+
+/* EXPONENT OF THE UNIT OF BIN b.  Bins below 0 are only used by the lower
+   folds. */
+static inline int xsum_bin_exp(int const b) {
+  return XSUM_BIN_MIN_EXP + b * XSUM_BIN_WIDTH;
+}
+
+/* BIN OF THE FIRST FOLD FOR A VALUE WITH BIASED EXPONENT exp.  The value is
+   at most 2^(XSUM_BIN_WIDTH - 1) units of this bin, half what the bin could
+   take, so that it rounds to zero in the last fold of any bin higher than
+   the folds it was added to. */
+static inline int xsum_bin_index(xsum_expint const exp) {
+  return exp / XSUM_BIN_WIDTH;
+}
+
+/* 2^exp, for exp the exponent of a normalized number. */
+static inline xsum_flt xsum_bin_pow2(int const exp) {
   fpunion u;
-  u.fltv = value;
+  u.uintv = static_cast<xsum_uint>(exp + XSUM_EXP_BIAS) << XSUM_MANTISSA_BITS;
+  return u.fltv;
+}
 
-  xsum_int const ivalue = u.intv;
-  xsum_int mantissa = ivalue & XSUM_MANTISSA_MASK;
-  xsum_expint exp = (ivalue >> XSUM_MANTISSA_BITS) & XSUM_EXP_MASK;
+/* MOVE THE FIRST FOLD OF A BINNED ACCUMULATOR UP TO BIN index.  The folds that
+   fall below the last one are dropped.  Their parts would have been rounded
+   off had the value that raised the index come first: the last fold rounds
+   the remainder just as a lower fold does, and a value that was only in
+   dropped folds is too small to round to anything but zero in the new
+   folds. */
+static void xsum_binned_raise(xsum_binned_accumulator *const bacc,
+                              int const index) {
+  int const s = index - bacc->index;
+  for (int k = bacc->fold - 1; k >= 0; --k) {
+    bacc->primary[k] = k >= s ? bacc->primary[k - s] : 0;
+    bacc->carry[k] = k >= s ? bacc->carry[k - s] : 0;
+  }
+  bacc->index = index;
+}
 
-  /* Categorize number as normal, denormalized, or Inf/NaN according to
-     the value of the exponent field. */
+/* TAKE THE CARRIES OUT OF THE PRIMARIES OF A BINNED ACCUMULATOR.  Leaves each
+   primary at most 2^(XSUM_BIN_WIDTH - 1) in magnitude, so that it can take
+   XSUM_BIN_ENDURANCE more parts of at most 2^XSUM_BIN_WIDTH before it could
+   reach 2^53.  How a sum is split between the primary and the carry does not
+   change its value. */
+static void xsum_binned_renorm(xsum_binned_accumulator *const bacc) {
+  xsum_flt const unit = xsum_bin_pow2(-XSUM_BIN_WIDTH);
+  for (int k = 0; k < bacc->fold; ++k) {
+    xsum_flt const hi =
+        (bacc->primary[k] + XSUM_BIN_CARRY_ROUND) - XSUM_BIN_CARRY_ROUND;
+    bacc->carry[k] += static_cast<xsum_int>(hi * unit);
+    bacc->primary[k] -= hi;
+  }
+  bacc->adds_until_renorm = XSUM_BIN_ENDURANCE;
+}
 
-  /* normalized */
-  /* OR in implicit 1 bit at top of mantissa */
-  if (exp != 0 && exp != XSUM_EXP_MASK) {
-    mantissa |= static_cast<xsum_int>(1) << XSUM_MANTISSA_BITS;
+/* ADD n FINITE VALUES TO THE K FOLDS OF A BINNED ACCUMULATOR, all at most
+   2^(XSUM_BIN_WIDTH - 1) units of the bin of its first fold, with n no more
+   than the adds left before the carries must be taken out.  The values are
+   scaled so that the unit of the first fold is 1.  In each fold but the last,
+   the value is rounded to an integer, which is added to the fold, and what is
+   left is scaled to the unit of the next fold.  The last fold only takes the
+   rounded remainder.  Two sets of sums are kept to overlap the additions.
+   They hold integers below 2^53, so adding them up at the end is exact.
+   Values below a quarter of the unit of the last fold round to zero in every
+   fold, and are replaced by zero before they are scaled, since scaling them
+   could give denormalized numbers, which are slow on many processors. */
+template <int K>
+static void xsum_binned_deposit(xsum_binned_accumulator *const bacc,
+                                xsum_flt const *const vec,
+                                xsum_length const n) {
+  int const exp = xsum_bin_exp(bacc->index);
+  int const tiny_exp = exp - (K - 1) * XSUM_BIN_WIDTH - 2;
+  xsum_flt const tiny =
+      tiny_exp >= XSUM_BIN_MIN_EXP ? xsum_bin_pow2(tiny_exp) : 0;
+  xsum_flt const scale = xsum_bin_pow2(-exp);
+  xsum_flt const width = xsum_bin_pow2(XSUM_BIN_WIDTH);
+
+  xsum_flt p1[K] = {};
+  xsum_flt p2[K] = {};
+
+  xsum_length i = 0;
+  for (; i + 1 < n; i += 2) {
+    xsum_flt y1 = (std::fabs(vec[i]) < tiny ? 0 : vec[i]) * scale;
+    xsum_flt y2 = (std::fabs(vec[i + 1]) < tiny ? 0 : vec[i + 1]) * scale;
+    for (int k = 0; k < K - 1; ++k) {
+      xsum_flt const d1 = (y1 + XSUM_BIN_ROUND) - XSUM_BIN_ROUND;
+      xsum_flt const d2 = (y2 + XSUM_BIN_ROUND) - XSUM_BIN_ROUND;
+      p1[k] += d1;
+      p2[k] += d2;
+      y1 = (y1 - d1) * width;
+      y2 = (y2 - d2) * width;
+    }
+    p1[K - 1] += (y1 + XSUM_BIN_ROUND) - XSUM_BIN_ROUND;
+    p2[K - 1] += (y2 + XSUM_BIN_ROUND) - XSUM_BIN_ROUND;
+  }
+  if (i < n) {
+    xsum_flt y1 = (std::fabs(vec[i]) < tiny ? 0 : vec[i]) * scale;
+    for (int k = 0; k < K - 1; ++k) {
+      xsum_flt const d1 = (y1 + XSUM_BIN_ROUND) - XSUM_BIN_ROUND;
+      p1[k] += d1;
+      y1 = (y1 - d1) * width;
+    }
+    p1[K - 1] += (y1 + XSUM_BIN_ROUND) - XSUM_BIN_ROUND;
+  }
+
+  for (int k = 0; k < K; ++k) {
+    bacc->primary[k] += p1[k] + p2[k];
   }
-  /* zero or denormalized */
-  /* If it's a zero (positive or negative), we do nothing. */
-  else if (exp == 0) {
-    if (mantissa == 0) {
-      return;
+}
+
+/* ADD A BLOCK OF AT MOST XSUM_BIN_BLOCK VALUES TO A BINNED ACCUMULATOR.  The
+   largest exponent in the block is found first, so the first fold is moved
+   at most once, and the values are then added without checks.  A block with
+   an Inf or NaN is added one value at a time. */
+static void xsum_binned_add_block(xsum_binned_accumulator *const bacc,
+                                  xsum_flt const *const vec,
+                                  xsum_length const n) {
+  xsum_int imax = 0;
+  for (xsum_length i = 0; i < n; ++i) {
+    fpunion u;
+    u.fltv = vec[i];
+    imax = std::max(imax, static_cast<xsum_int>(u.uintv & ~XSUM_SIGN_MASK));
+  }
+  xsum_expint const exp = static_cast<xsum_expint>(imax >> XSUM_MANTISSA_BITS);
+
+  if (exp == XSUM_EXP_MASK) {
+    for (xsum_length i = 0; i < n; ++i) {
+      fpunion u;
+      u.fltv = vec[i];
+      if (((u.uintv >> XSUM_MANTISSA_BITS) & XSUM_EXP_MASK) == XSUM_EXP_MASK) {
+        xsum_add_inf_nan_fields(&bacc->Inf, &bacc->NaN, u.intv);
+      } else {
+        xsum_binned_add_block(bacc, vec + i, 1);
+      }
     }
-    /* Denormalized mantissa has no implicit 1, but exponent is 1 not 0. */
-    exp = 1;
-  }
-  /* Inf or NaN */
-  /* Just update flags in accumulator structure. */
-  else {
-    xsum_small_add_inf_nan<xsum_small_accumulator>(sacc, ivalue);
     return;
   }
 
-  /* Separate high part of exponent, used as index of chunk, and low
-     part of exponent, giving position within chunk. */
+  int const index = xsum_bin_index(exp);
+  if (index > bacc->index) {
+    xsum_binned_raise(bacc, index);
+  }
 
-  xsum_expint const low_exp = exp & XSUM_LOW_EXP_MASK;
-  xsum_expint const high_exp = exp >> XSUM_LOW_EXP_BITS;
+  if (bacc->adds_until_renorm < n) {
+    xsum_binned_renorm(bacc);
+  }
+  bacc->adds_until_renorm -= n;
 
-  xsum_schunk *chunk_ptr = sacc->chunk + high_exp;
+  switch (bacc->fold) {
+    case 1:
+      xsum_binned_deposit<1>(bacc, vec, n);
+      break;
+    case 2:
+      xsum_binned_deposit<2>(bacc, vec, n);
+      break;
+    case 3:
+      xsum_binned_deposit<3>(bacc, vec, n);
+      break;
+    default:
+      xsum_binned_deposit<XSUM_BIN_MAX_FOLD>(bacc, vec, n);
+      break;
+  }
+}
 
-  xsum_schunk const chunk0 = chunk_ptr[0];
-  xsum_schunk const chunk1 = chunk_ptr[1];
+/* PRE-FETCH THE BLOCK dist VALUES AHEAD OF BLOCK i OF vec, as far as it is
+   inside the n values of vec, one cache line at a time. */
+static inline void xsum_binned_prefetch(xsum_flt const *const vec,
+                                        xsum_length const i,
+                                        xsum_length const n, int const dist,
+                                        bool const stream) {
+  if (dist > 0) {
+    xsum_length const end = std::min<xsum_length>(n, i + dist + XSUM_BIN_BLOCK);
+    for (xsum_length j = i + dist; j < end; j += 64 / sizeof(xsum_flt)) {
+      xsum_prefetch(vec + j, stream);
+    }
+  }
+}
 
-  /* Separate mantissa into two parts, after shifting, and add to (or
-     subtract from) this chunk and the next higher chunk (which always
-     exists since there are three extra ones at the top). */
-  xsum_int const low_mantissa =
-      (static_cast<xsum_uint>(mantissa) << low_exp) & XSUM_LOW_MANTISSA_MASK;
-  xsum_int const high_mantissa = mantissa >> (XSUM_LOW_MANTISSA_BITS - low_exp);
+template <>
+void xsum_init<xsum_binned_accumulator>(xsum_binned_accumulator *const bacc) {
+  *bacc = xsum_binned_accumulator(bacc->fold);
+}
 
-  /* Add or subtract to or from the two affected chunks. */
-  if (ivalue < 0) {
-    chunk_ptr[0] = chunk0 - low_mantissa;
-    chunk_ptr[1] = chunk1 - high_mantissa;
-  } else {
-    chunk_ptr[0] = chunk0 + low_mantissa;
-    chunk_ptr[1] = chunk1 + high_mantissa;
+template <>
+void xsum_add<xsum_binned_accumulator>(xsum_binned_accumulator *const bacc,
+                                       xsum_flt const value) {
+  xsum_binned_add_block(bacc, &value, 1);
+}
+
+template <>
+void xsum_add<xsum_binned_accumulator>(xsum_binned_accumulator *const bacc,
+                                       xsum_flt const *const vec,
+                                       xsum_length const n) {
+  bool const stream =
+      XSUM_STREAM_THRESHOLD > 0 && n >= XSUM_STREAM_THRESHOLD;
+  for (xsum_length i = 0; i < n; i += XSUM_BIN_BLOCK) {
+    xsum_binned_prefetch(vec, i, n, XSUM_PREFETCH_ADD, stream);
+    xsum_binned_add_block(bacc, vec + i,
+                          std::min<xsum_length>(n - i, XSUM_BIN_BLOCK));
   }
 }
 
 template <>
-inline void xsum_add_no_carry<xsum_small_accumulator>(
-    xsum_small_accumulator *const sacc,
-    xsum_small_accumulator const *const value) {
+void xsum_add<xsum_binned_accumulator>(xsum_binned_accumulator *const bacc,
+                                       std::vector<xsum_flt> const &vec) {
+  xsum_add<xsum_binned_accumulator>(bacc, vec.data(),
+                                    static_cast<xsum_length>(vec.size()));
+}
+
+/* ADD A BINNED ACCUMULATOR TO ANOTHER.  The sum keeps the smaller of the two
+   numbers of folds, and the higher of the two first bins, which gives the
+   same bins as adding all the values to one accumulator with that number of
+   folds.  As for the small accumulator, nothing more is added once there is
+   an Inf or NaN. */
+template <>
+void xsum_add<xsum_binned_accumulator>(xsum_binned_accumulator *const bacc,
+                                       xsum_binned_accumulator *const value) {
   if (value->Inf != 0) {
-    /* no previous Inf */
-    if (sacc->Inf == 0) {
-      sacc->Inf = value->Inf;
-    }
-    /* previous Inf had opposite sign */
-    else if (sacc->Inf != value->Inf) {
+    if (bacc->Inf == 0) {
+      bacc->Inf = value->Inf;
+    } else if (bacc->Inf != value->Inf) {
       fpunion u;
       u.intv = value->Inf;
-
-      /* result will be a NaN */
       u.fltv = u.fltv - u.fltv;
-
-      sacc->Inf = u.intv;
+      bacc->Inf = u.intv;
     }
     return;
   }
-  if (value->NaN != 0 || sacc->NaN != 0) {
-    if (value->NaN != 0) {
-      if ((sacc->NaN & XSUM_MANTISSA_MASK) <
-          (value->NaN & XSUM_MANTISSA_MASK)) {
-        sacc->NaN = value->NaN;
-      }
+  if (value->NaN != 0 || bacc->NaN != 0) {
+    if ((bacc->NaN & XSUM_MANTISSA_MASK) < (value->NaN & XSUM_MANTISSA_MASK)) {
+      bacc->NaN = value->NaN;
     }
     return;
   }
-  xsum_schunk *sacc_chunk = sacc->chunk;
-  xsum_schunk const *const value_chunk = value->chunk;
-  for (int i = 0; i < XSUM_SCHUNKS; ++i) {
-    sacc_chunk[i] += value_chunk[i];
-  }
-}
 
-template <>
-inline void xsum_add_no_carry<xsum_small_accumulator>(
-    xsum_small_accumulator *const sacc, xsum_flt const *const vec,
-    xsum_length const n) {
-  xsum_flt const *const f = vec;
-  for (int i = 0; i < n - 1; ++i) {
-    xsum_flt const g = f[i];
-    xsum_add_no_carry<xsum_small_accumulator>(sacc, g);
+  xsum_binned_accumulator v = *value;
+  v.fold = bacc->fold = std::min(bacc->fold, value->fold);
+  xsum_binned_renorm(&v);
+  xsum_binned_renorm(bacc);
+  if (v.index > bacc->index) {
+    xsum_binned_raise(bacc, v.index);
+  } else if (bacc->index > v.index) {
+    xsum_binned_raise(&v, bacc->index);
   }
-}
-
-template <>
-inline void xsum_add_no_carry<xsum_small_accumulator>(
-    xsum_small_accumulator *const sacc, xsum_small_accumulator const *const vec,
-    xsum_length const n) {
-  xsum_small_accumulator const *const f = vec;
-  for (int i = 0; i < n - 1; ++i) {
-    xsum_add_no_carry<xsum_small_accumulator>(sacc, &f[i]);
+  for (int k = 0; k < bacc->fold; ++k) {
+    bacc->primary[k] += v.primary[k];
+    bacc->carry[k] += v.carry[k];
   }
+  --bacc->adds_until_renorm;
 }
 
+/* SQUARED NORMS AND DOT PRODUCTS.  The squares or products are computed a
+   block at a time, and added as a block. */
+
 template <>
-inline void xsum_add_sqnorm_no_carry<xsum_small_accumulator>(
-    xsum_small_accumulator *const sacc, xsum_flt const *const vec,
+void xsum_add_sqnorm<xsum_binned_accumulator>(
+    xsum_binned_accumulator *const bacc, xsum_flt const *const vec,
     xsum_length const n) {
+  bool const stream =
+      XSUM_STREAM_THRESHOLD > 0 && n >= XSUM_STREAM_THRESHOLD;
+  xsum_flt sq[XSUM_BIN_BLOCK];
   xsum_flt const *v = vec;
-  for (xsum_length i = 0; i < n - 1; ++i, ++v) {
-    xsum_flt const f = *v;
-    xsum_flt const g = f * f;
-    xsum_add_no_carry<xsum_small_accumulator>(sacc, g);
+  for (xsum_length i = 0; i < n; i += XSUM_BIN_BLOCK) {
+    xsum_length const m = std::min<xsum_length>(n - i, XSUM_BIN_BLOCK);
+    xsum_binned_prefetch(vec, i, n, XSUM_PREFETCH_SQNORM, stream);
+    for (xsum_length j = 0; j < m; ++j, ++v) {
+      sq[j] = *v * *v;
+    }
+    xsum_binned_add_block(bacc, sq, m);
   }
 }
 
 template <>
-inline void xsum_add_dot_no_carry<xsum_small_accumulator>(
-    xsum_small_accumulator *const sacc, xsum_flt const *const vec1,
-    xsum_flt const *const vec2, xsum_length const n) {
-  xsum_flt const *v1 = vec1;
-  xsum_flt const *v2 = vec2;
-  for (xsum_length i = 0; i < n - 1; ++i, ++v1, ++v2) {
-    xsum_flt const f1 = *v1;
-    xsum_flt const f2 = *v2;
-    xsum_flt const g = f1 * f2;
-    xsum_add_no_carry<xsum_small_accumulator>(sacc, g);
-  }
+void xsum_add_sqnorm<xsum_binned_accumulator>(
+    xsum_binned_accumulator *const bacc, std::vector<xsum_flt> const &vec) {
+  xsum_add_sqnorm<xsum_binned_accumulator>(
+      bacc, vec.data(), static_cast<xsum_length>(vec.size()));
 }
 
 template <>
-void xsum_init<xsum_small_accumulator>(xsum_small_accumulator *const sacc) {
-  std::fill(sacc->chunk, sacc->chunk + XSUM_SCHUNKS, 0);
-  sacc->Inf = 0;
-  sacc->NaN = 0;
-  sacc->adds_until_propagate = XSUM_SMALL_CARRY_TERMS;
+void xsum_add_dot<xsum_binned_accumulator>(xsum_binned_accumulator *const bacc,
+                                           xsum_flt const *const vec1,
+                                           xsum_flt const *const vec2,
+                                           xsum_length const n) {
+  bool const stream =
+      XSUM_STREAM_THRESHOLD > 0 && n >= XSUM_STREAM_THRESHOLD;
+  xsum_flt pr[XSUM_BIN_BLOCK];
+  xsum_flt const *v1 = vec1;
+  xsum_flt const *v2 = vec2;
+  for (xsum_length i = 0; i < n; i += XSUM_BIN_BLOCK) {
+    xsum_length const m = std::min<xsum_length>(n - i, XSUM_BIN_BLOCK);
+    xsum_binned_prefetch(vec1, i, n, XSUM_PREFETCH_DOT, stream);
+    xsum_binned_prefetch(vec2, i, n, XSUM_PREFETCH_DOT, stream);
+    for (xsum_length j = 0; j < m; ++j, ++v1, ++v2) {
+      pr[j] = *v1 * *v2;
+    }
+    xsum_binned_add_block(bacc, pr, m);
+  }
 }
 
 template <>
-void xsum_init<xsum_large_accumulator>(xsum_large_accumulator *const lacc) {
-  std::fill(lacc->count, lacc->count + XSUM_LCHUNKS, -1);
-  std::fill(lacc->chunks_used, lacc->chunks_used + XSUM_LCHUNKS / 64, 0);
-  lacc->used_used = 0;
-  std::fill(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS, 0);
-  lacc->sacc.Inf = 0;
-  lacc->sacc.NaN = 0;
-  lacc->sacc.adds_until_propagate = XSUM_SMALL_CARRY_TERMS;
+void xsum_add_dot<xsum_binned_accumulator>(
+    xsum_binned_accumulator *const bacc, std::vector<xsum_flt> const &vec1,
+    std::vector<xsum_flt> const &vec2) {
+  xsum_length const n = static_cast<xsum_length>(vec1.size());
+  if (n == 0 || n > static_cast<xsum_length>(vec2.size())) {
+    return;
+  }
+  xsum_add_dot<xsum_binned_accumulator>(bacc, vec1.data(), vec2.data(), n);
 }
 
+/* ROUND A BINNED ACCUMULATOR.  The primaries and carries are added exactly to
+   a small accumulator, as doubles that are exact: the carries are split in
+   two 32-bit halves, and parts in bins below the smallest denormal are
+   multiples of it, since the values are.  When the first bin is above 2^0,
+   everything is first scaled down so that its unit is 1, which keeps the
+   parts finite.  The result is then at least 2^-120, so scaling it back does
+   not round it again. */
 template <>
-void xsum_add<xsum_small_accumulator>(xsum_small_accumulator *const sacc,
-                                      xsum_flt const value) {
-  if (sacc->adds_until_propagate == 0) {
-    xsum_carry_propagate<xsum_small_accumulator>(sacc);
+xsum_flt xsum_round<xsum_binned_accumulator>(
+    xsum_binned_accumulator *const bacc) {
+  fpunion u;
+  if (bacc->NaN != 0) {
+    u.intv = bacc->NaN;
+    return u.fltv;
+  }
+  if (bacc->Inf != 0) {
+    u.intv = bacc->Inf;
+    return u.fltv;
   }
 
-  xsum_add_no_carry<xsum_small_accumulator>(sacc, value);
+  int const scale = std::max(xsum_bin_exp(bacc->index), 0);
 
-  --sacc->adds_until_propagate;
+  xsum_small_accumulator sacc;
+  for (int k = 0; k < bacc->fold; ++k) {
+    int const exp = xsum_bin_exp(bacc->index - k) - scale;
+    xsum_int const c = bacc->carry[k];
+    xsum_add<xsum_small_accumulator>(&sacc, std::ldexp(bacc->primary[k], exp));
+    xsum_add<xsum_small_accumulator>(
+        &sacc, std::ldexp(static_cast<xsum_flt>(c >> 32),
+                          exp + XSUM_BIN_WIDTH + 32));
+    xsum_add<xsum_small_accumulator>(
+        &sacc, std::ldexp(static_cast<xsum_flt>(c & 0xffffffff),
+                          exp + XSUM_BIN_WIDTH));
+  }
+  return std::ldexp(xsum_round<xsum_small_accumulator>(&sacc), scale);
 }
 
-template <>
-inline void xsum_add_lchunk_to_small<xsum_large_accumulator>(
-    xsum_large_accumulator *const lacc, xsum_expint const ix) {
-  // xsum_expint exp, low_exp, high_exp;
-  // xsum_uint low_chunk, mid_chunk, high_chunk;
-  // xsum_lchunk chunk;
+#ifdef __SIZEOF_INT128__
+/* ACCUMULATORS WITH 128-BIT CHUNKS */
 
-  xsum_expint const count = lacc->count[ix];
+/* PROPAGATE CARRIES IN A SMALL ACCUMULATOR WITH 128-BIT CHUNKS.  Every chunk
+   but the top one is left in [0, 2^32), and the top one takes the rest, which
+   is then far less than 2^63, so that all of them fit in the chunks of a small
+   accumulator.  Returns the index of the uppermost non-zero chunk, or 0 if
+   there is none. */
 
-  /* Add to the small accumulator only if the count is not -1, which
-     indicates a chunk that contains nothing yet. */
-  if (count >= 0) {
-    /* Propagate carries in the small accumulator if necessary. */
-    if (lacc->sacc.adds_until_propagate == 0) {
-      xsum_carry_propagate<xsum_small_accumulator>(&lacc->sacc);
+template <>
+int xsum_carry_propagate<xsum_small128_accumulator>(
+    xsum_small128_accumulator *const sacc) {
+  int u = 0;
+  xsum_schunk128 carry = 0;
+  for (int i = 0; i < XSUM_SCHUNKS - 1; ++i) {
+    xsum_schunk128 const c = sacc->chunk[i] + carry;
+    carry = c >> XSUM_LOW_MANTISSA_BITS;
+    sacc->chunk[i] = c & XSUM_LOW_MANTISSA_MASK;
+    if (sacc->chunk[i] != 0) {
+      u = i;
     }
+  }
+  sacc->chunk[XSUM_SCHUNKS - 1] += carry;
+  if (sacc->chunk[XSUM_SCHUNKS - 1] != 0) {
+    u = XSUM_SCHUNKS - 1;
+  }
 
-    /* Get the chunk we will add.  Note that this chunk is the integer sum
-       of entire 64-bit floating-point representations, with sign, exponent,
-       and mantissa, but we want only the sum of the mantissas. */
-    xsum_lchunk chunk = lacc->chunk[ix];
+  sacc->adds_until_propagate = XSUM_SMALL128_CARRY_TERMS;
 
-    /* If we added the maximum number of values to 'chunk', the sum of
-       the sign and exponent parts (all the same, equal to the index) will
-       have overflowed out the top, leaving only the sum of the mantissas.
-       If the count of how many more terms we could have summed is greater
-       than zero, we therefore add this count times the index (shifted to
-       the position of the sign and exponent) to get the unwanted bits to
-       overflow out the top. */
-    if (count > 0) {
-      chunk += static_cast<xsum_lchunk>(count * ix) << XSUM_MANTISSA_BITS;
-    }
+  return u;
+}
 
-    /* Find the exponent for this chunk from the low bits of the index,
-       and split it into low and high parts, for accessing the small
-       accumulator.  Noting that for denormalized numbers where the
-       exponent part is zero, the actual exponent is 1 (before subtracting
-       the bias), not zero. */
+template <>
+inline void xsum_small_add_inf_nan<xsum_small128_accumulator>(
+    xsum_small128_accumulator *const sacc, xsum_int const ivalue) {
+  xsum_add_inf_nan_fields(&sacc->Inf, &sacc->NaN, ivalue);
+}
 
-    xsum_expint low_exp;
-    xsum_expint high_exp;
+/* ADD A VECTOR OF FLOATING-POINT NUMBERS TO A SMALL ACCUMULATOR WITH 128-BIT
+   CHUNKS, WITHOUT CARRIES.  As for the small accumulator, but all n values are
+   added here, and the # of values must not be more than adds_until_propagate.
+ */
 
-    xsum_expint const exp = ix & XSUM_EXP_MASK;
-    if (exp == 0) {
-      low_exp = 1;
-      high_exp = 0;
-    } else {
-      low_exp = exp & XSUM_LOW_EXP_MASK;
-      high_exp = exp >> XSUM_LOW_EXP_BITS;
-    }
+static void xsum_small128_add_no_carry(xsum_small128_accumulator *const sacc,
+                                       xsum_flt const *const vec,
+                                       xsum_length const n) {
+  xsum_schunk128 chunk2[XSUM_SCHUNKS] = {};
+  xsum_int special = 0;
 
-    /* Split the mantissa into three parts, for three consecutive chunks in
-       the small accumulator.  Except for denormalized numbers, add in the sum
-       of all the implicit 1 bits that are above the actual mantissa bits. */
-    xsum_uint const low_chunk = (chunk << low_exp) & XSUM_LOW_MANTISSA_MASK;
-    xsum_uint mid_chunk = chunk >> (XSUM_LOW_MANTISSA_BITS - low_exp);
+  fpunion u1;
+  fpunion u2;
+  fpunion u3;
+  fpunion u4;
 
-    /* normalized */
-    if (exp != 0) {
-      mid_chunk += static_cast<xsum_lchunk>((1 << XSUM_LCOUNT_BITS) - count)
-                   << (XSUM_MANTISSA_BITS - XSUM_LOW_MANTISSA_BITS + low_exp);
-    }
+  xsum_flt const *v = vec;
+  xsum_flt const *const e = vec + n;
 
-    xsum_uint const high_chunk = mid_chunk >> XSUM_LOW_MANTISSA_BITS;
-    mid_chunk &= XSUM_LOW_MANTISSA_MASK;
+  for (; v + 4 <= e; v += 4) {
+    u1.fltv = v[0];
+    u2.fltv = v[1];
+    u3.fltv = v[2];
+    u4.fltv = v[3];
+    xsum_small_add_branchless(sacc->chunk, u1.intv, special);
+    xsum_small_add_branchless(chunk2, u2.intv, special);
+    xsum_small_add_branchless(sacc->chunk, u3.intv, special);
+    xsum_small_add_branchless(chunk2, u4.intv, special);
+  }
+  for (; v < e; ++v) {
+    u1.fltv = *v;
+    xsum_small_add_branchless(sacc->chunk, u1.intv, special);
+  }
 
-    /* Add or subtract the three parts of the mantissa from three small
-       accumulator chunks, according to the sign that is part of the index. */
+  for (int i = 0; i < XSUM_SCHUNKS; ++i) {
+    sacc->chunk[i] += chunk2[i];
+  }
 
-    if (ix & (1 << XSUM_EXP_BITS)) {
-      lacc->sacc.chunk[high_exp] -= low_chunk;
-      lacc->sacc.chunk[high_exp + 1] -= mid_chunk;
-      lacc->sacc.chunk[high_exp + 2] -= high_chunk;
-    } else {
-      lacc->sacc.chunk[high_exp] += low_chunk;
-      lacc->sacc.chunk[high_exp + 1] += mid_chunk;
-      lacc->sacc.chunk[high_exp + 2] += high_chunk;
+  if (special) {
+    for (v = vec; v < e; ++v) {
+      u1.fltv = *v;
+      if (((u1.intv >> XSUM_MANTISSA_BITS) & XSUM_EXP_MASK) == XSUM_EXP_MASK) {
+        xsum_small_add_inf_nan<xsum_small128_accumulator>(sacc, u1.intv);
+      }
     }
-
-    /* The above additions/subtractions reduce by one the number we can
-       do before we need to do carry propagation again. */
-    --lacc->sacc.adds_until_propagate;
   }
+}
 
-  /* We now clear the chunk to zero, and set the count to the number
-     of adds we can do before the mantissa would overflow.  We also
-     set the bit in chunks_used to indicate that this chunk is in use
-     (if that is enabled). */
+/* ADD SQUARES OR PRODUCTS TO AN ACCUMULATOR WITH 128-BIT CHUNKS.  They are
+   computed a block at a time into a buffer that stays in cache, and added with
+   the vector add function. */
 
-  lacc->chunk[ix] = 0;
-  lacc->count[ix] = 1 << XSUM_LCOUNT_BITS;
-  lacc->chunks_used[ix >> 6] |= static_cast<xsum_used>(1) << (ix & 0x3f);
-  lacc->used_used |= static_cast<xsum_used>(1) << (ix >> 6);
+template <typename accumulatorType>
+static void xsum_add_products128(accumulatorType *const acc,
+                                 xsum_flt const *const vec1,
+                                 xsum_flt const *const vec2,
+                                 xsum_length const n) {
+  xsum_flt pr[XSUM_BLOCK128];
+  xsum_flt const *v1 = vec1;
+  xsum_flt const *v2 = vec2;
+  for (xsum_length i = 0; i < n; i += XSUM_BLOCK128) {
+    xsum_length const m = std::min<xsum_length>(n - i, XSUM_BLOCK128);
+    for (xsum_length j = 0; j < m; ++j, ++v1, ++v2) {
+      pr[j] = *v1 * *v2;
+    }
+    xsum_add<accumulatorType>(acc, pr, m);
+  }
 }
 
 template <>
-inline void xsum_add_value_inf_nan<xsum_large_accumulator>(
-    xsum_large_accumulator *const lacc, xsum_expint const ix,
-    xsum_lchunk const uintv) {
-  if ((ix & XSUM_EXP_MASK) == XSUM_EXP_MASK) {
-    xsum_small_add_inf_nan<xsum_small_accumulator>(&lacc->sacc, uintv);
-  } else {
-    xsum_add_lchunk_to_small(lacc, ix);
-    --lacc->count[ix];
-    lacc->chunk[ix] += uintv;
-  }
+void xsum_init<xsum_small128_accumulator>(
+    xsum_small128_accumulator *const sacc) {
+  *sacc = xsum_small128_accumulator();
 }
 
 template <>
-void xsum_add<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
-                                      xsum_flt const value) {
+void xsum_add<xsum_small128_accumulator>(xsum_small128_accumulator *const sacc,
+                                         xsum_flt const value) {
+  if (sacc->adds_until_propagate == 0) {
+    xsum_carry_propagate<xsum_small128_accumulator>(sacc);
+  }
+
   fpunion u;
   u.fltv = value;
-  xsum_expint const ix = u.uintv >> XSUM_MANTISSA_BITS;
-  int const count = lacc->count[ix] - 1;
-  if (count < 0) {
-    xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix, u.uintv);
-  } else {
-    lacc->count[ix] = count;
-    lacc->chunk[ix] += u.uintv;
+  xsum_int special = 0;
+  xsum_small_add_branchless(sacc->chunk, u.intv, special);
+  if (special) {
+    xsum_small_add_inf_nan<xsum_small128_accumulator>(sacc, u.intv);
   }
+
+  --sacc->adds_until_propagate;
 }
 
 template <>
-void xsum_add<xsum_small_accumulator>(xsum_small_accumulator *const sacc,
-                                      xsum_flt const *const vec,
-                                      xsum_length const c) {
-  if (c == 0) {
-    return;
-  }
+void xsum_add<xsum_small128_accumulator>(xsum_small128_accumulator *const sacc,
+                                         xsum_flt const *const vec,
+                                         xsum_length const n) {
   xsum_flt const *v = vec;
-  xsum_length n = c;
-  while (n > 1) {
+  xsum_length k = n;
+  while (k > 0) {
     if (sacc->adds_until_propagate == 0) {
-      xsum_carry_propagate<xsum_small_accumulator>(sacc);
+      xsum_carry_propagate<xsum_small128_accumulator>(sacc);
     }
-    xsum_length const m = (n - 1 <= sacc->adds_until_propagate)
-                              ? n - 1
-                              : sacc->adds_until_propagate;
-    xsum_add_no_carry<xsum_small_accumulator>(sacc, v, m + 1);
+    xsum_length const m =
+        (k <= sacc->adds_until_propagate)
+            ? k
+            : static_cast<xsum_length>(sacc->adds_until_propagate);
+    xsum_small128_add_no_carry(sacc, v, m);
     sacc->adds_until_propagate -= m;
     v += m;
-    n -= m;
+    k -= m;
   }
-  xsum_add(sacc, *v);
 }
 
 template <>
-void xsum_add<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
-                                      xsum_flt const *const vec,
-                                      xsum_length const n) {
-  if (n == 0) {
-    return;
+void xsum_add<xsum_small128_accumulator>(xsum_small128_accumulator *const sacc,
+                                         std::vector<xsum_flt> const &vec) {
+  xsum_add<xsum_small128_accumulator>(sacc, vec.data(),
+                                      static_cast<xsum_length>(vec.size()));
+}
+
+/* The chunks of value are first propagated, so that they add no more than one
+   value would to the chunks of sacc. */
+
+template <>
+void xsum_add<xsum_small128_accumulator>(
+    xsum_small128_accumulator *const sacc,
+    xsum_small128_accumulator *const value) {
+  if (value->Inf != 0) {
+    xsum_add_inf_nan_fields(&sacc->Inf, &sacc->NaN, value->Inf);
+  }
+  if (value->NaN != 0) {
+    xsum_add_inf_nan_fields(&sacc->Inf, &sacc->NaN, value->NaN);
   }
 
-  xsum_flt const *v = vec;
+  if (sacc->adds_until_propagate == 0) {
+    xsum_carry_propagate<xsum_small128_accumulator>(sacc);
+  }
+  xsum_carry_propagate<xsum_small128_accumulator>(value);
 
-  /* Version that's been manually optimized:  Loop unrolled, pre-fetch
-     attempted, branches eliminated, ... */
+  for (int i = 0; i < XSUM_SCHUNKS; ++i) {
+    sacc->chunk[i] += value->chunk[i];
+  }
 
-  /* Unrolled loop processing two values each time around.  The loop is
-     done as two nested loops, arranged so that the inner one will have
-     no branches except for the one looping back.  This is achieved by
-     a trick for combining three tests for negativity into one.  The
-     last one or two values are not done here, so that the pre-fetching
-     will not go past the end of the array (which would probably be OK,
-     but is technically not allowed). */
+  --sacc->adds_until_propagate;
+}
 
-  fpunion u1;
-  fpunion u2;
+template <>
+void xsum_add_sqnorm<xsum_small128_accumulator>(
+    xsum_small128_accumulator *const sacc, xsum_flt const *const vec,
+    xsum_length const n) {
+  xsum_add_products128(sacc, vec, vec, n);
+}
 
-  int count1;
-  int count2;
+template <>
+void xsum_add_sqnorm<xsum_small128_accumulator>(
+    xsum_small128_accumulator *const sacc, std::vector<xsum_flt> const &vec) {
+  xsum_add_products128(sacc, vec.data(), vec.data(),
+                       static_cast<xsum_length>(vec.size()));
+}
 
-  xsum_expint ix1;
-  xsum_expint ix2;
+template <>
+void xsum_add_dot<xsum_small128_accumulator>(
+    xsum_small128_accumulator *const sacc, xsum_flt const *const vec1,
+    xsum_flt const *const vec2, xsum_length const n) {
+  xsum_add_products128(sacc, vec1, vec2, n);
+}
 
-  /* leave out last one or two, terminate when negative, for trick */
-  xsum_length m = n - 3;
+template <>
+void xsum_add_dot<xsum_small128_accumulator>(
+    xsum_small128_accumulator *const sacc, std::vector<xsum_flt> const &vec1,
+    std::vector<xsum_flt> const &vec2) {
+  xsum_length const n = static_cast<xsum_length>(vec1.size());
+  if (n == 0 || n > static_cast<xsum_length>(vec2.size())) {
+    return;
+  }
+  xsum_add_products128(sacc, vec1.data(), vec2.data(), n);
+}
 
-  while (m >= 0) {
-    /* Loop processing two values at a time until we're done, or until
-       one (or both) of the values result in a chunk needing to be processed.
-       Updates are done here for both of these chunks, even though it is not
-       yet known whether these updates ought to have been done.  We hope
-       this allows for better memory pre-fetch and instruction scheduling. */
+/* ROUND A SMALL ACCUMULATOR WITH 128-BIT CHUNKS TO A SMALL ACCUMULATOR, after
+   propagating its carries, which leaves it with the same sum. */
 
-    for (;;) {
-      u1.fltv = *v++;
-      u2.fltv = *v++;
+template <>
+xsum_small_accumulator xsum_round_to_small<xsum_small128_accumulator>(
+    xsum_small128_accumulator *const sacc) {
+  xsum_carry_propagate<xsum_small128_accumulator>(sacc);
 
-      ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
-      count1 = lacc->count[ix1] - 1;
-      lacc->count[ix1] = count1;
-      lacc->chunk[ix1] += u1.uintv;
+  xsum_small_accumulator r;
+  for (int i = 0; i < XSUM_SCHUNKS; ++i) {
+    r.chunk[i] = static_cast<xsum_schunk>(sacc->chunk[i]);
+  }
+  r.Inf = sacc->Inf;
+  r.NaN = sacc->NaN;
+  return r;
+}
 
-      ix2 = u2.uintv >> XSUM_MANTISSA_BITS;
-      count2 = lacc->count[ix2] - 1;
-      lacc->count[ix2] = count2;
-      lacc->chunk[ix2] += u2.uintv;
+template <>
+xsum_flt xsum_round<xsum_small128_accumulator>(
+    xsum_small128_accumulator *const sacc) {
+  xsum_small_accumulator r =
+      xsum_round_to_small<xsum_small128_accumulator>(sacc);
+  return xsum_round<xsum_small_accumulator>(&r);
+}
 
-      m -= 2;
+/* ADD CHUNK ix OF A LARGE ACCUMULATOR WITH 128-BIT CHUNKS TO ITS SMALL
+   ACCUMULATOR, and clear it for further adds.  As for the large accumulator,
+   except that the sum of the mantissas can take up to 82 bits, which are split
+   into three parts that each fit in the 64 bits of a value. */
 
-      /* ... equivalent to while (count1 >= 0 && count2 >= 0 && m >= 0) */
-      if ((static_cast<xsum_length>(count1) | static_cast<xsum_length>(count2) |
-           m) < 0) {
-        break;
-      }
+template <>
+inline void xsum_add_lchunk_to_small<xsum_large128_accumulator>(
+    xsum_large128_accumulator *const lacc, xsum_expint const ix) {
+  xsum_lcount128 const count = lacc->count[ix];
+
+  if (count >= 0) {
+    xsum_small128_accumulator *const sacc = &lacc->sacc;
+    if (sacc->adds_until_propagate == 0) {
+      xsum_carry_propagate<xsum_small128_accumulator>(sacc);
     }
 
-    /* See if we were actually supposed to update these chunks.  If not,
-       back out the changes and then process the chunks as they ought to
-       have been processed. */
-    if (count1 < 0 || count2 < 0) {
-      lacc->count[ix2] = count2 + 1;
-      lacc->chunk[ix2] -= u2.uintv;
+    /* Take out the sign and exponent parts of the values added. */
+    xsum_lchunk128 const added =
+        (static_cast<xsum_lchunk128>(1) << XSUM_LCOUNT128_BITS) - count;
+    xsum_lchunk128 const chunk =
+        lacc->chunk[ix] - ((added * static_cast<xsum_lchunk128>(ix))
+                           << XSUM_MANTISSA_BITS);
 
-      if (count1 < 0) {
-        lacc->count[ix1] = count1 + 1;
-        lacc->chunk[ix1] -= u1.uintv;
-        xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix1, u1.uintv);
-        count2 = lacc->count[ix2] - 1;
-      }
+    xsum_expint low_exp;
+    xsum_expint high_exp;
 
-      if (count2 < 0) {
-        xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix2, u2.uintv);
-      } else {
-        lacc->count[ix2] = count2;
-        lacc->chunk[ix2] += u2.uintv;
-      }
+    xsum_expint const exp = ix & XSUM_EXP_MASK;
+    if (exp == 0) {
+      low_exp = 1;
+      high_exp = 0;
+    } else {
+      low_exp = exp & XSUM_LOW_EXP_MASK;
+      high_exp = exp >> XSUM_LOW_EXP_BITS;
+    }
+
+    xsum_lchunk128 const low_chunk =
+        (chunk << low_exp) & XSUM_LOW_MANTISSA_MASK;
+    xsum_lchunk128 mid_chunk = chunk >> (XSUM_LOW_MANTISSA_BITS - low_exp);
+
+    /* normalized */
+    if (exp != 0) {
+      mid_chunk += added
+                   << (XSUM_MANTISSA_BITS - XSUM_LOW_MANTISSA_BITS + low_exp);
     }
-  }
 
-  /* Process the last one or two values, without pre-fetching. */
-  m += 3;
-  for (;;) {
-    u1.fltv = *v++;
-    ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
-    count1 = lacc->count[ix1] - 1;
+    xsum_lchunk128 const high_chunk = mid_chunk >> XSUM_LOW_MANTISSA_BITS;
+    mid_chunk &= XSUM_LOW_MANTISSA_MASK;
 
-    if (count1 < 0) {
-      xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix1, u1.uintv);
+    if (ix & (1 << XSUM_EXP_BITS)) {
+      sacc->chunk[high_exp] -= static_cast<xsum_schunk128>(low_chunk);
+      sacc->chunk[high_exp + 1] -= static_cast<xsum_schunk128>(mid_chunk);
+      sacc->chunk[high_exp + 2] -= static_cast<xsum_schunk128>(high_chunk);
     } else {
-      lacc->count[ix1] = count1;
-      lacc->chunk[ix1] += u1.uintv;
+      sacc->chunk[high_exp] += static_cast<xsum_schunk128>(low_chunk);
+      sacc->chunk[high_exp + 1] += static_cast<xsum_schunk128>(mid_chunk);
+      sacc->chunk[high_exp + 2] += static_cast<xsum_schunk128>(high_chunk);
     }
 
-    --m;
-    if (m == 0) {
-      break;
-    }
+    --sacc->adds_until_propagate;
   }
+
+  lacc->chunk[ix] = 0;
+  lacc->count[ix] = static_cast<xsum_lcount128>(1) << XSUM_LCOUNT128_BITS;
+  lacc->chunks_used[ix >> 6] |= static_cast<xsum_used>(1) << (ix & 0x3f);
 }
 
 template <>
-void xsum_add<xsum_small_accumulator>(xsum_small_accumulator *const sacc,
-                                      std::vector<xsum_flt> const &vec) {
-  xsum_length n = static_cast<xsum_length>(vec.size());
-  if (n == 0) {
-    return;
+inline void xsum_add_value_inf_nan<xsum_large128_accumulator>(
+    xsum_large128_accumulator *const lacc, xsum_expint const ix,
+    xsum_lchunk const uintv) {
+  if ((ix & XSUM_EXP_MASK) == XSUM_EXP_MASK) {
+    xsum_small_add_inf_nan<xsum_small128_accumulator>(&lacc->sacc, uintv);
+  } else {
+    xsum_add_lchunk_to_small(lacc, ix);
+    --lacc->count[ix];
+    lacc->chunk[ix] += uintv;
   }
+}
 
-  xsum_flt const *v = vec.data();
+/* ADD ALL CHUNKS IN USE OF A LARGE ACCUMULATOR WITH 128-BIT CHUNKS TO ITS
+   SMALL ACCUMULATOR. */
 
-  while (n > 1) {
-    if (sacc->adds_until_propagate == 0) {
-      xsum_carry_propagate<xsum_small_accumulator>(sacc);
+static void xsum_large128_flush(xsum_large128_accumulator *const lacc) {
+  for (int w = 0; w < XSUM_LCHUNKS / 64; ++w) {
+    xsum_used u = lacc->chunks_used[w];
+    for (xsum_expint ix = w << 6; u != 0; ++ix, u >>= 1) {
+      if (u & 1) {
+        xsum_add_lchunk_to_small(lacc, ix);
+      }
     }
-    xsum_length const m = (n - 1 <= sacc->adds_until_propagate)
-                              ? n - 1
-                              : sacc->adds_until_propagate;
-    xsum_add_no_carry<xsum_small_accumulator>(sacc, v, m + 1);
-    sacc->adds_until_propagate -= m;
-    v += m;
-    n -= m;
   }
-  xsum_add(sacc, *v);
 }
 
 template <>
-void xsum_add<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
-                                      std::vector<xsum_flt> const &vec) {
-  xsum_length const n = static_cast<xsum_length>(vec.size());
+void xsum_init<xsum_large128_accumulator>(
+    xsum_large128_accumulator *const lacc) {
+  std::fill(lacc->count, lacc->count + XSUM_LCHUNKS, -1);
+  std::fill(lacc->chunks_used, lacc->chunks_used + XSUM_LCHUNKS / 64, 0);
+  xsum_init<xsum_small128_accumulator>(&lacc->sacc);
+}
+
+template <>
+void xsum_add<xsum_large128_accumulator>(xsum_large128_accumulator *const lacc,
+                                         xsum_flt const value) {
+  fpunion u;
+  u.fltv = value;
+  xsum_expint const ix = u.uintv >> XSUM_MANTISSA_BITS;
+  xsum_lcount128 const count = lacc->count[ix] - 1;
+  if (count < 0) {
+    xsum_add_value_inf_nan<xsum_large128_accumulator>(lacc, ix, u.uintv);
+  } else {
+    lacc->count[ix] = count;
+    lacc->chunk[ix] += u.uintv;
+  }
+}
+
+/* Unrolled loop processing two values each time around, as for the large
+   accumulator. */
+
+template <>
+void xsum_add<xsum_large128_accumulator>(xsum_large128_accumulator *const lacc,
+                                         xsum_flt const *const vec,
+                                         xsum_length const n) {
   if (n == 0) {
     return;
   }
 
-  xsum_flt const *v = vec.data();
-
-  /* Version that's been manually optimized:  Loop unrolled, pre-fetch
-     attempted, branches eliminated, ... */
+  xsum_flt const *v = vec;
 
-  /* Unrolled loop processing two values each time around.  The loop is
-     done as two nested loops, arranged so that the inner one will have
-     no branches except for the one looping back.  This is achieved by
-     a trick for combining three tests for negativity into one.  The
-     last one or two values are not done here, so that the pre-fetching
-     will not go past the end of the array (which would probably be OK,
-     but is technically not allowed). */
+  bool const stream =
+      XSUM_STREAM_THRESHOLD > 0 && n >= XSUM_STREAM_THRESHOLD;
 
   fpunion u1;
   fpunion u2;
 
-  int count1;
-  int count2;
+  xsum_lcount128 count1;
+  xsum_lcount128 count2;
 
   xsum_expint ix1;
   xsum_expint ix2;
@@ -4624,13 +7205,12 @@ void xsum_add<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
   xsum_length m = n - 3;
 
   while (m >= 0) {
-    /* Loop processing two values at a time until we're done, or until
-       one (or both) of the values result in a chunk needing to be processed.
-       Updates are done here for both of these chunks, even though it is not
-       yet known whether these updates ought to have been done.  We hope
-       this allows for better memory pre-fetch and instruction scheduling. */
-
     for (;;) {
+      if (XSUM_PREFETCH_ADD > 0) {
+        xsum_prefetch(v + (m < XSUM_PREFETCH_ADD ? m : XSUM_PREFETCH_ADD),
+                      stream);
+      }
+
       u1.fltv = *v++;
       u2.fltv = *v++;
 
@@ -4653,1187 +7233,1485 @@ void xsum_add<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
       }
     }
 
-    /* See if we were actually supposed to update these chunks.  If not,
-       back out the changes and then process the chunks as they ought to
-       have been processed. */
+    /* Back out both updates, and add the two values one at a time. */
     if (count1 < 0 || count2 < 0) {
       lacc->count[ix2] = count2 + 1;
       lacc->chunk[ix2] -= u2.uintv;
+      lacc->count[ix1] = count1 + 1;
+      lacc->chunk[ix1] -= u1.uintv;
 
-      if (count1 < 0) {
-        lacc->count[ix1] = count1 + 1;
-        lacc->chunk[ix1] -= u1.uintv;
-        xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix1, u1.uintv);
-        count2 = lacc->count[ix2] - 1;
-      }
-
-      if (count2 < 0) {
-        xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix2, u2.uintv);
-      } else {
-        lacc->count[ix2] = count2;
-        lacc->chunk[ix2] += u2.uintv;
-      }
+      xsum_add<xsum_large128_accumulator>(lacc, u1.fltv);
+      xsum_add<xsum_large128_accumulator>(lacc, u2.fltv);
     }
   }
 
-  /* Process the last one or two values, without pre-fetching. */
-  m += 3;
-  for (;;) {
-    u1.fltv = *v++;
-    ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
-    count1 = lacc->count[ix1] - 1;
-
-    if (count1 < 0) {
-      xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix1, u1.uintv);
-    } else {
-      lacc->count[ix1] = count1;
-      lacc->chunk[ix1] += u1.uintv;
-    }
-
-    --m;
-    if (m == 0) {
-      break;
-    }
+  /* Process the last one or two values. */
+  for (m += 3; m > 0; --m) {
+    xsum_add<xsum_large128_accumulator>(lacc, *v++);
   }
 }
 
 template <>
-void xsum_add<xsum_small_accumulator>(
-    xsum_small_accumulator *const sacc,
-    xsum_small_accumulator const *const value) {
-  if (sacc->adds_until_propagate == 0) {
-    xsum_carry_propagate<xsum_small_accumulator>(sacc);
-  }
-
-  xsum_add_no_carry<xsum_small_accumulator>(sacc, value);
-
-  --sacc->adds_until_propagate;
+void xsum_add<xsum_large128_accumulator>(xsum_large128_accumulator *const lacc,
+                                         std::vector<xsum_flt> const &vec) {
+  xsum_add<xsum_large128_accumulator>(lacc, vec.data(),
+                                      static_cast<xsum_length>(vec.size()));
 }
 
 template <>
-void xsum_add<xsum_small_accumulator>(xsum_small_accumulator *const sacc,
-                                      xsum_small_accumulator *const value) {
-  if (sacc->adds_until_propagate == 0) {
-    xsum_carry_propagate<xsum_small_accumulator>(sacc);
-  }
-
-  xsum_add_no_carry<xsum_small_accumulator>(sacc, value);
-
-  --sacc->adds_until_propagate;
+void xsum_add<xsum_large128_accumulator>(
+    xsum_large128_accumulator *const lacc,
+    xsum_large128_accumulator *const value) {
+  xsum_large128_flush(value);
+  xsum_add<xsum_small128_accumulator>(&lacc->sacc, &value->sacc);
 }
 
 template <>
-void xsum_add<xsum_large_accumulator>(
-    xsum_large_accumulator *const lacc,
-    xsum_small_accumulator const *const value) {
-  if (lacc->sacc.adds_until_propagate == 0) {
-    xsum_carry_propagate<xsum_small_accumulator>(&lacc->sacc);
-  }
-
-  xsum_add_no_carry<xsum_small_accumulator>(&lacc->sacc, value);
-
-  --lacc->sacc.adds_until_propagate;
+void xsum_add_sqnorm<xsum_large128_accumulator>(
+    xsum_large128_accumulator *const lacc, xsum_flt const *const vec,
+    xsum_length const n) {
+  xsum_add_products128(lacc, vec, vec, n);
 }
 
 template <>
-xsum_small_accumulator *xsum_round_to_small_ptr<xsum_large_accumulator>(
-    xsum_large_accumulator *const lacc) {
-  xsum_used *p = lacc->chunks_used;
-  xsum_used *e = p + XSUM_LCHUNKS / 64;
-
-  /* Very quickly skip some unused low-order blocks of chunks by looking
-     at the used_used flags. */
+void xsum_add_sqnorm<xsum_large128_accumulator>(
+    xsum_large128_accumulator *const lacc, std::vector<xsum_flt> const &vec) {
+  xsum_add_products128(lacc, vec.data(), vec.data(),
+                       static_cast<xsum_length>(vec.size()));
+}
 
-  xsum_used uu = lacc->used_used;
+template <>
+void xsum_add_dot<xsum_large128_accumulator>(
+    xsum_large128_accumulator *const lacc, xsum_flt const *const vec1,
+    xsum_flt const *const vec2, xsum_length const n) {
+  xsum_add_products128(lacc, vec1, vec2, n);
+}
 
-  if ((uu & 0xffffffff) == 0) {
-    uu >>= 32;
-    p += 32;
-  }
-  if ((uu & 0xffff) == 0) {
-    uu >>= 16;
-    p += 16;
-  }
-  if ((uu & 0xff) == 0) {
-    p += 8;
+template <>
+void xsum_add_dot<xsum_large128_accumulator>(
+    xsum_large128_accumulator *const lacc, std::vector<xsum_flt> const &vec1,
+    std::vector<xsum_flt> const &vec2) {
+  xsum_length const n = static_cast<xsum_length>(vec1.size());
+  if (n == 0 || n > static_cast<xsum_length>(vec2.size())) {
+    return;
   }
+  xsum_add_products128(lacc, vec1.data(), vec2.data(), n);
+}
 
-  xsum_used u;
-
-  /* Loop over remaining blocks of chunks. */
-  do {
-    /* Loop to quickly find the next non-zero block of used flags, or finish
-       up if we've added all the used blocks to the small accumulator. */
-
-    for (;;) {
-      u = *p;
-      if (u != 0) {
-        break;
-      }
-
-      ++p;
-      if (p == e) {
-        return &lacc->sacc;
-      }
-
-      u = *p;
-      if (u != 0) {
-        break;
-      }
-
-      ++p;
-      if (p == e) {
-        return &lacc->sacc;
-      }
-
-      u = *p;
-      if (u != 0) {
-        break;
-      }
-
-      ++p;
-      if (p == e) {
-        return &lacc->sacc;
-      }
-
-      u = *p;
-      if (u != 0) {
-        break;
-      }
-
-      ++p;
-      if (p == e) {
-        return &lacc->sacc;
-      }
-    }
-
-    /* Find and process the chunks in this block that are used.  We skip
-       forward based on the chunks_used flags until we're within eight
-        bits of a chunk that is in use. */
-
-    int ix = (p - lacc->chunks_used) << 6;
-
-    if ((u & 0xffffffff) == 0) {
-      u >>= 32;
-      ix += 32;
-    }
-    if ((u & 0xffff) == 0) {
-      u >>= 16;
-      ix += 16;
-    }
-    if ((u & 0xff) == 0) {
-      u >>= 8;
-      ix += 8;
-    }
-
-    do {
-      if (lacc->count[ix] >= 0) {
-        xsum_add_lchunk_to_small<xsum_large_accumulator>(lacc, ix);
-      }
-      ++ix;
-      u >>= 1;
-    } while (u != 0);
-
-    ++p;
-
-  } while (p != e);
-
-  /* Finish now that all blocks have been added to the small accumulator
-     by calling the small accumulator rounding function. */
-
-  return &lacc->sacc;
+template <>
+xsum_small_accumulator xsum_round_to_small<xsum_large128_accumulator>(
+    xsum_large128_accumulator *const lacc) {
+  xsum_large128_flush(lacc);
+  return xsum_round_to_small<xsum_small128_accumulator>(&lacc->sacc);
 }
 
 template <>
-xsum_small_accumulator xsum_round_to_small<xsum_large_accumulator>(
-    xsum_large_accumulator *const lacc) {
-  xsum_used *p = lacc->chunks_used;
-  xsum_used *e = p + XSUM_LCHUNKS / 64;
+xsum_flt xsum_round<xsum_large128_accumulator>(
+    xsum_large128_accumulator *const lacc) {
+  xsum_small_accumulator r =
+      xsum_round_to_small<xsum_large128_accumulator>(lacc);
+  return xsum_round<xsum_small_accumulator>(&r);
+}
+#endif
+
+/* ACCUMULATOR FOR VALUES IN A RANGE OF EXPONENTS */
+
+template <int MinExp, int MaxExp>
+xsum_bounded_accumulator<MinExp, MaxExp>::xsum_bounded_accumulator(
+    int const carry_budget)
+    : adds_until_propagate(std::min(std::max(carry_budget, 2),
+                                    (1 << XSUM_SMALL_CARRY_BITS) - 1)),
+      carry_budget(adds_until_propagate) {}
+
+template <int MinExp, int MaxExp>
+xsum_bounded_accumulator<MinExp, MaxExp>::xsum_bounded_accumulator(
+    xsum_bounded_accumulator const &other)
+    : Inf(other.Inf),
+      NaN(other.NaN),
+      adds_until_propagate(other.adds_until_propagate),
+      carry_budget(other.carry_budget),
+      outside(other.outside ? new xsum_small_accumulator(*other.outside)
+                            : nullptr) {
+  std::copy(other.chunk, other.chunk + nchunks, chunk);
+}
 
-  /* Very quickly skip some unused low-order blocks of chunks by looking
-     at the used_used flags. */
+template <int MinExp, int MaxExp>
+xsum_bounded_accumulator<MinExp, MaxExp> &
+xsum_bounded_accumulator<MinExp, MaxExp>::operator=(
+    xsum_bounded_accumulator const &other) {
+  if (this != &other) {
+    std::copy(other.chunk, other.chunk + nchunks, chunk);
+    Inf = other.Inf;
+    NaN = other.NaN;
+    adds_until_propagate = other.adds_until_propagate;
+    carry_budget = other.carry_budget;
+    outside.reset(other.outside ? new xsum_small_accumulator(*other.outside)
+                                : nullptr);
+  }
+  return *this;
+}
 
-  xsum_used uu = lacc->used_used;
+/* PROPAGATE CARRIES IN AN ACCUMULATOR FOR A RANGE OF EXPONENTS.  Every chunk
+   but the top one is left in [0, 2^32), and the top one takes the rest. */
+
+template <int MinExp, int MaxExp>
+static void xsum_bounded_propagate(
+    xsum_bounded_accumulator<MinExp, MaxExp> *const bacc) {
+  constexpr int top = xsum_bounded_accumulator<MinExp, MaxExp>::nchunks - 1;
+  xsum_schunk carry = 0;
+  for (int i = 0; i < top; ++i) {
+    xsum_schunk const c = bacc->chunk[i] + carry;
+    carry = c >> XSUM_LOW_MANTISSA_BITS;
+    bacc->chunk[i] = c & XSUM_LOW_MANTISSA_MASK;
+  }
+  bacc->chunk[top] += carry;
+  bacc->adds_until_propagate = xsum_carry_terms(bacc);
+}
 
-  if ((uu & 0xffffffff) == 0) {
-    uu >>= 32;
-    p += 32;
-  }
-  if ((uu & 0xffff) == 0) {
-    uu >>= 16;
-    p += 16;
-  }
-  if ((uu & 0xff) == 0) {
-    p += 8;
+/* SMALL ACCUMULATOR FOR THE VALUES OUTSIDE THE RANGE OF AN ACCUMULATOR FOR A
+   RANGE OF EXPONENTS, created with its carry budget if there is none yet. */
+
+template <int MinExp, int MaxExp>
+static xsum_small_accumulator *xsum_bounded_outside(
+    xsum_bounded_accumulator<MinExp, MaxExp> *const bacc) {
+  if (!bacc->outside) {
+    bacc->outside.reset(new xsum_small_accumulator);
+    bacc->outside->carry_budget = bacc->carry_budget;
+    bacc->outside->adds_until_propagate = xsum_carry_terms(bacc);
   }
+  return bacc->outside.get();
+}
 
-  xsum_small_accumulator sacc;
+/* ADD A VALUE OUTSIDE THE RANGE OF AN ACCUMULATOR FOR A RANGE OF EXPONENTS.
+   Zeros add nothing, and Inf and NaN go to its own fields. */
+
+template <int MinExp, int MaxExp>
+static void xsum_bounded_add_outside(
+    xsum_bounded_accumulator<MinExp, MaxExp> *const bacc,
+    xsum_int const ivalue) {
+  xsum_expint const exp = (ivalue >> XSUM_MANTISSA_BITS) & XSUM_EXP_MASK;
+  if (exp == XSUM_EXP_MASK) {
+    xsum_add_inf_nan_fields(&bacc->Inf, &bacc->NaN, ivalue);
+  } else if ((ivalue & ~XSUM_SIGN_MASK) != 0) {
+    fpunion u;
+    u.intv = ivalue;
+    xsum_add<xsum_small_accumulator>(xsum_bounded_outside(bacc), u.fltv);
+  }
+}
 
-  xsum_used u;
+/* WHETHER A VALUE IS IN THE RANGE OF AN ACCUMULATOR FOR A RANGE OF EXPONENTS.
+ */
 
-  /* Loop over remaining blocks of chunks. */
-  do {
-    /* Loop to quickly find the next non-zero block of used flags, or finish
-       up if we've added all the used blocks to the small accumulator. */
+template <typename accumulatorType>
+static inline bool xsum_bounded_in_range(xsum_int const ivalue) {
+  xsum_expint const exp = (ivalue >> XSUM_MANTISSA_BITS) & XSUM_EXP_MASK;
+  return static_cast<xsum_uint>(exp - accumulatorType::exp_lo) <=
+         static_cast<xsum_uint>(accumulatorType::exp_hi -
+                                accumulatorType::exp_lo);
+}
 
-    for (;;) {
-      u = *p;
-      if (u != 0) {
-        break;
-      }
+/* ADD A VALUE IN RANGE TO THE CHUNKS OF AN ACCUMULATOR FOR A RANGE OF
+   EXPONENTS, split over two of them as for the small accumulator. */
 
-      ++p;
-      if (p == e) {
-        std::copy(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS,
-                  sacc.chunk);
-        sacc.Inf = lacc->sacc.Inf;
-        sacc.NaN = lacc->sacc.NaN;
-        sacc.adds_until_propagate = lacc->sacc.adds_until_propagate;
-        return sacc;
-      }
+template <typename accumulatorType>
+static inline void xsum_bounded_add_chunks(xsum_schunk *const chunk,
+                                           xsum_int const ivalue) {
+  xsum_expint const exp = (ivalue >> XSUM_MANTISSA_BITS) & XSUM_EXP_MASK;
+  xsum_int const mantissa = (ivalue & XSUM_MANTISSA_MASK) |
+                            (static_cast<xsum_int>(1) << XSUM_MANTISSA_BITS);
+  xsum_expint const low_exp = exp & XSUM_LOW_EXP_MASK;
+  int const high_exp = (exp >> XSUM_LOW_EXP_BITS) - accumulatorType::base;
 
-      u = *p;
-      if (u != 0) {
-        break;
-      }
+  xsum_int const low_mantissa =
+      (static_cast<xsum_uint>(mantissa) << low_exp) & XSUM_LOW_MANTISSA_MASK;
+  xsum_int const high_mantissa = mantissa >> (XSUM_LOW_MANTISSA_BITS - low_exp);
 
-      ++p;
-      if (p == e) {
-        std::copy(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS,
-                  sacc.chunk);
-        sacc.Inf = lacc->sacc.Inf;
-        sacc.NaN = lacc->sacc.NaN;
-        sacc.adds_until_propagate = lacc->sacc.adds_until_propagate;
-        return sacc;
-      }
+  /* All ones for a negative value, to negate both parts */
+  xsum_int const sign = ivalue >> (XSUM_SCHUNK_BITS - 1);
 
-      u = *p;
-      if (u != 0) {
-        break;
-      }
+  chunk[high_exp] += (low_mantissa ^ sign) - sign;
+  chunk[high_exp + 1] += (high_mantissa ^ sign) - sign;
+}
 
-      ++p;
-      if (p == e) {
-        std::copy(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS,
-                  sacc.chunk);
-        sacc.Inf = lacc->sacc.Inf;
-        sacc.NaN = lacc->sacc.NaN;
-        sacc.adds_until_propagate = lacc->sacc.adds_until_propagate;
-        return sacc;
-      }
+template <int MinExp, int MaxExp>
+static inline void xsum_bounded_add_no_carry(
+    xsum_bounded_accumulator<MinExp, MaxExp> *const bacc,
+    xsum_int const ivalue) {
+  using accumulatorType = xsum_bounded_accumulator<MinExp, MaxExp>;
+  if (xsum_bounded_in_range<accumulatorType>(ivalue)) {
+    xsum_bounded_add_chunks<accumulatorType>(bacc->chunk, ivalue);
+  } else {
+    xsum_bounded_add_outside(bacc, ivalue);
+  }
+}
 
-      u = *p;
-      if (u != 0) {
-        break;
-      }
+/* ADD A VECTOR OF FLOATING-POINT NUMBERS TO AN ACCUMULATOR FOR A RANGE OF
+   EXPONENTS, WITHOUT CARRIES.  As for the small accumulator, the loop is
+   unrolled four times, and alternate values go to a second set of chunks.  The
+   four values are looked at one at a time only if one is out of range. */
 
-      ++p;
-      if (p == e) {
-        std::copy(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS,
-                  sacc.chunk);
-        sacc.Inf = lacc->sacc.Inf;
-        sacc.NaN = lacc->sacc.NaN;
-        sacc.adds_until_propagate = lacc->sacc.adds_until_propagate;
-        return sacc;
-      }
-    }
+template <int MinExp, int MaxExp>
+static void xsum_bounded_add_no_carry(
+    xsum_bounded_accumulator<MinExp, MaxExp> *const bacc,
+    xsum_flt const *const vec, xsum_length const n) {
+  using accumulatorType = xsum_bounded_accumulator<MinExp, MaxExp>;
 
-    /* Find and process the chunks in this block that are used.  We skip
-       forward based on the chunks_used flags until we're within eight
-        bits of a chunk that is in use. */
+  xsum_schunk chunk2[accumulatorType::nchunks] = {};
 
-    int ix = (p - lacc->chunks_used) << 6;
+  fpunion u1;
+  fpunion u2;
+  fpunion u3;
+  fpunion u4;
 
-    if ((u & 0xffffffff) == 0) {
-      u >>= 32;
-      ix += 32;
-    }
-    if ((u & 0xffff) == 0) {
-      u >>= 16;
-      ix += 16;
-    }
-    if ((u & 0xff) == 0) {
-      u >>= 8;
-      ix += 8;
+  xsum_flt const *v = vec;
+  xsum_flt const *const e = vec + n;
+
+  for (; v + 4 <= e; v += 4) {
+    u1.fltv = v[0];
+    u2.fltv = v[1];
+    u3.fltv = v[2];
+    u4.fltv = v[3];
+    if (xsum_bounded_in_range<accumulatorType>(u1.intv) &
+        xsum_bounded_in_range<accumulatorType>(u2.intv) &
+        xsum_bounded_in_range<accumulatorType>(u3.intv) &
+        xsum_bounded_in_range<accumulatorType>(u4.intv)) {
+      xsum_bounded_add_chunks<accumulatorType>(bacc->chunk, u1.intv);
+      xsum_bounded_add_chunks<accumulatorType>(chunk2, u2.intv);
+      xsum_bounded_add_chunks<accumulatorType>(bacc->chunk, u3.intv);
+      xsum_bounded_add_chunks<accumulatorType>(chunk2, u4.intv);
+    } else {
+      xsum_bounded_add_no_carry(bacc, u1.intv);
+      xsum_bounded_add_no_carry(bacc, u2.intv);
+      xsum_bounded_add_no_carry(bacc, u3.intv);
+      xsum_bounded_add_no_carry(bacc, u4.intv);
     }
+  }
+  for (; v < e; ++v) {
+    u1.fltv = *v;
+    xsum_bounded_add_no_carry(bacc, u1.intv);
+  }
 
-    do {
-      if (lacc->count[ix] >= 0) {
-        xsum_add_lchunk_to_small<xsum_large_accumulator>(lacc, ix);
-      }
-      ++ix;
-      u >>= 1;
-    } while (u != 0);
-
-    ++p;
-
-  } while (p != e);
-
-  /* Finish now that all blocks have been added to the small accumulator
-     by calling the small accumulator rounding function. */
-  std::copy(lacc->sacc.chunk, lacc->sacc.chunk + XSUM_SCHUNKS, sacc.chunk);
-  sacc.Inf = lacc->sacc.Inf;
-  sacc.NaN = lacc->sacc.NaN;
-  sacc.adds_until_propagate = lacc->sacc.adds_until_propagate;
-  return sacc;
+  for (int i = 0; i < accumulatorType::nchunks; ++i) {
+    bacc->chunk[i] += chunk2[i];
+  }
 }
 
-template <>
-void xsum_add<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
-                                      xsum_large_accumulator *const value) {
-  xsum_small_accumulator const *const sacc = xsum_round_to_small_ptr(value);
-  xsum_add(lacc, sacc);
+template <int MinExp, int MaxExp>
+void xsum_init(xsum_bounded_accumulator<MinExp, MaxExp> *const bacc) {
+  std::fill(bacc->chunk,
+            bacc->chunk + xsum_bounded_accumulator<MinExp, MaxExp>::nchunks, 0);
+  bacc->Inf = 0;
+  bacc->NaN = 0;
+  bacc->adds_until_propagate = xsum_carry_terms(bacc);
+  bacc->outside.reset();
 }
 
-template <>
-void xsum_add<xsum_small_accumulator>(xsum_small_accumulator *const sacc,
-                                      xsum_small_accumulator const *const vec,
-                                      xsum_length const c) {
-  if (c == 0) {
-    return;
+template <int MinExp, int MaxExp>
+void xsum_add(xsum_bounded_accumulator<MinExp, MaxExp> *const bacc,
+              xsum_flt const value) {
+  if (bacc->adds_until_propagate == 0) {
+    xsum_bounded_propagate(bacc);
   }
-  xsum_small_accumulator const *v = vec;
-  xsum_length n = c;
-  while (n > 1) {
-    if (sacc->adds_until_propagate == 0) {
-      xsum_carry_propagate<xsum_small_accumulator>(sacc);
+  fpunion u;
+  u.fltv = value;
+  xsum_bounded_add_no_carry(bacc, u.intv);
+  --bacc->adds_until_propagate;
+}
+
+template <int MinExp, int MaxExp>
+void xsum_add(xsum_bounded_accumulator<MinExp, MaxExp> *const bacc,
+              xsum_flt const *const vec, xsum_length const n) {
+  xsum_flt const *v = vec;
+  xsum_length k = n;
+  while (k > 0) {
+    if (bacc->adds_until_propagate == 0) {
+      xsum_bounded_propagate(bacc);
     }
-    xsum_length const m = (n - 1 <= sacc->adds_until_propagate)
-                              ? n - 1
-                              : sacc->adds_until_propagate;
-    xsum_add_no_carry<xsum_small_accumulator>(sacc, v, m + 1);
-    sacc->adds_until_propagate -= m;
+    xsum_length const m =
+        (k <= bacc->adds_until_propagate) ? k : bacc->adds_until_propagate;
+    xsum_bounded_add_no_carry(bacc, v, m);
+    bacc->adds_until_propagate -= m;
     v += m;
-    n -= m;
+    k -= m;
   }
-  xsum_add<xsum_small_accumulator>(sacc, v);
 }
 
-template <>
-void xsum_add_sqnorm<xsum_small_accumulator>(xsum_small_accumulator *const sacc,
-                                             xsum_flt const *const vec,
-                                             xsum_length const c) {
-  if (c == 0) {
-    return;
+template <int MinExp, int MaxExp>
+void xsum_add(xsum_bounded_accumulator<MinExp, MaxExp> *const bacc,
+              std::vector<xsum_flt> const &vec) {
+  xsum_add(bacc, vec.data(), static_cast<xsum_length>(vec.size()));
+}
+
+/* The chunks of value are first propagated, so that they add no more than one
+   value would to the chunks of bacc. */
+
+template <int MinExp, int MaxExp>
+void xsum_add(xsum_bounded_accumulator<MinExp, MaxExp> *const bacc,
+              xsum_bounded_accumulator<MinExp, MaxExp> *const value) {
+  if (value->Inf != 0) {
+    xsum_add_inf_nan_fields(&bacc->Inf, &bacc->NaN, value->Inf);
+  }
+  if (value->NaN != 0) {
+    xsum_add_inf_nan_fields(&bacc->Inf, &bacc->NaN, value->NaN);
+  }
+  if (value->outside) {
+    xsum_add<xsum_small_accumulator>(xsum_bounded_outside(bacc),
+                                     value->outside.get());
   }
 
-  xsum_flt const *v = vec;
-  xsum_length n = c;
-  while (n > 1) {
-    if (sacc->adds_until_propagate == 0) {
-      xsum_carry_propagate<xsum_small_accumulator>(sacc);
-    }
+  if (bacc->adds_until_propagate == 0) {
+    xsum_bounded_propagate(bacc);
+  }
+  xsum_bounded_propagate(value);
 
-    xsum_length const m = n - 1 <= sacc->adds_until_propagate
-                              ? n - 1
-                              : sacc->adds_until_propagate;
-    xsum_add_sqnorm_no_carry<xsum_small_accumulator>(sacc, v, m + 1);
-    sacc->adds_until_propagate -= m;
-    v += m;
-    n -= m;
+  for (int i = 0; i < xsum_bounded_accumulator<MinExp, MaxExp>::nchunks; ++i) {
+    bacc->chunk[i] += value->chunk[i];
   }
 
-  xsum_add(sacc, *v * *v);
+  --bacc->adds_until_propagate;
 }
 
-template <>
-void xsum_add_sqnorm<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
-                                             xsum_flt const *const vec,
-                                             xsum_length const n) {
-  if (n == 0) {
+/* SQUARED NORMS AND DOT PRODUCTS.  The squares or products are computed a
+   block at a time into a buffer that stays in cache, and added with the vector
+   add function. */
+
+template <int MinExp, int MaxExp>
+void xsum_add_dot(xsum_bounded_accumulator<MinExp, MaxExp> *const bacc,
+                  xsum_flt const *const vec1, xsum_flt const *const vec2,
+                  xsum_length const n) {
+  xsum_flt pr[XSUM_BOUNDED_BLOCK];
+  xsum_flt const *v1 = vec1;
+  xsum_flt const *v2 = vec2;
+  for (xsum_length i = 0; i < n; i += XSUM_BOUNDED_BLOCK) {
+    xsum_length const m = std::min<xsum_length>(n - i, XSUM_BOUNDED_BLOCK);
+    for (xsum_length j = 0; j < m; ++j, ++v1, ++v2) {
+      pr[j] = *v1 * *v2;
+    }
+    xsum_add(bacc, pr, m);
+  }
+}
+
+template <int MinExp, int MaxExp>
+void xsum_add_dot(xsum_bounded_accumulator<MinExp, MaxExp> *const bacc,
+                  std::vector<xsum_flt> const &vec1,
+                  std::vector<xsum_flt> const &vec2) {
+  xsum_length const n = static_cast<xsum_length>(vec1.size());
+  if (n == 0 || n > static_cast<xsum_length>(vec2.size())) {
     return;
   }
+  xsum_add_dot(bacc, vec1.data(), vec2.data(), n);
+}
 
-  xsum_flt const *v = vec;
+template <int MinExp, int MaxExp>
+void xsum_add_sqnorm(xsum_bounded_accumulator<MinExp, MaxExp> *const bacc,
+                     xsum_flt const *const vec, xsum_length const n) {
+  xsum_add_dot(bacc, vec, vec, n);
+}
 
-  /* Unrolled loop processing two squares each time around.  The loop is
-     done as two nested loops, arranged so that the inner one will have
-     no branches except for the one looping back.  This is achieved by
-     a trick for combining three tests for negativity into one.  The
-     last one or two squares are not done here, so that the pre-fetching
-     will not go past the end of the array (which would probably be OK,
-     but is technically not allowed). */
+template <int MinExp, int MaxExp>
+void xsum_add_sqnorm(xsum_bounded_accumulator<MinExp, MaxExp> *const bacc,
+                     std::vector<xsum_flt> const &vec) {
+  xsum_add_dot(bacc, vec.data(), vec.data(),
+               static_cast<xsum_length>(vec.size()));
+}
 
-  fpunion u1;
-  fpunion u2;
+/* ROUND AN ACCUMULATOR FOR A RANGE OF EXPONENTS TO A SMALL ACCUMULATOR.  Its
+   carries are propagated, which leaves every chunk small enough, and its
+   chunks are put in place among those of a small accumulator, to which the sum
+   of the values outside the range is added. */
+
+template <int MinExp, int MaxExp>
+xsum_small_accumulator xsum_round_to_small(
+    xsum_bounded_accumulator<MinExp, MaxExp> *const bacc) {
+  using accumulatorType = xsum_bounded_accumulator<MinExp, MaxExp>;
+
+  xsum_bounded_propagate(bacc);
+
+  xsum_small_accumulator r;
+  r.carry_budget = bacc->carry_budget;
+  r.adds_until_propagate = xsum_carry_terms(&r);
+  std::copy(bacc->chunk, bacc->chunk + accumulatorType::nchunks,
+            r.chunk + accumulatorType::base);
+  r.Inf = bacc->Inf;
+  r.NaN = bacc->NaN;
+  if (bacc->outside) {
+    xsum_add<xsum_small_accumulator>(&r, bacc->outside.get());
+  }
+  return r;
+}
 
-  int count1;
-  int count2;
+template <int MinExp, int MaxExp>
+xsum_flt xsum_round(xsum_bounded_accumulator<MinExp, MaxExp> *const bacc) {
+  xsum_small_accumulator r = xsum_round_to_small(bacc);
+  return xsum_round<xsum_small_accumulator>(&r);
+}
 
-  xsum_expint ix1;
-  xsum_expint ix2;
+/* SIGNS AND COMPARISONS.  These give the sign of the exact sum, or of the
+   exact difference of two sums, which is also the sign of the rounded result
+   (as a sum that is not zero is at least the smallest denormalized number).
+   A NaN result gives 0, and compares neither smaller nor larger.  They do not
+   round.  They first look at the uppermost chunks in use, with a bound on what
+   the chunks below can add, and only propagate carries (and add the chunks of
+   a large or windowed accumulator to its small accumulator) when these do not
+   decide. */
 
-  /* leave out last one or two, terminate when negative, for trick */
-  xsum_length m = n - 3;
-  while (m >= 0) {
-    /* Loop processing two squares at a time until we're done, or until
-       one (or both) of them result in a chunk needing to be processed.
-       Updates are done here for both of these chunks, even though it is not
-       yet known whether these updates ought to have been done.  We hope
-       this allows for better memory pre-fetch and instruction scheduling. */
+/* KIND OF THE RESULT OF A SMALL ACCUMULATOR THAT SAW AN INF OR NAN: 0 if
+   there was none, 2 for a NaN, or the sign of an Inf. */
 
-    for (;;) {
-      u1.fltv = *v * *v;
-      ++v;
-      u2.fltv = *v * *v;
-      ++v;
+static int xsum_small_inf_nan_sign(xsum_small_accumulator const *const sacc) {
+  if (sacc->NaN != 0) {
+    return 2;
+  }
+  if (sacc->Inf != 0) {
+    fpunion u;
+    u.intv = sacc->Inf;
+    /* +Inf and -Inf both seen gives a NaN */
+    if (std::isnan(u.fltv)) {
+      return 2;
+    }
+    return u.fltv > 0 ? 1 : -1;
+  }
+  return 0;
+}
 
-      ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
-      count1 = lacc->count[ix1] - 1;
-      lacc->count[ix1] = count1;
-      lacc->chunk[ix1] += u1.uintv;
+/* INDEX OF THE UPPERMOST NON-ZERO CHUNK OF A SMALL ACCUMULATOR, or -1 if all
+   are zero. */
+
+static inline int xsum_small_top(xsum_small_accumulator const *const sacc) {
+  int u = XSUM_SCHUNKS - 1;
+  while (u >= 0 && sacc->chunk[u] == 0) {
+    --u;
+  }
+  return u;
+}
 
-      ix2 = u2.uintv >> XSUM_MANTISSA_BITS;
-      count2 = lacc->count[ix2] - 1;
-      lacc->count[ix2] = count2;
-      lacc->chunk[ix2] += u2.uintv;
+/* MARGIN OF THE UPPERMOST NON-ZERO CHUNK OF A SMALL ACCUMULATOR.  After carry
+   propagation every chunk is less than 2^32 in magnitude, and each add since
+   changes a chunk by less than 2^52 (a value adds at most its mantissa shifted
+   down by one bit, and a chunk of a large accumulator or a carry propagated
+   small accumulator less than 2^32), so after n adds every chunk is less than
+   b = 2^32 + n * 2^52 in magnitude.  The chunks below the uppermost non-zero
+   one then add less than b / (2^32 - 1) units of it, which is less than the
+   margin returned.  An uppermost chunk at least this big gives the sign. */
+
+static inline xsum_schunk xsum_small_margin(
+    xsum_small_accumulator const *const sacc) {
+  xsum_schunk const n = xsum_carry_terms(sacc) - sacc->adds_until_propagate;
+  xsum_schunk const b = (static_cast<xsum_schunk>(1) << XSUM_LOW_MANTISSA_BITS) +
+                        n * (static_cast<xsum_schunk>(1) << XSUM_MANTISSA_BITS);
+  return (b >> (XSUM_LOW_MANTISSA_BITS - 1)) + 1;
+}
 
-      m -= 2;
+/* BOUNDS ON THE SUM IN A SMALL ACCUMULATOR, in units of chunk u, which must
+   not be below its uppermost non-zero chunk t (-1 if none).  The sum is in
+   the open interval (lo, hi). */
+
+static inline void xsum_small_bounds(xsum_small_accumulator const *const sacc,
+                                     int const t, int const u,
+                                     xsum_schunk *const lo,
+                                     xsum_schunk *const hi) {
+  if (t < 0) {
+    *lo = -1;
+    *hi = 1;
+    return;
+  }
+  xsum_schunk const m = xsum_small_margin(sacc);
+  xsum_schunk const c = sacc->chunk[t];
+  if (t == u) {
+    *lo = c - m;
+    *hi = c + m;
+    return;
+  }
+  /* The sum is less than |c| + m units of chunk t, and chunk u is at least
+     2^32 times bigger */
+  xsum_schunk const a = (((c < 0 ? -c : c) + m) >> XSUM_LOW_MANTISSA_BITS) + 1;
+  *lo = -a;
+  *hi = a;
+}
 
-      /* ... equivalent to while (count1 >= 0 && count2 >= 0 && m >= 0) */
-      /* ... while (((xsum_length)count1 | (xsum_length)count2 | m) >= 0); */
-      if ((static_cast<xsum_length>(count1) | static_cast<xsum_length>(count2) |
-           m) < 0) {
-        break;
-      }
-    }
+template <>
+int xsum_sign<xsum_small_accumulator>(xsum_small_accumulator *const sacc) {
+  int const s = xsum_small_inf_nan_sign(sacc);
+  if (s != 0) {
+    return s == 2 ? 0 : s;
+  }
 
-    /* See if we were actually supposed to update these chunks.  If not,
-       back out the changes and then process the chunks as they ought to
-       have been processed. */
-    if (count1 < 0 || count2 < 0) {
-      lacc->count[ix2] = count2 + 1;
-      lacc->chunk[ix2] -= u2.uintv;
+  /* The uppermost non-zero chunk decides, unless it is so small that the
+     chunks below could outweigh it. */
+  int const u = xsum_small_top(sacc);
+  if (u < 0) {
+    return 0;
+  }
 
-      if (count1 < 0) {
-        lacc->count[ix1] = count1 + 1;
-        lacc->chunk[ix1] -= u1.uintv;
-        xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix1, u1.uintv);
-        count2 = lacc->count[ix2] - 1;
+  xsum_schunk c = sacc->chunk[u];
+  xsum_schunk const m = xsum_small_margin(sacc);
+  if (c < m && c > -m) {
+    /* After carry propagation, the uppermost non-zero chunk has the sign of
+       the number (and is 0 if the number is) */
+    c = sacc->chunk[xsum_carry_propagate<xsum_small_accumulator>(sacc)];
+  }
+  return (c > 0) - (c < 0);
+}
+
+/* CALL f(k, ix) FOR EACH CHUNK OF A LARGE OR WINDOWED ACCUMULATOR THAT HOLDS
+   VALUES, with k the # of values in it, and ix the sign and exponent of these
+   values, as the index of a chunk of the large accumulator.  The chunks are
+   only read. */
+
+template <typename F>
+static inline void xsum_for_each_lchunk(
+    xsum_large_accumulator const *const lacc, F f) {
+  int const full = 1 << lacc->count_bits;
+  for (int w = 0; w < XSUM_LCHUNKS / 64; ++w) {
+    xsum_used u = lacc->chunks_used[w];
+    for (int i = w << 6; u != 0; ++i, u >>= 1) {
+      if (u & 1) {
+        int const count = lacc->lcount(i);
+        if (count >= 0 && count < full) {
+          f(full - count, i);
+        }
       }
+    }
+  }
+}
 
-      if (count2 < 0) {
-        xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix2, u2.uintv);
-      } else {
-        lacc->count[ix2] = count2;
-        lacc->chunk[ix2] += u2.uintv;
+template <typename F>
+static inline void xsum_for_each_lchunk(
+    xsum_window_accumulator const *const wacc, F f) {
+  int const full = 1 << XSUM_LCOUNT_BITS;
+  for (int w = 0; w < (XSUM_WCHUNKS + 63) / 64; ++w) {
+    xsum_used u = wacc->chunks_used[w];
+    for (int i = w << 6; u != 0; ++i, u >>= 1) {
+      if (u & 1) {
+        int const count = wacc->count[i];
+        if (count >= 0 && count < full) {
+          f(full - count, ((i & 1) << XSUM_EXP_BITS) | (wacc->base + (i >> 1)));
+        }
       }
     }
   }
+}
 
-  /* Process the last one or two squares, without pre-fetching. */
-  m += 3;
-  for (;;) {
-    u1.fltv = *v * *v;
-    ++v;
+/* POSITION OF THE TOP OF THE SUM IN A LARGE OR WINDOWED ACCUMULATOR.  The sum
+   is less than 2^p units of the lowest bit of the small accumulator
+   (2^-1075), for the p returned, or is zero if p is -1.  A value with
+   exponent e (at least 1) is less than 2^(e+53) units, and a sum in the small
+   accumulator whose uppermost non-zero chunk is t is less than 2^(32t+64). */
 
-    ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
-    count1 = lacc->count[ix1] - 1;
-    if (count1 < 0) {
-      xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix1, u1.uintv);
+template <typename accumulatorType>
+static int xsum_lchunks_top(accumulatorType const *const acc) {
+  int const t = xsum_small_top(&acc->sacc);
+  int p = t < 0 ? -1 : XSUM_LOW_MANTISSA_BITS * t + 64;
+  xsum_for_each_lchunk(acc, [&p](int const, int const ix) {
+    int const e = std::max(ix & XSUM_EXP_MASK, 1);
+    p = std::max(p, e + XSUM_MANTISSA_BITS + 1);
+  });
+  return p;
+}
+
+/* BOUNDS ON THE SUM IN A LARGE OR WINDOWED ACCUMULATOR, in units of 2^p of the
+   lowest bit of the small accumulator, with p at least the top of the sum.
+   The k values of a chunk with exponent e (at least 1) add between k * 2^(e+52)
+   and k * 2^(e+53) units, and those with exponent 0 less than k * 2^53, and
+   the small accumulator adds c +- m units of its uppermost non-zero chunk.
+   The bounds of the positive and the negative parts are summed separately, in
+   floating point, and the sum is in the open interval (lo, hi).  The slack of
+   2^-30 times the parts covers the rounding errors of the sums of at most a
+   few thousand terms, and terms below 2^-900 are dropped from the lower bounds
+   and raised to 2^-900 in the upper ones, so that nothing underflows. */
+
+template <typename accumulatorType>
+static void xsum_lchunks_bounds(accumulatorType const *const acc, int const p,
+                                xsum_flt *const lo, xsum_flt *const hi) {
+  static constexpr int XSUM_BOUND_MIN_EXP = -900;
+  auto lower = [](xsum_flt const k, int const e) {
+    return e < XSUM_BOUND_MIN_EXP ? 0.0 : std::ldexp(k, e);
+  };
+  auto upper = [](xsum_flt const k, int const e) {
+    return std::ldexp(k, std::max(e, XSUM_BOUND_MIN_EXP));
+  };
+
+  /* lower and upper bounds of the positive and negative parts */
+  xsum_flt pl = 0;
+  xsum_flt ph = 0;
+  xsum_flt nl = 0;
+  xsum_flt nh = 0;
+
+  xsum_for_each_lchunk(acc, [&](int const k, int const ix) {
+    int const e = ix & XSUM_EXP_MASK;
+    xsum_flt const l =
+        e == 0 ? 0.0 : lower(k, e + XSUM_MANTISSA_BITS - p);
+    xsum_flt const h =
+        upper(k, std::max(e, 1) + XSUM_MANTISSA_BITS + 1 - p);
+    if (ix >> XSUM_EXP_BITS) {
+      nl += l;
+      nh += h;
     } else {
-      lacc->count[ix1] = count1;
-      lacc->chunk[ix1] += u1.uintv;
+      pl += l;
+      ph += h;
+    }
+  });
+
+  xsum_small_accumulator const *const sacc = &acc->sacc;
+  int const t = xsum_small_top(sacc);
+  if (t >= 0) {
+    xsum_schunk const m = xsum_small_margin(sacc);
+    xsum_schunk const c = sacc->chunk[t];
+    xsum_schunk const a = c < 0 ? -c : c;
+    int const e = XSUM_LOW_MANTISSA_BITS * t - p;
+    xsum_flt const l = a > m ? lower(static_cast<xsum_flt>(a - m), e) : 0.0;
+    xsum_flt const h = upper(static_cast<xsum_flt>(a + m), e);
+    if (c < 0) {
+      nl += l;
+      nh += h;
+    } else {
+      pl += l;
+      ph += h;
     }
+  }
 
-    --m;
-    if (m == 0) {
-      break;
-    }
+  xsum_flt const slack = std::ldexp(1.0, -30);
+  *lo = (pl - nh) - (pl + nh) * slack;
+  *hi = (ph - nl) + (ph + nl) * slack;
+}
+
+/* SIGN OF THE SUM IN A LARGE OR WINDOWED ACCUMULATOR FROM ITS BOUNDS.  Returns
+   2 if they do not decide it, so that the chunks must be added to the small
+   accumulator. */
+
+template <typename accumulatorType>
+static int xsum_lchunks_sign(accumulatorType const *const acc) {
+  int const s = xsum_small_inf_nan_sign(&acc->sacc);
+  if (s != 0) {
+    return s == 2 ? 0 : s;
+  }
+  int const p = xsum_lchunks_top(acc);
+  if (p < 0) {
+    return 0;
+  }
+  xsum_flt lo;
+  xsum_flt hi;
+  xsum_lchunks_bounds(acc, p, &lo, &hi);
+  if (lo > 0) {
+    return 1;
   }
+  if (hi < 0) {
+    return -1;
+  }
+  return 2;
 }
 
 template <>
-void xsum_add_sqnorm<xsum_small_accumulator>(xsum_small_accumulator *const sacc,
-                                             std::vector<xsum_flt> const &vec) {
-  xsum_length n = static_cast<xsum_length>(vec.size());
-  if (n == 0) {
-    return;
+int xsum_sign<xsum_large_accumulator>(xsum_large_accumulator *const lacc) {
+  int const s = xsum_lchunks_sign(lacc);
+  if (s != 2) {
+    return s;
   }
+  return xsum_sign<xsum_small_accumulator>(
+      xsum_round_to_small_ptr<xsum_large_accumulator>(lacc));
+}
 
-  xsum_flt const *v = vec.data();
-
-  while (n > 1) {
-    if (sacc->adds_until_propagate == 0) {
-      xsum_carry_propagate<xsum_small_accumulator>(sacc);
-    }
-
-    xsum_length const m = n - 1 <= sacc->adds_until_propagate
-                              ? n - 1
-                              : sacc->adds_until_propagate;
-    xsum_add_sqnorm_no_carry<xsum_small_accumulator>(sacc, v, m + 1);
-    sacc->adds_until_propagate -= m;
-    v += m;
-    n -= m;
+template <>
+int xsum_sign<xsum_window_accumulator>(xsum_window_accumulator *const wacc) {
+  int const s = xsum_lchunks_sign(wacc);
+  if (s != 2) {
+    return s;
   }
-
-  xsum_add(sacc, *v * *v);
+  return xsum_sign<xsum_small_accumulator>(
+      xsum_round_to_small_ptr<xsum_window_accumulator>(wacc));
 }
 
 template <>
-void xsum_add_sqnorm<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
-                                             std::vector<xsum_flt> const &vec) {
-  xsum_length const n = static_cast<xsum_length>(vec.size());
-  if (n == 0) {
-    return;
-  }
+bool xsum_is_zero<xsum_small_accumulator>(xsum_small_accumulator *const sacc) {
+  return xsum_small_inf_nan_sign(sacc) == 0 &&
+         xsum_sign<xsum_small_accumulator>(sacc) == 0;
+}
 
-  xsum_flt const *v = vec.data();
+template <>
+bool xsum_is_zero<xsum_large_accumulator>(xsum_large_accumulator *const lacc) {
+  return xsum_small_inf_nan_sign(&lacc->sacc) == 0 &&
+         xsum_sign<xsum_large_accumulator>(lacc) == 0;
+}
 
-  /* Unrolled loop processing two squares each time around.  The loop is
-     done as two nested loops, arranged so that the inner one will have
-     no branches except for the one looping back.  This is achieved by
-     a trick for combining three tests for negativity into one.  The
-     last one or two squares are not done here, so that the pre-fetching
-     will not go past the end of the array (which would probably be OK,
-     but is technically not allowed). */
+template <>
+bool xsum_is_zero<xsum_window_accumulator>(
+    xsum_window_accumulator *const wacc) {
+  return xsum_small_inf_nan_sign(&wacc->sacc) == 0 &&
+         xsum_sign<xsum_window_accumulator>(wacc) == 0;
+}
 
-  fpunion u1;
-  fpunion u2;
+/* COMPARISON OF TWO SUMS THAT SAW AN INF OR NAN.  Returns -1, 0, or 1 as
+   for xsum_compare, or 2 if neither did. */
 
-  int count1;
-  int count2;
+static int xsum_compare_inf_nan(xsum_small_accumulator const *const sacc1,
+                                xsum_small_accumulator const *const sacc2) {
+  int const s1 = xsum_small_inf_nan_sign(sacc1);
+  int const s2 = xsum_small_inf_nan_sign(sacc2);
+  if (s1 == 2 || s2 == 2) {
+    return 0;
+  }
+  if (s1 != 0 || s2 != 0) {
+    /* An Inf beats any finite sum */
+    return (s1 > s2) - (s1 < s2);
+  }
+  return 2;
+}
 
-  xsum_expint ix1;
-  xsum_expint ix2;
+/* COMPARE TWO SMALL ACCUMULATORS.  Returns -1, 0, or 1 as the sum in sacc1 is
+   smaller than, equal to, or larger than the sum in sacc2.  The bounds of the
+   two sums in units of the higher of their uppermost non-zero chunks decide
+   if they do not overlap.  Otherwise, after carry propagation, the chunks
+   below the uppermost non-zero one are all in [0, 2^XSUM_LOW_MANTISSA_BITS),
+   so the first chunk from the top that differs decides. */
 
-  /* leave out last one or two, terminate when negative, for trick */
-  xsum_length m = n - 3;
-  while (m >= 0) {
-    /* Loop processing two squares at a time until we're done, or until
-       one (or both) of them result in a chunk needing to be processed.
-       Updates are done here for both of these chunks, even though it is not
-       yet known whether these updates ought to have been done.  We hope
-       this allows for better memory pre-fetch and instruction scheduling. */
+template <>
+int xsum_compare<xsum_small_accumulator>(xsum_small_accumulator *const sacc1,
+                                         xsum_small_accumulator *const sacc2) {
+  int const s = xsum_compare_inf_nan(sacc1, sacc2);
+  if (s != 2) {
+    return s;
+  }
 
-    for (;;) {
-      u1.fltv = *v * *v;
-      ++v;
-      u2.fltv = *v * *v;
-      ++v;
+  int const t1 = xsum_small_top(sacc1);
+  int const t2 = xsum_small_top(sacc2);
+  int const u = std::max(t1, t2);
+  if (u < 0) {
+    return 0;
+  }
+  xsum_schunk lo1;
+  xsum_schunk hi1;
+  xsum_schunk lo2;
+  xsum_schunk hi2;
+  xsum_small_bounds(sacc1, t1, u, &lo1, &hi1);
+  xsum_small_bounds(sacc2, t2, u, &lo2, &hi2);
+  if (hi1 <= lo2) {
+    return -1;
+  }
+  if (hi2 <= lo1) {
+    return 1;
+  }
 
-      ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
-      count1 = lacc->count[ix1] - 1;
-      lacc->count[ix1] = count1;
-      lacc->chunk[ix1] += u1.uintv;
+  xsum_carry_propagate<xsum_small_accumulator>(sacc1);
+  xsum_carry_propagate<xsum_small_accumulator>(sacc2);
 
-      ix2 = u2.uintv >> XSUM_MANTISSA_BITS;
-      count2 = lacc->count[ix2] - 1;
-      lacc->count[ix2] = count2;
-      lacc->chunk[ix2] += u2.uintv;
+  for (int i = XSUM_SCHUNKS - 1; i >= 0; --i) {
+    xsum_schunk const c1 = sacc1->chunk[i];
+    xsum_schunk const c2 = sacc2->chunk[i];
+    if (c1 != c2) {
+      return c1 > c2 ? 1 : -1;
+    }
+  }
+  return 0;
+}
 
-      m -= 2;
+/* COMPARE TWO LARGE OR WINDOWED ACCUMULATORS FROM THEIR BOUNDS, in units of
+   the higher of their tops.  Returns 2 if they overlap. */
 
-      /* ... equivalent to while (count1 >= 0 && count2 >= 0 && m >= 0) */
-      /* ... while (((xsum_length)count1 | (xsum_length)count2 | m) >= 0); */
-      if ((static_cast<xsum_length>(count1) | static_cast<xsum_length>(count2) |
-           m) < 0) {
-        break;
-      }
-    }
+template <typename accumulatorType>
+static int xsum_lchunks_compare(accumulatorType const *const acc1,
+                                accumulatorType const *const acc2) {
+  int const s = xsum_compare_inf_nan(&acc1->sacc, &acc2->sacc);
+  if (s != 2) {
+    return s;
+  }
+  int const p = std::max(xsum_lchunks_top(acc1), xsum_lchunks_top(acc2));
+  if (p < 0) {
+    return 0;
+  }
+  xsum_flt lo1;
+  xsum_flt hi1;
+  xsum_flt lo2;
+  xsum_flt hi2;
+  xsum_lchunks_bounds(acc1, p, &lo1, &hi1);
+  xsum_lchunks_bounds(acc2, p, &lo2, &hi2);
+  if (hi1 <= lo2) {
+    return -1;
+  }
+  if (hi2 <= lo1) {
+    return 1;
+  }
+  return 2;
+}
 
-    /* See if we were actually supposed to update these chunks.  If not,
-       back out the changes and then process the chunks as they ought to
-       have been processed. */
-    if (count1 < 0 || count2 < 0) {
-      lacc->count[ix2] = count2 + 1;
-      lacc->chunk[ix2] -= u2.uintv;
+template <>
+int xsum_compare<xsum_large_accumulator>(xsum_large_accumulator *const lacc1,
+                                         xsum_large_accumulator *const lacc2) {
+  int const s = xsum_lchunks_compare(lacc1, lacc2);
+  if (s != 2) {
+    return s;
+  }
+  return xsum_compare<xsum_small_accumulator>(
+      xsum_round_to_small_ptr<xsum_large_accumulator>(lacc1),
+      xsum_round_to_small_ptr<xsum_large_accumulator>(lacc2));
+}
 
-      if (count1 < 0) {
-        lacc->count[ix1] = count1 + 1;
-        lacc->chunk[ix1] -= u1.uintv;
-        xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix1, u1.uintv);
-        count2 = lacc->count[ix2] - 1;
-      }
+template <>
+int xsum_compare<xsum_window_accumulator>(
+    xsum_window_accumulator *const wacc1,
+    xsum_window_accumulator *const wacc2) {
+  int const s = xsum_lchunks_compare(wacc1, wacc2);
+  if (s != 2) {
+    return s;
+  }
+  return xsum_compare<xsum_small_accumulator>(
+      xsum_round_to_small_ptr<xsum_window_accumulator>(wacc1),
+      xsum_round_to_small_ptr<xsum_window_accumulator>(wacc2));
+}
 
-      if (count2 < 0) {
-        xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix2, u2.uintv);
-      } else {
-        lacc->count[ix2] = count2;
-        lacc->chunk[ix2] += u2.uintv;
-      }
-    }
-  }
+/* NEGATION, SUBTRACTION, AND MULTIPLICATION BY POWERS OF TWO.  These are
+   exact, and work on the chunks of the small accumulator, so that neither the
+   sum is rounded nor the terms are added again.  The large and windowed
+   accumulators first add their chunks in use to their small accumulator,
+   except for subtraction, which can go to the small accumulator directly. */
 
-  /* Process the last one or two squares, without pre-fetching. */
-  m += 3;
-  for (;;) {
-    u1.fltv = *v * *v;
-    ++v;
+/* INF FIELD OF A SMALL ACCUMULATOR FOR THE NEGATED SUM.  A NaN from Infs of
+   both signs stays a NaN. */
 
-    ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
-    count1 = lacc->count[ix1] - 1;
-    if (count1 < 0) {
-      xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix1, u1.uintv);
-    } else {
-      lacc->count[ix1] = count1;
-      lacc->chunk[ix1] += u1.uintv;
-    }
+static inline xsum_int xsum_small_negate_inf(xsum_int const inf) {
+  return inf == 0 ? 0 : static_cast<xsum_int>(inf ^ XSUM_SIGN_MASK);
+}
 
-    --m;
-    if (m == 0) {
-      break;
-    }
+template <>
+void xsum_negate<xsum_small_accumulator>(xsum_small_accumulator *const sacc) {
+  /* The chunks keep their magnitudes, so the count of adds until the next
+     carry propagation still holds. */
+  for (int i = 0; i < XSUM_SCHUNKS; ++i) {
+    sacc->chunk[i] = -sacc->chunk[i];
   }
+  sacc->Inf = xsum_small_negate_inf(sacc->Inf);
 }
 
 template <>
-void xsum_add_dot<xsum_small_accumulator>(xsum_small_accumulator *const sacc,
-                                          xsum_flt const *const vec1,
-                                          xsum_flt const *const vec2,
-                                          xsum_length const c) {
-  if (c == 0) {
-    return;
-  }
+void xsum_negate<xsum_large_accumulator>(xsum_large_accumulator *const lacc) {
+  xsum_negate<xsum_small_accumulator>(
+      xsum_round_to_small_ptr<xsum_large_accumulator>(lacc));
+}
 
-  xsum_flt const *v1 = vec1;
-  xsum_flt const *v2 = vec2;
-  xsum_length n = c;
+template <>
+void xsum_negate<xsum_window_accumulator>(xsum_window_accumulator *const wacc) {
+  xsum_negate<xsum_small_accumulator>(
+      xsum_round_to_small_ptr<xsum_window_accumulator>(wacc));
+}
 
-  while (n > 1) {
+/* SUBTRACT A SMALL ACCUMULATOR FROM ANOTHER.  As for the add, but with the
+   chunks subtracted and the sign of an Inf in value flipped.  The chunks of
+   either accumulator may hold up to a carry budget of adds, so the carries of
+   both (of a copy of value) are propagated first, and the subtraction then
+   counts as a single add. */
+
+template <>
+void xsum_sub<xsum_small_accumulator>(
+    xsum_small_accumulator *const sacc,
+    xsum_small_accumulator const *const value) {
+  if (value->Inf != 0 || value->NaN != 0 || sacc->NaN != 0) {
     if (sacc->adds_until_propagate == 0) {
       xsum_carry_propagate<xsum_small_accumulator>(sacc);
     }
-    xsum_length const m = n - 1 <= sacc->adds_until_propagate
-                              ? n - 1
-                              : sacc->adds_until_propagate;
-    xsum_add_dot_no_carry<xsum_small_accumulator>(sacc, v1, v2, m + 1);
-    sacc->adds_until_propagate -= m;
-    v1 += m;
-    v2 += m;
-    n -= m;
+
+    /* Only the Inf and NaN fields matter */
+    xsum_small_accumulator neg;
+    neg.Inf = xsum_small_negate_inf(value->Inf);
+    neg.NaN = value->NaN;
+    xsum_add_no_carry<xsum_small_accumulator>(sacc, &neg);
+  } else {
+    xsum_carry_propagate<xsum_small_accumulator>(sacc);
+
+    xsum_small_accumulator v = *value;
+    xsum_carry_propagate<xsum_small_accumulator>(&v);
+
+    xsum_schunk *sacc_chunk = sacc->chunk;
+    xsum_schunk const *const value_chunk = v.chunk;
+    for (int i = 0; i < XSUM_SCHUNKS; ++i) {
+      sacc_chunk[i] -= value_chunk[i];
+    }
   }
 
-  xsum_add(sacc, *v1 * *v2);
+  --sacc->adds_until_propagate;
 }
 
 template <>
-void xsum_add_dot<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
-                                          xsum_flt const *const vec1,
-                                          xsum_flt const *const vec2,
-                                          xsum_length const n) {
-  if (n == 0) {
-    return;
-  }
-
-  xsum_flt const *v1 = vec1;
-  xsum_flt const *v2 = vec2;
+void xsum_sub<xsum_small_accumulator>(xsum_small_accumulator *const sacc,
+                                      xsum_small_accumulator *const value) {
+  xsum_sub<xsum_small_accumulator>(
+      sacc, static_cast<xsum_small_accumulator const *>(value));
+}
 
-  /* Version that's been manually optimized:  Loop unrolled, pre-fetch
-     attempted, branches eliminated, ... */
+template <>
+void xsum_sub<xsum_large_accumulator>(
+    xsum_large_accumulator *const lacc,
+    xsum_small_accumulator const *const value) {
+  xsum_sub<xsum_small_accumulator>(&lacc->sacc, value);
+}
 
-  // union fpunion u1, u2;
-  // int count1, count2;
-  // xsum_expint ix1, ix2;
-  // const xsum_flt *v1, *v2;
-  // xsum_flt f1, f2;
-  // xsum_length m;
+template <>
+void xsum_sub<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
+                                      xsum_large_accumulator *const value) {
+  xsum_small_accumulator const *const sacc =
+      xsum_round_to_small_ptr<xsum_large_accumulator>(value);
+  xsum_sub<xsum_large_accumulator>(lacc, sacc);
+}
 
-  fpunion u1;
-  fpunion u2;
+template <>
+void xsum_sub<xsum_window_accumulator>(
+    xsum_window_accumulator *const wacc,
+    xsum_small_accumulator const *const value) {
+  xsum_sub<xsum_small_accumulator>(&wacc->sacc, value);
+}
 
-  int count1;
-  int count2;
+template <>
+void xsum_sub<xsum_window_accumulator>(xsum_window_accumulator *const wacc,
+                                       xsum_window_accumulator *const value) {
+  xsum_small_accumulator const *const sacc =
+      xsum_round_to_small_ptr<xsum_window_accumulator>(value);
+  xsum_sub<xsum_window_accumulator>(wacc, sacc);
+}
 
-  xsum_expint ix1;
-  xsum_expint ix2;
+/* MULTIPLY THE SUM IN A SMALL ACCUMULATOR BY 2^exp.  After carry propagation,
+   every chunk but the top one is in [0, 2^32), and the top one in
+   [-2^32, 2^32), so shifting a chunk left by exp mod 32 bits cannot overflow.
+   The low and high 32 bits of the result are added to the chunks floor(exp/32)
+   and floor(exp/32)+1 places above.  A final carry pass then brings the chunks
+   back to the form left by carry propagation, with two spare chunks at the top
+   that tell whether the result still fits, and one at the bottom that holds
+   the bits shifted below chunk 0.  The lowest bit of chunk 0 is half the
+   smallest denormalized number, which no sum of doubles has set, and which
+   xsum_round ignores, so the result is rounded to a multiple of the smallest
+   denormalized number, to nearest with ties to even.  A result too large for
+   the accumulator becomes an Inf of the same sign.  Returns true if the result
+   is exact.  An Inf or NaN is left as it is. */
 
-  /* Unrolled loop processing two products each time around.  The loop is
-     done as two nested loops, arranged so that the inner one will have
-     no branches except for the one looping back.  This is achieved by
-     a trick for combining three tests for negativity into one.  The
-     last one or two products are not done here, so that the pre-fetching
-     will not go past the end of the array (which would probably be OK,
-     but is technically not allowed). */
+template <>
+bool xsum_ldexp<xsum_small_accumulator>(xsum_small_accumulator *const sacc,
+                                        int const exp) {
+  if (sacc->Inf != 0 || sacc->NaN != 0) {
+    return true;
+  }
 
-  /* leave out last one or two, terminate when negative, for trick */
-  xsum_length m = n - 3;
-  while (m >= 0) {
-    /* Loop processing two products at a time until we're done, or until
-       one (or both) of them result in a chunk needing to be processed.
-       Updates are done here for both of these chunks, even though it is not
-       yet known whether these updates ought to have been done.  We hope
-       this allows for better memory pre-fetch and instruction scheduling. */
+  int const u = xsum_carry_propagate<xsum_small_accumulator>(sacc);
+  xsum_schunk const top = sacc->chunk[u];
+  if (top == 0 || exp == 0) {
+    return true;
+  }
 
-    for (;;) {
-      u1.fltv = *v1 * *v2;
-      ++v1;
-      ++v2;
-      u2.fltv = *v1 * *v2;
-      ++v1;
-      ++v2;
+  /* exp = q * 32 + r, with 0 <= r < 32 */
+  int const r = exp & (XSUM_LOW_MANTISSA_BITS - 1);
+  int const q = (exp - r) / XSUM_LOW_MANTISSA_BITS;
 
-      ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
-      count1 = lacc->count[ix1] - 1;
-      lacc->count[ix1] = count1;
-      lacc->chunk[ix1] += u1.uintv;
+  /* t[j + 1] is chunk j of the result */
+  static constexpr int N = XSUM_SCHUNKS + 3;
+  xsum_schunk t[N] = {};
 
-      ix2 = u2.uintv >> XSUM_MANTISSA_BITS;
-      count2 = lacc->count[ix2] - 1;
-      lacc->count[ix2] = count2;
-      lacc->chunk[ix2] += u2.uintv;
+  /* true if bits were shifted out below t[0] */
+  bool sticky = false;
+  bool overflow = false;
 
-      m -= 2;
+  for (int i = 0; i <= u; ++i) {
+    xsum_schunk const c = sacc->chunk[i];
+    if (c == 0) {
+      continue;
+    }
 
-      /* ... equivalent to while (count1 >= 0 && count2 >= 0 && m >= 0) */
-      /* ... while (((xsum_length)count1 | (xsum_length)count2 | m) >= 0); */
-      if ((static_cast<xsum_length>(count1) | static_cast<xsum_length>(count2) |
-           m) < 0) {
-        break;
-      }
+    int const j = i + q + 1;
+    if (j >= N - 1) {
+      overflow = true;
+      break;
     }
 
-    /* See if we were actually supposed to update these chunks.  If not,
-       back out the changes and then process the chunks as they ought to
-       have been processed. */
+    xsum_schunk const v = c * (static_cast<xsum_schunk>(1) << r);
+    xsum_schunk const lo = v & XSUM_LOW_MANTISSA_MASK;
+    xsum_schunk const hi = v >> XSUM_LOW_MANTISSA_BITS;
 
-    if (count1 < 0 || count2 < 0) {
-      lacc->count[ix2] = count2 + 1;
-      lacc->chunk[ix2] -= u2.uintv;
+    if (j >= 0) {
+      t[j] += lo;
+    } else if (lo != 0) {
+      sticky = true;
+    }
+    if (j + 1 >= 0) {
+      t[j + 1] += hi;
+    } else if (hi != 0) {
+      /* Only the top chunk can be negative, so the whole sum is in (-1, 0)
+         here if hi is, and is -1 in t[0] with the rest shifted out */
+      sticky = true;
+      t[0] -= hi < 0;
+    }
+  }
 
-      if (count1 < 0) {
-        lacc->count[ix1] = count1 + 1;
-        lacc->chunk[ix1] -= u1.uintv;
-        xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix1, u1.uintv);
-        count2 = lacc->count[ix2] - 1;
-      }
+  if (!overflow) {
+    for (int j = 0; j < N - 1; ++j) {
+      t[j + 1] += t[j] >> XSUM_LOW_MANTISSA_BITS;
+      t[j] &= XSUM_LOW_MANTISSA_MASK;
+    }
 
-      if (count2 < 0) {
-        xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix2, u2.uintv);
-      } else {
-        lacc->count[ix2] = count2;
-        lacc->chunk[ix2] += u2.uintv;
+    /* Round away the bits below the smallest denormalized number, which are
+       all non-negative after the carry pass */
+    xsum_schunk const half = t[1] & 1;
+    bool const below = sticky || t[0] != 0;
+    if (half != 0 || below) {
+      t[1] -= half;
+      t[0] = 0;
+      if (half != 0 && (below || (t[1] & 2) != 0)) {
+        t[1] += 2;
+        for (int j = 1; j < N - 1; ++j) {
+          t[j + 1] += t[j] >> XSUM_LOW_MANTISSA_BITS;
+          t[j] &= XSUM_LOW_MANTISSA_MASK;
+        }
       }
     }
-  }
-
-  /* Process the last one or two products, without pre-fetching. */
-  m += 3;
-  for (;;) {
-    u1.fltv = *v1 * *v2;
-    ++v1;
-    ++v2;
 
-    ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
-    count1 = lacc->count[ix1] - 1;
-    if (count1 < 0) {
-      xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix1, u1.uintv);
-    } else {
-      lacc->count[ix1] = count1;
-      lacc->chunk[ix1] += u1.uintv;
+    /* A negative result that fits has all ones in the spare chunks, which are
+       folded into the top chunk of the accumulator. */
+    if (t[N - 1] == -1 && t[N - 2] == XSUM_LOW_MANTISSA_MASK) {
+      t[N - 3] -= static_cast<xsum_schunk>(1) << XSUM_LOW_MANTISSA_BITS;
+    } else if (t[N - 1] != 0 || t[N - 2] != 0) {
+      overflow = true;
     }
 
-    --m;
-    if (m == 0) {
-      break;
+    if (!overflow) {
+      std::copy(t + 1, t + 1 + XSUM_SCHUNKS, sacc->chunk);
+      sacc->adds_until_propagate = xsum_carry_terms(sacc) - 1;
+      return half == 0 && !below;
     }
   }
+
+  xsum_int const inf = static_cast<xsum_int>(XSUM_EXP_MASK)
+                       << XSUM_MANTISSA_BITS;
+  sacc->Inf = top > 0 ? inf : xsum_small_negate_inf(inf);
+  std::fill(sacc->chunk, sacc->chunk + XSUM_SCHUNKS, 0);
+  return false;
 }
 
 template <>
-void xsum_add_dot<xsum_small_accumulator>(xsum_small_accumulator *const sacc,
-                                          std::vector<xsum_flt> const &vec1,
-                                          std::vector<xsum_flt> const &vec2) {
-  xsum_length n = static_cast<xsum_length>(vec1.size());
-  if (n == 0 || n > static_cast<xsum_length>(vec2.size())) {
-    return;
-  }
+bool xsum_ldexp<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
+                                        int const exp) {
+  return xsum_ldexp<xsum_small_accumulator>(
+      xsum_round_to_small_ptr<xsum_large_accumulator>(lacc), exp);
+}
 
-  xsum_flt const *v1 = vec1.data();
-  xsum_flt const *v2 = vec2.data();
+template <>
+bool xsum_ldexp<xsum_window_accumulator>(xsum_window_accumulator *const wacc,
+                                         int const exp) {
+  return xsum_ldexp<xsum_small_accumulator>(
+      xsum_round_to_small_ptr<xsum_window_accumulator>(wacc), exp);
+}
 
-  while (n > 1) {
-    if (sacc->adds_until_propagate == 0) {
-      xsum_carry_propagate<xsum_small_accumulator>(sacc);
+/* SNAPSHOT AND ROLLBACK.  A snapshot saves the sum in a small accumulator,
+   and a rollback sets the accumulator back to a saved sum.  A chunk of a
+   large accumulator whose count is not -1 always has its bit set in
+   chunks_used.  The snapshot adds these chunks to the small accumulator and
+   marks them unused again, so that afterwards the chunks with their bit set
+   are exactly those changed since.  The rollback marks just these unused, and
+   copies the saved small accumulator, instead of the whole large one.  Both
+   cost in proportion to the chunks used since the last snapshot. */
+
+/* MARK THE CHUNKS IN USE OF A LARGE ACCUMULATOR UNUSED.  If add is true, they
+   are first added to the small accumulator. */
+
+static void xsum_large_clear_used(xsum_large_accumulator *const lacc,
+                                  bool const add) {
+  xsum_used uu = lacc->used_used;
+  for (int w = 0; uu != 0; ++w, uu >>= 1) {
+    if ((uu & 1) == 0) {
+      continue;
     }
-    xsum_length const m = n - 1 <= sacc->adds_until_propagate
-                              ? n - 1
-                              : sacc->adds_until_propagate;
-    xsum_add_dot_no_carry<xsum_small_accumulator>(sacc, v1, v2, m + 1);
-    sacc->adds_until_propagate -= m;
-    v1 += m;
-    v2 += m;
-    n -= m;
+    xsum_used u = lacc->chunks_used[w];
+    for (int ix = w << 6; u != 0; ++ix, u >>= 1) {
+      if ((u & 1) && lacc->lcount(ix) >= 0) {
+        if (add) {
+          xsum_small_add_lchunk(&lacc->sacc, lacc->lchunk(ix),
+                                lacc->lcount(ix), ix, lacc->count_bits);
+        }
+        lacc->lcount(ix) = -1;
+      }
+    }
+    lacc->chunks_used[w] = 0;
   }
+  lacc->used_used = 0;
+}
 
-  xsum_add(sacc, *v1 * *v2);
+template <>
+void xsum_snapshot<xsum_small_accumulator>(
+    xsum_small_accumulator *const sacc, xsum_small_accumulator *const snap) {
+  *snap = *sacc;
 }
 
 template <>
-void xsum_add_dot<xsum_large_accumulator>(xsum_large_accumulator *const lacc,
-                                          std::vector<xsum_flt> const &vec1,
-                                          std::vector<xsum_flt> const &vec2) {
-  xsum_length const n = static_cast<xsum_length>(vec1.size());
-  if (n == 0 || n > static_cast<xsum_length>(vec2.size())) {
-    return;
-  }
+void xsum_snapshot<xsum_large_accumulator>(
+    xsum_large_accumulator *const lacc, xsum_small_accumulator *const snap) {
+  xsum_large_clear_used(lacc, true);
+  *snap = lacc->sacc;
+}
 
-  xsum_flt const *v1 = vec1.data();
-  xsum_flt const *v2 = vec2.data();
+template <>
+void xsum_rollback<xsum_small_accumulator>(
+    xsum_small_accumulator *const sacc,
+    xsum_small_accumulator const *const snap) {
+  *sacc = *snap;
+}
 
-  /* Version that's been manually optimized:  Loop unrolled, pre-fetch
-     attempted, branches eliminated, ... */
+template <>
+void xsum_rollback<xsum_large_accumulator>(
+    xsum_large_accumulator *const lacc,
+    xsum_small_accumulator const *const snap) {
+  xsum_large_clear_used(lacc, false);
+  lacc->sacc = *snap;
+}
 
-  // union fpunion u1, u2;
-  // int count1, count2;
-  // xsum_expint ix1, ix2;
-  // const xsum_flt *v1, *v2;
-  // xsum_flt f1, f2;
-  // xsum_length m;
+/* COMPLEX NUMBERS.  std::complex<xsum_flt> is laid out as an array of two
+   xsum_flt, real part first.  The interleaved values are read once, a block
+   at a time, and split into real and imaginary buffers that stay in cache,
+   which are then summed with the vector functions above.  The same code
+   serves both small and large accumulators. */
 
-  fpunion u1;
-  fpunion u2;
+template <typename accumulatorType>
+void xsum_add(accumulatorType *const acc_real, accumulatorType *const acc_imag,
+              std::complex<xsum_flt> const *const vec, xsum_length const n) {
+  xsum_flt re[XSUM_COMPLEX_BLOCK];
+  xsum_flt im[XSUM_COMPLEX_BLOCK];
 
-  int count1;
-  int count2;
+  xsum_flt const *v = reinterpret_cast<xsum_flt const *>(vec);
 
-  xsum_expint ix1;
-  xsum_expint ix2;
+  for (xsum_length i = 0; i < n; i += XSUM_COMPLEX_BLOCK) {
+    xsum_length const m = std::min<xsum_length>(n - i, XSUM_COMPLEX_BLOCK);
+    for (xsum_length j = 0; j < m; ++j, v += 2) {
+      re[j] = v[0];
+      im[j] = v[1];
+    }
+    xsum_add<accumulatorType>(acc_real, re, m);
+    xsum_add<accumulatorType>(acc_imag, im, m);
+  }
+}
 
-  /* Unrolled loop processing two products each time around.  The loop is
-     done as two nested loops, arranged so that the inner one will have
-     no branches except for the one looping back.  This is achieved by
-     a trick for combining three tests for negativity into one.  The
-     last one or two products are not done here, so that the pre-fetching
-     will not go past the end of the array (which would probably be OK,
-     but is technically not allowed). */
+template <typename accumulatorType>
+void xsum_add(accumulatorType *const acc_real, accumulatorType *const acc_imag,
+              std::vector<std::complex<xsum_flt>> const &vec) {
+  xsum_add<accumulatorType>(acc_real, acc_imag, vec.data(),
+                            static_cast<xsum_length>(vec.size()));
+}
 
-  /* leave out last one or two, terminate when negative, for trick */
-  xsum_length m = n - 3;
-  while (m >= 0) {
-    /* Loop processing two products at a time until we're done, or until
-       one (or both) of them result in a chunk needing to be processed.
-       Updates are done here for both of these chunks, even though it is not
-       yet known whether these updates ought to have been done.  We hope
-       this allows for better memory pre-fetch and instruction scheduling. */
+template <typename accumulatorType>
+void xsum_add_sqnorm(accumulatorType *const acc,
+                     std::complex<xsum_flt> const *const vec,
+                     xsum_length const n) {
+  /* |z|^2 = re^2 + im^2, so the squared norm of n complex numbers is the
+     squared norm of the 2n interleaved parts.  Done in blocks, so that 2n
+     can not overflow. */
+  xsum_flt const *v = reinterpret_cast<xsum_flt const *>(vec);
+
+  for (xsum_length i = 0; i < n; i += XSUM_COMPLEX_BLOCK) {
+    xsum_length const m = std::min<xsum_length>(n - i, XSUM_COMPLEX_BLOCK);
+    xsum_add_sqnorm<accumulatorType>(acc, v, 2 * m);
+    v += 2 * m;
+  }
+}
 
-    for (;;) {
-      u1.fltv = *v1 * *v2;
-      ++v1;
-      ++v2;
-      u2.fltv = *v1 * *v2;
-      ++v1;
-      ++v2;
+template <typename accumulatorType>
+void xsum_add_sqnorm(accumulatorType *const acc,
+                     std::vector<std::complex<xsum_flt>> const &vec) {
+  xsum_add_sqnorm<accumulatorType>(acc, vec.data(),
+                                   static_cast<xsum_length>(vec.size()));
+}
 
-      ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
-      count1 = lacc->count[ix1] - 1;
-      lacc->count[ix1] = count1;
-      lacc->chunk[ix1] += u1.uintv;
+template <typename accumulatorType>
+void xsum_add_dot(accumulatorType *const acc_real,
+                  accumulatorType *const acc_imag,
+                  std::complex<xsum_flt> const *const vec1,
+                  std::complex<xsum_flt> const *const vec2,
+                  xsum_length const n) {
+  /* (a + ib)(c + id) = (ac - bd) + i(ad + bc).  Each product is rounded, as
+     in the real dot product, and then summed exactly. */
+  xsum_flt re[2 * XSUM_COMPLEX_BLOCK];
+  xsum_flt im[2 * XSUM_COMPLEX_BLOCK];
+
+  xsum_flt const *v1 = reinterpret_cast<xsum_flt const *>(vec1);
+  xsum_flt const *v2 = reinterpret_cast<xsum_flt const *>(vec2);
+
+  for (xsum_length i = 0; i < n; i += XSUM_COMPLEX_BLOCK) {
+    xsum_length const m = std::min<xsum_length>(n - i, XSUM_COMPLEX_BLOCK);
+    for (xsum_length j = 0; j < 2 * m; j += 2, v1 += 2, v2 += 2) {
+      re[j] = v1[0] * v2[0];
+      re[j + 1] = -(v1[1] * v2[1]);
+      im[j] = v1[0] * v2[1];
+      im[j + 1] = v1[1] * v2[0];
+    }
+    xsum_add<accumulatorType>(acc_real, re, 2 * m);
+    xsum_add<accumulatorType>(acc_imag, im, 2 * m);
+  }
+}
 
-      ix2 = u2.uintv >> XSUM_MANTISSA_BITS;
-      count2 = lacc->count[ix2] - 1;
-      lacc->count[ix2] = count2;
-      lacc->chunk[ix2] += u2.uintv;
+template <typename accumulatorType>
+void xsum_add_dot(accumulatorType *const acc_real,
+                  accumulatorType *const acc_imag,
+                  std::vector<std::complex<xsum_flt>> const &vec1,
+                  std::vector<std::complex<xsum_flt>> const &vec2) {
+  xsum_length const n = static_cast<xsum_length>(vec1.size());
+  if (n == 0 || n > static_cast<xsum_length>(vec2.size())) {
+    return;
+  }
+  xsum_add_dot<accumulatorType>(acc_real, acc_imag, vec1.data(), vec2.data(),
+                                n);
+}
 
-      m -= 2;
+template <typename accumulatorType>
+void xsum_add_dotc(accumulatorType *const acc_real,
+                   accumulatorType *const acc_imag,
+                   std::complex<xsum_flt> const *const vec1,
+                   std::complex<xsum_flt> const *const vec2,
+                   xsum_length const n) {
+  /* (a - ib)(c + id) = (ac + bd) + i(ad - bc) */
+  xsum_flt re[2 * XSUM_COMPLEX_BLOCK];
+  xsum_flt im[2 * XSUM_COMPLEX_BLOCK];
+
+  xsum_flt const *v1 = reinterpret_cast<xsum_flt const *>(vec1);
+  xsum_flt const *v2 = reinterpret_cast<xsum_flt const *>(vec2);
+
+  for (xsum_length i = 0; i < n; i += XSUM_COMPLEX_BLOCK) {
+    xsum_length const m = std::min<xsum_length>(n - i, XSUM_COMPLEX_BLOCK);
+    for (xsum_length j = 0; j < 2 * m; j += 2, v1 += 2, v2 += 2) {
+      re[j] = v1[0] * v2[0];
+      re[j + 1] = v1[1] * v2[1];
+      im[j] = v1[0] * v2[1];
+      im[j + 1] = -(v1[1] * v2[0]);
+    }
+    xsum_add<accumulatorType>(acc_real, re, 2 * m);
+    xsum_add<accumulatorType>(acc_imag, im, 2 * m);
+  }
+}
 
-      /* ... equivalent to while (count1 >= 0 && count2 >= 0 && m >= 0) */
-      /* ... while (((xsum_length)count1 | (xsum_length)count2 | m) >= 0); */
-      if ((static_cast<xsum_length>(count1) | static_cast<xsum_length>(count2) |
-           m) < 0) {
-        break;
-      }
-    }
+template <typename accumulatorType>
+void xsum_add_dotc(accumulatorType *const acc_real,
+                   accumulatorType *const acc_imag,
+                   std::vector<std::complex<xsum_flt>> const &vec1,
+                   std::vector<std::complex<xsum_flt>> const &vec2) {
+  xsum_length const n = static_cast<xsum_length>(vec1.size());
+  if (n == 0 || n > static_cast<xsum_length>(vec2.size())) {
+    return;
+  }
+  xsum_add_dotc<accumulatorType>(acc_real, acc_imag, vec1.data(), vec2.data(),
+                                 n);
+}
 
-    /* See if we were actually supposed to update these chunks.  If not,
-       back out the changes and then process the chunks as they ought to
-       have been processed. */
+void xsum_small::add(xsum_small &imag, std::complex<xsum_flt> const *vec,
+                     xsum_length const n) {
+  xsum_add<xsum_small_accumulator>(_sacc.get(), imag.get(), vec, n);
+}
 
-    if (count1 < 0 || count2 < 0) {
-      lacc->count[ix2] = count2 + 1;
-      lacc->chunk[ix2] -= u2.uintv;
+void xsum_small::add(xsum_small &imag,
+                     std::vector<std::complex<xsum_flt>> const &vec) {
+  xsum_add<xsum_small_accumulator>(_sacc.get(), imag.get(), vec);
+}
 
-      if (count1 < 0) {
-        lacc->count[ix1] = count1 + 1;
-        lacc->chunk[ix1] -= u1.uintv;
-        xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix1, u1.uintv);
-        count2 = lacc->count[ix2] - 1;
-      }
+void xsum_small::add_sqnorm(std::complex<xsum_flt> const *vec,
+                            xsum_length const n) {
+  xsum_add_sqnorm<xsum_small_accumulator>(_sacc.get(), vec, n);
+}
 
-      if (count2 < 0) {
-        xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix2, u2.uintv);
-      } else {
-        lacc->count[ix2] = count2;
-        lacc->chunk[ix2] += u2.uintv;
-      }
-    }
-  }
+void xsum_small::add_sqnorm(std::vector<std::complex<xsum_flt>> const &vec) {
+  xsum_add_sqnorm<xsum_small_accumulator>(_sacc.get(), vec);
+}
 
-  /* Process the last one or two products, without pre-fetching. */
-  m += 3;
-  for (;;) {
-    u1.fltv = *v1 * *v2;
-    ++v1;
-    ++v2;
+void xsum_small::add_dot(xsum_small &imag, std::complex<xsum_flt> const *vec1,
+                         std::complex<xsum_flt> const *vec2,
+                         xsum_length const n) {
+  xsum_add_dot<xsum_small_accumulator>(_sacc.get(), imag.get(), vec1, vec2, n);
+}
 
-    ix1 = u1.uintv >> XSUM_MANTISSA_BITS;
-    count1 = lacc->count[ix1] - 1;
-    if (count1 < 0) {
-      xsum_add_value_inf_nan<xsum_large_accumulator>(lacc, ix1, u1.uintv);
-    } else {
-      lacc->count[ix1] = count1;
-      lacc->chunk[ix1] += u1.uintv;
-    }
+void xsum_small::add_dot(xsum_small &imag,
+                         std::vector<std::complex<xsum_flt>> const &vec1,
+                         std::vector<std::complex<xsum_flt>> const &vec2) {
+  xsum_add_dot<xsum_small_accumulator>(_sacc.get(), imag.get(), vec1, vec2);
+}
+
+void xsum_small::add_dotc(xsum_small &imag, std::complex<xsum_flt> const *vec1,
+                          std::complex<xsum_flt> const *vec2,
+                          xsum_length const n) {
+  xsum_add_dotc<xsum_small_accumulator>(_sacc.get(), imag.get(), vec1, vec2, n);
+}
 
-    --m;
-    if (m == 0) {
-      break;
-    }
-  }
+void xsum_small::add_dotc(xsum_small &imag,
+                          std::vector<std::complex<xsum_flt>> const &vec1,
+                          std::vector<std::complex<xsum_flt>> const &vec2) {
+  xsum_add_dotc<xsum_small_accumulator>(_sacc.get(), imag.get(), vec1, vec2);
 }
 
-template <>
-xsum_flt xsum_round<xsum_small_accumulator>(
-    xsum_small_accumulator *const sacc) {
-  fpunion u;
+void xsum_large::add(xsum_large &imag, std::complex<xsum_flt> const *vec,
+                     xsum_length const n) {
+  xsum_add<xsum_large_accumulator>(_lacc.get(), imag.get(), vec, n);
+}
 
-  /* See if we have a NaN from one of the numbers being a NaN, in which
-     case we return the NaN with largest payload. */
-  if (sacc->NaN != 0) {
-    u.intv = sacc->NaN;
-    return u.fltv;
-  }
+void xsum_large::add(xsum_large &imag,
+                     std::vector<std::complex<xsum_flt>> const &vec) {
+  xsum_add<xsum_large_accumulator>(_lacc.get(), imag.get(), vec);
+}
 
-  /* Otherwise, if any number was infinite, we return +Inf, -Inf, or a Nan
-     (if both +Inf and -Inf occurred).  Note that we do NOT return NaN if
-     we have both an infinite number and a sum of other numbers that
-     overflows with opposite sign, since there is no real ambiguity in
-     such a case. */
-  if (sacc->Inf != 0) {
-    u.intv = sacc->Inf;
-    return u.fltv;
-  }
+void xsum_large::add_sqnorm(std::complex<xsum_flt> const *vec,
+                            xsum_length const n) {
+  xsum_add_sqnorm<xsum_large_accumulator>(_lacc.get(), vec, n);
+}
 
-  /* If none of the numbers summed were infinite or NaN, we proceed to
-     propagate carries, as a preliminary to finding the magnitude of
-     the sum.  This also ensures that the sign of the result can be
-     determined from the uppermost non-zero chunk.
+void xsum_large::add_sqnorm(std::vector<std::complex<xsum_flt>> const &vec) {
+  xsum_add_sqnorm<xsum_large_accumulator>(_lacc.get(), vec);
+}
 
-     We also find the index, i, of this uppermost non-zero chunk, as
-     the value returned by xsum_carry_propagate, and set ivalue to
-     sacc->chunk[i].  Note that ivalue will not be 0 or -1, unless
-     i is 0 (the lowest chunk), in which case it will be handled by
-     the code for denormalized numbers. */
+void xsum_large::add_dot(xsum_large &imag, std::complex<xsum_flt> const *vec1,
+                         std::complex<xsum_flt> const *vec2,
+                         xsum_length const n) {
+  xsum_add_dot<xsum_large_accumulator>(_lacc.get(), imag.get(), vec1, vec2, n);
+}
 
-  int i = xsum_carry_propagate<xsum_small_accumulator>(sacc);
+void xsum_large::add_dot(xsum_large &imag,
+                         std::vector<std::complex<xsum_flt>> const &vec1,
+                         std::vector<std::complex<xsum_flt>> const &vec2) {
+  xsum_add_dot<xsum_large_accumulator>(_lacc.get(), imag.get(), vec1, vec2);
+}
 
-  xsum_int ivalue = sacc->chunk[i];
+void xsum_large::add_dotc(xsum_large &imag, std::complex<xsum_flt> const *vec1,
+                          std::complex<xsum_flt> const *vec2,
+                          xsum_length const n) {
+  xsum_add_dotc<xsum_large_accumulator>(_lacc.get(), imag.get(), vec1, vec2, n);
+}
 
-  /* Handle a possible denormalized number, including zero. */
-  if (i <= 1) {
-    /* Check for zero value, in which case we can return immediately. */
-    if (ivalue == 0) {
-      return 0.0;
-    }
+void xsum_large::add_dotc(xsum_large &imag,
+                          std::vector<std::complex<xsum_flt>> const &vec1,
+                          std::vector<std::complex<xsum_flt>> const &vec2) {
+  xsum_add_dotc<xsum_large_accumulator>(_lacc.get(), imag.get(), vec1, vec2);
+}
 
-    /* Check if it is actually a denormalized number.  It always is if only
-       the lowest chunk is non-zero.  If the highest non-zero chunk is the
-       next-to-lowest, we check the magnitude of the absolute value.
-       Note that the real exponent is 1 (not 0), so we need to shift right
-       by 1 here, which also means there will be no overflow from the left
-       shift below (but must view absolute value as unsigned). */
-    if (i == 0) {
-      u.intv = ivalue >= 0 ? ivalue : -ivalue;
-      u.intv >>= 1;
-      if (ivalue < 0) {
-        u.intv |= XSUM_SIGN_MASK;
-      }
-      return u.fltv;
-    }
-    /* Note: Left shift of -ve number is undefined, so do a multiply instead,
-       which is probably optimized to a shift. */
-    else {
-      u.intv =
-          ivalue * (static_cast<xsum_int>(1) << (XSUM_LOW_MANTISSA_BITS - 1)) +
-          (sacc->chunk[0] >> 1);
-      if (u.intv < 0) {
-        if (u.intv > -(static_cast<xsum_int>(1) << XSUM_MANTISSA_BITS)) {
-          u.intv = (-u.intv) | XSUM_SIGN_MASK;
-          return u.fltv;
-        }
-      } else {
-        if (u.uintv < static_cast<xsum_int>(1) << XSUM_MANTISSA_BITS) {
-          return u.fltv;
-        }
-      }
-      /* otherwise, it's not actually denormalized, so fall through to below */
-    }
-  }
+/* SIGNS AND COMPARISONS OF THE CLASSES */
 
-  /* Find the location of the uppermost 1 bit in the absolute value of the
-     upper chunk by converting it (as a signed integer) to a floating point
-     value, and looking at the exponent.  Then set 'more' to the number of
-     bits from the lower chunk (and maybe the next lower) that are needed
-     to fill out the mantissa of the result, plus an extra bit to help decide
-     on rounding.  For negative numbers, it may turn out later that we need
-     another bit because negating a negative value may carry out of the top
-     here, but not once more bits are shifted into the bottom later on. */
+int xsum_small::sign() { return xsum_sign<xsum_small_accumulator>(_sacc.get()); }
 
-  u.fltv = static_cast<xsum_flt>(ivalue);
-  int e = (u.uintv >> XSUM_MANTISSA_BITS) & XSUM_EXP_MASK;
-  int more = 1 + XSUM_MANTISSA_BITS + XSUM_EXP_BIAS - e;
+bool xsum_small::is_zero() {
+  return xsum_is_zero<xsum_small_accumulator>(_sacc.get());
+}
 
-  /* Change 'ivalue' to put in 'more' bits from lower chunks into the bottom.
-     Also set 'j' to the index of the lowest chunk from which these bits came,
-     and 'lower' to the remaining bits of that chunk not now in 'ivalue'.
-     We make sure that 'lower' initially has at least one bit in it, which
-     we can later move into 'ivalue' if it turns out that one more bit is
-     needed. */
+int xsum_small::compare(xsum_small &other) {
+  return xsum_compare<xsum_small_accumulator>(_sacc.get(), other.get());
+}
 
-  /* multiply, since << of negative undefined */
-  ivalue *= static_cast<xsum_int>(1) << more;
-  int j = i - 1;
-  /* must exist, since denormalized if i==0 */
-  xsum_schunk lower = sacc->chunk[j];
-  if (more >= XSUM_LOW_MANTISSA_BITS) {
-    more -= XSUM_LOW_MANTISSA_BITS;
-    ivalue += lower << more;
-    --j;
-    lower = j < 0 ? 0 : sacc->chunk[j];
-  }
+int xsum_large::sign() { return xsum_sign<xsum_large_accumulator>(_lacc.get()); }
 
-  ivalue += lower >> (XSUM_LOW_MANTISSA_BITS - more);
-  lower &= (static_cast<xsum_schunk>(1) << (XSUM_LOW_MANTISSA_BITS - more)) - 1;
+bool xsum_large::is_zero() {
+  return xsum_is_zero<xsum_large_accumulator>(_lacc.get());
+}
 
-  /* Check for a negative 'ivalue' that when negated doesn't contain a full
-     mantissa's worth of bits, plus one to help rounding.  If so, move one
-     more bit into 'ivalue' from 'lower' (and remove it from 'lower').
-     Note that more than one additional bit will not be required because
-     xsum_carry_propagate ensures the uppermost non-zero chunk is not -1. */
+int xsum_large::compare(xsum_large &other) {
+  return xsum_compare<xsum_large_accumulator>(_lacc.get(), other.get());
+}
 
-  if (ivalue < 0 && ((-ivalue) & (static_cast<xsum_int>(1)
-                                  << (XSUM_MANTISSA_BITS + 1))) == 0) {
-    int const pos = static_cast<xsum_schunk>(1)
-                    << (XSUM_LOW_MANTISSA_BITS - 1 - more);
-    /* note that left shift undefined if ivalue is negative */
-    ivalue *= 2;
-    if (lower & pos) {
-      ivalue |= 1;
-      lower &= ~pos;
-    }
-    --e;
-  }
+/* ARITHMETIC OF THE CLASSES */
 
-  /* Set u.intv to have just the correct sign bit (rest zeros), and 'ivalue'
-     to now have the absolute value of the mantissa. */
+void xsum_small::negate() { xsum_negate<xsum_small_accumulator>(_sacc.get()); }
 
-  if (ivalue >= 0) {
-    u.intv = 0;
-  } else {
-    ivalue = -ivalue;
-    u.intv = XSUM_SIGN_MASK;
-  }
+void xsum_small::sub(xsum_small_accumulator const *value) {
+  xsum_sub<xsum_small_accumulator>(_sacc.get(), value);
+}
 
-  if (xsum_debug && (ivalue >> (XSUM_MANTISSA_BITS + 1)) != 1) {
-    std::abort();
-  }
+void xsum_small::sub(xsum_small const &xvalue) {
+  xsum_sub<xsum_small_accumulator>(_sacc.get(), xvalue.get());
+}
 
-  /* Round to nearest, with ties to even. At this point, 'ivalue' has the
-     absolute value of the number to be rounded, including an extra bit at
-     the bottom.  Bits below that are in 'lower' and in the chunks
-     indexed by 'j' and below.  Note that the bits in 'lower' and the chunks
-     below add to the magnitude of the remainder if the number is positive,
-     but subtract from this magnitude if the number is negative.
+bool xsum_small::ldexp(int const exp) {
+  return xsum_ldexp<xsum_small_accumulator>(_sacc.get(), exp);
+}
 
-     This code goes to done_rounding if it finds that just discarding lower
-     order bits is correct, and to round_away_from_zero if instead the
-     magnitude should be increased by one in the lowest bit. */
+void xsum_large::negate() { xsum_negate<xsum_large_accumulator>(_lacc.get()); }
 
-  /* extra bit is 0 */
-  if ((ivalue & 1) == 0) {
-    goto done_rounding;
-  }
+void xsum_large::sub(xsum_small_accumulator const *value) {
+  xsum_sub<xsum_large_accumulator>(_lacc.get(), value);
+}
 
-  /* number is positive */
-  if (u.intv == 0) {
-    /* low bit 1 (odd) */
-    if ((ivalue & 2) != 0) {
-      goto round_away_from_zero;
-    }
-    if (lower != 0) {
-      goto round_away_from_zero;
-    }
-  }
-  /* number is negative */
-  else {
-    /* low bit 0 (even) */
-    if ((ivalue & 2) == 0) {
-      goto done_rounding;
-    }
-    if (lower != 0) {
-      goto done_rounding;
-    }
-  }
+void xsum_large::sub(xsum_large &value) {
+  xsum_sub<xsum_large_accumulator>(_lacc.get(), value.get());
+}
 
-  /* If we get here, 'lower' is zero.  We need to look at chunks lower down
-     to see if any are non-zero. */
-  while (j > 0) {
-    --j;
-    if (sacc->chunk[j] != 0) {
-      lower = 1;
-      break;
-    }
-  }
+bool xsum_large::ldexp(int const exp) {
+  return xsum_ldexp<xsum_large_accumulator>(_lacc.get(), exp);
+}
 
-  /* number is positive, low bit 0 (even) */
-  if (u.intv == 0) {
-    if (lower != 0) {
-      goto round_away_from_zero;
-    } else {
-      goto done_rounding;
-    }
-  }
-  /* number is negative, low bit 1 (odd) */
-  else {
-    if (lower != 0) {
-      goto done_rounding;
-    } else {
-      goto round_away_from_zero;
-    }
-  }
+xsum_small_accumulator xsum_small::snapshot() {
+  xsum_small_accumulator snap;
+  xsum_snapshot<xsum_small_accumulator>(_sacc.get(), &snap);
+  return snap;
+}
 
-round_away_from_zero:
+void xsum_small::rollback(xsum_small_accumulator const &snap) {
+  xsum_rollback<xsum_small_accumulator>(_sacc.get(), &snap);
+}
 
-  /* Round away from zero, then check for carry having propagated out the
-     top, and shift if so. */
-  ivalue += 2;
-  if (ivalue & (static_cast<xsum_int>(1) << (XSUM_MANTISSA_BITS + 2))) {
-    ivalue >>= 1;
-    ++e;
-  }
+xsum_small_accumulator xsum_large::snapshot() {
+  xsum_small_accumulator snap;
+  xsum_snapshot<xsum_large_accumulator>(_lacc.get(), &snap);
+  return snap;
+}
 
-done_rounding:;
+void xsum_large::rollback(xsum_small_accumulator const &snap) {
+  xsum_rollback<xsum_large_accumulator>(_lacc.get(), &snap);
+}
 
-  /* Get rid of the bottom bit that was used to decide on rounding. */
-  ivalue >>= 1;
+/* BUFFERED ACCUMULATOR */
 
-  /* Adjust to the true exponent, accounting for where this chunk is. */
-  e += (i << XSUM_LOW_EXP_BITS) - XSUM_EXP_BIAS - XSUM_MANTISSA_BITS;
+template <typename accumulatorType, int N>
+xsum_buffered<accumulatorType, N>::xsum_buffered()
+    : _n(0), _acc(new accumulatorType) {}
 
-  /* If exponent has overflowed, change to plus or minus Inf and return. */
-  if (e >= XSUM_EXP_MASK) {
-    u.intv |= static_cast<xsum_int>(XSUM_EXP_MASK) << XSUM_MANTISSA_BITS;
-    return u.fltv;
+template <typename accumulatorType, int N>
+void xsum_buffered<accumulatorType, N>::reset() {
+  _n = 0;
+  _acc.reset(new accumulatorType);
+}
+
+template <typename accumulatorType, int N>
+inline void xsum_buffered<accumulatorType, N>::add(xsum_flt const value) {
+  _buf[_n] = value;
+  if (++_n == N) {
+    flush();
   }
+}
 
-  /* Put exponent and mantissa into u.intv, which already has the sign,
-     then return u.fltv. */
-  u.intv += static_cast<xsum_int>(e) << XSUM_MANTISSA_BITS;
+template <typename accumulatorType, int N>
+void xsum_buffered<accumulatorType, N>::add(xsum_flt const *vec,
+                                            xsum_length const n) {
+  flush();
+  xsum_add<accumulatorType>(_acc.get(), vec, n);
+}
 
-  /* mask out the implicit 1 bit */
-  u.intv += ivalue & XSUM_MANTISSA_MASK;
+template <typename accumulatorType, int N>
+void xsum_buffered<accumulatorType, N>::add(std::vector<xsum_flt> const &vec) {
+  flush();
+  xsum_add<accumulatorType>(_acc.get(), vec);
+}
 
-  if (xsum_debug && (ivalue >> XSUM_MANTISSA_BITS) != 1) {
-    std::abort();
+template <typename accumulatorType, int N>
+void xsum_buffered<accumulatorType, N>::add(
+    xsum_small_accumulator const *const value) {
+  xsum_add<accumulatorType>(_acc.get(), value);
+}
+
+template <typename accumulatorType, int N>
+void xsum_buffered<accumulatorType, N>::flush() {
+  if (_n > 0) {
+    xsum_add<accumulatorType>(_acc.get(), _buf, _n);
+    _n = 0;
   }
+}
 
-  return u.fltv;
+template <typename accumulatorType, int N>
+xsum_flt xsum_buffered<accumulatorType, N>::round() {
+  flush();
+  return xsum_round<accumulatorType>(_acc.get());
 }
 
-template <>
-xsum_flt xsum_round<xsum_large_accumulator>(
-    xsum_large_accumulator *const lacc) {
-  return xsum_round<xsum_small_accumulator>(xsum_round_to_small_ptr(lacc));
+template <typename accumulatorType, int N>
+xsum_small_accumulator xsum_buffered<accumulatorType, N>::round_to_small() {
+  flush();
+  return xsum_round_to_small<accumulatorType>(_acc.get());
+}
+
+template <typename accumulatorType, int N>
+accumulatorType *xsum_buffered<accumulatorType, N>::get() {
+  flush();
+  return _acc.get();
 }
+
 }  // namespace xsum
 #endif  // XSUM_HPP